@@ -0,0 +1,551 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshGenerators.cpp
+// ============
+// procedural generators for the curved ShapeMeshes primitives:
+//     cone, cylinder, plane, sphere, tapered cylinder, torus
+//
+// The generators reproduce the conventions of the original vertex tables
+// so existing scenes keep their look:
+//   - round caps are a triangle fan from the first rim vertex, mapped
+//     onto the texture as a disc (u from z, v from x)
+//   - cylinder and cone sides are flat shaded, one normal per segment,
+//     and the cone normals stay horizontal like in the table
+//   - the sphere stores a seam column of duplicated vertices and scales
+//     u by the ring radius, so the poles do not pinch the texture
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGenerators.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+
+namespace
+{
+	constexpr double PI = glm::pi<double>();
+	constexpr double TWO_PI = glm::two_pi<double>();
+}
+
+///////////////////////////////////////////////////
+//	AddVertex()
+//
+//	Append one interleaved vertex to the mesh.
+//
+///////////////////////////////////////////////////
+GLuint MeshGenerators::AddVertex(
+	MESH_DATA& mesh,
+	float x, float y, float z,
+	float nx, float ny, float nz,
+	float u, float v)
+{
+	GLuint index = mesh.VertexCount();
+	const GLfloat vertex[FLOATS_PER_VERTEX] = { x, y, z, nx, ny, nz, u, v };
+	mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + FLOATS_PER_VERTEX);
+	return index;
+}
+
+///////////////////////////////////////////////////
+//	AddTriangle()
+//
+//	Append one triangle to the index list.
+//
+///////////////////////////////////////////////////
+void MeshGenerators::AddTriangle(
+	MESH_DATA& mesh,
+	GLuint a, GLuint b, GLuint c)
+{
+	mesh.indices.push_back(a);
+	mesh.indices.push_back(b);
+	mesh.indices.push_back(c);
+}
+
+///////////////////////////////////////////////////
+//	EndPart()
+//
+//	Record every index added since the previous part
+//	as the next drawable part of the mesh.
+///////////////////////////////////////////////////
+void MeshGenerators::EndPart(MESH_DATA& mesh)
+{
+	GLuint first = 0;
+	if (mesh.nParts > 0)
+	{
+		const MESH_PART& previous = mesh.parts[mesh.nParts - 1];
+		first = previous.firstIndex + previous.nIndices;
+	}
+
+	mesh.parts[mesh.nParts].firstIndex = first;
+	mesh.parts[mesh.nParts].nIndices = (GLuint)mesh.indices.size() - first;
+	mesh.nParts++;
+}
+
+///////////////////////////////////////////////////
+//	AddRoundCap()
+//
+//	Append a flat disc, fanned from the first rim
+//	vertex, facing along the passed normal.
+///////////////////////////////////////////////////
+void MeshGenerators::AddRoundCap(
+	MESH_DATA& mesh,
+	int segments,
+	float radius,
+	float height,
+	float normalY)
+{
+	GLuint first = mesh.VertexCount();
+	for (int i = 0; i < segments; i++)
+	{
+		double angle = TWO_PI * i / segments;
+		float c = (float)cos(angle);
+		float s = (float)sin(angle);
+
+		AddVertex(mesh,
+			radius * c, height, -radius * s,
+			0.0f, normalY, 0.0f,
+			0.5f - 0.5f * s, 0.5f + 0.5f * c);
+	}
+
+	for (int i = 1; i + 1 < segments; i++)
+	{
+		AddTriangle(mesh, first, first + i, first + i + 1);
+	}
+}
+
+///////////////////////////////////////////////////
+//	GeneratePlane()
+//
+//	Generate a flat 2x2 square on the XZ plane, split
+//	into divisions x divisions cells.
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GeneratePlane(
+	int divisions)
+{
+	MESH_DATA mesh;
+	if (divisions < 1)
+	{
+		divisions = 1;
+	}
+
+	for (int row = 0; row <= divisions; row++)
+	{
+		float v = (float)row / divisions;
+		for (int column = 0; column <= divisions; column++)
+		{
+			float u = (float)column / divisions;
+			AddVertex(mesh,
+				2.0f * u - 1.0f, 0.0f, 1.0f - 2.0f * v,
+				0.0f, 1.0f, 0.0f,
+				u, v);
+		}
+	}
+
+	const GLuint stride = divisions + 1;
+	for (int row = 0; row < divisions; row++)
+	{
+		for (int column = 0; column < divisions; column++)
+		{
+			GLuint a = row * stride + column;
+			GLuint b = a + 1;
+			GLuint c = a + stride + 1;
+			GLuint d = a + stride;
+			AddTriangle(mesh, a, b, c);
+			AddTriangle(mesh, a, d, c);
+		}
+	}
+	EndPart(mesh);
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////
+//	GenerateSphere()
+//
+//	Generate a unit sphere from its poles and
+//	rings - 1 latitude rings of segments vertices.
+//	The segment count is rounded up to an even
+//	number so the texture seam falls on a vertex.
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GenerateSphere(
+	int rings,
+	int segments)
+{
+	MESH_DATA mesh;
+	if (rings < 2)
+	{
+		rings = 2;
+	}
+	if (segments < 4)
+	{
+		segments = 4;
+	}
+	segments += segments % 2;
+
+	const int half = segments / 2;
+	const GLuint ringSize = segments + 1;
+
+	// top center point
+	const GLuint top = AddVertex(mesh, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.5f, 1.0f);
+
+	// each ring runs from +z around +x to the seam at -z, repeats
+	// the seam vertex for the other side of the texture, and comes
+	// back around -x
+	for (int ring = 1; ring < rings; ring++)
+	{
+		double polar = PI * ring / rings;
+		float radius = (float)sin(polar);
+		float y = (float)cos(polar);
+		float v = 1.0f - (float)ring / rings;
+
+		for (int i = 0; i <= segments; i++)
+		{
+			int segment = (i <= half) ? i : i - 1;
+			double angle = TWO_PI * segment / segments;
+			glm::vec3 position(radius * (float)sin(angle), y, radius * (float)cos(angle));
+			glm::vec3 normal = glm::normalize(position);
+
+			float u = (i <= half)
+				? 0.5f + radius * segment / segments
+				: 0.5f - radius * (segments - segment) / segments;
+
+			AddVertex(mesh,
+				position.x, position.y, position.z,
+				normal.x, normal.y, normal.z,
+				u, v);
+		}
+	}
+
+	// bottom center point
+	const GLuint bottom = AddVertex(mesh, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.5f, 0.0f);
+
+	// ring vertex of the n-th step around the ring, starting
+	// right after the seam
+	auto around = [half, segments, ringSize](int ring, int step)
+	{
+		int offset = (step < segments - half) ? half + 1 + step : step - (segments - half);
+		return (GLuint)(1 + (ring - 1) * ringSize + offset);
+	};
+
+	int upperIndices = 0;
+	for (int step = 0; step < segments; step++)
+	{
+		AddTriangle(mesh, top, around(1, step), around(1, step + 1));
+	}
+	for (int ring = 1; ring + 1 < rings; ring++)
+	{
+		if (ring == rings / 2)
+		{
+			upperIndices = (int)mesh.indices.size();
+		}
+		for (int step = 0; step < segments; step++)
+		{
+			GLuint a = around(ring, step);
+			GLuint b = around(ring, step + 1);
+			GLuint c = around(ring + 1, step);
+			GLuint d = around(ring + 1, step + 1);
+			AddTriangle(mesh, a, c, d);
+			AddTriangle(mesh, a, b, d);
+		}
+	}
+	for (int step = 0; step < segments; step++)
+	{
+		AddTriangle(mesh, around(rings - 1, step), bottom, around(rings - 1, step + 1));
+	}
+	EndPart(mesh);
+
+	// the upper hemisphere is every triangle above the equator ring
+	if (upperIndices == 0)
+	{
+		upperIndices = (int)mesh.indices.size() / 2;
+	}
+	mesh.parts[1].firstIndex = 0;
+	mesh.parts[1].nIndices = upperIndices;
+	mesh.nParts = 2;
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////
+//	GenerateCylinder()
+//
+//	Generate a unit cylinder standing on the XZ plane.
+//
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GenerateCylinder(
+	int segments)
+{
+	return GenerateTaperedCylinder(segments, 1.0f);
+}
+
+///////////////////////////////////////////////////
+//	GenerateTaperedCylinder()
+//
+//	Generate a cylinder of height 1 with a unit bottom
+//	and the passed top radius. The top edge of the
+//	sides samples the middle part of the texture in
+//	proportion to the top radius.
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GenerateTaperedCylinder(
+	int segments,
+	float topRadius)
+{
+	MESH_DATA mesh;
+	if (segments < 3)
+	{
+		segments = 3;
+	}
+
+	AddRoundCap(mesh, segments, 1.0f, 0.0f, -1.0f);
+	EndPart(mesh);
+
+	AddRoundCap(mesh, segments, topRadius, 1.0f, 1.0f);
+	EndPart(mesh);
+
+	const float topU = 0.5f - 0.5f * topRadius;
+	for (int i = 0; i < segments; i++)
+	{
+		double angle0 = TWO_PI * i / segments;
+		double angle1 = TWO_PI * (i + 1) / segments;
+		double middle = (angle0 + angle1) * 0.5;
+		float c0 = (float)cos(angle0), s0 = (float)sin(angle0);
+		float c1 = (float)cos(angle1), s1 = (float)sin(angle1);
+		float u0 = (float)i / segments;
+		float u1 = (float)(i + 1) / segments;
+
+		// one flat normal per segment, tilted by the taper
+		glm::vec3 normal = glm::normalize(glm::vec3(
+			(float)cos(middle), 1.0f - topRadius, -(float)sin(middle)));
+
+		GLuint top0 = AddVertex(mesh,
+			topRadius * c0, 1.0f, -topRadius * s0,
+			normal.x, normal.y, normal.z,
+			topU + topRadius * u0, 1.0f);
+		GLuint bottom0 = AddVertex(mesh,
+			c0, 0.0f, -s0,
+			normal.x, normal.y, normal.z,
+			u0, 0.0f);
+		GLuint bottom1 = AddVertex(mesh,
+			c1, 0.0f, -s1,
+			normal.x, normal.y, normal.z,
+			u1, 0.0f);
+		GLuint top1 = AddVertex(mesh,
+			topRadius * c1, 1.0f, -topRadius * s1,
+			normal.x, normal.y, normal.z,
+			topU + topRadius * u1, 1.0f);
+
+		AddTriangle(mesh, top0, bottom0, bottom1);
+		AddTriangle(mesh, bottom1, top0, top1);
+	}
+	EndPart(mesh);
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////
+//	GenerateCone()
+//
+//	Generate a cone of height 1 on a unit disc. The
+//	sides map onto the texture as a disc seen from
+//	above, u from x and v from -z, with the tip in
+//	the middle.
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GenerateCone(
+	int segments)
+{
+	MESH_DATA mesh;
+	if (segments < 3)
+	{
+		segments = 3;
+	}
+
+	AddRoundCap(mesh, segments, 1.0f, 0.0f, -1.0f);
+	EndPart(mesh);
+
+	for (int i = 0; i < segments; i++)
+	{
+		double angle0 = TWO_PI * i / segments;
+		double angle1 = TWO_PI * (i + 1) / segments;
+		double middle = (angle0 + angle1) * 0.5;
+		float c0 = (float)cos(angle0), s0 = (float)sin(angle0);
+		float c1 = (float)cos(angle1), s1 = (float)sin(angle1);
+		float nx = (float)cos(middle);
+		float nz = -(float)sin(middle);
+
+		GLuint bottom0 = AddVertex(mesh,
+			c0, 0.0f, -s0,
+			nx, 0.0f, nz,
+			0.5f + 0.5f * c0, 0.5f + 0.5f * s0);
+		GLuint tip = AddVertex(mesh,
+			0.0f, 1.0f, 0.0f,
+			nx, 0.0f, nz,
+			0.5f, 0.5f);
+		GLuint bottom1 = AddVertex(mesh,
+			c1, 0.0f, -s1,
+			nx, 0.0f, nz,
+			0.5f + 0.5f * c1, 0.5f + 0.5f * s1);
+
+		AddTriangle(mesh, bottom0, tip, bottom1);
+	}
+	EndPart(mesh);
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////
+//	GenerateTorus()
+//
+//	Generate a torus around the Z axis with a main
+//	radius of 1. Vertices are shared between the
+//	quads, with a duplicated seam row and column for
+//	the texture coordinates, and the normals point
+//	away from the center of the tube.
+///////////////////////////////////////////////////
+MeshGenerators::MESH_DATA MeshGenerators::GenerateTorus(
+	int mainSegments,
+	int tubeSegments,
+	float tubeRadius)
+{
+	MESH_DATA mesh;
+	if (mainSegments < 3)
+	{
+		mainSegments = 3;
+	}
+	if (tubeSegments < 3)
+	{
+		tubeSegments = 3;
+	}
+
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		double mainAngle = TWO_PI * i / mainSegments;
+		float cosMain = (float)cos(mainAngle);
+		float sinMain = (float)sin(mainAngle);
+
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			double tubeAngle = TWO_PI * j / tubeSegments;
+			float cosTube = (float)cos(tubeAngle);
+			float sinTube = (float)sin(tubeAngle);
+			float ringRadius = 1.0f + tubeRadius * cosTube;
+
+			AddVertex(mesh,
+				ringRadius * cosMain, ringRadius * sinMain, tubeRadius * sinTube,
+				cosTube * cosMain, cosTube * sinMain, sinTube,
+				(float)i / mainSegments, (float)j / tubeSegments);
+		}
+	}
+
+	const GLuint stride = tubeSegments + 1;
+	int halfIndices = 0;
+	for (int i = 0; i < mainSegments; i++)
+	{
+		if (i == mainSegments / 2)
+		{
+			halfIndices = (int)mesh.indices.size();
+		}
+		for (int j = 0; j < tubeSegments; j++)
+		{
+			GLuint a = i * stride + j;
+			GLuint b = a + 1;
+			GLuint c = a + stride + 1;
+			GLuint d = a + stride;
+			AddTriangle(mesh, a, b, c);
+			AddTriangle(mesh, a, d, c);
+		}
+	}
+	EndPart(mesh);
+
+	mesh.parts[1].firstIndex = 0;
+	mesh.parts[1].nIndices = halfIndices;
+	mesh.nParts = 2;
+
+	return mesh;
+}
+
+///////////////////////////////////////////////////
+//	GenerateTangents()
+//
+//	Accumulate the UV tangent of every triangle at its
+//	corners, weighted by the corner angle and projected
+//	onto the plane of the vertex normal, as MikkTSpace
+//	does. The generators already split vertices along
+//	UV seams, so vertices are not split again where the
+//	handedness flips. Vertices without UV area, such as
+//	a cone apex, get any tangent orthogonal to the normal.
+///////////////////////////////////////////////////
+std::vector<GLfloat> MeshGenerators::GenerateTangents(
+	const MESH_DATA& mesh)
+{
+	const GLuint nVertices = mesh.VertexCount();
+	std::vector<glm::vec3> tangentSums(nVertices, glm::vec3(0.0f));
+	std::vector<glm::vec3> bitangentSums(nVertices, glm::vec3(0.0f));
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		glm::vec3 positions[3];
+		glm::vec3 normals[3];
+		glm::vec2 uvs[3];
+		for (int k = 0; k < 3; k++)
+		{
+			const GLfloat* vertex = &mesh.vertices[mesh.indices[i + k] * FLOATS_PER_VERTEX];
+			positions[k] = glm::make_vec3(vertex);
+			normals[k] = glm::make_vec3(vertex + 3);
+			uvs[k] = glm::make_vec2(vertex + 6);
+		}
+
+		glm::vec3 edge1 = positions[1] - positions[0];
+		glm::vec3 edge2 = positions[2] - positions[0];
+		glm::vec2 deltaUV1 = uvs[1] - uvs[0];
+		glm::vec2 deltaUV2 = uvs[2] - uvs[0];
+		float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+		if (fabsf(determinant) < 1e-12f)
+		{
+			continue;
+		}
+		glm::vec3 tangent = (edge1 * deltaUV2.y - edge2 * deltaUV1.y) / determinant;
+		glm::vec3 bitangent = (edge2 * deltaUV1.x - edge1 * deltaUV2.x) / determinant;
+
+		for (int k = 0; k < 3; k++)
+		{
+			glm::vec3 side1 = positions[(k + 1) % 3] - positions[k];
+			glm::vec3 side2 = positions[(k + 2) % 3] - positions[k];
+			float lengths = glm::length(side1) * glm::length(side2);
+			if (lengths <= 0.0f)
+			{
+				continue;
+			}
+			float angle = acosf(glm::clamp(glm::dot(side1, side2) / lengths, -1.0f, 1.0f));
+
+			glm::vec3 normal = normals[k];
+			glm::vec3 projected = tangent - normal * glm::dot(normal, tangent);
+			float projectedLength = glm::length(projected);
+			if (projectedLength > 0.0f)
+			{
+				tangentSums[mesh.indices[i + k]] += projected * (angle / projectedLength);
+			}
+			bitangentSums[mesh.indices[i + k]] += bitangent * angle;
+		}
+	}
+
+	std::vector<GLfloat> tangents;
+	tangents.reserve(nVertices * FLOATS_PER_TANGENT);
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		glm::vec3 normal = glm::normalize(glm::make_vec3(&mesh.vertices[v * FLOATS_PER_VERTEX + 3]));
+		glm::vec3 tangent = tangentSums[v] - normal * glm::dot(normal, tangentSums[v]);
+		if (glm::length(tangent) < 1e-6f)
+		{
+			glm::vec3 axis = (fabsf(normal.y) < 0.99f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+			tangent = glm::cross(axis, normal);
+		}
+		tangent = glm::normalize(tangent);
+		float handedness = (glm::dot(glm::cross(normal, tangent), bitangentSums[v]) < 0.0f) ? -1.0f : 1.0f;
+
+		tangents.push_back(tangent.x);
+		tangents.push_back(tangent.y);
+		tangents.push_back(tangent.z);
+		tangents.push_back(handedness);
+	}
+	return tangents;
+}
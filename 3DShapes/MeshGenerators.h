@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshGenerators.h
+// ============
+// procedural generators for the curved ShapeMeshes primitives:
+//     cone, cylinder, plane, sphere, tapered cylinder, torus
+//
+// Every generator takes its segment / ring counts as parameters and emits
+// an indexed triangle list in the interleaved layout that
+// ShapeMeshes::SetShaderMemoryLayout() expects: position (3), normal (3)
+// and texture coordinates (2). At the default counts the output matches
+// the vertex tables the primitives used to be typed in as.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshGenerators
+ *
+ *  This class contains the code for generating the vertex
+ *  and index data of the curved 3D shapes at any resolution
+ ***********************************************************/
+class MeshGenerators
+{
+public:
+	// number of floats of one interleaved vertex
+	static const int FLOATS_PER_VERTEX = 8;
+
+	// number of floats of one tangent: direction (3) and the
+	// handedness of the bitangent (1)
+	static const int FLOATS_PER_TANGENT = 4;
+
+	// largest number of separately drawable parts of a mesh
+	static const int MAX_PARTS = 3;
+
+	// a drawable part of a generated mesh, as a range
+	// of the index list
+	struct MESH_PART
+	{
+		GLuint firstIndex;
+		GLuint nIndices;
+	};
+
+	// generated vertex and index data
+	struct MESH_DATA
+	{
+		std::vector<GLfloat> vertices;	// interleaved pos / normal / uv
+		std::vector<GLuint> indices;	// triangle list
+		int nParts = 0;
+		MESH_PART parts[MAX_PARTS] = {};
+
+		GLuint VertexCount() const { return (GLuint)(vertices.size() / FLOATS_PER_VERTEX); }
+		GLuint TriangleCount() const { return (GLuint)(indices.size() / 3); }
+	};
+
+	// default resolutions of the primitives
+	static const int DEFAULT_ROUND_SEGMENTS = 36;
+	static const int DEFAULT_SPHERE_RINGS = 16;
+	static const int DEFAULT_SPHERE_SEGMENTS = 16;
+	static const int DEFAULT_TORUS_SEGMENTS = 30;
+
+	// parts: 0 = whole square
+	static MESH_DATA GeneratePlane(
+		int divisions = 1);
+
+	// parts: 0 = whole sphere, 1 = upper hemisphere
+	static MESH_DATA GenerateSphere(
+		int rings = DEFAULT_SPHERE_RINGS,
+		int segments = DEFAULT_SPHERE_SEGMENTS);
+
+	// parts: 0 = bottom, 1 = top, 2 = sides
+	static MESH_DATA GenerateCylinder(
+		int segments = DEFAULT_ROUND_SEGMENTS);
+	static MESH_DATA GenerateTaperedCylinder(
+		int segments = DEFAULT_ROUND_SEGMENTS,
+		float topRadius = 0.5f);
+
+	// parts: 0 = bottom, 1 = sides
+	static MESH_DATA GenerateCone(
+		int segments = DEFAULT_ROUND_SEGMENTS);
+
+	// parts: 0 = whole torus, 1 = half torus
+	static MESH_DATA GenerateTorus(
+		int mainSegments = DEFAULT_TORUS_SEGMENTS,
+		int tubeSegments = DEFAULT_TORUS_SEGMENTS,
+		float tubeRadius = 0.2f);
+
+	// per-vertex tangents of any mesh, one FLOATS_PER_TANGENT
+	// entry per vertex, following the MikkTSpace conventions:
+	// the tangent points along +u, is orthogonal to the vertex
+	// normal, and the bitangent is w * cross(normal, tangent)
+	static std::vector<GLfloat> GenerateTangents(
+		const MESH_DATA& mesh);
+
+private:
+	// append one interleaved vertex, returning its index
+	static GLuint AddVertex(
+		MESH_DATA& mesh,
+		float x, float y, float z,
+		float nx, float ny, float nz,
+		float u, float v);
+
+	// append a triangle
+	static void AddTriangle(
+		MESH_DATA& mesh,
+		GLuint a, GLuint b, GLuint c);
+
+	// close the current part at the end of the index list
+	static void EndPart(MESH_DATA& mesh);
+
+	// append a flat round cap at the given height
+	static void AddRoundCap(
+		MESH_DATA& mesh,
+		int segments,
+		float radius,
+		float height,
+		float normalY);
+};
@@ -0,0 +1,563 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshOptimizer.cpp
+// ============
+// reorders indexed meshes for the GPU vertex cache, overdraw and fetch
+//
+// Cache scoring follows Forsyth's reference values: the three vertices of
+// the last triangle get a fixed score so the next triangle does not simply
+// reuse them, older cache entries decay with their position, and vertices
+// with few remaining triangles get a boost so they are finished off
+// instead of being left behind as isolated triangles.
+//
+// The overdraw clusters follow Sander et al., "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw": the cache order is cut wherever a
+// triangle misses on all three vertices, and cut again wherever the ACMR
+// of the cluster so far is within the threshold of the whole range.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	const float g_CacheDecayPower = 1.5f;
+	const float g_LastTriangleScore = 0.75f;
+	const float g_ValenceBoostScale = 2.0f;
+	const float g_ValenceBoostPower = 0.5f;
+
+	///////////////////////////////////////////////////
+	//	VertexScore()
+	//
+	//	Score of a vertex at the passed cache position,
+	//	or -1 when it is not cached, that is still used
+	//	by the passed number of unemitted triangles.
+	///////////////////////////////////////////////////
+	float VertexScore(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			// no triangle needs the vertex any more
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				score = g_LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / (MeshOptimizer::CACHE_SIZE - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, g_CacheDecayPower);
+			}
+		}
+
+		score += g_ValenceBoostScale * powf((float)remainingTriangles, -g_ValenceBoostPower);
+		return score;
+	}
+
+	///////////////////////////////////////////////////
+	//	PartBoundaries()
+	//
+	//	Sorted index offsets where a part of the mesh
+	//	starts or ends. Optimising each stretch between
+	//	two of them on its own keeps every part, even
+	//	overlapping ones, a contiguous index range.
+	///////////////////////////////////////////////////
+	std::vector<GLuint> PartBoundaries(const MeshGenerators::MESH_DATA& mesh)
+	{
+		std::vector<GLuint> boundaries;
+		boundaries.push_back(0);
+		boundaries.push_back((GLuint)mesh.indices.size());
+		for (int i = 0; i < mesh.nParts; i++)
+		{
+			boundaries.push_back(mesh.parts[i].firstIndex);
+			boundaries.push_back(mesh.parts[i].firstIndex + mesh.parts[i].nIndices);
+		}
+		std::sort(boundaries.begin(), boundaries.end());
+		boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+		return boundaries;
+	}
+
+	///////////////////////////////////////////////////
+	//	Position()
+	//
+	//	Position of a vertex of an interleaved list.
+	///////////////////////////////////////////////////
+	glm::vec3 Position(const GLfloat* vertices, GLuint index)
+	{
+		const GLfloat* vertex = vertices + (size_t)index * MeshGenerators::FLOATS_PER_VERTEX;
+		return glm::vec3(vertex[0], vertex[1], vertex[2]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	OptimizeMesh()
+//
+//	Reorder the triangles of every stretch of the
+//	mesh for the vertex cache and then for overdraw,
+//	keeping the original order if that was already
+//	better for the cache, and renumber the vertices
+//	for fetching.
+///////////////////////////////////////////////////
+MeshOptimizer::OPTIMIZE_STATS MeshOptimizer::OptimizeMesh(
+	MeshGenerators::MESH_DATA& mesh,
+	bool bReorderTriangles)
+{
+	OPTIMIZE_STATS stats;
+	const size_t vertexCount = mesh.VertexCount();
+	stats.before = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+	if (bReorderTriangles)
+	{
+		std::vector<GLuint> original = mesh.indices;
+		std::vector<GLuint> boundaries = PartBoundaries(mesh);
+		for (size_t i = 0; i + 1 < boundaries.size(); i++)
+		{
+			GLuint* indices = mesh.indices.data() + boundaries[i];
+			size_t indexCount = boundaries[i + 1] - boundaries[i];
+			OptimizeVertexCache(indices, indexCount, vertexCount);
+			OptimizeOverdraw(indices, indexCount, mesh.vertices.data(), vertexCount);
+		}
+
+		// fans, short strips and small grids are often
+		// already in the best order for the cache
+		if (AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount).acmr >
+			stats.before.acmr)
+		{
+			mesh.indices.swap(original);
+		}
+	}
+
+	OptimizeVertexFetch(mesh);
+
+	stats.after = AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount);
+	return stats;
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexCache()
+//
+//	Reorder the triangles of the passed index range
+//	so consecutive triangles share cached vertices.
+//	The vertices themselves are not moved.
+///////////////////////////////////////////////////
+void MeshOptimizer::OptimizeVertexCache(
+	GLuint* indices,
+	size_t indexCount,
+	size_t vertexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+	{
+		return;
+	}
+
+	// triangles using each vertex, packed into one array
+	std::vector<int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+	}
+
+	std::vector<size_t> adjacency(triangleCount * 3);
+	std::vector<size_t> adjacencyFill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			adjacency[adjacencyFill[indices[t * 3 + k]]++] = t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]]
+			+ vertexScore[indices[t * 3 + 1]]
+			+ vertexScore[indices[t * 3 + 2]];
+	}
+
+	// the cache holds three extra slots for the vertices
+	// of the triangle being added before it is trimmed
+	std::vector<GLuint> cache;
+	std::vector<GLuint> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	std::vector<GLuint> output(triangleCount * 3);
+	size_t outputTriangles = 0;
+	size_t scanPosition = 0;
+	size_t bestTriangle = triangleCount;
+
+	while (outputTriangles < triangleCount)
+	{
+		// nothing in the cache scores - take the best
+		// remaining triangle of the whole mesh
+		if (bestTriangle == triangleCount)
+		{
+			float bestScore = -1.0f;
+			while (scanPosition < triangleCount && emitted[scanPosition])
+			{
+				scanPosition++;
+			}
+			for (size_t t = scanPosition; t < triangleCount; t++)
+			{
+				if (!emitted[t] && triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		const GLuint* triangle = &indices[bestTriangle * 3];
+		output[outputTriangles * 3] = triangle[0];
+		output[outputTriangles * 3 + 1] = triangle[1];
+		output[outputTriangles * 3 + 2] = triangle[2];
+		outputTriangles++;
+		emitted[bestTriangle] = true;
+
+		// the vertices of the emitted triangle go to the
+		// front of the cache and no longer count it
+		newCache.clear();
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = triangle[k];
+			newCache.push_back(v);
+
+			size_t* first = &adjacency[adjacencyStart[v]];
+			size_t* last = first + remaining[v];
+			size_t* found = std::find(first, last, bestTriangle);
+			std::iter_swap(found, last - 1);
+			remaining[v]--;
+		}
+		for (GLuint v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// rescore the vertices that moved in the cache and
+		// the triangles that use them
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			GLuint v = newCache[i];
+			cachePosition[v] = (i < (size_t)CACHE_SIZE) ? (int)i : -1;
+
+			float score = VertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (int n = 0; n < remaining[v]; n++)
+			{
+				triangleScore[adjacency[adjacencyStart[v] + n]] += delta;
+			}
+		}
+
+		if (newCache.size() > (size_t)CACHE_SIZE)
+		{
+			newCache.resize(CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		// the next triangle is the best one touching the cache
+		bestTriangle = triangleCount;
+		float bestScore = -1.0f;
+		for (GLuint v : cache)
+		{
+			for (int n = 0; n < remaining[v]; n++)
+			{
+				size_t t = adjacency[adjacencyStart[v] + n];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexCache()
+//
+//	Reorder the triangles of a mesh, one stretch
+//	between part boundaries at a time.
+///////////////////////////////////////////////////
+void MeshOptimizer::OptimizeVertexCache(
+	MeshGenerators::MESH_DATA& mesh)
+{
+	std::vector<GLuint> boundaries = PartBoundaries(mesh);
+	for (size_t i = 0; i + 1 < boundaries.size(); i++)
+	{
+		OptimizeVertexCache(
+			mesh.indices.data() + boundaries[i],
+			boundaries[i + 1] - boundaries[i],
+			mesh.VertexCount());
+	}
+}
+
+///////////////////////////////////////////////////
+//	OptimizeOverdraw()
+//
+//	Cut the cache-ordered triangles into clusters
+//	and draw the clusters in order of how far they
+//	face away from the center of the range, so the
+//	outer surfaces are drawn before the inner ones.
+///////////////////////////////////////////////////
+void MeshOptimizer::OptimizeOverdraw(
+	GLuint* indices,
+	size_t indexCount,
+	const GLfloat* vertices,
+	size_t vertexCount,
+	float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+	{
+		return;
+	}
+
+	// hard cluster starts: triangles that share nothing
+	// with the cache, where the cache order restarted
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = ANALYZE_CACHE_SIZE + 1;
+	size_t totalMisses = 0;
+	std::vector<size_t> hardStarts;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			if (time - timestamps[v] > (size_t)ANALYZE_CACHE_SIZE)
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3)
+		{
+			hardStarts.push_back(t);
+		}
+		totalMisses += misses;
+	}
+	hardStarts.push_back(triangleCount);
+
+	// soft cluster starts: wherever the cluster so far
+	// reuses the cache about as well as the whole range
+	const float acmrLimit = threshold * (float)totalMisses / (float)triangleCount;
+	std::vector<size_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		time += ANALYZE_CACHE_SIZE + 1;
+		size_t clusterStart = hardStarts[h];
+		size_t clusterMisses = 0;
+		clusterStarts.push_back(clusterStart);
+
+		for (size_t t = hardStarts[h]; t < hardStarts[h + 1]; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint v = indices[t * 3 + k];
+				if (time - timestamps[v] > (size_t)ANALYZE_CACHE_SIZE)
+				{
+					timestamps[v] = time++;
+					clusterMisses++;
+				}
+			}
+
+			size_t clusterTriangles = t + 1 - clusterStart;
+			if (t + 1 < hardStarts[h + 1] &&
+				(float)clusterMisses <= acmrLimit * (float)clusterTriangles)
+			{
+				// the next cluster starts with an empty cache
+				time += ANALYZE_CACHE_SIZE + 1;
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				clusterStarts.push_back(clusterStart);
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// area weighted centroid and normal of each cluster
+	const size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	std::vector<float> areas(clusterCount, 0.0f);
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			glm::vec3 p0 = Position(vertices, indices[t * 3]);
+			glm::vec3 p1 = Position(vertices, indices[t * 3 + 1]);
+			glm::vec3 p2 = Position(vertices, indices[t * 3 + 2]);
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += normal;
+			areas[c] += area;
+		}
+
+		meshCentroid += centroids[c];
+		meshArea += areas[c];
+		if (areas[c] > 0.0f)
+		{
+			centroids[c] /= areas[c];
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float normalLength = glm::length(normals[c]);
+		if (normalLength > 0.0f)
+		{
+			sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normals[c] / normalLength);
+		}
+	}
+
+	std::vector<size_t> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		clusterOrder[c] = c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+		[&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<GLuint> output;
+	output.reserve(triangleCount * 3);
+	for (size_t c : clusterOrder)
+	{
+		output.insert(output.end(),
+			indices + clusterStarts[c] * 3,
+			indices + clusterStarts[c + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexFetch()
+//
+//	Renumber the vertices of a mesh in the order the
+//	index list first uses them. Vertices no triangle
+//	uses are moved to the end.
+///////////////////////////////////////////////////
+void MeshOptimizer::OptimizeVertexFetch(
+	MeshGenerators::MESH_DATA& mesh)
+{
+	const GLuint vertexCount = mesh.VertexCount();
+	const GLuint unused = 0xFFFFFFFFu;
+
+	std::vector<GLuint> remap(vertexCount, unused);
+	GLuint next = 0;
+	for (GLuint& index : mesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	for (GLuint v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] == unused)
+		{
+			remap[v] = next++;
+		}
+	}
+
+	const int stride = MeshGenerators::FLOATS_PER_VERTEX;
+	std::vector<GLfloat> vertices(mesh.vertices.size());
+	for (GLuint v = 0; v < vertexCount; v++)
+	{
+		std::copy(
+			mesh.vertices.begin() + (size_t)v * stride,
+			mesh.vertices.begin() + (size_t)(v + 1) * stride,
+			vertices.begin() + (size_t)remap[v] * stride);
+	}
+	mesh.vertices.swap(vertices);
+}
+
+///////////////////////////////////////////////////
+//	AnalyzeVertexCache()
+//
+//	Count the vertex shader runs of an index list
+//	with a FIFO cache of the passed size.
+///////////////////////////////////////////////////
+MeshOptimizer::CACHE_STATS MeshOptimizer::AnalyzeVertexCache(
+	const GLuint* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	int cacheSize)
+{
+	CACHE_STATS stats;
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	// a vertex is cached while fewer than cacheSize
+	// misses happened since it was loaded
+	std::vector<size_t> timestamps(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	size_t time = (size_t)cacheSize + 1;
+	size_t misses = 0;
+	size_t usedVertices = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		GLuint v = indices[i];
+		if (time - timestamps[v] > (size_t)cacheSize)
+		{
+			timestamps[v] = time++;
+			misses++;
+		}
+		if (!used[v])
+		{
+			used[v] = true;
+			usedVertices++;
+		}
+	}
+
+	stats.acmr = (float)misses / (float)triangleCount;
+	stats.atvr = (float)misses / (float)usedVertices;
+	return stats;
+}
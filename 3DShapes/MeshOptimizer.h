@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshOptimizer.h
+// ============
+// reorders indexed meshes for the GPU vertex cache, overdraw and fetch
+//
+// The post-transform cache keeps the shaded results of the last few
+// vertices. Drawing triangles that reuse recently shaded vertices back to
+// back lets the GPU skip running the vertex shader for them again. The
+// cache optimiser is a greedy one after Tom Forsyth's "Linear-Speed Vertex
+// Cache Optimisation": it scores vertices by their position in a simulated
+// LRU cache and by how many triangles still use them, and always emits
+// the highest scoring triangle next.
+//
+// The overdraw pass then cuts the cache-ordered triangles into clusters
+// and draws the clusters facing away from the mesh center first, so the
+// outside of a shape tends to fill the depth buffer before the inside.
+// The fetch pass finally renumbers the vertices in the order the indices
+// first use them, so vertex reads walk through memory.
+//
+// ACMR is the average number of vertex shader runs per triangle and ATVR
+// the average per vertex, both from a simulated FIFO cache. An ATVR of 1
+// means every vertex is shaded exactly once.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "MeshGenerators.h"
+
+#include <cstddef>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class contains the code for reordering indexed
+ *  meshes so they draw faster, and for measuring them
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// number of vertices the optimiser's LRU cache holds
+	static const int CACHE_SIZE = 32;
+
+	// number of vertices of the FIFO cache used to measure meshes
+	static const int ANALYZE_CACHE_SIZE = 16;
+
+	// how much worse than the cache order the overdraw order may
+	// make the ACMR of a mesh
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	// vertex cache efficiency of an index list
+	struct CACHE_STATS
+	{
+		float acmr = 0.0f;	// vertex shader runs per triangle
+		float atvr = 0.0f;	// vertex shader runs per vertex
+	};
+
+	// efficiency of a mesh before and after OptimizeMesh()
+	struct OPTIMIZE_STATS
+	{
+		CACHE_STATS before;
+		CACHE_STATS after;
+	};
+
+	// run every pass over a mesh, keeping each drawable part a
+	// contiguous range of the index list; the triangles of a part
+	// only keep their order when bReorderTriangles is false
+	static OPTIMIZE_STATS OptimizeMesh(
+		MeshGenerators::MESH_DATA& mesh,
+		bool bReorderTriangles = true);
+
+	// reorder the triangles of one index range in place; the
+	// indices must be smaller than vertexCount
+	static void OptimizeVertexCache(
+		GLuint* indices,
+		size_t indexCount,
+		size_t vertexCount);
+
+	// reorder the triangles of every part of a mesh
+	static void OptimizeVertexCache(
+		MeshGenerators::MESH_DATA& mesh);
+
+	// reorder clusters of cache-ordered triangles of one index
+	// range so outward facing clusters are drawn first
+	static void OptimizeOverdraw(
+		GLuint* indices,
+		size_t indexCount,
+		const GLfloat* vertices,
+		size_t vertexCount,
+		float threshold = OVERDRAW_THRESHOLD);
+
+	// renumber the vertices of a mesh in order of first use
+	static void OptimizeVertexFetch(
+		MeshGenerators::MESH_DATA& mesh);
+
+	// simulate a FIFO vertex cache over an index list
+	static CACHE_STATS AnalyzeVertexCache(
+		const GLuint* indices,
+		size_t indexCount,
+		size_t vertexCount,
+		int cacheSize = ANALYZE_CACHE_SIZE);
+};
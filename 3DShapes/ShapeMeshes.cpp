@@ -9,13 +9,19 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ShapeMeshes.h"
+#include "GLStateCache.h"
+#include "StreamRingBuffer.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <vector>
 
 namespace
@@ -30,11 +36,89 @@ namespace
 	const GLuint g_FloatsPerVertex = 3;	// Number of coordinates per vertex
 	const GLuint g_FloatsPerNormal = 3;	// Number of values per vertex color
 	const GLuint g_FloatsPerUV = 2;		// Number of texture coordinate values
+
+	// detail of each level of detail relative to the full mesh
+	const float g_LodDetail[ShapeMeshes::MAX_LOD_LEVELS] = { 1.0f, 0.66f, 0.4f, 0.25f };
+
+	// smallest screen height, in pixels, each level of detail
+	// is used for - the last level takes everything smaller
+	const float g_LodMinSize[ShapeMeshes::MAX_LOD_LEVELS] = { 160.0f, 64.0f, 24.0f, 0.0f };
+
+	// attribute locations the vertex shader reads the position
+	// decode from; they are left disabled, so every vertex sees
+	// the constant value set with glVertexAttrib
+	const GLuint g_DecodeScaleLocation = 14;
+	const GLuint g_DecodeOffsetLocation = 15;
+
+	// attribute location of the optional tangent stream
+	const GLuint g_TangentLocation = 3;
+
+	// attribute location of the per-draw record index read by
+	// the indirect vertex shader
+	const GLuint g_DrawIndexLocation = 4;
+
+	///////////////////////////////////////////////////
+	//	EncodeOctahedral()
+	//
+	//	Map a unit normal onto the octahedron folded
+	//	into the [-1, 1] square.
+	///////////////////////////////////////////////////
+	glm::vec2 EncodeOctahedral(glm::vec3 n)
+	{
+		n /= (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f)
+		{
+			e.x = (1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			e.y = (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return e;
+	}
+
+	///////////////////////////////////////////////////
+	//	DecodeOctahedral()
+	//
+	//	Unfold an octahedral encoded normal, as the
+	//	vertex shader does.
+	///////////////////////////////////////////////////
+	glm::vec3 DecodeOctahedral(glm::vec2 e)
+	{
+		glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+		float t = std::max(-n.z, 0.0f);
+		n.x += (n.x >= 0.0f) ? -t : t;
+		n.y += (n.y >= 0.0f) ? -t : t;
+		return glm::normalize(n);
+	}
 }
 
-ShapeMeshes::ShapeMeshes()
+ShapeMeshes::ShapeMeshes(VERTEX_LAYOUT layout)
 {
+	m_vertexLayout = layout;
+	m_arenaVertexCount = 0;
+	m_pDecodeLod = nullptr;
 	m_bMemoryLayoutDone = false;
+	m_bArenaDirty = false;
+	m_arenaVAO = 0;
+	m_arenaVBOs[0] = 0;
+	m_arenaVBOs[1] = 0;
+	m_arenaVBOs[2] = 0;
+	m_instanceVBO = 0;
+	m_instanceCapacity = 0;
+	m_pStreamBuffer = nullptr;
+	m_bStreamInstances = false;
+	m_bInstancesInStream = false;
+	m_instanceSource = 0;
+	m_instanceBase = 0;
+	m_storageAlignment = 0;
+	m_indirectBuffers[0] = 0;
+	m_indirectBuffers[1] = 0;
+	m_indirectBuffers[2] = 0;
+	m_indirectCommandCapacity = 0;
+	m_indirectDrawCapacity = 0;
+	m_lodLevel = 0;
+	m_drawLevel = 0;
+	m_bReorderTriangles = true;
+	m_bGenerateTangents = false;
 }
 
 ///////////////////////////////////////////////////
@@ -111,519 +195,60 @@ void ShapeMeshes::LoadBoxMesh()
 	m_BoxMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 	m_BoxMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
 
-	glGenVertexArrays(1, &m_BoxMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_BoxMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(2, m_BoxMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_BoxMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BoxMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// append the mesh to the shared vertex/index arena
+	AddIndexedMesh(m_BoxMesh, "box", verts, m_BoxMesh.nVertices, indices, m_BoxMesh.nIndices);
 }
 
 ///////////////////////////////////////////////////
 //	LoadConeMesh()
 //
-//	Create a cole mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
-//  coordinates are also set.
-//
-//  Correct triangle drawing commands:
+//	Generate a cone mesh with the passed number of
+//  segments around its base and append it to the
+//  shared arena.
 //
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
+//  Drawable parts: 0 = bottom, 1 = sides
+//  Levels of detail: MAX_LOD_LEVELS, fewer segments
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadConeMesh()
+void ShapeMeshes::LoadConeMesh(int segments)
 {
-	GLfloat verts[] = {
-		// cone bottom			// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cone sides		// normals									// texture coords
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 		1.0f,0.5f,
-		0.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, -0.116841137f, 		0.5f, 0.5f,
-		.98f, 0.0f, -0.17f,		0.993150651f, 0.0f, -0.116841137f, 		0.983f,0.6f,
-		.98f, 0.0f, -0.17f,		0.973417103f, 0.0f, -0.229039446f, 		0.983f,0.6f,
-		0.0f, 1.0f, 0.0f,		0.973417103f, 0.0f, -0.229039446f, 		0.5f, 0.5f,
-		.94f, 0.0f, -0.34f,		0.973417103f, 0.0f, -0.229039446f, 		0.96f,0.68f,
-		.94f, 0.0f, -0.34f,		0.916157305f, 0.0f, -0.400818795f, 		0.96f,0.68f,
-		0.0f, 1.0f, 0.0f,		0.916157305f, 0.0f, -0.400818795f, 		0.5f, 0.5f,
-		.87f, 0.0f, -0.5f,		0.916157305f, 0.0f, -0.400818795f, 		0.92f,0.77f,
-		.87f, 0.0f, -0.5f,		0.813733339f, 0.0f, -0.581238329f, 		0.92f,0.77f,
-		0.0f, 1.0f, 0.0f,		0.813733339f, 0.0f, -0.581238329f, 		0.5f, 0.5f,
-		.77f, 0.0f, -0.64f,		0.813733339f, 0.0f, -0.581238329f, 		0.87f, 0.83f,
-		.77f, 0.0f, -0.64f,		0.707106769f, 0.0f, -0.707106769f, 		0.87f, 0.83f,
-		0.0f, 1.0f, 0.0f,		0.707106769f, 0.0f, -0.707106769f, 		0.5f, 0.5f,
-		.64f, 0.0f, -0.77f,		0.707106769f, 0.0f, -0.707106769f, 		0.83f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.581238329f, 0.0f, -0.813733339f, 		0.83f, 0.87f,
-		0.0f, 1.0f, 0.0f,		0.581238329f, 0.0f, -0.813733339f, 		0.5f, 0.5f,
-		.5f, 0.0f, -0.87f,		0.581238329f, 0.0f, -0.813733339f, 		0.77f, 0.92f,
-		.5f, 0.0f, -0.87f,		0.400818795f, 0.0f, -0.916157305f, 		0.77f, 0.92f,
-		0.0f, 1.0f, 0.0f,		0.400818795f, 0.0f, -0.916157305f, 		0.5f, 0.5f,
-		.34f, 0.0f, -0.94f,		0.400818795f, 0.0f, -0.916157305f, 		0.68f, 0.96f,
-		.34f, 0.0f, -0.94f,		0.229039446f, 0.0f, -0.973417103f, 		0.68f, 0.96f,
-		0.0f, 1.0f, 0.0f,		0.229039446f, 0.0f, -0.973417103f, 		0.5f, 0.5f,
-		.17f, 0.0f, -0.98f,		0.229039446f, 0.0f, -0.973417103f, 		0.6f, 0.983f,
-		.17f, 0.0f, -0.98f,		0.116841137f, 0.0f, -0.993150651f, 		0.6f, 0.983f,
-		0.0f, 1.0f, 0.0f,		0.116841137f, 0.0f, -0.993150651f, 		0.5f, 0.5f,
-		0.0f, 0.0f, -1.0f,		0.116841137f, 0.0f, -0.993150651f, 		0.5f, 1.0f,
-
-		0.0f, 0.0f, -1.0f,		-0.116841137f, 0.0f, -0.993150651f, 		0.5f, 1.0f,
-		0.0f, 1.0f, 0.0f,		-0.116841137f, 0.0f, -0.993150651f, 		0.5f, 0.5f,
-		-.17f, 0.0f, -0.98f,	-0.116841137f, 0.0f, -0.993150651f, 		0.41f, 0.983f,
-		-.17f, 0.0f, -0.98f,	-0.229039446f, 0.0f, -0.973417103f, 		0.41f, 0.983f,
-		0.0f, 1.0f, 0.0f,		-0.229039446f, 0.0f, -0.973417103f, 		0.5f, 0.5f,
-		-.34f, 0.0f, -0.94f,	-0.229039446f, 0.0f, -0.973417103f, 		0.33f, 0.96f,
-		-.34f, 0.0f, -0.94f,	-0.400818795f, 0.0f, -0.916157305f, 		0.33f, 0.96f,
-		0.0f, 1.0f, 0.0f,		-0.400818795f, 0.0f, -0.916157305f, 		0.5f, 0.5f,
-		-.5f, 0.0f, -0.87f,		-0.400818795f, 0.0f, -0.916157305f, 		0.25f, 0.92f,
-		-.5f, 0.0f, -0.87f,		-0.581238329f, 0.0f, -0.813733339f, 		0.25f, 0.92f,
-		0.0f, 1.0f, 0.0f,		-0.581238329f, 0.0f, -0.813733339f, 		0.5f, 0.5f,
-		-.64f, 0.0f, -0.77f,	-0.581238329f, 0.0f, -0.813733339f, 		0.17f, 0.87f,
-		-.64f, 0.0f, -0.77f,	-0.707106769f, 0.0f, -0.707106769f, 		0.17f, 0.87f,
-		0.0f, 1.0f, 0.0f,		-0.707106769f, 0.0f, -0.707106769f, 		0.5f, 0.5f,
-		-.77f, 0.0f, -0.64f,	-0.707106769f, 0.0f, -0.707106769f, 		0.13f, 0.83f,
-		-.77f, 0.0f, -0.64f,	-0.813733339f, 0.0f, -0.581238329f, 		0.13f, 0.83f,
-		0.0f, 1.0f, 0.0f,		-0.813733339f, 0.0f, -0.581238329f, 		0.5f, 0.5f,
-		-.87f, 0.0f, -0.5f,		-0.813733339f, 0.0f, -0.581238329f, 		0.08f, 0.77f,
-		-.87f, 0.0f, -0.5f,		-0.916157305f, 0.0f, -0.400818795f, 		0.08f, 0.77f,
-		0.0f, 1.0f, 0.0f,		-0.916157305f, 0.0f, -0.400818795f, 		0.5f, 0.5f,
-		-.94f, 0.0f, -0.34f,	-0.916157305f, 0.0f, -0.400818795f, 		0.04f, 0.68f,
-		-.94f, 0.0f, -0.34f,	-0.973417103f, 0.0f, -0.229039446f, 		0.04f, 0.68f,
-		0.0f, 1.0f, 0.0f,		-0.973417103f, 0.0f, -0.229039446f, 		0.5f, 0.5f,
-		-.98f, 0.0f, -0.17f,	-0.973417103f, 0.0f, -0.229039446f, 		0.017f, 0.6f,
-		-.98f, 0.0f, -0.17f,	-0.993150651f, 0.0f, -0.116841137f, 		0.017f, 0.6f,
-		0.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f, 		0.5f, 0.5f,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f, 		0.0f, 0.5f,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f, 		0.0f, 0.5f,
-		0.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, 0.116841137f, 		0.5f, 0.5f,
-		-.98f, 0.0f, 0.17f,		-0.993150651f, 0.0f, 0.116841137f, 		0.017f, 0.41f,
-		-.98f, 0.0f, 0.17f,		-0.973417103f, 0.0f, 0.229039446f, 		0.017f, 0.41f,
-		0.0f, 1.0f, 0.0f,		-0.973417103f, 0.0f, 0.229039446f, 		0.5f, 0.5f,
-		-.94f, 0.0f, 0.34f,		-0.973417103f, 0.0f, 0.229039446f, 		0.04f, 0.33f,
-		-.94f, 0.0f, 0.34f,		-0.916157305f, 0.0f, 0.400818795f, 		0.04f, 0.33f,
-		0.0f, 1.0f, 0.0f,		-0.916157305f, 0.0f, 0.400818795f, 		0.5f, 0.5f,
-		-.87f, 0.0f, 0.5f,		-0.916157305f, 0.0f, 0.400818795f, 		0.08f, 0.25f,
-		-.87f, 0.0f, 0.5f,		-0.813733339f, 0.0f, 0.581238329f, 		0.08f, 0.25f,
-		0.0f, 1.0f, 0.0f,		-0.813733339f, 0.0f, 0.581238329f, 		0.5f, 0.5f,
-		-.77f, 0.0f, 0.64f,		-0.813733339f, 0.0f, 0.581238329f, 		0.13f, 0.17f,
-		-.77f, 0.0f, 0.64f,		-0.707106769f, 0.0f, 0.707106769f, 		0.13f, 0.17f,
-		0.0f, 1.0f, 0.0f,		-0.707106769f, 0.0f, 0.707106769f, 		0.5f, 0.5f,
-		-.64f, 0.0f, 0.77f,		-0.707106769f, 0.0f, 0.707106769f, 		0.17f, 0.13f,
-		-.64f, 0.0f, 0.77f,		-0.581238329f, 0.0f, 0.813733339f, 		0.17f, 0.13f,
-		0.0f, 1.0f, 0.0f,		-0.581238329f, 0.0f, 0.813733339f, 		0.5f, 0.5f,
-		-.5f, 0.0f, 0.87f,		-0.581238329f, 0.0f, 0.813733339f, 		0.25f, 0.08f,
-		-.5f, 0.0f, 0.87f,		-0.400818795f, 0.0f, 0.916157305f, 		0.25f, 0.08f,
-		0.0f, 1.0f, 0.0f,		-0.400818795f, 0.0f, 0.916157305f, 		0.5f, 0.5f,
-		-.34f, 0.0f, 0.94f,		-0.400818795f, 0.0f, 0.916157305f, 		0.33f, 0.04f,
-		-.34f, 0.0f, 0.94f,		-0.229039446f, 0.0f, 0.973417103f, 		0.33f, 0.04f,
-		0.0f, 1.0f, 0.0f,		-0.229039446f, 0.0f, 0.973417103f, 		0.5f, 0.5f,
-		-.17f, 0.0f, 0.98f,		-0.229039446f, 0.0f, 0.973417103f, 		0.41f, 0.017f,
-		-.17f, 0.0f, 0.98f,		-0.116841137f, 0.0f, 0.993150651f, 		0.41f, 0.017f,
-		0.0f, 1.0f, 0.0f,		-0.116841137f, 0.0f, 0.993150651f, 		0.5f, 0.5f,
-		0.0f, 0.0f, 1.0f,		-0.116841137f, 0.0f, 0.993150651f, 		0.5f, 0.0f,
-		0.0f, 0.0f, 1.0f,		0.116841137f, 0.0f, 0.993150651f, 	0.5f, 0.0f,
-		0.0f, 1.0f, 0.0f,		0.116841137f, 0.0f, 0.993150651f, 	0.5f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.116841137f, 0.0f, 0.993150651f, 	0.6f, 0.017f,
-		.17f, 0.0f, 0.98f,		0.229039446f, 0.0f, 0.973417103f, 	0.6f, 0.017f,
-		0.0f, 1.0f, 0.0f,		0.229039446f, 0.0f, 0.973417103f, 	0.5f, 0.5f,
-		.34f, 0.0f, 0.94f,		0.229039446f, 0.0f, 0.973417103f, 	0.68f, 0.04f,
-		.34f, 0.0f, 0.94f,		0.400818795f, 0.0f, 0.916157305f, 	0.68f, 0.04f,
-		0.0f, 1.0f, 0.0f,		0.400818795f, 0.0f, 0.916157305f, 	0.5f, 0.5f,
-		.5f, 0.0f, 0.87f,		0.400818795f, 0.0f, 0.916157305f, 	0.77f, 0.08f,
-		.5f, 0.0f, 0.87f,		0.581238329f, 0.0f, 0.813733339f, 	0.77f, 0.08f,
-		0.0f, 1.0f, 0.0f,		0.581238329f, 0.0f, 0.813733339f, 	0.5f, 0.5f,
-		.64f, 0.0f, 0.77f,		0.581238329f, 0.0f, 0.813733339f, 	0.83f, 0.13f,
-		.64f, 0.0f, 0.77f,		0.707106769f, 0.0f, 0.707106769f, 	0.83f, 0.13f,
-		0.0f, 1.0f, 0.0f,		0.707106769f, 0.0f, 0.707106769f, 	0.5f, 0.5f,
-		.77f, 0.0f, 0.64f,		0.707106769f, 0.0f, 0.707106769f, 	0.87f, 0.17f,
-		.77f, 0.0f, 0.64f,		0.813733339f, 0.0f, 0.581238329f, 	0.87f, 0.17f,
-		0.0f, 1.0f, 0.0f,		0.813733339f, 0.0f, 0.581238329f, 	0.5f, 0.5f,
-		.87f, 0.0f, 0.5f,		0.813733339f, 0.0f, 0.581238329f, 	0.92f, 0.25f,
-		.87f, 0.0f, 0.5f,		0.916157305f, 0.0f, 0.400818795f, 	0.92f, 0.25f,
-		0.0f, 1.0f, 0.0f,		0.916157305f, 0.0f, 0.400818795f, 	0.5f, 0.5f,
-		.94f, 0.0f, 0.34f,		0.916157305f, 0.0f, 0.400818795f, 	0.96f, 0.33f,
-		.94f, 0.0f, 0.34f,		0.973417103f, 0.0f, 0.229039446f, 	0.96f, 0.33f,
-		0.0f, 1.0f, 0.0f,		0.973417103f, 0.0f, 0.229039446f, 	0.5f, 0.5f,
-		.98f, 0.0f, 0.17f,		0.973417103f, 0.0f, 0.229039446f, 	0.983f, 0.41f,
-		.98f, 0.0f, 0.17f,		0.993150651f, 0.0f, 0.116841137f, 	0.983f, 0.41f,
-		0.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 	0.5f, 0.5f,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f, 	1.0f, 0.5f
-	};
-
-	// store vertex and index count
-	m_ConeMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_ConeMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_ConeMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_ConeMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_ConeMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_ConeMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
+	for (int level = 0; level < MAX_LOD_LEVELS; level++)
 	{
-		SetShaderMemoryLayout();
+		int lodSegments = LodResolution(segments, level, 6);
+		AddGeneratedMesh(m_ConeMesh, "cone", MeshGenerators::GenerateCone(lodSegments), level);
 	}
 }
 
 ///////////////////////////////////////////////////
 //	LoadCylinderMesh()
 //
-//	Create a cylinder mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
-//  coordinates are also set.
-//
-//  Correct triangle drawing commands:
+//	Generate a cylinder mesh with the passed number
+//  of segments around its axis and append it to the
+//  shared arena.
 //
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  Drawable parts: 0 = bottom, 1 = top, 2 = sides
+//  Levels of detail: MAX_LOD_LEVELS, fewer segments
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadCylinderMesh()
+void ShapeMeshes::LoadCylinderMesh(int segments)
 {
-	GLfloat verts[] = {
-		// cylinder bottom		// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder top			// normals			// texture coords
-		1.0f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 1.0f, -0.17f,		0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 1.0f, -0.34f,		0.0f, 1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 1.0f, -0.64f,		0.0f, 1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 1.0f, -0.77f,		0.0f, 1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 1.0f, -0.87f,		0.0f, 1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 1.0f, -0.94f,		0.0f, 1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 1.0f, -0.98f,		0.0f, 1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 1.0f, -1.0f,		0.0f, 1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 1.0f, -0.98f,	0.0f, 1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 1.0f, -0.94f,	0.0f, 1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 1.0f, -0.87f,		0.0f, 1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 1.0f, -0.77f,	0.0f, 1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 1.0f, -0.64f,	0.0f, 1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 1.0f, -0.34f,	0.0f, 1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 1.0f, -0.17f,	0.0f, 1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 1.0f, 0.34f,		0.0f, 1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 1.0f, 0.64f,		0.0f, 1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 1.0f, 0.77f,		0.0f, 1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 1.0f, 0.87f,		0.0f, 1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 1.0f, 0.94f,		0.0f, 1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 1.0f, 0.98f,		0.0f, 1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 1.0f, 1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 1.0f, 0.98f,		0.0f, 1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 1.0f, 0.94f,		0.0f, 1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 1.0f, 0.87f,		0.0f, 1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 1.0f, 0.77f,		0.0f, 1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 1.0f, 0.64f,		0.0f, 1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 1.0f, 0.34f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder body		// normals							// texture coords
-		1.0f, 1.0f, 0.0f,		0.993150651f, 0.5f, -0.116841137f,	0.0,1.0,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, -0.116841137f,	0.0,0.0,
-		.98f, 0.0f, -0.17f,		0.993150651f, 0.5f, -0.116841137f,	0.0277,0.0,
-		1.0f, 1.0f, 0.0f,		0.993150651f, 0.5f, -0.116841137f,	0.0,1.0,
-		.98f, 1.0f, -0.17f,		0.973417103f, 0.5f, -0.229039446f,	0.0277,1.0,
-		.98f, 0.0f, -0.17f,		0.973417103f, 0.5f, -0.229039446f,	0.0277,0.0,
-		.94f, 0.0f, -0.34f,		0.973417103f, 0.0f, -0.229039446f,	0.0554,0.0,
-		.98f, 1.0f, -0.17f,		0.973417103f, 0.0f, -0.229039446f,	0.0277,1.0,
-		.94f, 1.0f, -0.34f,		0.916157305f, 0.0f, -0.400818795f,	0.0554,1.0,
-		.94f, 0.0f, -0.34f,		0.916157305f, 0.0f, -0.400818795f,	0.0554,0.0,
-		.87f, 0.0f, -0.5f,		0.916157305f, 0.0f, -0.400818795f,	0.0831,0.0,
-		.94f, 1.0f, -0.34f,		0.916157305f, 0.0f, -0.400818795f,	0.0554,1.0,
-		.87f, 1.0f, -0.5f,		0.813733339f, 0.0f, -0.581238329f,	0.0831,1.0,
-		.87f, 0.0f, -0.5f,		0.813733339f, 0.0f, -0.581238329f,	0.0831,0.0,
-		.77f, 0.0f, -0.64f,		0.813733339f, 0.0f, -0.581238329f,	0.1108,0.0,
-		.87f, 1.0f, -0.5f,		0.813733339f, 0.0f, -0.581238329f,	0.0831,1.0,
-		.77f, 1.0f, -0.64f,		0.707106769f, 0.0f, -0.707106769f,	0.1108,1.0,
-		.77f, 0.0f, -0.64f,		0.707106769f, 0.0f, -0.707106769f,	0.1108,0.0,
-		.64f, 0.0f, -0.77f,		0.707106769f, 0.0f, -0.707106769f,	0.1385,0.0,
-		.77f, 1.0f, -0.64f,		0.707106769f, 0.0f, -0.707106769f,	0.1108,1.0,
-		.64f, 1.0f, -0.77f,		0.581238329f, 0.0f, -0.813733339f,	0.1385,1.0,
-		.64f, 0.0f, -0.77f,		0.581238329f, 0.0f, -0.813733339f,	0.1385,0.0,
-		.5f, 0.0f, -0.87f,		0.581238329f, 0.0f, -0.813733339f,	0.1662,0.0,
-		.64f, 1.0f, -0.77f,		0.581238329f, 0.0f, -0.813733339f,	0.1385, 1.0,
-		.5f, 1.0f, -0.87f,		0.400818795f, 0.0f, -0.916157305f,	0.1662, 1.0,
-		.5f, 0.0f, -0.87f,		0.400818795f, 0.0f, -0.916157305f,	0.1662, 0.0,
-		.34f, 0.0f, -0.94f,		0.400818795f, 0.0f, -0.916157305f,	0.1939, 0.0,
-		.5f, 1.0f, -0.87f,		0.400818795f, 0.0f, -0.916157305f,	0.1662, 1.0,
-		.34f, 1.0f, -0.94f,		0.229039446f, 0.0f, -0.973417103f,	0.1939, 1.0,
-		.34f, 0.0f, -0.94f,		0.229039446f, 0.0f, -0.973417103f,	0.1939, 0.0,
-		.17f, 0.0f, -0.98f,		0.229039446f, 0.0f, -0.973417103f,	0.2216, 0.0,
-		.34f, 1.0f, -0.94f,		0.229039446f, 0.0f, -0.973417103f,	0.1939, 1.0,
-		.17f, 1.0f, -0.98f,		0.116841137f, 0.0f, -0.993150651f,	0.2216, 1.0,
-		.17f, 0.0f, -0.98f,		0.116841137f, 0.0f, -0.993150651f,	0.2216, 0.0,
-		0.0f, 0.0f, -1.0f,		0.116841137f, 0.0f, -0.993150651f,	0.2493, 0.0,
-		.17f, 1.0f, -0.98f,		0.116841137f, 0.0f, -0.993150651f,	0.2216, 1.0,
-		0.0f, 1.0f, -1.0f,		0.116841137f, 0.0f, -0.993150651f,	0.2493, 1.0,
-		0.0f, 0.0f, -1.0f,		0.116841137f, 0.0f, -0.993150651f,	0.2493, 0.0,
-		-.17f, 0.0f, -0.98f,	-0.116841137f, 0.0f, -0.993150651f,	0.277, 0.0,
-		0.0f, 1.0f, -1.0f,		-0.116841137f, 0.0f, -0.993150651f,	0.2493, 1.0,
-		-.17f, 1.0f, -0.98f,	-0.229039446f, 0.0f, -0.973417103f,	0.277, 1.0,
-		-.17f, 0.0f, -0.98f,	-0.229039446f, 0.0f, -0.973417103f,	0.277, 0.0,
-		-.34f, 0.0f, -0.94f,	-0.229039446f, 0.0f, -0.973417103f,	0.3047, 0.0,
-		-.17f, 1.0f, -0.98f,	-0.229039446f, 0.0f, -0.973417103f,	0.277, 1.0,
-		-.34f, 1.0f, -0.94f,	-0.400818795f, 0.0f, -0.916157305f,	0.3047, 1.0,
-		-.34f, 0.0f, -0.94f,	-0.400818795f, 0.0f, -0.916157305f,	0.3047, 0.0,
-		-.5f, 0.0f, -0.87f,		-0.400818795f, 0.0f, -0.916157305f,	0.3324, 0.0,
-		-.34f, 1.0f, -0.94f,	-0.400818795f, 0.0f, -0.916157305f,	0.3047, 1.0,
-		-.5f, 1.0f, -0.87f,		-0.581238329f, 0.0f, -0.813733339f,	0.3324, 1.0,
-		-.5f, 0.0f, -0.87f,		-0.581238329f, 0.0f, -0.813733339f,	0.3324, 0.0,
-		-.64f, 0.0f, -0.77f,	-0.581238329f, 0.0f, -0.813733339f,	0.3601, 0.0,
-		-.5f, 1.0f, -0.87f,		-0.581238329f, 0.0f, -0.813733339f,	0.3324, 1.0,
-		-.64f, 1.0f, -0.77f,	-0.707106769f, 0.0f, -0.707106769f,	0.3601, 1.0,
-		-.64f, 0.0f, -0.77f,	-0.707106769f, 0.0f, -0.707106769f,	0.3601, 0.0,
-		-.77f, 0.0f, -0.64f,	-0.707106769f, 0.0f, -0.707106769f,	0.3878, 0.0,
-		-.64f, 1.0f, -0.77f,	-0.707106769f, 0.0f, -0.707106769f,	0.3601, 1.0,
-		-.77f, 1.0f, -0.64f,	-0.813733339f, 0.0f, -0.581238329f,	0.3878, 1.0,
-		-.77f, 0.0f, -0.64f,	-0.813733339f, 0.0f, -0.581238329f,	0.3878, 0.0,
-		-.87f, 0.0f, -0.5f,		-0.813733339f, 0.0f, -0.581238329f,	0.4155, 0.0,
-		-.77f, 1.0f, -0.64f,	-0.813733339f, 0.0f, -0.581238329f,	0.3878, 1.0,
-		-.87f, 1.0f, -0.5f,		-0.916157305f, 0.0f, -0.400818795f,	0.4155, 1.0,
-		-.87f, 0.0f, -0.5f,		-0.916157305f, 0.0f, -0.400818795f,	0.4155, 0.0,
-		-.94f, 0.0f, -0.34f,	-0.916157305f, 0.0f, -0.400818795f,	0.4432, 0.0,
-		-.87f, 1.0f, -0.5f,		-0.916157305f, 0.0f, -0.400818795f,	0.4155, 1.0,
-		-.94f, 1.0f, -0.34f,	-0.973417103f, 0.0f, -0.229039446f,	0.4432, 1.0,
-		-.94f, 0.0f, -0.34f,	-0.973417103f, 0.0f, -0.229039446f,	0.4432, 0.0,
-		-.98f, 0.0f, -0.17f,	-0.973417103f, 0.0f, -0.229039446f,	0.4709, 0.0,
-		-.94f, 1.0f, -0.34f,	-0.973417103f, 0.0f, -0.229039446f,	0.4432, 1.0,
-		-.98f, 1.0f, -0.17f,	-0.993150651f, 0.0f, -0.116841137f,	0.4709, 1.0,
-		-.98f, 0.0f, -0.17f,	-0.993150651f, 0.0f, -0.116841137f,	0.4709, 0.0,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f,	0.4986, 0.0,
-		-.98f, 1.0f, -0.17f,	-0.993150651f, 0.0f, -0.116841137f,	0.4709, 1.0,
-		-1.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f,	0.4986, 1.0,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.0f, -0.116841137f,	0.4986, 0.0,
-		-.98f, 0.0f, 0.17f,		-0.993150651f, 0.0f, 0.116841137f,	0.5263, 0.0,
-		-1.0f, 1.0f, 0.0f,		-0.993150651f, 0.0f, 0.116841137f,	0.4986, 1.0,
-		-.98f, 1.0f, 0.17f,		-0.973417103f, 0.0f, 0.229039446f,	0.5263, 1.0,
-		-.98f, 0.0f, 0.17f,		-0.973417103f, 0.0f, 0.229039446f,	0.5263, 0.0,
-		-.94f, 0.0f, 0.34f,		-0.973417103f, 0.0f, 0.229039446f,	0.554, 0.0,
-		-.98f, 1.0f, 0.17f,		-0.973417103f, 0.0f, 0.229039446f,	0.5263, 1.0,
-		-.94f, 1.0f, 0.34f,		-0.916157305f, 0.0f, 0.400818795f,	0.554, 1.0,
-		-.94f, 0.0f, 0.34f,		-0.916157305f, 0.0f, 0.400818795f,	0.554, 0.0,
-		-.87f, 0.0f, 0.5f,		-0.916157305f, 0.0f, 0.400818795f,	0.5817, 0.0,
-		-.94f, 1.0f, 0.34f,		-0.916157305f, 0.0f, 0.400818795f,	0.554, 1.0,
-		-.87f, 1.0f, 0.5f,		-0.813733339f, 0.0f, 0.581238329f,	0.5817, 1.0,
-		-.87f, 0.0f, 0.5f,		-0.813733339f, 0.0f, 0.581238329f,	0.5817, 0.0,
-		-.77f, 0.0f, 0.64f,		-0.813733339f, 0.0f, 0.581238329f,	0.6094, 0.0,
-		-.87f, 1.0f, 0.5f,		-0.813733339f, 0.0f, 0.581238329f,	0.5817, 1.0,
-		-.77f, 1.0f, 0.64f,		-0.707106769f, 0.0f, 0.707106769f,	0.6094, 1.0,
-		-.77f, 0.0f, 0.64f,		-0.707106769f, 0.0f, 0.707106769f,	0.6094, 0.0,
-		-.64f, 0.0f, 0.77f,		-0.707106769f, 0.0f, 0.707106769f,	0.6371, 0.0,
-		-.77f, 1.0f, 0.64f,		-0.707106769f, 0.0f, 0.707106769f,	0.6094, 1.0,
-		-.64f, 1.0f, 0.77f,		-0.581238329f, 0.0f, 0.813733339f,	0.6371, 1.0,
-		-.64f, 0.0f, 0.77f,		-0.581238329f, 0.0f, 0.813733339f,	0.6371, 0.0,
-		-.5f, 0.0f, 0.87f,		-0.581238329f, 0.0f, 0.813733339f,	0.6648, 0.0,
-		-.64f, 1.0f, 0.77f,		-0.581238329f, 0.0f, 0.813733339f,	0.6371, 1.0,
-		-.5f, 1.0f, 0.87f,		-0.400818795f, 0.0f, 0.916157305f,	0.6648, 1.0,
-		-.5f, 0.0f, 0.87f,		-0.400818795f, 0.0f, 0.916157305f,	0.6648, 0.0,
-		-.34f, 0.0f, 0.94f,		-0.400818795f, 0.0f, 0.916157305f,	0.6925, 0.0,
-		-.5f, 1.0f, 0.87f,		-0.400818795f, 0.0f, 0.916157305f,	0.6648, 1.0,
-		-.34f, 1.0f, 0.94f,		-0.229039446f, 0.0f, 0.973417103f,	0.6925, 1.0,
-		-.34f, 0.0f, 0.94f,		-0.229039446f, 0.0f, 0.973417103f,	0.6925, 0.0,
-		-.17f, 0.0f, 0.98f,		-0.229039446f, 0.0f, 0.973417103f,	0.7202, 0.0,
-		-.34f, 1.0f, 0.94f,		-0.229039446f, 0.0f, 0.973417103f,	0.6925, 1.0,
-		-.17f, 1.0f, 0.98f,		-0.116841137f, 0.0f, 0.993150651f,	0.7202, 1.0,
-		-.17f, 0.0f, 0.98f,		-0.116841137f, 0.0f, 0.993150651f,	0.7202, 0.0,
-		0.0f, 0.0f, 1.0f,		0.116841137f, 0.0f, 0.993150651f,	0.7479, 0.0,
-		-.17f, 1.0f, 0.98f,		-0.116841137f, 0.0f, 0.993150651f,	0.7202, 1.0,
-		0.0f, 1.0f, 1.0f,		0.116841137f, 0.0f, 0.993150651f,	0.7479, 1.0,
-		0.0f, 0.0f, 1.0f,		0.116841137f, 0.0f, 0.993150651f,	0.7479, 0.0,
-		.17f, 0.0f, 0.98f,		0.116841137f, 0.0f, 0.993150651f,	0.7756, 0.0,
-		0.0f, 1.0f, 1.0f,		0.116841137f, 0.0f, 0.993150651f,	0.7479, 1.0,
-		.17f, 1.0f, 0.98f,		0.229039446f, 0.0f, 0.973417103f,	0.7756, 1.0,
-		.17f, 0.0f, 0.98f,		0.229039446f, 0.0f, 0.973417103f,	0.7756, 0.0,
-		.34f, 0.0f, 0.94f,		0.229039446f, 0.0f, 0.973417103f,	0.8033, 0.0,
-		.17f, 1.0f, 0.98f,		0.229039446f, 0.0f, 0.973417103f,	0.7756, 1.0,
-		.34f, 1.0f, 0.94f,		0.400818795f, 0.0f, 0.916157305f,	0.8033, 1.0,
-		.34f, 0.0f, 0.94f,		0.400818795f, 0.0f, 0.916157305f,	0.8033, 0.0,
-		.5f, 0.0f, 0.87f,		0.400818795f, 0.0f, 0.916157305f,	0.831, 0.0,
-		.34f, 1.0f, 0.94f,		0.400818795f, 0.0f, 0.916157305f,	0.8033, 1.0,
-		.5f, 1.0f, 0.87f,		0.581238329f, 0.0f, 0.813733339f,	0.831, 1.0,
-		.5f, 0.0f, 0.87f,		0.581238329f, 0.0f, 0.813733339f,	0.831, 0.0,
-		.64f, 0.0f, 0.77f,		0.581238329f, 0.0f, 0.813733339f,	0.8587, 0.0,
-		.5f, 1.0f, 0.87f,		0.581238329f, 0.0f, 0.813733339f,	0.831, 1.0,
-		.64f, 1.0f, 0.77f,		0.707106769f, 0.0f, 0.707106769f,	0.8587, 1.0,
-		.64f, 0.0f, 0.77f,		0.707106769f, 0.0f, 0.707106769f,	0.8587, 0.0,
-		.77f, 0.0f, 0.64f,		0.707106769f, 0.0f, 0.707106769f,	0.8864, 0.0,
-		.64f, 1.0f, 0.77f,		0.707106769f, 0.0f, 0.707106769f,	0.8587, 1.0,
-		.77f, 1.0f, 0.64f,		0.813733339f, 0.0f, 0.581238329f,	0.8864, 1.0,
-		.77f, 0.0f, 0.64f,		0.813733339f, 0.0f, 0.581238329f,	0.8864, 0.0,
-		.87f, 0.0f, 0.5f,		0.813733339f, 0.0f, 0.581238329f,	0.9141, 0.0,
-		.77f, 1.0f, 0.64f,		0.813733339f, 0.0f, 0.581238329f,	0.8864, 1.0,
-		.87f, 1.0f, 0.5f,		0.916157305f, 0.0f, 0.400818795f,	0.9141, 1.0,
-		.87f, 0.0f, 0.5f,		0.916157305f, 0.0f, 0.400818795f,	0.9141, 0.0,
-		.94f, 0.0f, 0.34f,		0.916157305f, 0.0f, 0.400818795f,	0.9418, 0.0,
-		.87f, 1.0f, 0.5f,		0.916157305f, 0.0f, 0.400818795f,	0.9141, 1.0,
-		.94f, 1.0f, 0.34f,		0.973417103f, 0.0f, 0.229039446f,	0.9418, 1.0,
-		.94f, 0.0f, 0.34f,		0.973417103f, 0.0f, 0.229039446f,	0.9418, 0.0,
-		.98f, 0.0f, 0.17f,		0.973417103f, 0.0f, 0.229039446f,	0.9695, 0.0,
-		.94f, 1.0f, 0.34f,		0.973417103f, 0.0f, 0.229039446f,	0.9418, 1.0,
-		.98f, 1.0f, 0.17f,		0.993150651f, 0.0f, 0.116841137f,	0.9695, 1.0,
-		.98f, 0.0f, 0.17f,		0.993150651f, 0.0f, 0.116841137f,	0.9695, 0.0,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f,	1.0, 0.0,
-		.98f, 1.0f, 0.17f,		0.993150651f, 0.0f, 0.116841137f,	0.9695, 1.0,
-		1.0f, 1.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f,	1.0, 1.0,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.0f, 0.116841137f,	1.0, 0.0
-	};
-
-	glm::vec3 normal;
-
-	normal = CalculateTriangleNormal(glm::vec3(.98f, 1.0f, 0.17f), glm::vec3(.98f, 0.0f, 0.17f), glm::vec3(1.0f, 0.0f, 0.0f));
-
-	// store vertex and index count
-	m_CylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_CylinderMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_CylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_CylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_CylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_CylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
+	for (int level = 0; level < MAX_LOD_LEVELS; level++)
 	{
-		SetShaderMemoryLayout();
+		int lodSegments = LodResolution(segments, level, 6);
+		AddGeneratedMesh(m_CylinderMesh, "cylinder", MeshGenerators::GenerateCylinder(lodSegments), level);
 	}
 }
 
 ///////////////////////////////////////////////////
 //	LoadPlaneMesh()
 //
-//	Create a plane mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
-//  coordinates are also set.
+//	Generate a plane mesh split into the passed
+//  number of divisions per side and append it to
+//  the shared arena.
 // 
-//  Correct triangle drawing command:
-//
-//	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+//  Drawable parts: 0 = whole plane
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadPlaneMesh()
+void ShapeMeshes::LoadPlaneMesh(int divisions)
 {
-	// Vertex data
-	GLfloat verts[] = {
-		// Vertex Positions		// Normals			// Texture coords	// Index
-		-1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	0.0f, 0.0f,			//0
-		1.0f, 0.0f, 1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 0.0f,			//1
-		1.0f,  0.0f, -1.0f,		0.0f, 1.0f, 0.0f,	1.0f, 1.0f,			//2
-		-1.0f, 0.0f, -1.0f,		0.0f, 1.0f, 0.0f,	0.0f, 1.0f,			//3
-	};
-
-	// Index data
-	GLuint indices[] = {
-		0,1,2,
-		0,3,2
-	};
-
-	// store vertex and index count
-	m_PlaneMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_PlaneMesh.nIndices = sizeof(indices) / sizeof(indices[0]);
-
-	// Generate the VAO for the mesh
-	glGenVertexArrays(1, &m_PlaneMesh.vao);
-	glBindVertexArray(m_PlaneMesh.vao);	// activate the VAO
-
-	// Create VBOs for the mesh
-	glGenBuffers(2, m_PlaneMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PlaneMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_PlaneMesh.vbos[1]); // Activates the buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	AddGeneratedMesh(m_PlaneMesh, "plane", MeshGenerators::GeneratePlane(divisions));
 }
 
 ///////////////////////////////////////////////////
@@ -690,18 +315,11 @@ void ShapeMeshes::LoadPrismMesh()
 
 	m_PrismMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_PrismMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_PrismMesh.vao);
-
-	// Create 2 buffers: first one for the vertex data; second one for the indices
-	glGenBuffers(1, m_PrismMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_PrismMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// append the mesh to the shared arena as indexed triangles
+	const ARRAY_RANGE ranges[] = {
+		{ GL_TRIANGLE_STRIP, 0, m_PrismMesh.nVertices }
+	};
+	AddArrayMesh(m_PrismMesh, "prism", verts, m_PrismMesh.nVertices, ranges, 1);
 }
 
 ///////////////////////////////////////////////////
@@ -745,17 +363,11 @@ void ShapeMeshes::LoadPyramid3Mesh()
 	// Calculate total defined vertices
 	m_Pyramid3Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_Pyramid3Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid3Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid3Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid3Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// append the mesh to the shared arena as indexed triangles
+	const ARRAY_RANGE ranges[] = {
+		{ GL_TRIANGLE_STRIP, 0, m_Pyramid3Mesh.nVertices }
+	};
+	AddArrayMesh(m_Pyramid3Mesh, "pyramid3", verts, m_Pyramid3Mesh.nVertices, ranges, 1);
 }
 
 ///////////////////////////////////////////////////
@@ -808,1390 +420,77 @@ void ShapeMeshes::LoadPyramid4Mesh()
 	// Calculate total defined vertices
 	m_Pyramid4Mesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
 
-	glGenVertexArrays(1, &m_Pyramid4Mesh.vao);				// Creates 1 VAO
-	glGenBuffers(1, m_Pyramid4Mesh.vbos);					// Creates 1 VBO
-	glBindVertexArray(m_Pyramid4Mesh.vao);					// Activates the VAO
-	glBindBuffer(GL_ARRAY_BUFFER, m_Pyramid4Mesh.vbos[0]);	// Activates the VBO
-	// Sends vertex or coordinate data to the GPU
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
-	{
-		SetShaderMemoryLayout();
-	}
+	// append the mesh to the shared arena as indexed triangles
+	const ARRAY_RANGE ranges[] = {
+		{ GL_TRIANGLE_STRIP, 0, m_Pyramid4Mesh.nVertices }
+	};
+	AddArrayMesh(m_Pyramid4Mesh, "pyramid4", verts, m_Pyramid4Mesh.nVertices, ranges, 1);
 }
 
 ///////////////////////////////////////////////////
 //	LoadSphereMesh()
 //
-//	Create a sphere mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
-//  coordinates are also set.
-//
-//  Correct triangle drawing command:
+//	Generate a sphere mesh with the passed number of
+//  latitude rings and segments around each ring, and
+//  append it to the shared arena.
 //
-//	glDrawElements(GL_TRIANGLES, meshes.gSphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+//  Drawable parts: 0 = whole sphere, 1 = upper half
+//  Levels of detail: MAX_LOD_LEVELS, fewer rings and
+//  segments
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadSphereMesh()
+void ShapeMeshes::LoadSphereMesh(int rings, int segments)
 {
-	GLfloat verts[] = {
-		// vertex data					// texture coords			// index
-		// top center point
-		0.0f, 1.0f, 0.0f,				0.5f, 1.0f,					//0
-		// ring 1
-		0.0f, 0.9808f, 0.1951f,			0.5f, 0.9375f,				//1
-		0.0747f, 0.9808f, 0.1802f,		0.51219375f, 0.9375f,		//2
-		0.1379f, 0.9808f, 0.1379f,		0.5243875f, 0.9375f,		//3
-		0.1802f, 0.9808f, 0.0747f,		0.53658125f, 0.9375f,		//4
-		0.1951f, 0.9808, 0.0f,			0.548775f, 0.9375f,			//5
-		0.1802f, 0.9808f, -0.0747f,		0.56096875f, 0.9375f,		//6
-		0.1379f, 0.9808f, -0.1379f,		0.5731625f, 0.9375f,		//7
-		0.0747f, 0.9808f, -0.1802f,		0.58535625f, 0.9375f,		//8
-		0.0f, 0.9808f, -0.1951f,		0.59755f, 0.9375f,			//9 - seam
-		0.0f, 0.9808f, -0.1951f,		0.40245f, 0.9375f,			//10 - seam
-		-0.0747f, 0.9808f, -0.1802f,	0.41464375f, 0.9375f,		//11
-		-0.1379f, 0.9808f, -0.1379f,	0.4268375f, 0.9375f,		//12
-		-0.1802f, 0.9808f, -0.0747f,	0.43903125f, 0.9375f,		//13
-		-0.1951f, 0.9808, 0.0f,			0.451225f, 0.9375f,			//14
-		-0.1802f, 0.9808f, 0.0747f,		0.46341875f, 0.9375f,		//15
-		-0.1379f, 0.9808f, 0.1379f,		0.4756125f, 0.9375f,		//16
-		-0.0747f, 0.9808f, 0.1802f,		0.48780625f, 0.9375f,		//17
-		// ring 2
-		0.0f, 0.9239f, 0.3827f,			0.5f, 0.875f,				//18
-		0.1464f, 0.9239f, 0.3536f,		0.52391875f, 0.875f,		//19
-		0.2706f, 0.9239f, 0.2706f,		0.5478375f, 0.875f,			//20
-		0.3536f, 0.9239f, 0.1464f,		0.57175625f, 0.875f,		//21
-		0.3827f, 0.9239f, 0.0f,			0.5956755f, 0.875f,			//22
-		0.3536f, 0.9239f, -0.1464f,		0.61959425f, 0.875f,		//23
-		0.2706f, 0.9239f, -0.2706f,		0.643513f, 0.875f,			//24
-		0.1464f, 0.9239f, -0.3536f,		0.66743175f, 0.875f,		//25
-		0.0f, 0.9239f, -0.3827f,		0.6913505f, 0.875f,			//26 - seam
-		0.0f, 0.9239f, -0.3827f,		0.3086495f, 0.875f,			//27 - seam
-		-0.1464f, 0.9239f, -0.3536f,	0.33256825f, 0.875f,		//28
-		-0.2706f, 0.9239f, -0.2706f,	0.356487f, 0.875f,			//29
-		-0.3536f, 0.9239f, -0.1464f,	0.38040575f, 0.875f,		//30
-		-0.3827f, 0.9239f, 0.0f,		0.4043245f, 0.875f,			//31
-		-0.3536f, 0.9239f, 0.1464f,		0.42824325f, 0.875f,		//32
-		-0.2706f, 0.9239f, 0.2706f,		0.452162f, 0.875f,			//33
-		-0.1464f, 0.9239f, 0.3536f,		0.47608075f, 0.875f,		//34
-		// ring 3
-		0.0f, 0.8315f, 0.5556f,			0.5f, 0.8125f,				//35
-		0.2126f, 0.8315f, 0.5133f,		0.534725f, 0.8125f,			//36
-		0.3928f, 0.8315f, 0.3928f,		0.56945f, 0.8125f,			//37
-		0.5133f, 0.8315f, 0.2126f,		0.604175f, 0.8125f,			//38
-		0.5556f, 0.8315f, 0.0f,			0.6389f, 0.8125f,			//39
-		0.5133f, 0.8315f, -0.2126f,		0.673625f, 0.8125f,			//40
-		0.3928f, 0.8315f, -0.3928f,		0.70835f, 0.8125f,			//41
-		0.2126f, 0.8315f, -0.5133f,		0.743075f, 0.8125f,			//42
-		0.0f, 0.8315f, -0.5556f,		0.7778f, 0.8125f,			//43 - seam
-		0.0f, 0.8315f, -0.5556f,		0.2222f, 0.8125f,			//44 - seam
-		-0.2126f, 0.8315f, -0.5133f,	0.256925f, 0.8125f,			//45
-		-0.3928f, 0.8315f, -0.3928f,	0.29165f, 0.8125f,			//46
-		-0.5133f, 0.8315f, -0.2126f,	0.326375f, 0.8125f,			//47
-		-0.5556f, 0.8315f, 0.0f,		0.3611f, 0.8125f,			//48
-		-0.5133f, 0.8315f, 0.2126f,		0.395825f, 0.8125f,			//49
-		-0.3928f, 0.8315f, 0.3928f,		0.43055f, 0.8125f,			//50
-		-0.2126f, 0.8315f, 0.5133f,		0.465275f, 0.8125f,			//51
-		// ring 4
-		0.0f, 0.7071f, 0.7071f,			0.5f, 0.75f,				//52
-		0.2706f, 0.7071f, 0.6533f,		0.54419375f, 0.75f,			//53
-		0.5f, 0.7071f, 0.5f,			0.5883875f, 0.75f,			//54
-		0.6533f, 0.7071f, 0.2706f,		0.63258125f, 0.75f,			//55
-		0.7071f, 0.7071f, 0.0f,			0.676775f, 0.75f,			//56
-		0.6533f, 0.7071f, -0.2706f,		0.72096875f, 0.75f,			//57
-		0.5f, 0.7071f, -0.5f,			0.7651625f, 0.75f,			//58
-		0.2706f, 0.7071f, -0.6533f,		0.80935625f, 0.75f,			//59
-		0.0f, 0.7071f, -0.7071f,		0.85355f, 0.75f,			//60 - seam
-		0.0f, 0.7071f, -0.7071f,		0.14645f, 0.75f,			//61 - seam
-		-0.2706f, 0.7071f, -0.6533f,	0.19064375f, 0.75f,			//62
-		-0.5f, 0.7071f, -0.5f,			0.2348375f, 0.75f,			//63
-		-0.6533f, 0.7071f, -0.2706f,	0.27903135f, 0.75f,			//64
-		-0.7071f, 0.7071f, 0.0f,		0.323225f, 0.75f,			//65
-		-0.6533f, 0.7071f, 0.2706f,		0.36741875f, 0.75f,			//66
-		-0.5f, 0.7071f, 0.5f,			0.4116125f, 0.75f,			//67
-		-0.2706f, 0.7071f, 0.6533f,		0.45580625f, 0.75f,			//68
-		// ring 5
-		0.0f, 0.5556f, 0.8315f,			0.5f, 0.6875f,				//69
-		0.3182f, 0.5556f, 0.7682f,		0.55196875f, 0.6875f,		//70
-		0.5879f, 0.5556f, 0.5879f,		0.6039375f, 0.6875f,		//71
-		0.7682f, 0.5556f, 0.3182f,		0.65590625f, 0.6875f,		//72
-		0.8315f, 0.5556f, 0.0f,			0.707875f, 0.6875f,			//73
-		0.7682f, 0.5556f, -0.3182f,		0.75984375f, 0.6875f,		//74
-		0.5879f, 0.5556f, -0.5879f,		0.8118125f, 0.6875f,		//75
-		0.3182f, 0.5556f, -0.7682f,		0.86378125f, 0.6875f,		//76
-		0.0f, 0.5556f, -0.8315f,		0.91575f, 0.6875f,			//77 - seam
-		0.0f, 0.5556f, -0.8315f,		0.08425f, 0.6875f,			//78 - seam
-		-0.3182f, 0.5556f, -0.7682f,	0.13621875f, 0.6875f,		//79
-		-0.5879f, 0.5556f, -0.5879f,	0.1881875f, 0.6875f,		//80
-		-0.7682f, 0.5556f, -0.3182f,	0.24015625f, 0.6875f,		//81
-		-0.8315f, 0.5556f, 0.0f,		0.292125f, 0.6875f,			//82
-		-0.7682f, 0.5556f, 0.3182f,		0.34409375f, 0.6875f,		//83
-		-0.5879f, 0.5556f, 0.5879f,		0.3960625f, 0.6875f,		//84
-		-0.3182f, 0.5556f, 0.7682f,		0.44803125f, 0.6875f,		//85
-		//ring 6
-		0.0f, 0.3827f, 0.9239f,			0.5f, 0.625f,				//86
-		0.3536f, 0.3827f, 0.8536f,		0.55774375f, 0.625f,		//87
-		0.6533f, 0.3827f, 0.6533f,		0.6154875f, 0.625f,			//88
-		0.8536f, 0.3827f, 0.3536f,		0.67323125f, 0.625f,		//89
-		0.9239f, 0.3827f, 0.0f,			0.730975f, 0.625f,			//90
-		0.8536f, 0.3827f, -0.3536f,		0.78871875f, 0.625f,		//91
-		0.6533f, 0.3827f, -0.6533f,		0.8464625f, 0.625f,			//92
-		0.3536f, 0.3827f, -0.8536f,		0.90420625f, 0.625f,		//93
-		0.0f, 0.3827f, -0.9239f,		0.96195f, 0.625f,			//94 - seam
-		0.0f, 0.3827f, -0.9239f,		0.03805f, 0.625f,			//95 - seam
-		-0.3536f, 0.3827f, -0.8536f,	0.09579375f, 0.625f,		//96
-		-0.6533f, 0.3827f, -0.6533f,	0.1535375f, 0.625f,			//97
-		-0.8536f, 0.3827f, -0.3536f,	0.21128125f, 0.625f,		//98
-		-0.9239f, 0.3827f, 0.0f,		0.269025f, 0.625f,			//99
-		-0.8536f, 0.3827f, 0.3536f,		0.32676875f, 0.625f,		//100
-		-0.6533f, 0.3827f, 0.6533f,		0.3845125f, 0.625f,			//101
-		-0.3536f, 0.3827f, 0.8536f,		0.44225625f, 0.625f,		//102
-		// ring 7
-		0.0f, 0.1951f, 0.9808f,			0.5f, 0.5625f,				//103
-		0.3753f, 0.1915f, 0.9061f,		0.5613f, 0.5625f,			//104
-		0.6935f, 0.1915f, 0.6935f,		0.6226f, 0.5625f,			//105
-		0.9061f, 0.1915f, 0.3753f,		0.6839f, 0.5625f,			//106
-		0.9808f, 0.1915f, 0.0f,			0.7452f, 0.5625f,			//107
-		0.9061f, 0.1915f, -0.3753f,		0.8065f, 0.5625f,			//108
-		0.6935f, 0.1915f, -0.6935f,		0.8678f, 0.5625f,			//109
-		0.3753f, 0.1915f, -0.9061f,		0.9291f, 0.5625f,			//110
-		0.0f, 0.1915f, -0.9808f,		0.9904f, 0.5625f,			//111 - seam
-		0.0f, 0.1915f, -0.9808f,		0.0096f, 0.5625f,			//112 - seam
-		-0.3753f, 0.1915f, -0.9061f,	0.0709f, 0.5625f,			//113
-		-0.6935f, 0.1915f, -0.6935f,	0.1322f, 0.5625f,			//114
-		-0.9061f, 0.1915f, -0.3753f,	0.1935f, 0.5625f,			//115
-		-0.9808f, 0.1915f, 0.0f,		0.2548f, 0.5625f,			//116
-		-0.9061f, 0.1915f, 0.3753f,		0.3161f, 0.5625f,			//117
-		-0.6935f, 0.1915f, 0.6935f,		0.3774f, 0.5625f,			//118
-		-0.3753f, 0.1915f, 0.9061f,		0.4387f, 0.5625f,			//119
-		// ring 8
-		0.0f, 0.0f, 1.0f,				0.5f, 0.5f,					//120
-		0.3827f, 0.0f, 0.9239f,			0.5625f, 0.5f,				//121
-		0.7071f, 0.0f, 0.7071f,			0.625f, 0.5f,				//122
-		0.9239f, 0.0f, 0.3827f,			0.6875f, 0.5f,				//123
-		1.0f, 0.0f, 0.0f,				0.75f, 0.5f,				//124
-		0.9239f, 0.0f, -0.3827f,		0.8125f, 0.5f,				//125
-		0.7071f, 0.0f, -0.7071f,		0.875f, 0.5f,				//126
-		0.3827f, 0.0f, -0.9239f,		0.9375f, 0.5f,				//127
-		0.0f, 0.0f, -1.0f,				1.0f, 0.5f,					//128 - seam
-		0.0f, 0.0f, -1.0f, 				0.0f, 0.5f,					//129 - seam
-		-0.3827f, 0.0f, -0.9239f,		0.0625f, 0.5f,				//130
-		-0.7071f, 0.0f, -0.7071f,		0.125f, 0.5f,				//131
-		-0.9239f, 0.0f, -0.3827f,		0.1875f, 0.5f,				//132
-		-1.0f, 0.0f, 0.0f,				0.25f, 0.5f,				//133
-		-0.9239f, 0.0f, 0.3827f,		0.3125f, 0.5f,				//134
-		-0.7071, 0.0, 0.7071f,			0.375f, 0.5f,				//135
-		-0.3827f, 0.0f, 0.9239f,		0.4375f, 0.5f,				//136
-		// ring 9
-		0.0f, -0.1915f, 0.9808f,		0.5f, 0.4375f,				//137
-		0.3753f, -0.1915f, 0.9061f,		0.5613f, 0.4375f,			//138
-		0.6935f, -0.1915f, 0.6935f,		0.6226f, 0.4375f,			//139
-		0.9061f, -0.1915f, 0.3753f,		0.6839f, 0.4375f,			//140
-		0.9808f, -0.1915f, 0.0f,		0.7452f, 0.4375f,			//141
-		0.9061f, -0.1915f, -0.3753f,	0.8065f, 0.4375f,			//142
-		0.6935f, -0.1915f, -0.6935f,	0.8678f, 0.4375f,			//143
-		0.3753f, -0.1915f, -0.9061f,	0.9261f, 0.4375f,			//144
-		0.0f, -0.1915f, -0.9808f,		0.9904f, 0.4375f,			//145 - seam
-		0.0f, -0.1915f, -0.9808f,		0.0096f, 0.4375f,			//146 - seam
-		-0.3753f, -0.1915f, -0.9061f,	0.0709f, 0.4375f,			//147
-		-0.6935f, -0.1915f, -0.6935f,	0.1322f, 0.4375f,			//148
-		-0.9061f, -0.1915f, -0.3753f,	0.1935f, 0.4375f,			//149
-		-0.9808f, -0.1915f, 0.0f,		0.2548f, 0.4375f,			//150
-		-0.9061f, -0.1915f, 0.3753f,	0.3161f, 0.4375f,			//151
-		-0.6935f, -0.1915f, 0.6935f,	0.3774f, 0.4375f,			//152
-		-0.3753f, -0.1915f, 0.9061f,	0.4387f, 0.4375f,			//153
-		// ring 10
-		0.0f, -0.3827f, 0.9239f,		0.5f, 0.375f,				//154
-		0.3536f, -0.3827f, 0.8536f,		0.55774375f, 0.375f,		//155
-		0.6533f, -0.3827f, 0.6533f,		0.6154875f, 0.375f,			//156
-		0.8536f, -0.3827f, 0.3536f,		0.67323125f, 0.375f,		//157
-		0.9239f, -0.3827f, 0.0f,		0.730975f, 0.375f,			//158
-		0.8536f, -0.3827f, -0.3536f,	0.78871875f, 0.375f,		//159
-		0.6533f, -0.3827f, -0.6533f,	0.8464625f, 0.375f,			//160
-		0.3536f, -0.3827f, -0.8536f,	0.90420625f, 0.375f,		//161
-		0.0f, -0.3827f, -0.9239f,		0.96195f, 0.375f,			//162 - seam
-		0.0f, -0.3827f, -0.9239f,		0.03805f, 0.375f,			//163 - seam
-		-0.3536f, -0.3827f, -0.8536f,	0.09579375f, 0.375f,		//164
-		-0.6533f, -0.3827f, -0.6533f,	0.1535375f, 0.375f,			//165
-		-0.8536f, -0.3827f, -0.3536f,	0.21128125f, 0.375f,		//166
-		-0.9239f, -0.3827f, 0.0f,		0.269025f, 0.375f,			//167
-		-0.8536f, -0.3827f, 0.3536f,	0.32676875f, 0.375f,		//168
-		-0.6533f, -0.3827f, 0.6533f,	0.3845125f, 0.375f,			//169
-		-0.3536f, -0.3827f, 0.8536f,	0.44225625f, 0.375f,		//170
-		// ring 11
-		0.0f, -0.5556f, 0.8315f,		0.5f, 0.3125f,				//171
-		0.3182f, -0.5556f, 0.7682f,		0.55196875f, 0.3125f,		//172
-		0.5879f, -0.5556f, 0.5879f,		0.6039375f, 0.3125f,		//173
-		0.7682f, -0.5556f, 0.3182f,		0.65590625f, 0.3125f,		//174
-		0.8315f, -0.5556f, 0.0f,		0.707875f, 0.3125f,			//175
-		0.7682f, -0.5556f, -0.3182f,	0.75984375f, 0.3125f,		//176
-		0.5879f, -0.5556f, -0.5879f,	0.8118125f, 0.3125f,		//177
-		0.3182f, -0.5556f, -0.7682f,	0.86378125f, 0.3125f,		//178
-		0.0f, -0.5556f, -0.8315f,		0.91575f, 0.3125f,			//179 - seam
-		0.0f, -0.5556f, -0.8315f,		0.08425f, 0.3125f,			//180 - seam
-		-0.3182f, -0.5556f, -0.7682f,	0.13621875f, 0.3125f,		//181
-		-0.5879f, 0.5556f, -0.5879f,	0.1881875f, 0.3125f,		//182
-		-0.7682f, -0.5556f, -0.3182f,	0.24015625f, 0.3125f,		//183
-		-0.8315f, -0.5556f, 0.0f,		0.292125f, 0.3125f,			//184
-		-0.7682f, -0.5556f, 0.3182f,	0.34409375f, 0.3125f,		//185
-		-0.5879f, -0.5556f, 0.5879f,	0.3960625f, 0.3125f,		//186
-		-0.3182f, -0.5556f, 0.7682f,	0.44803125f, 0.3125f,		//187
-		// ring 12
-		0.0f, -0.7071f, 0.7071f,		0.5f, 0.25f,				//188
-		0.2706f, -0.7071f, 0.6533f,		0.54419375f, 0.25f,			//189
-		0.5f, -0.7071f, 0.5f,			0.5883875f, 0.25f,			//190
-		0.6533f, -0.7071f, 0.2706f,		0.63258125f, 0.25f,			//191
-		0.7071f, -0.7071f, 0.0f,		0.676775f, 0.25f,			//192
-		0.6533f, -0.7071f, -0.2706f,	0.72096875f, 0.25f,			//193
-		0.5f, -0.7071f, -0.5f,			0.7651625f, 0.25f,			//194
-		0.2706f, -0.7071f, -0.6533f,	0.80935625f, 0.25f,			//195
-		0.0f, -0.7071f, -0.7071f,		0.85355f, 0.25f,			//196 - seam
-		0.0f, -0.7071f, -0.7071f,		0.14645f, 0.25f,			//197 - seam
-		-0.2706f, -0.7071f, -0.6533f,	0.19064375f, 0.25f,			//198
-		-0.5f, -0.7071f, -0.5f,			0.2348375f, 0.25f,			//199
-		-0.6533f, -0.7071f, -0.2706f,	0.27903135f, 0.25f,			//200
-		-0.7071f, -0.7071f, 0.0f,		0.323225f, 0.25f,			//201
-		-0.6533f, -0.7071f, 0.2706f,	0.36741875f, 0.25f,			//202
-		-0.5f, -0.7071f, 0.5f,			0.4116125f, 0.25f,			//203
-		-0.2706f, -0.7071f, 0.6533f,	0.45580625f, 0.25f,			//204
-		// ring 13
-		0.0f, -0.8315f, 0.5556f,		0.5f, 0.1875f,				//205
-		0.2126f, -0.8315f, 0.5133f,		0.534725f, 0.1875f,			//206
-		0.3928f, -0.8315f, 0.3928f,		0.56945f, 0.1875f,			//207
-		0.5133f, -0.8315f, 0.2126f,		0.604175f, 0.1875f,			//208
-		0.5556f, -0.8315f, 0.0f,		0.6389f, 0.1875f,			//209
-		0.5133f, -0.8315f, -0.2126f,	0.673625f, 0.1875f,			//210
-		0.3928f, -0.8315f, -0.3928f,	0.70835f, 0.1875f,			//211
-		0.2126f, -0.8315f, -0.5133f,	0.743075f, 0.1875f,			//212
-		0.0f, -0.8315f, -0.5556f,		0.7778f, 0.1875f,			//213 - seam
-		0.0f, -0.8315f, -0.5556f,		0.2222f, 0.1875f,			//214 - seam
-		-0.2126f, -0.8315f, -0.5133f,	0.256925f, 0.1875f,			//215
-		-0.3928f, -0.8315f, -0.3928f,	0.29165f, 0.1875f,			//216
-		-0.5133f, -0.8315f, -0.2126f,	0.326375f, 0.1875f,			//217
-		-0.5556f, -0.8315f, 0.0f,		0.3611f, 0.1875f,			//218
-		-0.5133f, -0.8315f, 0.2126f,	0.395825f, 0.1875f,			//219
-		-0.3928f, -0.8315f, 0.3928f,	0.43055f, 0.1875f,			//220
-		-0.2126f, -0.8315f, 0.5133f,	0.465275f, 0.1875f,			//221
-		// ring 14
-		0.0f, -0.9239f, 0.3827f,		0.5f, 0.125f,				//222
-		0.1464f, -0.9239f, 0.3536f,		0.52391875f, 0.125f,		//223
-		0.2706f, -0.9239f, 0.2706f,		0.5478375f, 0.125f,			//224
-		0.3536f, -0.9239f, 0.1464f,		0.57175625f, 0.125f,		//225
-		0.3827f, -0.9239f, 0.0f,		0.5956755f, 0.125f,			//226
-		0.3536f, -0.9239f, -0.1464f,	0.61959425f, 0.125f,		//227
-		0.2706f, -0.9239f, -0.2706f,	0.643513f, 0.125f,			//228
-		0.1464f, -0.9239f, -0.3536f,	0.66743175f, 0.125f,		//229
-		0.0f, -0.9239f, -0.3827f,		0.6913505f, 0.125f,			//230 - seam
-		0.0f, -0.9239f, -0.3827f,		0.3086495f, 0.125f,			//231 - seam
-		-0.1464f, -0.9239f, -0.3536f,	0.33256825f, 0.125f,		//232
-		-0.2706f, -0.9239f, -0.2706f,	0.356487f, 0.125f,			//233
-		-0.3536f, -0.9239f, -0.1464f,	0.38040575f, 0.125f,		//234
-		-0.3827f, -0.9239f, 0.0f,		0.4043245f, 0.125f,			//235
-		-0.3536f, -0.9239f, 0.1464f,	0.42824325f, 0.125f,		//236
-		-0.2706f, -0.9239f, 0.2706f,	0.452162f, 0.125f,			//237
-		-0.1464f, -0.9239f, 0.3536f,	0.47608075f, 0.125f,		//238
-		// ring 15
-		0.0f, -0.9808f, 0.1951f,		0.5f, 0.0625f,				//239
-		0.0747f, -0.9808f, 0.1802f,		0.51219375f, 0.0625f,		//240
-		0.1379f, -0.9808f, 0.1379f,		0.5243875f, 0.0625f,		//241
-		0.1802f, -0.9808f, 0.0747f,		0.53658125f, 0.0625f,		//242
-		0.1951f, -0.9808, 0.0f,			0.548775f, 0.0625f,			//243
-		0.1802f, -0.9808f, -0.0747f,	0.56096875f, 0.0625f,		//244
-		0.1379f, -0.9808f, -0.1379f,	0.5731625f, 0.0625f,		//245
-		0.0747f, -0.9808f, -0.1802f,	0.58535625f, 0.0625f,		//246
-		0.0f, -0.9808f, -0.1951f,		0.59755f, 0.0625f,			//247 - seam
-		0.0f, -0.9808f, -0.1951f,		0.40245f, 0.0625f,			//248 - seam
-		-0.0747f, -0.9808f, -0.1802f,	0.41464375f, 0.0625f,		//249
-		-0.1379f, -0.9808f, -0.1379f,	0.4268375f, 0.0625f,		//250
-		-0.1802f, -0.9808f, -0.0747f,	0.43903125f, 0.0625f,		//251
-		-0.1951f, -0.9808, 0.0f,		0.451225f, 0.0625f,			//252
-		-0.1802f, -0.9808f, 0.0747f,	0.46341875f, 0.0625f,		//253
-		-0.1379f, -0.9808f, 0.1379f,	0.4756125f, 0.0625f,		//254
-		-0.0747f, -0.9808f, 0.1802f,	0.48780625f, 0.0625f,		//255
-		// bottom center point
-		0.0f, -1.0f, 0.0f,				0.5f, 0.0f					//256
-	};
-
-	// index data
-	GLuint indices[] = {
-		//ring 1 - top
-		0,10,11,
-		0,11,12,
-		0,12,13,
-		0,13,14,
-		0,14,15,
-		0,15,16,
-		0,16,17,
-		0,17,1,
-		0,1,2,
-		0,2,3,
-		0,3,4,
-		0,4,5,
-		0,5,6,
-		0,6,7,
-		0,7,8,
-		0,8,9,
-		0,9,10,
-
-		// ring 1 to ring 2
-		10,27,28,
-		10,11,28,
-		11,28,29,
-		11,12,29,
-		12,29,30,
-		12,13,30,
-		13,30,31,
-		13,14,31,
-		14,31,32,
-		14,15,32,
-		15,32,33,
-		15,16,33,
-		16,33,34,
-		16,17,34,
-		17,34,18,
-		17,1,18,
-		1,18,19,
-		1,2,19,
-		2,19,20,
-		2,3,20,
-		3,20,21,
-		3,4,21,
-		4,21,22,
-		4,5,22,
-		5,22,23,
-		5,6,23,
-		6,23,24,
-		6,7,24,
-		7,24,25,
-		7,8,25,
-		8,25,26,
-		8,9,26,
-		9,26,27,
-		9,10,27,
-
-		// ring 2 to ring 3
-		27,44,45,
-		27,28,45,
-		28,45,46,
-		28,29,46,
-		29,46,47,
-		29,30,47,
-		30,47,48,
-		30,31,48,
-		31,48,49,
-		31,32,49,
-		32,49,50,
-		32,33,50,
-		33,50,51,
-		33,34,51,
-		34,51,35,
-		34,18,35,
-		18,35,36,
-		18,19,36,
-		19,36,37,
-		19,20,37,
-		20,37,38,
-		20,21,38,
-		21,38,39,
-		21,22,39,
-		22,39,40,
-		22,23,40,
-		23,40,41,
-		23,24,41,
-		24,41,42,
-		24,25,42,
-		25,42,43,
-		25,26,43,
-		26,43,44,
-		26,27,44,
-
-		// ring 3 to ring 4
-		44,61,62,
-		44,45,62,
-		45,62,63,
-		45,46,63,
-		46,63,64,
-		46,47,64,
-		47,64,65,
-		47,48,65,
-		48,65,66,
-		48,49,66,
-		49,66,67,
-		49,50,67,
-		50,67,68,
-		50,51,68,
-		51,68,52,
-		51,35,52,
-		35,52,53,
-		35,36,53,
-		36,53,54,
-		36,37,54,
-		37,54,55,
-		37,38,55,
-		38,55,56,
-		38,39,56,
-		39,56,57,
-		39,40,57,
-		40,57,58,
-		40,41,58,
-		41,58,59,
-		41,42,59,
-		42,59,60,
-		42,43,60,
-		43,60,61,
-		43,44,61,
-
-		// ring 4 to ring 5
-		61,78,79,
-		61,62,79,
-		62,79,80,
-		62,63,80,
-		63,80,81,
-		63,64,81,
-		64,81,82,
-		64,65,82,
-		65,82,83,
-		65,66,83,
-		66,83,84,
-		66,67,84,
-		67,84,85,
-		67,68,85,
-		68,85,69,
-		68,52,69,
-		52,69,70,
-		52,53,70,
-		53,70,71,
-		53,54,71,
-		54,71,72,
-		54,55,72,
-		55,72,73,
-		55,56,73,
-		56,73,74,
-		56,57,74,
-		57,74,75,
-		57,58,75,
-		58,75,76,
-		58,59,76,
-		59,76,77,
-		59,60,77,
-		60,77,78,
-		60,61,78,
-
-		// ring 5 to ring 6
-		78,95,96,
-		78,79,96,
-		79,96,97,
-		79,80,97,
-		80,97,98,
-		80,81,98,
-		81,98,99,
-		81,82,99,
-		82,99,100,
-		82,83,100,
-		83,100,101,
-		83,84,101,
-		84,101,102,
-		84,85,102,
-		85,102,86,
-		85,69,86,
-		69,86,87,
-		69,70,87,
-		70,87,88,
-		70,71,88,
-		71,88,89,
-		71,72,89,
-		72,89,90,
-		72,73,90,
-		73,90,91,
-		73,74,91,
-		74,91,92,
-		74,75,92,
-		75,92,93,
-		75,76,93,
-		76,93,94,
-		76,77,94,
-		77,94,95,
-		77,78,95,
-
-		// ring 6 to ring 7
-		95,112,113,
-		95,96,113,
-		96,113,114,
-		96,97,114,
-		97,114,115,
-		97,98,115,
-		98,115,116,
-		98,99,116,
-		99,116,117,
-		99,100,117,
-		100,117,118,
-		100,101,118,
-		101,118,119,
-		101,102,119,
-		102,119,103,
-		102,86,103,
-		86,103,104,
-		86,87,104,
-		87,104,105,
-		87,88,105,
-		88,105,106,
-		88,89,106,
-		89,106,107,
-		89,90,107,
-		90,107,108,
-		90,91,108,
-		91,108,109,
-		91,92,109,
-		92,109,110,
-		92,93,110,
-		93,110,111,
-		93,94,111,
-		94,111,112,
-		94,95,112,
-
-		// ring 7 to ring 8
-		112,129,130,
-		112,113,130,
-		113,130,131,
-		113,114,131,
-		114,131,132,
-		114,115,132,
-		115,132,133,
-		115,116,133,
-		116,133,134,
-		116,117,134,
-		117,134,135,
-		117,118,135,
-		118,135,136,
-		118,119,136,
-		119,136,120,
-		119,103,120,
-		103,120,121,
-		103,104,121,
-		104,121,122,
-		104,105,122,
-		105,122,123,
-		105,106,123,
-		106,123,124,
-		106,107,124,
-		107,124,125,
-		107,108,125,
-		108,125,126,
-		108,109,126,
-		109,126,127,
-		109,110,127,
-		110,127,128,
-		110,111,128,
-		111,128,129,
-		111,112,129,
-
-		// ring 8 to ring 9
-		129,146,147,
-		129,130,147,
-		130,147,148,
-		130,131,148,
-		131,148,149,
-		131,132,149,
-		132,149,150,
-		132,133,150,
-		133,150,151,
-		133,134,151,
-		134,151,152,
-		134,135,152,
-		135,152,153,
-		135,136,153,
-		136,153,137,
-		136,120,137,
-		120,137,138,
-		120,121,138,
-		121,138,139,
-		121,122,139,
-		122,139,140,
-		122,123,140,
-		123,140,141,
-		123,124,141,
-		124,141,142,
-		124,125,142,
-		125,142,143,
-		125,126,143,
-		126,143,144,
-		126,127,144,
-		127,144,145,
-		127,128,145,
-		128,145,146,
-		128,129,146,
-
-		// ring 9 to ring 10
-		146,163,164,
-		146,147,164,
-		147,164,165,
-		147,148,165,
-		148,165,166,
-		148,149,166,
-		149,166,167,
-		149,150,167,
-		150,167,168,
-		150,151,168,
-		151,168,169,
-		151,152,169,
-		152,169,170,
-		152,153,170,
-		153,170,154,
-		153,137,154,
-		137,154,155,
-		137,138,155,
-		138,155,156,
-		138,139,156,
-		139,156,157,
-		139,140,157,
-		140,157,158,
-		140,141,158,
-		141,158,159,
-		141,142,159,
-		142,159,160,
-		142,143,160,
-		143,160,161,
-		143,144,161,
-		144,161,162,
-		144,145,162,
-		145,162,163,
-		145,146,163,
-
-		// ring 10 to ring 11
-		163,180,181,
-		163,164,181,
-		164,181,182,
-		164,165,182,
-		165,182,183,
-		165,166,183,
-		166,183,184,
-		166,167,184,
-		167,184,185,
-		167,168,185,
-		168,185,186,
-		168,169,186,
-		169,186,187,
-		169,170,187,
-		170,187,171,
-		170,154,171,
-		154,171,172,
-		154,155,172,
-		155,172,173,
-		155,156,173,
-		156,173,174,
-		156,157,174,
-		157,174,175,
-		157,158,175,
-		158,175,176,
-		158,159,176,
-		159,176,177,
-		159,160,177,
-		160,177,178,
-		160,161,178,
-		161,178,179,
-		161,162,179,
-		162,179,180,
-		162,163,180,
-
-		// ring 11 to ring 12
-		180,197,198,
-		180,181,198,
-		181,198,199,
-		181,182,199,
-		182,199,200,
-		182,183,200,
-		183,200,201,
-		183,184,201,
-		184,201,202,
-		184,185,202,
-		185,202,203,
-		185,186,203,
-		186,203,204,
-		186,187,204,
-		187,204,188,
-		187,171,188,
-		171,188,189,
-		171,172,189,
-		172,189,190,
-		172,173,190,
-		173,190,191,
-		173,174,191,
-		174,191,192,
-		174,175,192,
-		175,192,193,
-		175,176,193,
-		176,193,194,
-		176,177,194,
-		177,194,195,
-		177,178,195,
-		178,195,196,
-		178,179,196,
-		179,196,197,
-		179,180,197,
-
-		// ring 12 to ring 13
-		197,214,215,
-		197,198,215,
-		198,215,216,
-		198,199,216,
-		199,216,217,
-		199,200,217,
-		200,217,218,
-		200,201,218,
-		201,218,219,
-		201,202,219,
-		202,219,220,
-		202,203,220,
-		203,220,221,
-		203,204,221,
-		204,221,205,
-		204,188,205,
-		188,205,206,
-		188,189,206,
-		189,206,207,
-		189,190,207,
-		190,207,208,
-		190,191,208,
-		191,208,209,
-		191,192,209,
-		192,209,210,
-		192,193,210,
-		193,210,211,
-		193,194,211,
-		194,211,212,
-		194,195,212,
-		195,212,213,
-		195,196,213,
-		196,213,214,
-		196,197,214,
-
-		// ring 13 to ring 14
-		214,231,232,
-		214,215,232,
-		215,232,233,
-		215,216,233,
-		216,233,234,
-		216,217,234,
-		217,234,235,
-		217,218,235,
-		218,235,236,
-		218,219,236,
-		219,236,237,
-		219,220,237,
-		220,237,238,
-		220,221,238,
-		221,238,222,
-		221,205,222,
-		205,222,223,
-		205,206,223,
-		206,223,224,
-		206,207,224,
-		207,224,225,
-		207,208,225,
-		208,225,226,
-		208,209,226,
-		209,226,227,
-		209,210,227,
-		210,227,228,
-		210,211,228,
-		211,228,229,
-		211,212,229,
-		212,229,230,
-		212,213,230,
-		213,230,231,
-		213,214,231,
-
-		// ring 14 to ring 15
-		231,248,249,
-		231,232,249,
-		232,249,250,
-		232,233,250,
-		233,250,251,
-		233,234,251,
-		234,251,252,
-		234,235,252,
-		235,252,253,
-		235,236,253,
-		236,253,254,
-		236,237,254,
-		237,254,255,
-		237,238,255,
-		238,255,239,
-		238,222,239,
-		222,239,240,
-		222,223,240,
-		223,240,241,
-		223,224,241,
-		224,241,242,
-		224,225,242,
-		225,242,243,
-		225,226,243,
-		226,243,244,
-		226,227,244,
-		227,244,245,
-		227,228,245,
-		228,245,246,
-		228,229,246,
-		229,246,247,
-		229,230,247,
-		230,247,248,
-		230,231,248,
-
-		// ring 15 - bottom
-		248,256,249,
-		249,256,250,
-		250,256,251,
-		251,256,252,
-		252,256,253,
-		253,256,254,
-		254,256,255,
-		255,256,239,
-		239,256,240,
-		240,256,241,
-		241,256,242,
-		242,256,243,
-		243,256,244,
-		244,256,245,
-		245,256,246,
-		246,256,247,
-		247,256,248
-	};
-
-	// total float values per each type
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerNormal = 3;
-	const GLuint floatsPerUV = 2;
-
-	// store vertex and index count
-	m_SphereMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (floatsPerVertex));
-	m_SphereMesh.nIndices = sizeof(indices) / (sizeof(indices[0]));
-
-	glm::vec3 normal;
-	glm::vec3 vert;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	float u, v;
-	std::vector<GLfloat> combined_values;
-
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < sizeof(verts) / (sizeof(verts[0])); i += 5)
-	{
-		vert = glm::vec3(verts[i], verts[i + 1], verts[i + 2]);
-		normal = normalize(vert - center);
-		//u = atan2(normal.x, normal.z) / (2 * PI) + 0.5;
-		//v = normal.y * 0.5 + 0.5;
-		combined_values.push_back(vert.x);
-		combined_values.push_back(vert.y);
-		combined_values.push_back(vert.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(verts[i + 3]);
-		combined_values.push_back(verts[i + 4]);
-	}
-
-	// Create VAO
-	glGenVertexArrays(1, &m_SphereMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_SphereMesh.vao);
-
-	// Create VBOs
-	glGenBuffers(2, m_SphereMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_SphereMesh.vbos[0]); // Activates the vertex buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereMesh.vbos[1]); // Activates the index buffer
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	if (m_bMemoryLayoutDone == false)
+	for (int level = 0; level < MAX_LOD_LEVELS; level++)
 	{
-		SetShaderMemoryLayout();
+		int lodRings = LodResolution(rings, level, 4);
+		int lodSegments = LodResolution(segments, level, 6);
+		AddGeneratedMesh(m_SphereMesh, "sphere", MeshGenerators::GenerateSphere(lodRings, lodSegments), level);
 	}
 }
 
 ///////////////////////////////////////////////////
 //	LoadTaperedCylinderMesh()
 //
-//	Create a tapered cylinder mesh by specifying the 
-//  vertices and store it in a VAO/VBO.  The normals 
-//  and texture coordinates are also set.
-//
-//  Correct triangle drawing commands:
+//	Generate a tapered cylinder mesh, with a top half
+//  as wide as the bottom, with the passed number of
+//  segments and append it to the shared arena.
 //
-//	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-//	glDrawArrays(GL_TRIANGLE_FAN, 36, 72);		//top
-//	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+//  Drawable parts: 0 = bottom, 1 = top, 2 = sides
+//  Levels of detail: MAX_LOD_LEVELS, fewer segments
 ///////////////////////////////////////////////////
-void ShapeMeshes::LoadTaperedCylinderMesh()
+void ShapeMeshes::LoadTaperedCylinderMesh(int segments)
 {
-	GLfloat verts[] = {
-		// cylinder bottom		// normals			// texture coords
-		1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f,1.0f,
-		.98f, 0.0f, -0.17f,		0.0f, -1.0f, 0.0f,	0.41f, 0.983f,
-		.94f, 0.0f, -0.34f,		0.0f, -1.0f, 0.0f,	0.33f, 0.96f,
-		.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.92f,
-		.77f, 0.0f, -0.64f,		0.0f, -1.0f, 0.0f,	0.17f, 0.87f,
-		.64f, 0.0f, -0.77f,		0.0f, -1.0f, 0.0f,	0.13f, 0.83f,
-		.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.77f,
-		.34f, 0.0f, -0.94f,		0.0f, -1.0f, 0.0f,	0.04f, 0.68f,
-		.17f, 0.0f, -0.98f,		0.0f, -1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 0.0f, -1.0f,		0.0f, -1.0f, 0.0f,	0.0f,0.5f,
-		-.17f, 0.0f, -0.98f,	0.0f, -1.0f, 0.0f,	0.017f, 0.41f,
-		-.34f, 0.0f, -0.94f,	0.0f, -1.0f, 0.0f,	0.04f, 0.33f,
-		-.5f, 0.0f, -0.87f,		0.0f, -1.0f, 0.0f,	0.08f, 0.25f,
-		-.64f, 0.0f, -0.77f,	0.0f, -1.0f, 0.0f,	0.13f, 0.17f,
-		-.77f, 0.0f, -0.64f,	0.0f, -1.0f, 0.0f,	0.17f, 0.13f,
-		-.87f, 0.0f, -0.5f,		0.0f, -1.0f, 0.0f,	0.25f, 0.08f,
-		-.94f, 0.0f, -0.34f,	0.0f, -1.0f, 0.0f,	0.33f, 0.04f,
-		-.98f, 0.0f, -0.17f,	0.0f, -1.0f, 0.0f,	0.41f, 0.017f,
-		-1.0f, 0.0f, 0.0f,		0.0f, -1.0f, 0.0f,	0.5f, 0.0f,
-		-.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.017f,
-		-.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.04f,
-		-.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.08f,
-		-.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.13f,
-		-.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.17f,
-		-.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.25f,
-		-.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.33f,
-		-.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 0.0f, 1.0f,		0.0f, -1.0f, 0.0f,	1.0f, 0.5f,
-		.17f, 0.0f, 0.98f,		0.0f, -1.0f, 0.0f,	0.983f, 0.6f,
-		.34f, 0.0f, 0.94f,		0.0f, -1.0f, 0.0f,	0.96f, 0.68f,
-		.5f, 0.0f, 0.87f,		0.0f, -1.0f, 0.0f,	0.92f, 0.77f,
-		.64f, 0.0f, 0.77f,		0.0f, -1.0f, 0.0f,	0.87f, 0.83f,
-		.77f, 0.0f, 0.64f,		0.0f, -1.0f, 0.0f,	0.83f, 0.87f,
-		.87f, 0.0f, 0.5f,		0.0f, -1.0f, 0.0f,	0.77f, 0.92f,
-		.94f, 0.0f, 0.34f,		0.0f, -1.0f, 0.0f,	0.68f, 0.96f,
-		.98f, 0.0f, 0.17f,		0.0f, -1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder top			// normals			// texture coords
-		0.5f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f,1.0f,
-		.49f, 1.0f, -0.085f,	0.0f, 1.0f, 0.0f,	0.41f, 0.983f,
-		.47f, 1.0f, -0.17f,		0.0f, 1.0f, 0.0f,	0.33f, 0.96f,
-		.435f, 1.0f, -0.25f,	0.0f, 1.0f, 0.0f,	0.25f, 0.92f,
-		.385f, 1.0f, -0.32f,	0.0f, 1.0f, 0.0f,	0.17f, 0.87f,
-		.32f, 1.0f, -0.385f,	0.0f, 1.0f, 0.0f,	0.13f, 0.83f,
-		.25f, 1.0f, -0.435f,	0.0f, 1.0f, 0.0f,	0.08f, 0.77f,
-		.17f, 1.0f, -0.47f,		0.0f, 1.0f, 0.0f,	0.04f, 0.68f,
-		.085f, 1.0f, -0.49f,	0.0f, 1.0f, 0.0f,	0.017f, 0.6f,
-		0.0f, 1.0f, -0.5f,		0.0f, 1.0f, 0.0f,	0.0f,0.5f,
-		-.085f, 1.0f, -0.49f,	0.0f, 1.0f, 0.0f,	0.017f, 0.41f,
-		-.17f, 1.0f, -0.47f,	0.0f, 1.0f, 0.0f,	0.04f, 0.33f,
-		-.25f, 1.0f, -0.435f,	0.0f, 1.0f, 0.0f,	0.08f, 0.25f,
-		-.32f, 1.0f, -0.385f,	0.0f, 1.0f, 0.0f,	0.13f, 0.17f,
-		-.385f, 1.0f, -0.32f,	0.0f, 1.0f, 0.0f,	0.17f, 0.13f,
-		-.435f, 1.0f, -0.25f,	0.0f, 1.0f, 0.0f,	0.25f, 0.08f,
-		-.47f, 1.0f, -0.17f,	0.0f, 1.0f, 0.0f,	0.33f, 0.04f,
-		-.49f, 1.0f, -0.085f,	0.0f, 1.0f, 0.0f,	0.41f, 0.017f,
-		-0.5f, 1.0f, 0.0f,		0.0f, 1.0f, 0.0f,	0.5f, 0.0f,
-		-.49f, 1.0f, 0.085f,	0.0f, 1.0f, 0.0f,	0.6f, 0.017f,
-		-.47f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.68f, 0.04f,
-		-.435f, 1.0f, 0.25f,	0.0f, 1.0f, 0.0f,	0.77f, 0.08f,
-		-.385f, 1.0f, 0.32f,	0.0f, 1.0f, 0.0f,	0.83f, 0.13f,
-		-.32f, 1.0f, 0.385f,	0.0f, 1.0f, 0.0f,	0.87f, 0.17f,
-		-.25f, 1.0f, 0.435f,	0.0f, 1.0f, 0.0f,	0.92f, 0.25f,
-		-.17f, 1.0f, 0.47f,		0.0f, 1.0f, 0.0f,	0.96f, 0.33f,
-		-.085f, 1.0f, 0.49f,	0.0f, 1.0f, 0.0f,	0.983f, 0.41f,
-		0.0f, 1.0f, 0.5f,		0.0f, 1.0f, 0.0f,	1.0f, 0.5f,
-		.085f, 1.0f, 0.49f,		0.0f, 1.0f, 0.0f,	0.983f, 0.6f,
-		.17f, 1.0f, 0.47f,		0.0f, 1.0f, 0.0f,	0.96f, 0.68f,
-		.25f, 1.0f, 0.435f,		0.0f, 1.0f, 0.0f,	0.92f, 0.77f,
-		.32f, 1.0f, 0.385f,		0.0f, 1.0f, 0.0f,	0.87f, 0.83f,
-		.385f, 1.0f, 0.32f,		0.0f, 1.0f, 0.0f,	0.83f, 0.87f,
-		.435f, 1.0f, 0.25f,		0.0f, 1.0f, 0.0f,	0.77f, 0.92f,
-		.47f, 1.0f, 0.17f,		0.0f, 1.0f, 0.0f,	0.68f, 0.96f,
-		.49f, 1.0f, 0.085f,		0.0f, 1.0f, 0.0f,	0.6f, 0.983f,
-
-		// cylinder body		// normals							// texture coords
-		0.5f, 1.0f, 0.0f,		0.993150651, 0.5f, -0.116841137f,	0.25,1.0,
-		1.0f, 0.0f, 0.0f,		0.993150651, 0.5f, -0.116841137f,	0.0,0.0,
-		.98f, 0.0f, -0.17f,		0.993150651, 0.5f, -0.116841137f,	0.0277,0.0,
-		0.5f, 1.0f, 0.0f,		0.993150651, 0.5f, -0.116841137f, 	0.25,1.0,
-		.49f, 1.0f, -0.085f,	0.993150651, 0.5f, -0.116841137f, 	0.2635,1.0,
-		.98f, 0.0f, -0.17f,		0.993150651, 0.5f, -0.116841137f,	0.0277,0.0,
-		.94f, 0.0f, -0.34f,		0.993417103f, 0.5f, -0.229039446f,	0.0554,0.0,
-		.49f, 1.0f, -0.085f,	0.993417103f, 0.5f, -0.229039446f,	0.2635,1.0,
-		.47f, 1.0f, -0.17f,		0.993417103f, 0.5f, -0.229039446f,	0.277,1.0,
-		.94f, 0.0f, -0.34f,		0.993417103f, 0.5f, -0.229039446f,	0.0554,0.0,
-		.87f, 0.0f, -0.5f,		0.993417103f, 0.5f, -0.229039446f,	0.0831,0.0,
-		.47f, 1.0f, -0.17f,		0.993417103f, 0.5f, -0.229039446f,	0.277,1.0,
-		.435f, 1.0f, -0.25f,	0.813733339f, 0.5f, -0.581238329f,	0.2905,1.0,
-		.87f, 0.0f, -0.5f,		0.813733339f, 0.5f, -0.581238329f,	0.0831,0.0,
-		.77f, 0.0f, -0.64f,		0.813733339f, 0.5f, -0.581238329f,	0.1108,0.0,
-		.435f, 1.0f, -0.25f,	0.813733339f, 0.5f, -0.581238329f,	0.2905,1.0,
-		.385f, 1.0f, -0.32f,	0.813733339f, 0.5f, -0.581238329f,	0.304,1.0,
-		.77f, 0.0f, -0.64f,		0.813733339f, 0.5f, -0.581238329f,	0.1108,0.0,
-		.64f, 0.0f, -0.77f,		0.707106769f, 0.5f, -0.707106769f,	0.1385,0.0,
-		.385f, 1.0f, -0.32f,	0.707106769f, 0.5f, -0.707106769f,	0.304,1.0,
-		.32f, 1.0f, -0.385f,	0.707106769f, 0.5f, -0.707106769f,	0.3175,1.0,
-		.64f, 0.0f, -0.77f,		0.707106769f, 0.5f, -0.707106769f,	0.1385,0.0,
-		.5f, 0.0f, -0.87f,		0.707106769f, 0.5f, -0.707106769f,	0.1662,0.0,
-		.32f, 1.0f, -0.385f,	0.707106769f, 0.5f, -0.707106769f,	0.3175, 1.0,
-		.25f, 1.0f, -0.435f,	0.400818795f, 0.5f, -0.916157305f,	0.331, 1.0,
-		.5f, 0.0f, -0.87f,		0.400818795f, 0.5f, -0.916157305f,	0.1662, 0.0,
-		.34f, 0.0f, -0.94f,		0.400818795f, 0.5f, -0.916157305f,	0.1939, 0.0,
-		.25f, 1.0f, -0.435f,	0.400818795f, 0.5f, -0.916157305f,	0.331, 1.0,
-		.17f, 1.0f, -0.47f,		0.400818795f, 0.5f, -0.916157305f,	0.3445, 1.0,
-		.34f, 0.0f, -0.94f,		0.400818795f, 0.5f, -0.916157305f,	0.1939, 0.0,
-		.17f, 0.0f, -0.98f,		0.229039446f, 0.5f, -0.973417103f,	0.2216, 0.0,
-		.17f, 1.0f, -0.47f,		0.229039446f, 0.5f, -0.973417103f,	0.3445, 1.0,
-		.085f, 1.0f, -0.49f,	0.229039446f, 0.5f, -0.973417103f,	0.358, 1.0,
-		.17f, 0.0f, -0.98f,		0.229039446f, 0.5f, -0.973417103f,	0.2216, 0.0,
-		0.0f, 0.0f, -1.0f,		0.229039446f, 0.5f, -0.973417103f,	0.2493, 0.0,
-		.085f, 1.0f, -0.49f,	0.229039446f, 0.5f, -0.973417103f,	0.358, 1.0,
-		0.0f, 1.0f, -0.5f,		-0.116841137f, 0.5f, -0.993150651f,	0.3715, 1.0,
-		0.0f, 0.0f, -1.0f,		-0.116841137f, 0.5f, -0.993150651f,	0.2493, 0.0,
-		-.17f, 0.0f, -0.98f,	-0.116841137f, 0.5f, -0.993150651f,	0.277, 0.0,
-		0.0f, 1.0f, -0.5f,		-0.116841137f, 0.5f, -0.993150651f,	0.3715, 1.0,
-		-.085f, 1.0f, -0.49f,	-0.116841137f, 0.5f, -0.993150651f,	0.385, 1.0,
-		-.17f, 0.0f, -0.98f,	-0.116841137f, 0.5f, -0.993150651f,	0.277, 0.0,
-		-.34f, 0.0f, -0.94f,	-0.229039446f, 0.5f, -0.973417103f,	0.3047, 0.0,
-		-.085f, 1.0f, -0.49f,	-0.229039446f, 0.5f, -0.973417103f,	0.385, 1.0,
-		-.17f, 1.0f, -0.47f,	-0.229039446f, 0.5f, -0.973417103f,	0.3985, 1.0,
-		-.34f, 0.0f, -0.94f,	-0.229039446f, 0.5f, -0.973417103f,	0.3047, 0.0,
-		-.5f, 0.0f, -0.87f,		-0.229039446f, 0.5f, -0.973417103f,	0.3324, 0.0,
-		-.17f, 1.0f, -0.47f,	-0.229039446f, 0.5f, -0.973417103f,	0.3985, 1.0,
-		-.25f, 1.0f, -0.435f,	-0.581238329f, 0.5f, -0.581238329f,	0.412, 1.0,
-		-.5f, 0.0f, -0.87f,		-0.581238329f, 0.5f, -0.581238329f,	0.3324, 0.0,
-		-.64f, 0.0f, -0.77f,	-0.581238329f, 0.5f, -0.581238329f,	0.3601, 0.0,
-		-.25f, 1.0f, -0.435f,	-0.581238329f, 0.5f, -0.581238329f,	0.412, 1.0,
-		-.32f, 1.0f, -0.385f,	-0.581238329f, 0.5f, -0.581238329f,	0.4255, 1.0,
-		-.64f, 0.0f, -0.77f,	-0.581238329f, 0.5f, -0.581238329f,	0.3601, 0.0,
-		-.77f, 0.0f, -0.64f,	-0.707106769f, 0.5f, -0.707106769f,	0.3878, 0.0,
-		-.32f, 1.0f, -0.385f,	-0.707106769f, 0.5f, -0.707106769f,	0.4255, 1.0,
-		-.385f, 1.0f, -0.32f,	-0.707106769f, 0.5f, -0.707106769f,	0.439, 1.0,
-		-.77f, 0.0f, -0.64f,	-0.707106769f, 0.5f, -0.707106769f,	0.3878, 0.0,
-		-.87f, 0.0f, -0.5f,		-0.707106769f, 0.5f, -0.707106769f,	0.4155, 0.0,
-		-.385f, 1.0f, -0.32f,	-0.707106769f, 0.5f, -0.707106769f,	0.439, 1.0,
-		-.435f, 1.0f, -0.25f,	-0.916157305f, 0.5f, -0.400818795f,	0.4525, 1.0,
-		-.87f, 0.0f, -0.5f,		-0.916157305f, 0.5f, -0.400818795f,	0.4155, 0.0,
-		-.94f, 0.0f, -0.34f,	-0.916157305f, 0.5f, -0.400818795f,	0.4432, 0.0,
-		-.435f, 1.0f, -0.25f,	-0.916157305f, 0.5f, -0.400818795f,	0.4525, 1.0,
-		-.47f, 1.0f, -0.17f,	-0.916157305f, 0.5f, -0.400818795f,	0.466, 1.0,
-		-.94f, 0.0f, -0.34f,	-0.916157305f, 0.5f, -0.400818795f,	0.4432, 0.0,
-		-.98f, 0.0f, -0.17f,	-0.973417103f, 0.5f, -0.229039446f,	0.4709, 0.0,
-		-.47f, 1.0f, -0.17f,	-0.973417103f, 0.5f, -0.229039446f,	0.466, 1.0,
-		-.49f, 1.0f, -0.085f,	-0.973417103f, 0.5f, -0.229039446f,	0.4795, 1.0,
-		-.98f, 0.0f, -0.17f,	-0.973417103f, 0.5f, -0.229039446f,	0.4709, 0.0,
-		-1.0f, 0.0f, 0.0f,		-0.973417103f, 0.5f, -0.229039446f,	0.4986, 0.0,
-		-.49f, 1.0f, -0.085f,	-0.973417103f, 0.5f, -0.229039446f,	0.4795, 1.0,
-		-0.5f, 1.0f, 0.0f,		-0.993150651f, 0.5f, -0.116841137f,	0.493, 1.0,
-		-1.0f, 0.0f, 0.0f,		-0.993150651f, 0.5f, -0.116841137f,	0.4986, 0.0,
-		-.98f, 0.0f, 0.17f,		-0.993150651f, 0.5f, 0.116841137f,	0.5263, 0.0,
-		-0.5f, 1.0f, 0.0f,		-0.993150651f, 0.5f, 0.116841137f,	0.493, 1.0,
-		-.49f, 1.0f, 0.085f,	-0.993150651f, 0.5f, 0.116841137f,	0.5065, 1.0,
-		-.98f, 0.0f, 0.17f,		-0.993150651f, 0.5f, 0.116841137f,	0.5263, 0.0,
-		-.94f, 0.0f, 0.34f,		-0.973417103f, 0.5f, 0.229039446f,	0.554, 0.0,
-		-.49f, 1.0f, 0.085f,	-0.973417103f, 0.5f, 0.229039446f,	0.5065, 1.0,
-		-.47f, 1.0f, 0.17f,		-0.973417103f, 0.5f, 0.229039446f,	0.52, 1.0,
-		-.94f, 0.0f, 0.34f,		-0.973417103f, 0.5f, 0.229039446f,	0.554, 0.0,
-		-.87f, 0.0f, 0.5f,		-0.973417103f, 0.5f, 0.229039446f,	0.5817, 0.0,
-		-.47f, 1.0f, 0.17f,		-0.973417103f, 0.5f, 0.229039446f,	0.52, 1.0,
-		-.435f, 1.0f, 0.25f,	-0.813733339f, 0.5f, 0.581238329f,	0.5335, 1.0,
-		-.87f, 0.0f, 0.5f,		-0.813733339f, 0.5f, 0.581238329f,	0.5817, 0.0,
-		-.77f, 0.0f, 0.64f,		-0.813733339f, 0.5f, 0.581238329f,	0.6094, 0.0,
-		-.435f, 1.0f, 0.25f,	-0.813733339f, 0.5f, 0.581238329f,	0.5335, 1.0,
-		-.385f, 1.0f, 0.32f,	-0.813733339f, 0.5f, 0.581238329f,	0.547, 1.0,
-		-.77f, 0.0f, 0.64f,		-0.813733339f, 0.5f, 0.581238329f,	0.6094, 0.0,
-		-.64f, 0.0f, 0.77f,		-0.707106769f, 0.5f, 0.707106769f,	0.6371, 0.0,
-		-.385f, 1.0f, 0.32f,	-0.707106769f, 0.5f, 0.707106769f,	0.547, 1.0,
-		-.32f, 1.0f, 0.385f,	-0.707106769f, 0.5f, 0.707106769f,	0.5605, 1.0,
-		-.64f, 0.0f, 0.77f,		-0.707106769f, 0.5f, 0.707106769f,	0.6371, 0.0,
-		-.5f, 0.0f, 0.87f,		-0.707106769f, 0.5f, 0.707106769f,	0.6648, 0.0,
-		-.32f, 1.0f, 0.385f,	-0.707106769f, 0.5f, 0.707106769f,	0.5605, 1.0,
-		-.25f, 1.0f, 0.435f,	-0.400818795f, 0.5f, 0.916157305f,	0.574, 1.0,
-		-.5f, 0.0f, 0.87f,		-0.400818795f, 0.5f, 0.916157305f,	0.6648, 0.0,
-		-.34f, 0.0f, 0.94f,		-0.400818795f, 0.5f, 0.916157305f,	0.6925, 0.0,
-		-.25f, 1.0f, 0.435f,	-0.400818795f, 0.5f, 0.916157305f,	0.574, 1.0,
-		-.17f, 1.0f, 0.47f,		-0.400818795f, 0.5f, 0.916157305f,	0.5875, 1.0,
-		-.34f, 0.0f, 0.94f,		-0.400818795f, 0.5f, 0.916157305f,	0.6925, 0.0,
-		-.17f, 0.0f, 0.98f,		-0.229039446f, 0.5f, 0.973417103f,	0.7202, 0.0,
-		-.17f, 1.0f, 0.47f,		-0.229039446f, 0.5f, 0.973417103f,	0.5875, 1.0,
-		-.085f, 1.0f, 0.49f,	-0.229039446f, 0.5f, 0.973417103f,	0.601, 1.0,
-		-.17f, 0.0f, 0.98f,		-0.229039446f, 0.5f, 0.973417103f,	0.7202, 0.0,
-		0.0f, 0.0f, 1.0f,		-0.229039446f, 0.5f, 0.973417103f,	0.7479, 0.0,
-		-.085f, 1.0f, 0.49f,	-0.229039446f, 0.5f, 0.973417103f,	0.601, 1.0,
-		0.0f, 1.0f, 0.5f,		-0.116841137f, 0.5f, 0.993150651f,	0.6145, 1.0,
-		0.0f, 0.0f, 1.0f,		-0.116841137f, 0.5f, 0.993150651f,	0.7479, 0.0,
-		.17f, 0.0f, 0.98f,		0.116841137f, 0.5f, 0.993150651f,	0.7756, 0.0,
-		0.0f, 1.0f, 0.5f,		0.116841137f, 0.5f, 0.993150651f,	0.6145, 1.0,
-		.085f, 1.0f, 0.49f,		0.116841137f, 0.5f, 0.993150651f,	0.628, 1.0,
-		.17f, 0.0f, 0.98f,		0.116841137f, 0.5f, 0.993150651f,	0.7756, 0.0,
-		.34f, 0.0f, 0.94f,		0.229039446f, 0.5f, 0.973417103f,	0.8033, 0.0,
-		.085f, 1.0f, 0.49f,		0.229039446f, 0.5f, 0.973417103f,	0.628, 1.0,
-		.17f, 1.0f, 0.47f,		0.229039446f, 0.5f, 0.973417103f,	0.6415, 1.0,
-		.34f, 0.0f, 0.94f,		0.229039446f, 0.5f, 0.973417103f,	0.8033, 0.0,
-		.5f, 0.0f, 0.87f,		0.229039446f, 0.5f, 0.973417103f,	0.831, 0.0,
-		.17f, 1.0f, 0.47f,		0.229039446f, 0.5f, 0.973417103f,	0.6415, 1.0,
-		.25f, 1.0f, 0.435f,		0.581238329f, 0.5f, 0.813733339f,	0.655, 1.0,
-		.5f, 0.0f, 0.87f,		0.581238329f, 0.5f, 0.813733339f,	0.831, 0.0,
-		.64f, 0.0f, 0.77f,		0.581238329f, 0.5f, 0.813733339f,	0.8587, 0.0,
-		.25f, 1.0f, 0.435f,		0.581238329f, 0.5f, 0.813733339f,	0.655, 1.0,
-		.32f, 1.0f, 0.385f,		0.581238329f, 0.5f, 0.813733339f,	0.6685, 1.0,
-		.64f, 0.0f, 0.77f,		0.581238329f, 0.5f, 0.813733339f,	0.8587, 0.0,
-		.77f, 0.0f, 0.64f,		0.707106769f, 0.5f, 0.707106769f,	0.8864, 0.0,
-		.32f, 1.0f, 0.385f,		0.707106769f, 0.5f, 0.707106769f,	0.6685, 1.0,
-		.385f, 1.0f, 0.32f,		0.707106769f, 0.5f, 0.707106769f,	0.682, 1.0,
-		.77f, 0.0f, 0.64f,		0.707106769f, 0.5f, 0.707106769f,	0.8864, 0.0,
-		.87f, 0.0f, 0.5f,		0.707106769f, 0.5f, 0.707106769f,	0.9141, 0.0,
-		.385f, 1.0f, 0.32f,		0.707106769f, 0.5f, 0.707106769f,	0.682, 1.0,
-		.435f, 1.0f, 0.25f,		0.916157305f, 0.5f, 0.400818795f,	0.6955, 1.0,
-		.87f, 0.0f, 0.5f,		0.916157305f, 0.5f, 0.400818795f,	0.9141, 0.0,
-		.94f, 0.0f, 0.34f,		0.916157305f, 0.5f, 0.400818795f,	0.9418, 0.0,
-		.435f, 1.0f, 0.25f,		0.916157305f, 0.5f, 0.400818795f,	0.6955, 1.0,
-		.47f, 1.0f, 0.17f,		0.916157305f, 0.5f, 0.400818795f,	0.709, 1.0,
-		.94f, 0.0f, 0.34f,		0.916157305f, 0.5f, 0.400818795f,	0.9418, 1.0,
-		.98f, 0.0f, 0.17f,		0.973417103f, 0.5f, 0.229039446f,	0.9695, 0.0,
-		.47f, 1.0f, 0.17f,		0.973417103f, 0.5f, 0.229039446f,	0.709, 0.0,
-		.49f, 1.0f, 0.085f,		0.973417103f, 0.5f, 0.229039446f,	0.7225, 1.0,
-		.98f, 0.0f, 0.17f,		0.973417103f, 0.5f, 0.229039446f,	0.9695, 0.0,
-		1.0f, 0.0f, 0.0f,		0.973417103f, 0.5f, 0.229039446f,	1.0, 0.0,
-		.49f, 1.0f, 0.085f,		0.973417103f, 0.5f, 0.229039446f,	0.7225, 1.0,
-		0.5f, 1.0f, 0.0f,		0.993150651f, 0.5f, 0.116841137f,	0.75, 1.0,
-		1.0f, 0.0f, 0.0f,		0.993150651f, 0.5f, 0.116841137f,	1.0, 0.0
-	};
-
-	// store vertex and index count
-	m_TaperedCylinderMesh.nVertices = sizeof(verts) / (sizeof(verts[0]) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV));
-	m_TaperedCylinderMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_TaperedCylinderMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
-
-	// Create VBO
-	glGenBuffers(1, m_TaperedCylinderMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TaperedCylinderMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
+	for (int level = 0; level < MAX_LOD_LEVELS; level++)
 	{
-		SetShaderMemoryLayout();
+		int lodSegments = LodResolution(segments, level, 6);
+		AddGeneratedMesh(m_TaperedCylinderMesh, "tapered cylinder", MeshGenerators::GenerateTaperedCylinder(lodSegments), level);
 	}
 }
 
 ///////////////////////////////////////////////////
 //	LoadTorusMesh()
 //
-//	Create a torus mesh by specifying the vertices and 
-//  store it in a VAO/VBO.  The normals and texture
-//  coordinates are also set.
-//
-//	Correct triangle drawing command:
+//	Generate an indexed torus with the passed tube
+//  thickness and append it to the shared arena.
 //
-//	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
+//  Drawable parts: 0 = whole torus, 1 = half torus
+//  Levels of detail: MAX_LOD_LEVELS, fewer segments
 ///////////////////////////////////////////////////
 void ShapeMeshes::LoadTorusMesh(float thickness)
 {
-	int _mainSegments = 30;
-	int _tubeSegments = 30;
-	float _mainRadius = 1.0f;
-	float _tubeRadius = .1f;
-
+	float tubeRadius = .1f;
 	if (thickness <= 1.0)
 	{
-		_tubeRadius = thickness;
-	}
-
-	auto mainSegmentAngleStep = glm::radians(360.0f / float(_mainSegments));
-	auto tubeSegmentAngleStep = glm::radians(360.0f / float(_tubeSegments));
-
-	std::vector<glm::vec3> vertex_list;
-	std::vector<std::vector<glm::vec3>> segments_list;
-	std::vector<glm::vec2> texture_coords;
-	glm::vec3 center(0.0f, 0.0f, 0.0f);
-	glm::vec3 normal;
-	glm::vec3 vertex;
-	glm::vec2 text_coord;
-
-	// generate the torus vertices
-	auto currentMainSegmentAngle = 0.0f;
-	for (auto i = 0; i < _mainSegments; i++)
-	{
-		// Calculate sine and cosine of main segment angle
-		auto sinMainSegment = sin(currentMainSegmentAngle);
-		auto cosMainSegment = cos(currentMainSegmentAngle);
-		auto currentTubeSegmentAngle = 0.0f;
-		std::vector<glm::vec3> segment_points;
-		for (auto j = 0; j < _tubeSegments; j++)
-		{
-			// Calculate sine and cosine of tube segment angle
-			auto sinTubeSegment = sin(currentTubeSegmentAngle);
-			auto cosTubeSegment = cos(currentTubeSegmentAngle);
-
-			// Calculate vertex position on the surface of torus
-			auto surfacePosition = glm::vec3(
-				(_mainRadius + _tubeRadius * cosTubeSegment) * cosMainSegment,
-				(_mainRadius + _tubeRadius * cosTubeSegment) * sinMainSegment,
-				_tubeRadius * sinTubeSegment);
-
-			//vertex_list.push_back(surfacePosition);
-			segment_points.push_back(surfacePosition);
-
-			// Update current tube angle
-			currentTubeSegmentAngle += tubeSegmentAngleStep;
-		}
-		segments_list.push_back(segment_points);
-		segment_points.clear();
-
-		// Update main segment angle
-		currentMainSegmentAngle += mainSegmentAngleStep;
-	}
-
-	float horizontalStep = 1.0 / _mainSegments;
-	float verticalStep = 1.0 / _tubeSegments;
-	float u = 0.0;
-	float v = 0.0;
-
-	// connect the various segments together, forming triangles
-	for (int i = 0; i < _mainSegments; i++)
-	{
-		for (int j = 0; j < _tubeSegments; j++)
-		{
-			if (((i + 1) < _mainSegments) && ((j + 1) < _tubeSegments))
-			{
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i][j + 1]);
-				texture_coords.push_back(glm::vec2(u, v + verticalStep));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v + verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
-				vertex_list.push_back(segments_list[i + 1][j]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v));
-				vertex_list.push_back(segments_list[i + 1][j + 1]);
-				texture_coords.push_back(glm::vec2(u + horizontalStep, v - verticalStep));
-				vertex_list.push_back(segments_list[i][j]);
-				texture_coords.push_back(glm::vec2(u, v));
-			}
-			else
-			{
-				if (((i + 1) == _mainSegments) && ((j + 1) == _tubeSegments))
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[0][0]);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][0]);
-					texture_coords.push_back(glm::vec2(0, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				else if ((i + 1) == _mainSegments)
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][j + 1]);
-					texture_coords.push_back(glm::vec2(u, v + verticalStep));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					texture_coords.push_back(glm::vec2(0, v + verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[0][j]);
-					texture_coords.push_back(glm::vec2(0, v));
-					vertex_list.push_back(segments_list[0][j + 1]);
-					texture_coords.push_back(glm::vec2(0, v + verticalStep));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-				else if ((j + 1) == _tubeSegments)
-				{
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i][0]);
-					texture_coords.push_back(glm::vec2(u, 0));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-					vertex_list.push_back(segments_list[i + 1][j]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, v));
-					vertex_list.push_back(segments_list[i + 1][0]);
-					texture_coords.push_back(glm::vec2(u + horizontalStep, 0));
-					vertex_list.push_back(segments_list[i][j]);
-					texture_coords.push_back(glm::vec2(u, v));
-				}
-
-			}
-			v += verticalStep;
-		}
-		v = 0.0;
-		u += horizontalStep;
+		tubeRadius = thickness;
 	}
 
-	std::vector<GLfloat> combined_values;
-
-	// combine interleaved vertices, normals, and texture coords
-	for (int i = 0; i < vertex_list.size(); i++)
-	{
-		vertex = vertex_list[i];
-		normal = normalize(vertex);
-		if (vertex.x < 0)
-		{
-			if (normal.x > 0)
-				normal.x *= -1;
-		}
-		else if (vertex.x > 0)
-		{
-			if (normal.x < 0)
-				normal.x *= -1;
-		}
-		if (vertex.y < 0)
-		{
-			if (normal.y > 0)
-				normal.y *= -1;
-		}
-		else if (vertex.y > 0)
-		{
-			if (normal.y < 0)
-				normal.y *= -1;
-		}
-		if (vertex.z < 0)
-		{
-			if (normal.z > 0)
-				normal.z *= -1;
-		}
-		else if (vertex.z > 0)
-		{
-			if (normal.z < 0)
-				normal.z *= -1;
-		}
-		text_coord = texture_coords[i];
-		combined_values.push_back(vertex.x);
-		combined_values.push_back(vertex.y);
-		combined_values.push_back(vertex.z);
-		combined_values.push_back(normal.x);
-		combined_values.push_back(normal.y);
-		combined_values.push_back(normal.z);
-		combined_values.push_back(text_coord.x);
-		combined_values.push_back(text_coord.y);
-	}
-
-	// store vertex and index count
-	m_TorusMesh.nVertices = vertex_list.size();
-	m_TorusMesh.nIndices = 0;
-
-	// Create VAO
-	glGenVertexArrays(1, &m_TorusMesh.vao); // we can also generate multiple VAOs or buffers at the same time
-	glBindVertexArray(m_TorusMesh.vao);
-
-	// Create VBOs
-	glGenBuffers(1, m_TorusMesh.vbos);
-	glBindBuffer(GL_ARRAY_BUFFER, m_TorusMesh.vbos[0]); // Activates the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * combined_values.size(), combined_values.data(), GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-	if (m_bMemoryLayoutDone == false)
+	for (int level = 0; level < MAX_LOD_LEVELS; level++)
 	{
-		SetShaderMemoryLayout();
+		int segments = LodResolution(MeshGenerators::DEFAULT_TORUS_SEGMENTS, level, 6);
+		AddGeneratedMesh(m_TorusMesh, "torus", MeshGenerators::GenerateTorus(segments, segments, tubeRadius), level);
 	}
 }
 
-
-
 ///////////////////////////////////////////////////
 //	DrawBoxMesh()
 //
@@ -2200,11 +499,10 @@ void ShapeMeshes::LoadTorusMesh(float thickness)
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawBoxMesh()
 {
-	glBindVertexArray(m_BoxMesh.vao);
-
-	glDrawElements(GL_TRIANGLES, m_BoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_BoxMesh);
 
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2216,15 +514,14 @@ void ShapeMeshes::DrawBoxMesh()
 void ShapeMeshes::DrawConeMesh(
 	bool bDrawBottom)
 {
-	glBindVertexArray(m_ConeMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_ConeMesh);
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
+		DrawRange(ranges[0]);		//bottom
 	}
-	glDrawArrays(GL_TRIANGLE_STRIP, 36, 108);	//sides
-
-	glBindVertexArray(0);
+	DrawRange(ranges[1]);	//sides
 }
 
 ///////////////////////////////////////////////////
@@ -2238,22 +535,21 @@ void ShapeMeshes::DrawCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_CylinderMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_CylinderMesh);
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
+		DrawRange(ranges[0]);	//bottom
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 36);	//top
+		DrawRange(ranges[1]);	//top
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+		DrawRange(ranges[2]);	//sides
 	}
-
-	glBindVertexArray(0);
 }
 
 ///////////////////////////////////////////////////
@@ -2264,11 +560,10 @@ void ShapeMeshes::DrawCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPlaneMesh()
 {
-	glBindVertexArray(m_PlaneMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_PlaneMesh);
 
-	glDrawElements(GL_TRIANGLES, m_PlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-	
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2279,11 +574,10 @@ void ShapeMeshes::DrawPlaneMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPrismMesh()
 {
-	glBindVertexArray(m_PrismMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_PrismMesh);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_PrismMesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2294,11 +588,10 @@ void ShapeMeshes::DrawPrismMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid3Mesh()
 {
-	glBindVertexArray(m_Pyramid3Mesh.vao);
-
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid3Mesh.nVertices);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_Pyramid3Mesh);
 
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2309,11 +602,10 @@ void ShapeMeshes::DrawPyramid3Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawPyramid4Mesh()
 {
-	glBindVertexArray(m_Pyramid4Mesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_Pyramid4Mesh);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, m_Pyramid4Mesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2324,11 +616,10 @@ void ShapeMeshes::DrawPyramid4Mesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
-
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_SphereMesh);
 
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2339,11 +630,10 @@ void ShapeMeshes::DrawSphereMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfSphereMesh()
 {
-	glBindVertexArray(m_SphereMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_SphereMesh);
 
-	glDrawElements(GL_TRIANGLES, m_SphereMesh.nIndices/2, GL_UNSIGNED_INT, (void*)0);
-
-	glBindVertexArray(0);
+	DrawRange(ranges[1]);
 }
 
 ///////////////////////////////////////////////////
@@ -2357,22 +647,21 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 	bool bDrawBottom,
 	bool bDrawSides)
 {
-	glBindVertexArray(m_TaperedCylinderMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TaperedCylinderMesh);
 
 	if (bDrawBottom == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, 36);	//bottom
+		DrawRange(ranges[0]);	//bottom
 	}
 	if (bDrawTop == true)
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 36, 72);	//top
+		DrawRange(ranges[1]);	//top
 	}
 	if (bDrawSides == true)
 	{
-		glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
+		DrawRange(ranges[2]);	//sides
 	}
-
-	glBindVertexArray(0);
 }
 
 ///////////////////////////////////////////////////
@@ -2383,11 +672,10 @@ void ShapeMeshes::DrawTaperedCylinderMesh(
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TorusMesh);
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices);
-
-	glBindVertexArray(0);
+	DrawRange(ranges[0]);
 }
 
 ///////////////////////////////////////////////////
@@ -2398,56 +686,1708 @@ void ShapeMeshes::DrawTorusMesh()
 ///////////////////////////////////////////////////
 void ShapeMeshes::DrawHalfTorusMesh()
 {
-	glBindVertexArray(m_TorusMesh.vao);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TorusMesh);
+
+	DrawRange(ranges[1]);
+}
 
-	glDrawArrays(GL_TRIANGLES, 0, m_TorusMesh.nVertices/2);
+///////////////////////////////////////////////////
+//	DrawBoxMeshInstanced()
+//
+//	Draw one copy of the box mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawBoxMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_BoxMesh);
 
-	glBindVertexArray(0);
+	DrawRange(ranges[0], instances);
 }
 
-glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+///////////////////////////////////////////////////
+//	DrawConeMeshInstanced()
+//
+//	Draw one copy of the cone mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawConeMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints,
+	bool bDrawBottom)
 {
-	glm::vec3 Normal(0, 0, 0);
-	float v1x = p1.x - p0.x;
-	float v1y = p1.y - p0.y;
-	float v1z = p1.z - p0.z;
-	float v2x = p2.x - p1.x;
-	float v2y = p2.y - p1.y;
-	float v2z = p2.z - p1.z;
-	Normal.x = v1y * v2z - v1z * v2y;
-	Normal.y = v1z * v2x - v1x * v2z;
-	Normal.y = v1x * v2y - v1y * v2x;
-	float len = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
-	if (len == 0)
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_ConeMesh);
+
+	if (bDrawBottom == true)
 	{
-		//throw Exception();
+		DrawRange(ranges[0], instances);		//bottom
 	}
-	else
+	DrawRange(ranges[1], instances);	//sides
+}
+
+///////////////////////////////////////////////////
+//	DrawCylinderMeshInstanced()
+//
+//	Draw one copy of the cylinder mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawCylinderMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_CylinderMesh);
+
+	if (bDrawBottom == true)
 	{
-		Normal.x /= len;
-		Normal.y /= len;
-		Normal.z /= len;
+		DrawRange(ranges[0], instances);	//bottom
 	}
-	return Normal;
+	if (bDrawTop == true)
+	{
+		DrawRange(ranges[1], instances);	//top
+	}
+	if (bDrawSides == true)
+	{
+		DrawRange(ranges[2], instances);	//sides
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawPlaneMeshInstanced()
+//
+//	Draw one copy of the plane mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawPlaneMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_PlaneMesh);
+
+	DrawRange(ranges[0], instances);
 }
 
+///////////////////////////////////////////////////
+//	DrawPrismMeshInstanced()
+//
+//	Draw one copy of the prism mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawPrismMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_PrismMesh);
 
+	DrawRange(ranges[0], instances);
+}
 
-void ShapeMeshes::SetShaderMemoryLayout()
+///////////////////////////////////////////////////
+//	DrawPyramid3MeshInstanced()
+//
+//	Draw one copy of the 3-sided pyramid mesh per
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawPyramid3MeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
 {
-	// The following code defines the layout of the mesh data in memory - each mesh needs
-	// to have the same memory layout so that the data is retrieved properly by the shaders
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_Pyramid3Mesh);
 
-	// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
-	GLint stride = sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV);// The number of floats before each
+	DrawRange(ranges[0], instances);
+}
 
-	// Create Vertex Attribute Pointers
-	glVertexAttribPointer(0, g_FloatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
+///////////////////////////////////////////////////
+//	DrawPyramid4MeshInstanced()
+//
+//	Draw one copy of the 4-sided pyramid mesh per
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawPyramid4MeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_Pyramid4Mesh);
 
-	glVertexAttribPointer(1, g_FloatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * g_FloatsPerVertex));
-	glEnableVertexAttribArray(1);
+	DrawRange(ranges[0], instances);
+}
 
-	glVertexAttribPointer(2, g_FloatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal)));
-	glEnableVertexAttribArray(2);
+///////////////////////////////////////////////////
+//	DrawSphereMeshInstanced()
+//
+//	Draw one copy of the sphere mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawSphereMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_SphereMesh);
+
+	DrawRange(ranges[0], instances);
+}
+
+///////////////////////////////////////////////////
+//	DrawHalfSphereMeshInstanced()
+//
+//	Draw one copy of the half sphere mesh per
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawHalfSphereMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_SphereMesh);
+
+	DrawRange(ranges[1], instances);
+}
+
+///////////////////////////////////////////////////
+//	DrawTaperedCylinderMeshInstanced()
+//
+//	Draw one copy of the tapered cylinder mesh per
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawTaperedCylinderMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TaperedCylinderMesh);
+
+	if (bDrawBottom == true)
+	{
+		DrawRange(ranges[0], instances);	//bottom
+	}
+	if (bDrawTop == true)
+	{
+		DrawRange(ranges[1], instances);	//top
+	}
+	if (bDrawSides == true)
+	{
+		DrawRange(ranges[2], instances);	//sides
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawTorusMeshInstanced()
+//
+//	Draw one copy of the torus mesh per instance.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawTorusMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TorusMesh);
+
+	DrawRange(ranges[0], instances);
+}
+
+///////////////////////////////////////////////////
+//	DrawHalfTorusMeshInstanced()
+//
+//	Draw one copy of the half torus mesh per
+//	instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawHalfTorusMeshInstanced(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	GLsizei instances = UploadInstances(transforms, count, uvScales, tints);
+	BindArena();
+	const DRAW_RANGE* ranges = UseLod(m_TorusMesh);
+
+	DrawRange(ranges[1], instances);
+}
+
+///////////////////////////////////////////////////
+//	AddBoxToBatch()
+//
+//	Copy the box mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddBoxToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_BoxMesh, m_BoxMesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddConeToBatch()
+//
+//	Copy the cone mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddConeToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model,
+	bool bDrawBottom)
+{
+	if (bDrawBottom == true)
+	{
+		AppendToBatch(batch, m_ConeMesh, m_ConeMesh.lods[0].ranges[0], model);
+	}
+	AppendToBatch(batch, m_ConeMesh, m_ConeMesh.lods[0].ranges[1], model);
+}
+
+///////////////////////////////////////////////////
+//	AddCylinderToBatch()
+//
+//	Copy the cylinder mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddCylinderToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	if (bDrawBottom == true)
+	{
+		AppendToBatch(batch, m_CylinderMesh, m_CylinderMesh.lods[0].ranges[0], model);
+	}
+	if (bDrawTop == true)
+	{
+		AppendToBatch(batch, m_CylinderMesh, m_CylinderMesh.lods[0].ranges[1], model);
+	}
+	if (bDrawSides == true)
+	{
+		AppendToBatch(batch, m_CylinderMesh, m_CylinderMesh.lods[0].ranges[2], model);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddPlaneToBatch()
+//
+//	Copy the plane mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPlaneToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_PlaneMesh, m_PlaneMesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddPrismToBatch()
+//
+//	Copy the prism mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPrismToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_PrismMesh, m_PrismMesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddPyramid3ToBatch()
+//
+//	Copy the 3-sided pyramid mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPyramid3ToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_Pyramid3Mesh, m_Pyramid3Mesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddPyramid4ToBatch()
+//
+//	Copy the 4-sided pyramid mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPyramid4ToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_Pyramid4Mesh, m_Pyramid4Mesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddSphereToBatch()
+//
+//	Copy the sphere mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddSphereToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_SphereMesh, m_SphereMesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddHalfSphereToBatch()
+//
+//	Copy the upper half of the sphere mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddHalfSphereToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_SphereMesh, m_SphereMesh.lods[0].ranges[1], model);
+}
+
+///////////////////////////////////////////////////
+//	AddTaperedCylinderToBatch()
+//
+//	Copy the tapered cylinder mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTaperedCylinderToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	if (bDrawBottom == true)
+	{
+		AppendToBatch(batch, m_TaperedCylinderMesh, m_TaperedCylinderMesh.lods[0].ranges[0], model);
+	}
+	if (bDrawTop == true)
+	{
+		AppendToBatch(batch, m_TaperedCylinderMesh, m_TaperedCylinderMesh.lods[0].ranges[1], model);
+	}
+	if (bDrawSides == true)
+	{
+		AppendToBatch(batch, m_TaperedCylinderMesh, m_TaperedCylinderMesh.lods[0].ranges[2], model);
+	}
+}
+
+///////////////////////////////////////////////////
+//	AddTorusToBatch()
+//
+//	Copy the torus mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTorusToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_TorusMesh, m_TorusMesh.lods[0].ranges[0], model);
+}
+
+///////////////////////////////////////////////////
+//	AddHalfTorusToBatch()
+//
+//	Copy the half torus mesh into a static batch.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddHalfTorusToBatch(
+	STATIC_BATCH& batch, const glm::mat4& model)
+{
+	AppendToBatch(batch, m_TorusMesh, m_TorusMesh.lods[0].ranges[1], model);
+}
+
+///////////////////////////////////////////////////
+//	DrawStaticBatch()
+//
+//	Draw a static batch. Its vertices are already in
+//	world space and stored as floats, so a packed
+//	arena gets the identity decode for the draw.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawStaticBatch(STATIC_BATCH& batch)
+{
+	if (batch.bDirty == true)
+	{
+		UploadStaticBatch(batch);
+	}
+	if (batch.nIndices == 0)
+	{
+		return;
+	}
+
+	GLState().BindVertexArray(batch.vao);
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		glVertexAttrib4f(g_DecodeScaleLocation, 1.0f, 1.0f, 1.0f, 0.0f);
+		glVertexAttrib3f(g_DecodeOffsetLocation, 0.0f, 0.0f, 0.0f);
+		m_pDecodeLod = nullptr;
+	}
+
+	m_frameStats.triangles[0] += batch.nIndices / 3;
+	m_frameStats.vertexFetches += batch.nFetches;
+	glDrawElements(GL_TRIANGLES, batch.nIndices, GL_UNSIGNED_INT, (void*)0);
+}
+
+///////////////////////////////////////////////////
+//	DeleteStaticBatch()
+//
+//	Free the GL buffers of a static batch and empty
+//	it.
+///////////////////////////////////////////////////
+void ShapeMeshes::DeleteStaticBatch(STATIC_BATCH& batch)
+{
+	if (batch.vao != 0)
+	{
+		if (GLState().CurrentVertexArray() == batch.vao)
+		{
+			GLState().BindVertexArray(0);
+		}
+		glDeleteVertexArrays(1, &batch.vao);
+		glDeleteBuffers(3, batch.buffers);
+	}
+	batch = STATIC_BATCH();
+}
+
+///////////////////////////////////////////////////
+//	AddBoxIndirect()
+//
+//	Add the box mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddBoxIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_BoxMesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddConeIndirect()
+//
+//	Add the cone mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddConeIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+	bool bDrawBottom)
+{
+	unsigned int parts = 2;		//sides
+	if (bDrawBottom == true)
+	{
+		parts |= 1;				//bottom
+	}
+	AppendIndirect(m_ConeMesh, parts, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddCylinderIndirect()
+//
+//	Add the cylinder mesh to the pending indirect
+//	call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddCylinderIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	unsigned int parts = 0;
+	if (bDrawBottom == true)
+	{
+		parts |= 1;		//bottom
+	}
+	if (bDrawTop == true)
+	{
+		parts |= 2;		//top
+	}
+	if (bDrawSides == true)
+	{
+		parts |= 4;		//sides
+	}
+	AppendIndirect(m_CylinderMesh, parts, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddPlaneIndirect()
+//
+//	Add the plane mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPlaneIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_PlaneMesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddPrismIndirect()
+//
+//	Add the prism mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPrismIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_PrismMesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddPyramid3Indirect()
+//
+//	Add the three sided pyramid mesh to the pending
+//	indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPyramid3Indirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_Pyramid3Mesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddPyramid4Indirect()
+//
+//	Add the four sided pyramid mesh to the pending
+//	indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddPyramid4Indirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_Pyramid4Mesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddSphereIndirect()
+//
+//	Add the sphere mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddSphereIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_SphereMesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddHalfSphereIndirect()
+//
+//	Add the upper half of the sphere mesh to the
+//	pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddHalfSphereIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_SphereMesh, 2, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddTaperedCylinderIndirect()
+//
+//	Add the tapered cylinder mesh to the pending
+//	indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTaperedCylinderIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	unsigned int parts = 0;
+	if (bDrawBottom == true)
+	{
+		parts |= 1;		//bottom
+	}
+	if (bDrawTop == true)
+	{
+		parts |= 2;		//top
+	}
+	if (bDrawSides == true)
+	{
+		parts |= 4;		//sides
+	}
+	AppendIndirect(m_TaperedCylinderMesh, parts, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddTorusIndirect()
+//
+//	Add the torus mesh to the pending indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddTorusIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_TorusMesh, 1, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	AddHalfTorusIndirect()
+//
+//	Add one half of the torus mesh to the pending
+//	indirect call.
+// 
+///////////////////////////////////////////////////
+void ShapeMeshes::AddHalfTorusIndirect(
+	const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint)
+{
+	AppendIndirect(m_TorusMesh, 2, model, uvScale, tint);
+}
+
+///////////////////////////////////////////////////
+//	DrawIndirect()
+//
+//	Copy the pending commands and per-draw records to
+//	their buffers and draw them all with one call.
+//	They are written straight to the stream buffer
+//	when there is one; otherwise the buffers are
+//	orphaned and grown the way the instance buffer
+//	is. The draw index buffer only changes when it
+//	grows.
+///////////////////////////////////////////////////
+GLsizei ShapeMeshes::DrawIndirect()
+{
+	if (m_indirectCommands.empty())
+	{
+		m_indirectDraws.clear();
+		return 0;
+	}
+
+	BindArena();
+
+	if (m_indirectBuffers[0] == 0)
+	{
+		glGenBuffers(3, m_indirectBuffers);
+		m_indirectCommandCapacity = 64;
+	}
+
+	if (m_indirectDrawCapacity < m_indirectDraws.size())
+	{
+		if (m_indirectDrawCapacity == 0)
+		{
+			m_indirectDrawCapacity = 64;
+		}
+		while (m_indirectDrawCapacity < m_indirectDraws.size())
+		{
+			m_indirectDrawCapacity *= 2;
+		}
+
+		std::vector<GLuint> drawIndices(m_indirectDrawCapacity);
+		for (size_t i = 0; i < drawIndices.size(); i++)
+		{
+			drawIndices[i] = (GLuint)i;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_indirectBuffers[2]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * drawIndices.size(), drawIndices.data(), GL_STATIC_DRAW);
+		glVertexAttribIPointer(g_DrawIndexLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), 0);
+		glVertexAttribDivisor(g_DrawIndexLocation, 1);
+		glEnableVertexAttribArray(g_DrawIndexLocation);
+	}
+
+	const GLsizeiptr drawBytes = sizeof(INDIRECT_DRAW) * m_indirectDraws.size();
+	const GLsizeiptr commandBytes = sizeof(INDIRECT_COMMAND) * m_indirectCommands.size();
+	GLsizei commands = (GLsizei)m_indirectCommands.size();
+
+	if (UseStreamBuffer())
+	{
+		if (m_storageAlignment == 0)
+		{
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_storageAlignment);
+		}
+		StreamRingBuffer::ALLOCATION draws = m_pStreamBuffer->Allocate(drawBytes, m_storageAlignment);
+		StreamRingBuffer::ALLOCATION commandData = m_pStreamBuffer->Allocate(commandBytes, sizeof(GLuint));
+		if (draws.data != nullptr && commandData.data != nullptr)
+		{
+			memcpy(draws.data, m_indirectDraws.data(), drawBytes);
+			memcpy(commandData.data, m_indirectCommands.data(), commandBytes);
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_BINDING, m_pStreamBuffer->Buffer(), draws.offset, drawBytes);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_pStreamBuffer->Buffer());
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandData.offset, commands, 0);
+
+			m_indirectCommands.clear();
+			m_indirectDraws.clear();
+			return commands;
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indirectBuffers[1]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(INDIRECT_DRAW) * m_indirectDrawCapacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, drawBytes, m_indirectDraws.data());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_BINDING, m_indirectBuffers[1]);
+
+	while (m_indirectCommandCapacity < m_indirectCommands.size())
+	{
+		m_indirectCommandCapacity *= 2;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffers[0]);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(INDIRECT_COMMAND) * m_indirectCommandCapacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_indirectCommands.data());
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, commands, 0);
+
+	m_indirectCommands.clear();
+	m_indirectDraws.clear();
+	return commands;
+}
+
+///////////////////////////////////////////////////
+//	IndirectSupported()
+//
+//	Multi-draw indirect and shader storage buffers
+//	are both core in GL 4.3.
+///////////////////////////////////////////////////
+bool ShapeMeshes::IndirectSupported()
+{
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	return major > 4 || (major == 4 && minor >= 3);
+}
+
+///////////////////////////////////////////////////
+//	SetStreamBuffer()
+//
+//	Select the stream buffer the instances and the
+//	indirect draws are written to. It is only used
+//	while persistently mapped - an orphaned stream
+//	buffer would just replace one orphaned buffer
+//	with another. The instances also need the base
+//	instance of GL 4.2, which a 3.3 context with
+//	ARB_buffer_storage may lack.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetStreamBuffer(StreamRingBuffer* pStreamBuffer)
+{
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	m_pStreamBuffer = pStreamBuffer;
+	m_bStreamInstances = major > 4 || (major == 4 && minor >= 2) || GLEW_ARB_base_instance;
+	m_bInstancesInStream = m_bStreamInstances && UseStreamBuffer();
+}
+
+bool ShapeMeshes::UseStreamBuffer() const
+{
+	return m_pStreamBuffer != nullptr && m_pStreamBuffer->IsPersistent();
+}
+
+///////////////////////////////////////////////////
+//	AddIndexedMesh()
+//
+//	Append an indexed mesh to the shared arena. The
+//	indices stay relative to the mesh - they are
+//	offset by the base vertex when drawing.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddIndexedMesh(
+	GLMesh& mesh,
+	const char* name,
+	const GLfloat* verts, GLuint nVertices,
+	const GLuint* indices, GLuint nIndices)
+{
+	MeshGenerators::MESH_DATA data;
+	data.vertices.assign(verts, verts + nVertices * MeshGenerators::FLOATS_PER_VERTEX);
+	data.indices.assign(indices, indices + nIndices);
+	data.nParts = 1;
+	data.parts[0].firstIndex = 0;
+	data.parts[0].nIndices = nIndices;
+
+	AddGeneratedMesh(mesh, name, data);
+}
+
+///////////////////////////////////////////////////
+//	AddArrayMesh()
+//
+//	Append a mesh that was laid out for glDrawArrays
+//	to the shared arena. Each fan, strip or triangle
+//	list range is converted to an indexed triangle
+//	list, keeping the winding of every triangle.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddArrayMesh(
+	GLMesh& mesh,
+	const char* name,
+	const GLfloat* verts, GLuint nVertices,
+	const ARRAY_RANGE* ranges, int nRanges)
+{
+	MeshGenerators::MESH_DATA data;
+	data.vertices.assign(verts, verts + nVertices * MeshGenerators::FLOATS_PER_VERTEX);
+	std::vector<GLuint>& indices = data.indices;
+
+	for (int r = 0; r < nRanges; r++)
+	{
+		const ARRAY_RANGE& range = ranges[r];
+		data.parts[r].firstIndex = (GLuint)indices.size();
+
+		if (range.mode == GL_TRIANGLES)
+		{
+			for (GLuint i = 0; i < range.count; i++)
+			{
+				indices.push_back(range.first + i);
+			}
+		}
+		else
+		{
+			for (GLuint i = 0; i + 2 < range.count; i++)
+			{
+				GLuint v = range.first + i;
+				if (range.mode == GL_TRIANGLE_FAN)
+				{
+					indices.push_back(range.first);
+					indices.push_back(v + 1);
+					indices.push_back(v + 2);
+				}
+				else if ((i & 1) == 0)
+				{
+					indices.push_back(v);
+					indices.push_back(v + 1);
+					indices.push_back(v + 2);
+				}
+				else
+				{
+					// odd strip triangles swap the first two
+					// vertices to keep a consistent winding
+					indices.push_back(v + 1);
+					indices.push_back(v);
+					indices.push_back(v + 2);
+				}
+			}
+		}
+
+		data.parts[r].nIndices = (GLuint)indices.size() - data.parts[r].firstIndex;
+	}
+	data.nParts = nRanges;
+
+	AddGeneratedMesh(mesh, name, data);
+}
+
+///////////////////////////////////////////////////
+//	AddGeneratedMesh()
+//
+//	Run the output of a mesh generator through the
+//	mesh optimiser and append it to the shared arena
+//	as the given level of detail of the mesh, keeping
+//	its drawable parts.
+///////////////////////////////////////////////////
+void ShapeMeshes::AddGeneratedMesh(
+	GLMesh& mesh,
+	const char* name,
+	MeshGenerators::MESH_DATA data,
+	int lodLevel)
+{
+	const GLint baseVertex = (GLint)m_arenaVertexCount;
+	const GLuint firstIndex = (GLuint)m_arenaIndices.size();
+
+	MESH_REPORT report;
+	report.name = name;
+	report.lodLevel = lodLevel;
+	report.nVertices = data.VertexCount();
+	report.nTriangles = data.TriangleCount();
+	report.stats = MeshOptimizer::OptimizeMesh(data, m_bReorderTriangles);
+	m_meshReports.push_back(report);
+
+	if (lodLevel == 0)
+	{
+		mesh.nVertices = data.VertexCount();
+		mesh.nIndices = (GLuint)data.indices.size();
+		mesh.baseVertex = baseVertex;
+	}
+
+	MESH_LOD& lod = mesh.lods[lodLevel];
+	lod.nRanges = data.nParts;
+	for (int i = 0; i < data.nParts; i++)
+	{
+		const GLuint* partIndices = data.indices.data() + data.parts[i].firstIndex;
+		MeshOptimizer::CACHE_STATS cache = MeshOptimizer::AnalyzeVertexCache(
+			partIndices, data.parts[i].nIndices, data.VertexCount());
+
+		lod.ranges[i].firstIndex = firstIndex + data.parts[i].firstIndex;
+		lod.ranges[i].nIndices = data.parts[i].nIndices;
+		lod.ranges[i].baseVertex = baseVertex;
+		lod.ranges[i].nFetches = (GLuint)(cache.acmr * (data.parts[i].nIndices / 3) + 0.5f);
+	}
+	mesh.nLods = lodLevel + 1;
+
+	// bounds of the positions, which the packed layout
+	// stores its positions relative to
+	const GLuint nVertices = data.VertexCount();
+	const int stride = MeshGenerators::FLOATS_PER_VERTEX;
+	glm::vec3 boundsMin(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		glm::vec3 position = glm::make_vec3(&data.vertices[v * stride]);
+		boundsMin = (v == 0) ? position : glm::min(boundsMin, position);
+		boundsMax = (v == 0) ? position : glm::max(boundsMax, position);
+	}
+	lod.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+	lod.boundsHalfExtent = glm::max((boundsMax - boundsMin) * 0.5f, glm::vec3(1e-6f));
+
+	if (lodLevel == 0)
+	{
+		mesh.bounds.boxMin = boundsMin;
+		mesh.bounds.boxMax = boundsMax;
+		mesh.bounds.sphereCenter = lod.boundsCenter;
+		mesh.bounds.sphereRadius = 0.0f;
+		for (GLuint v = 0; v < nVertices; v++)
+		{
+			float distance = glm::length(glm::make_vec3(&data.vertices[v * stride]) - lod.boundsCenter);
+			mesh.bounds.sphereRadius = std::max(mesh.bounds.sphereRadius, distance);
+		}
+	}
+
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		for (GLuint v = 0; v < nVertices; v++)
+		{
+			const GLfloat* vertex = &data.vertices[v * stride];
+			glm::vec3 position = (glm::make_vec3(vertex) - lod.boundsCenter) / lod.boundsHalfExtent;
+			glm::vec2 normal = EncodeOctahedral(glm::normalize(glm::make_vec3(vertex + 3)));
+
+			PACKED_VERTEX packed;
+			packed.position[0] = (GLshort)glm::packSnorm1x16(position.x);
+			packed.position[1] = (GLshort)glm::packSnorm1x16(position.y);
+			packed.position[2] = (GLshort)glm::packSnorm1x16(position.z);
+			packed.position[3] = 0;
+			packed.normal[0] = (GLshort)glm::packSnorm1x16(normal.x);
+			packed.normal[1] = (GLshort)glm::packSnorm1x16(normal.y);
+			packed.uv = glm::packHalf2x16(glm::make_vec2(vertex + 6));
+			m_packedVertices.push_back(packed);
+		}
+	}
+	else
+	{
+		m_arenaVertices.insert(m_arenaVertices.end(), data.vertices.begin(), data.vertices.end());
+	}
+
+	if (m_bGenerateTangents)
+	{
+		// meshes loaded before tangents were turned on get
+		// zero tangents, so the stream stays aligned
+		std::vector<GLfloat> tangents = MeshGenerators::GenerateTangents(data);
+		if (m_vertexLayout == LAYOUT_PACKED)
+		{
+			m_packedTangents.resize(m_arenaVertexCount, PACKED_TANGENT());
+			for (GLuint v = 0; v < nVertices; v++)
+			{
+				PACKED_TANGENT packed;
+				for (int i = 0; i < MeshGenerators::FLOATS_PER_TANGENT; i++)
+				{
+					packed.tangent[i] = (GLshort)glm::packSnorm1x16(tangents[v * MeshGenerators::FLOATS_PER_TANGENT + i]);
+				}
+				m_packedTangents.push_back(packed);
+			}
+		}
+		else
+		{
+			m_arenaTangents.resize(m_arenaVertexCount * MeshGenerators::FLOATS_PER_TANGENT, 0.0f);
+			m_arenaTangents.insert(m_arenaTangents.end(), tangents.begin(), tangents.end());
+		}
+	}
+	m_arenaVertexCount += nVertices;
+
+	m_arenaIndices.insert(m_arenaIndices.end(), data.indices.begin(), data.indices.end());
+	m_bArenaDirty = true;
+}
+
+///////////////////////////////////////////////////
+//	SetTriangleReordering()
+//
+//	Turn the triangle reordering of the meshes loaded
+//	after this call on or off.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetTriangleReordering(bool bReorderTriangles)
+{
+	m_bReorderTriangles = bReorderTriangles;
+}
+
+///////////////////////////////////////////////////
+//	SetTangentGeneration()
+//
+//	Turn the tangent generation of the meshes loaded
+//	after this call on or off.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetTangentGeneration(bool bGenerateTangents)
+{
+	m_bGenerateTangents = bGenerateTangents;
+}
+
+///////////////////////////////////////////////////
+//	LodResolution()
+//
+//	The segment or ring count of a level of detail,
+//	scaled down from the full detail count.
+///////////////////////////////////////////////////
+int ShapeMeshes::LodResolution(int resolution, int lodLevel, int minimum)
+{
+	int scaled = (int)(resolution * g_LodDetail[lodLevel] + 0.5f);
+	return (scaled < minimum) ? minimum : scaled;
+}
+
+///////////////////////////////////////////////////
+//	UseLod()
+//
+//	Return the draw ranges of the selected level of
+//	detail, clamped to the levels the mesh has, and
+//	remember the level for the frame statistics.
+///////////////////////////////////////////////////
+const ShapeMeshes::DRAW_RANGE* ShapeMeshes::UseLod(const GLMesh& mesh)
+{
+	m_drawLevel = (m_lodLevel < mesh.nLods) ? m_lodLevel : mesh.nLods - 1;
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		SetVertexDecode(mesh.lods[m_drawLevel]);
+	}
+	return mesh.lods[m_drawLevel].ranges;
+}
+
+///////////////////////////////////////////////////
+//	SetLodLevel()
+//
+//	Select the level of detail used by the following
+//	draws. Meshes with fewer levels use their
+//	coarsest one.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetLodLevel(int lodLevel)
+{
+	if (lodLevel < 0)
+	{
+		lodLevel = 0;
+	}
+	if (lodLevel >= MAX_LOD_LEVELS)
+	{
+		lodLevel = MAX_LOD_LEVELS - 1;
+	}
+	m_lodLevel = lodLevel;
+}
+
+///////////////////////////////////////////////////
+//	ProjectedSize()
+//
+//	Approximate height on screen, in pixels, of a
+//	bounding sphere given in object space.
+///////////////////////////////////////////////////
+float ShapeMeshes::ProjectedSize(
+	const glm::vec3& center,
+	float radius,
+	const glm::mat4& model,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	float viewportHeight)
+{
+	// scale the radius by the largest axis of the transform
+	float scale = glm::max(glm::length(glm::vec3(model[0])),
+		glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float worldRadius = radius * scale;
+
+	glm::vec4 viewCenter = view * model * glm::vec4(center, 1.0f);
+	float w = (projection * viewCenter).w;
+
+	// the camera is inside or right in front of the sphere
+	if (w <= worldRadius)
+	{
+		return viewportHeight;
+	}
+
+	return worldRadius * projection[1][1] * viewportHeight / w;
+}
+
+///////////////////////////////////////////////////
+//	SelectLodLevel()
+//
+//	Pick the level of detail for an object of the
+//	passed screen size. A level is only left once the
+//	size is clearly past its threshold, so objects
+//	near a threshold do not switch every frame.
+///////////////////////////////////////////////////
+int ShapeMeshes::SelectLodLevel(float screenSize, int currentLevel)
+{
+	int level = currentLevel;
+	if (level < 0)
+	{
+		level = 0;
+	}
+	if (level >= MAX_LOD_LEVELS)
+	{
+		level = MAX_LOD_LEVELS - 1;
+	}
+
+	while (level > 0 && screenSize >= g_LodMinSize[level - 1] * (1.0f + LOD_HYSTERESIS))
+	{
+		level--;
+	}
+	while (level + 1 < MAX_LOD_LEVELS && screenSize < g_LodMinSize[level] * (1.0f - LOD_HYSTERESIS))
+	{
+		level++;
+	}
+
+	return level;
+}
+
+///////////////////////////////////////////////////
+//	BindArena()
+//
+//	Bind the VAO of the shared arena, uploading the
+//	vertex and index data first when meshes were
+//	added since the last upload.
+///////////////////////////////////////////////////
+void ShapeMeshes::BindArena()
+{
+	if (m_bArenaDirty == false)
+	{
+		GLState().BindVertexArray(m_arenaVAO);
+		UpdateInstanceSource();
+		return;
+	}
+
+	if (m_arenaVAO == 0)
+	{
+		glGenVertexArrays(1, &m_arenaVAO);
+		glGenBuffers(3, m_arenaVBOs);
+	}
+	GLState().BindVertexArray(m_arenaVAO);
+
+	if (HasTangents())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_arenaVBOs[2]);
+		if (m_vertexLayout == LAYOUT_PACKED)
+		{
+			m_packedTangents.resize(m_arenaVertexCount, PACKED_TANGENT());
+			glBufferData(GL_ARRAY_BUFFER, sizeof(PACKED_TANGENT) * m_packedTangents.size(), m_packedTangents.data(), GL_STATIC_DRAW);
+		}
+		else
+		{
+			m_arenaTangents.resize(m_arenaVertexCount * MeshGenerators::FLOATS_PER_TANGENT, 0.0f);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_arenaTangents.size(), m_arenaTangents.data(), GL_STATIC_DRAW);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_arenaVBOs[0]);
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		glBufferData(GL_ARRAY_BUFFER, sizeof(PACKED_VERTEX) * m_packedVertices.size(), m_packedVertices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * m_arenaVertices.size(), m_arenaVertices.data(), GL_STATIC_DRAW);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_arenaVBOs[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_arenaIndices.size(), m_arenaIndices.data(), GL_STATIC_DRAW);
+
+	if (m_bMemoryLayoutDone == false)
+	{
+		SetShaderMemoryLayout();
+		m_bMemoryLayoutDone = true;
+	}
+	UpdateInstanceSource();
+
+	m_bArenaDirty = false;
+}
+
+///////////////////////////////////////////////////
+//	UpdateInstanceSource()
+//
+//	The instance attributes of the arena VAO read the
+//	stream buffer while the instances are written to
+//	it, and the instance buffer otherwise. The stream
+//	buffer is recreated when it grows, so the check
+//	runs every time the arena is bound.
+///////////////////////////////////////////////////
+void ShapeMeshes::UpdateInstanceSource()
+{
+	GLuint source = m_instanceVBO;
+	if (m_bInstancesInStream == true && UseStreamBuffer())
+	{
+		source = m_pStreamBuffer->Buffer();
+	}
+
+	if (source != m_instanceSource && source != 0)
+	{
+		AttachInstanceBuffer(source);
+		m_instanceSource = source;
+	}
+}
+
+///////////////////////////////////////////////////
+//	DrawRange()
+//
+//	Draw a sub-range of the arena index buffer, once
+//	or once per instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::DrawRange(const DRAW_RANGE& range)
+{
+	m_frameStats.triangles[m_drawLevel] += range.nIndices / 3;
+	m_frameStats.vertexFetches += range.nFetches;
+	glDrawElementsBaseVertex(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * range.firstIndex), range.baseVertex);
+}
+
+void ShapeMeshes::DrawRange(const DRAW_RANGE& range, GLsizei instances)
+{
+	m_frameStats.triangles[m_drawLevel] += range.nIndices / 3 * instances;
+	m_frameStats.vertexFetches += range.nFetches * instances;
+	if (m_instanceBase != 0)
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT,
+			(void*)(sizeof(GLuint) * range.firstIndex), instances, range.baseVertex, m_instanceBase);
+		return;
+	}
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.nIndices, GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * range.firstIndex), instances, range.baseVertex);
+}
+
+///////////////////////////////////////////////////
+//	AppendToBatch()
+//
+//	Copy the vertices one part of a mesh uses to the
+//	end of a static batch, transformed the way the
+//	vertex shader transforms them, and append its
+//	triangles renumbered to the copies. Packed
+//	vertices are decoded back to floats first.
+///////////////////////////////////////////////////
+void ShapeMeshes::AppendToBatch(
+	STATIC_BATCH& batch,
+	const GLMesh& mesh,
+	const DRAW_RANGE& range,
+	const glm::mat4& model)
+{
+	const int stride = MeshGenerators::FLOATS_PER_VERTEX;
+	const int tangentStride = MeshGenerators::FLOATS_PER_TANGENT;
+	const MESH_LOD& lod = mesh.lods[0];
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	const glm::mat3 tangentMatrix = glm::mat3(model);
+	const float handedness = (glm::determinant(tangentMatrix) < 0.0f) ? -1.0f : 1.0f;
+	const bool bTangents = HasTangents();
+
+	// batch vertex of each mesh vertex, once copied
+	const GLuint unused = 0xFFFFFFFFu;
+	std::vector<GLuint> remap(mesh.nVertices, unused);
+
+	for (GLuint i = 0; i < range.nIndices; i++)
+	{
+		const GLuint meshVertex = m_arenaIndices[range.firstIndex + i];
+		if (remap[meshVertex] == unused)
+		{
+			const GLuint arenaVertex = (GLuint)range.baseVertex + meshVertex;
+			glm::vec3 position;
+			glm::vec3 normal;
+			glm::vec2 uv;
+			glm::vec4 tangent(0.0f);
+			if (m_vertexLayout == LAYOUT_PACKED)
+			{
+				const PACKED_VERTEX& packed = m_packedVertices[arenaVertex];
+				position = lod.boundsCenter + lod.boundsHalfExtent * glm::vec3(
+					glm::unpackSnorm1x16((uint16_t)packed.position[0]),
+					glm::unpackSnorm1x16((uint16_t)packed.position[1]),
+					glm::unpackSnorm1x16((uint16_t)packed.position[2]));
+				normal = DecodeOctahedral(glm::vec2(
+					glm::unpackSnorm1x16((uint16_t)packed.normal[0]),
+					glm::unpackSnorm1x16((uint16_t)packed.normal[1])));
+				uv = glm::unpackHalf2x16(packed.uv);
+				if (bTangents && arenaVertex < m_packedTangents.size())
+				{
+					for (int t = 0; t < tangentStride; t++)
+					{
+						tangent[t] = glm::unpackSnorm1x16((uint16_t)m_packedTangents[arenaVertex].tangent[t]);
+					}
+				}
+			}
+			else
+			{
+				const GLfloat* vertex = &m_arenaVertices[arenaVertex * stride];
+				position = glm::make_vec3(vertex);
+				normal = glm::make_vec3(vertex + 3);
+				uv = glm::make_vec2(vertex + 6);
+				if (bTangents && (arenaVertex + 1) * tangentStride <= m_arenaTangents.size())
+				{
+					tangent = glm::make_vec4(&m_arenaTangents[arenaVertex * tangentStride]);
+				}
+			}
+
+			position = glm::vec3(model * glm::vec4(position, 1.0f));
+			normal = glm::normalize(normalMatrix * normal);
+			const GLfloat copy[MeshGenerators::FLOATS_PER_VERTEX] = {
+				position.x, position.y, position.z,
+				normal.x, normal.y, normal.z,
+				uv.x, uv.y };
+
+			remap[meshVertex] = (GLuint)(batch.vertices.size() / stride);
+			batch.vertices.insert(batch.vertices.end(), copy, copy + stride);
+			if (bTangents)
+			{
+				glm::vec3 direction = tangentMatrix * glm::vec3(tangent);
+				batch.tangents.push_back(direction.x);
+				batch.tangents.push_back(direction.y);
+				batch.tangents.push_back(direction.z);
+				batch.tangents.push_back(tangent.w * handedness);
+			}
+		}
+		batch.indices.push_back(remap[meshVertex]);
+	}
+	batch.bDirty = true;
+}
+
+///////////////////////////////////////////////////
+//	AppendIndirect()
+//
+//	Add the per-draw record of a mesh at the selected
+//	level of detail, with the decode the vertex
+//	attributes would get, and one single instance
+//	command per selected part that points back at
+//	the record through its base instance.
+///////////////////////////////////////////////////
+void ShapeMeshes::AppendIndirect(
+	const GLMesh& mesh,
+	unsigned int parts,
+	const glm::mat4& model,
+	const glm::vec2& uvScale,
+	const glm::vec4& tint)
+{
+	const int level = (m_lodLevel < mesh.nLods) ? m_lodLevel : mesh.nLods - 1;
+	const MESH_LOD& lod = mesh.lods[level];
+
+	INDIRECT_DRAW draw;
+	draw.model = model;
+	draw.tint = tint;
+	draw.uvScale = uvScale;
+	draw.padding = glm::vec2(0.0f);
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		draw.decodeScale = glm::vec4(lod.boundsHalfExtent, 1.0f);
+		draw.decodeOffset = glm::vec4(lod.boundsCenter, 0.0f);
+	}
+	else
+	{
+		draw.decodeScale = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+		draw.decodeOffset = glm::vec4(0.0f);
+	}
+
+	const GLuint drawIndex = (GLuint)m_indirectDraws.size();
+	m_indirectDraws.push_back(draw);
+
+	for (int i = 0; i < lod.nRanges; i++)
+	{
+		if ((parts & (1u << i)) == 0)
+		{
+			continue;
+		}
+
+		const DRAW_RANGE& range = lod.ranges[i];
+		INDIRECT_COMMAND command;
+		command.count = range.nIndices;
+		command.instanceCount = 1;
+		command.firstIndex = range.firstIndex;
+		command.baseVertex = range.baseVertex;
+		command.baseInstance = drawIndex;
+		m_indirectCommands.push_back(command);
+
+		m_frameStats.triangles[level] += range.nIndices / 3;
+		m_frameStats.vertexFetches += range.nFetches;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UploadStaticBatch()
+//
+//	Create the VAO and buffers of a static batch on
+//	its first upload, fill them, and measure the
+//	vertex cache behaviour of the merged triangles.
+///////////////////////////////////////////////////
+void ShapeMeshes::UploadStaticBatch(STATIC_BATCH& batch)
+{
+	batch.bDirty = false;
+	batch.nIndices = (GLsizei)batch.indices.size();
+	if (batch.nIndices == 0)
+	{
+		return;
+	}
+
+	if (batch.vao == 0)
+	{
+		glGenVertexArrays(1, &batch.vao);
+		glGenBuffers(3, batch.buffers);
+	}
+	GLState().BindVertexArray(batch.vao);
+
+	const GLsizei stride = VertexStride(LAYOUT_FLOAT);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * batch.vertices.size(), batch.vertices.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, g_FloatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, g_FloatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * g_FloatsPerVertex));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, g_FloatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal)));
+	glEnableVertexAttribArray(2);
+
+	if (batch.tangents.empty() == false)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, batch.buffers[2]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * batch.tangents.size(), batch.tangents.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(g_TangentLocation, MeshGenerators::FLOATS_PER_TANGENT, GL_FLOAT, GL_FALSE, 0, 0);
+		glEnableVertexAttribArray(g_TangentLocation);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * batch.indices.size(), batch.indices.data(), GL_STATIC_DRAW);
+
+	const size_t nVertices = batch.vertices.size() / MeshGenerators::FLOATS_PER_VERTEX;
+	MeshOptimizer::CACHE_STATS cache = MeshOptimizer::AnalyzeVertexCache(
+		batch.indices.data(), batch.indices.size(), nVertices);
+	batch.nFetches = (GLuint)(cache.acmr * (batch.indices.size() / 3) + 0.5f);
+}
+
+glm::vec3 ShapeMeshes::CalculateTriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+{
+	glm::vec3 Normal(0, 0, 0);
+	float v1x = p1.x - p0.x;
+	float v1y = p1.y - p0.y;
+	float v1z = p1.z - p0.z;
+	float v2x = p2.x - p1.x;
+	float v2y = p2.y - p1.y;
+	float v2z = p2.z - p1.z;
+	Normal.x = v1y * v2z - v1z * v2y;
+	Normal.y = v1z * v2x - v1x * v2z;
+	Normal.y = v1x * v2y - v1y * v2x;
+	float len = (float)sqrt(Normal.x * Normal.x + Normal.y * Normal.y + Normal.z * Normal.z);
+	if (len == 0)
+	{
+		//throw Exception();
+	}
+	else
+	{
+		Normal.x /= len;
+		Normal.y /= len;
+		Normal.z /= len;
+	}
+	return Normal;
+}
+
+
+
+void ShapeMeshes::SetShaderMemoryLayout()
+{
+	// The following code defines the layout of the mesh data in memory - each mesh needs
+	// to have the same memory layout so that the data is retrieved properly by the shaders
+
+	if (m_vertexLayout == LAYOUT_PACKED)
+	{
+		// the shader rescales the positions with the decode
+		// of each mesh and unfolds the octahedral normals
+		GLint stride = sizeof(PACKED_VERTEX);
+
+		glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, position));
+		glEnableVertexAttribArray(0);
+
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, normal));
+		glEnableVertexAttribArray(1);
+
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PACKED_VERTEX, uv));
+		glEnableVertexAttribArray(2);
+	}
+	else
+	{
+		// Strides between vertex coordinates is 6 (x, y, z, r, g, b, a). A tightly packed stride is 0.
+		GLint stride = sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal + g_FloatsPerUV);// The number of floats before each
+
+		// Create Vertex Attribute Pointers
+		glVertexAttribPointer(0, g_FloatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+		glEnableVertexAttribArray(0);
+
+		glVertexAttribPointer(1, g_FloatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * g_FloatsPerVertex));
+		glEnableVertexAttribArray(1);
+
+		glVertexAttribPointer(2, g_FloatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (g_FloatsPerVertex + g_FloatsPerNormal)));
+		glEnableVertexAttribArray(2);
+
+		// float vertices are used as they are
+		glVertexAttrib4f(g_DecodeScaleLocation, 1.0f, 1.0f, 1.0f, 0.0f);
+		glVertexAttrib3f(g_DecodeOffsetLocation, 0.0f, 0.0f, 0.0f);
+	}
+
+	// tangents come from their own buffer when generated
+	if (HasTangents())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_arenaVBOs[2]);
+		if (m_vertexLayout == LAYOUT_PACKED)
+		{
+			glVertexAttribPointer(g_TangentLocation, 4, GL_SHORT, GL_TRUE, sizeof(PACKED_TANGENT), 0);
+		}
+		else
+		{
+			glVertexAttribPointer(g_TangentLocation, MeshGenerators::FLOATS_PER_TANGENT, GL_FLOAT, GL_FALSE, 0, 0);
+		}
+		glEnableVertexAttribArray(g_TangentLocation);
+	}
+
+	SetInstanceMemoryLayout();
+}
+
+///////////////////////////////////////////////////
+//	SetVertexDecode()
+//
+//	Set the constant attributes that map the packed
+//	positions of a mesh back to object space. The w
+//	of the scale tells the shader the normals are
+//	octahedral encoded.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetVertexDecode(const MESH_LOD& lod)
+{
+	if (m_pDecodeLod == &lod)
+	{
+		return;
+	}
+
+	glVertexAttrib4f(g_DecodeScaleLocation,
+		lod.boundsHalfExtent.x, lod.boundsHalfExtent.y, lod.boundsHalfExtent.z, 1.0f);
+	glVertexAttrib3f(g_DecodeOffsetLocation,
+		lod.boundsCenter.x, lod.boundsCenter.y, lod.boundsCenter.z);
+	m_pDecodeLod = &lod;
+}
+
+///////////////////////////////////////////////////
+//	VertexStride()
+//
+//	Bytes of one vertex in the passed layout.
+///////////////////////////////////////////////////
+GLsizei ShapeMeshes::VertexStride(VERTEX_LAYOUT layout)
+{
+	if (layout == LAYOUT_PACKED)
+	{
+		return sizeof(PACKED_VERTEX);
+	}
+	return sizeof(GLfloat) * MeshGenerators::FLOATS_PER_VERTEX;
+}
+///////////////////////////////////////////////////
+//	SetInstanceMemoryLayout()
+//
+//	Attach the shared instance buffer to the bound
+//	VAO. The per-instance model matrix takes four
+//	attribute locations (8-11), followed by the UV
+//	scale (12) and the tint (13), all advancing once
+//	per instance. The buffer always holds at least
+//	one instance, so ordinary draws can leave these
+//	arrays enabled - the shader ignores them unless
+//	bUseInstancing is set.
+///////////////////////////////////////////////////
+void ShapeMeshes::SetInstanceMemoryLayout()
+{
+	if (m_instanceVBO == 0)
+	{
+		m_instanceCapacity = 64;
+		glGenBuffers(1, &m_instanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), nullptr, GL_STREAM_DRAW);
+	}
+
+	AttachInstanceBuffer(m_instanceVBO);
+	m_instanceSource = m_instanceVBO;
+}
+
+///////////////////////////////////////////////////
+//	AttachInstanceBuffer()
+//
+//	Point the instance attributes of the bound VAO
+//	at the start of a buffer.
+///////////////////////////////////////////////////
+void ShapeMeshes::AttachInstanceBuffer(GLuint buffer)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	GLsizei stride = sizeof(INSTANCE_DATA);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(8 + column, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*)(offsetof(INSTANCE_DATA, model) + sizeof(glm::vec4) * column));
+		glVertexAttribDivisor(8 + column, 1);
+		glEnableVertexAttribArray(8 + column);
+	}
+
+	glVertexAttribPointer(12, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(INSTANCE_DATA, uvScale));
+	glVertexAttribDivisor(12, 1);
+	glEnableVertexAttribArray(12);
+
+	glVertexAttribPointer(13, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(INSTANCE_DATA, tint));
+	glVertexAttribDivisor(13, 1);
+	glEnableVertexAttribArray(13);
+}
+
+///////////////////////////////////////////////////
+//	UploadInstances()
+//
+//	Interleave the instance streams and copy them
+//	into the instance buffer, growing it when the
+//	batch does not fit. Missing UV scale or tint
+//	streams default to 1. With a stream buffer the
+//	instances are written straight into its mapping,
+//	and the batch starts at its base instance.
+///////////////////////////////////////////////////
+GLsizei ShapeMeshes::UploadInstances(
+	const glm::mat4* transforms, size_t count,
+	const glm::vec2* uvScales,
+	const glm::vec4* tints)
+{
+	if (m_instanceVBO == 0 || count == 0)
+	{
+		return 0;
+	}
+
+	INSTANCE_DATA* instances = nullptr;
+	m_instanceBase = 0;
+	m_bInstancesInStream = false;
+	if (m_bStreamInstances == true && UseStreamBuffer())
+	{
+		// aligned to whole instances, so the offset is one
+		StreamRingBuffer::ALLOCATION allocation =
+			m_pStreamBuffer->Allocate(count * sizeof(INSTANCE_DATA), sizeof(INSTANCE_DATA));
+		if (allocation.data != nullptr)
+		{
+			instances = (INSTANCE_DATA*)allocation.data;
+			m_instanceBase = (GLuint)(allocation.offset / sizeof(INSTANCE_DATA));
+			m_bInstancesInStream = true;
+		}
+	}
+	if (instances == nullptr)
+	{
+		m_instanceData.resize(count);
+		instances = m_instanceData.data();
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		INSTANCE_DATA& instance = instances[i];
+		instance.model = transforms[i];
+		instance.uvScale = uvScales ? uvScales[i] : glm::vec2(1.0f);
+		instance.padding = glm::vec2(0.0f);
+		instance.tint = tints ? tints[i] : glm::vec4(1.0f);
+	}
+
+	if (m_bInstancesInStream == true)
+	{
+		return (GLsizei)count;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	while (m_instanceCapacity < count)
+	{
+		m_instanceCapacity *= 2;
+	}
+
+	// orphan the previous contents so the driver does not have
+	// to wait for draws that are still reading them
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(INSTANCE_DATA), m_instanceData.data());
+
+	return (GLsizei)count;
 }
@@ -1,19 +1,27 @@
-///////////////////////////////////////////////////////////////////////////////
-// shapemeshes.h
-// ============
-// create meshes for various 3D primitives: 
-//     box, cone, cylinder, plane, prism, pyramid, sphere, tapered cylinder, torus
-//
-//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
-//	Created for CS-330-Computational Graphics and Visualization, Nov. 7th, 2022
+///////////////////////////////////////////////////////////////////////////////
+// shapemeshes.h
+// ============
+// create meshes for various 3D primitives: 
+//     box, cone, cylinder, plane, prism, pyramid, sphere, tapered cylinder, torus
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 7th, 2022
 ///////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
 #include <GL/glew.h>
 
+#include "MeshGenerators.h"
+#include "MeshOptimizer.h"
+
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <vector>
+
+class StreamRingBuffer;
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -23,18 +31,119 @@
 class ShapeMeshes
 {
 public:
+	// vertex layouts the shared arena can be stored in
+	enum VERTEX_LAYOUT
+	{
+		LAYOUT_FLOAT = 0,	// 32 bytes: float position, normal and UV
+		LAYOUT_PACKED		// 16 bytes: snorm16 position against the mesh
+							// bounds, octahedral snorm16 normal, half UV
+	};
+
 	// constructor
-	ShapeMeshes();
+	ShapeMeshes(VERTEX_LAYOUT layout = LAYOUT_FLOAT);
+
+	// number of levels of detail generated for the curved
+	// shapes; level 0 is the full detail mesh
+	static const int MAX_LOD_LEVELS = 4;
+
+	// fraction of a level's screen size threshold an object has
+	// to move past before the level changes
+	static constexpr float LOD_HYSTERESIS = 0.15f;
+
+	// per-frame counters of the submitted geometry
+	struct FRAME_STATS
+	{
+		unsigned int triangles[MAX_LOD_LEVELS] = {};	// triangles drawn at each level
+		unsigned int vertexFetches = 0;	// vertices shaded, from the simulated cache
+	};
+
+	// what the mesh optimiser did to one loaded mesh
+	struct MESH_REPORT
+	{
+		const char* name;
+		int lodLevel;
+		GLuint nVertices;
+		GLuint nTriangles;
+		MeshOptimizer::OPTIMIZE_STATS stats;
+	};
+
+	// object-space bounds of the full detail mesh; the half
+	// sphere and half torus report the bounds of the whole shape
+	struct MESH_BOUNDS
+	{
+		glm::vec3 boxMin = glm::vec3(0.0f);
+		glm::vec3 boxMax = glm::vec3(0.0f);
+		glm::vec3 sphereCenter = glm::vec3(0.0f);	// center of the box
+		float sphereRadius = 0.0f;	// farthest vertex from the center
+	};
+
+	// world-space copies of loaded meshes merged into one
+	// vertex and index buffer, drawn with a single call; the
+	// vertices are always stored in the float layout
+	struct STATIC_BATCH
+	{
+		std::vector<GLfloat> vertices;	// interleaved pos / normal / uv
+		std::vector<GLfloat> tangents;	// when the meshes have tangents
+		std::vector<GLuint> indices;	// triangle list
+		GLuint vao = 0;
+		GLuint buffers[3] = {};			// vertices, indices, tangents
+		GLsizei nIndices = 0;			// indices uploaded
+		GLuint nFetches = 0;			// vertices shaded per draw
+		bool bDirty = true;				// changed since the upload
+	};
 
 private:
 
-	// stores the GL data relative to a given mesh
+	// a sub-range of the shared index buffer
+	struct DRAW_RANGE
+	{
+		GLuint firstIndex;	// First index in the arena index buffer
+		GLuint nIndices;	// Number of indices to draw
+		GLint baseVertex;	// Added to every index when drawing
+		GLuint nFetches;	// Vertices shaded when drawing the range
+	};
+
+	// the drawable parts of one level of detail
+	struct MESH_LOD
+	{
+		int nRanges;		// Number of drawable parts
+		DRAW_RANGE ranges[3];	// Parts such as bottom, top and sides
+		glm::vec3 boundsCenter;		// Packed positions are stored
+		glm::vec3 boundsHalfExtent;	// relative to the mesh bounds
+	};
+
+	// one vertex of the packed layout
+	struct PACKED_VERTEX
+	{
+		GLshort position[4];	// snorm16 within the mesh bounds, w unused
+		GLshort normal[2];		// snorm16 octahedral encoding
+		GLuint uv;				// two half floats
+	};
+
+	// one tangent of the packed layout, snorm16 direction
+	// and handedness
+	struct PACKED_TANGENT
+	{
+		GLshort tangent[4];
+	};
+
+	// stores the location of a given mesh in the shared arena
 	struct GLMesh
 	{
-		GLuint vao;         // Handle for the vertex array object
-		GLuint vbos[2];     // Handles for the vertex buffer objects
 		GLuint nVertices;	// Number of vertices for the mesh
 		GLuint nIndices;    // Number of indices for the mesh
+		GLint baseVertex;	// First vertex of the mesh in the arena
+		int nLods;			// Number of levels of detail
+		MESH_LOD lods[MAX_LOD_LEVELS];
+		MESH_BOUNDS bounds;	// Bounds of the full detail mesh
+	};
+
+	// a glDrawArrays range of a mesh laid out as fans or strips
+	struct ARRAY_RANGE
+	{
+		GLenum mode;
+		GLuint first;
+		GLuint count;
 	};
 
 	// the available 3D shapes
@@ -51,18 +160,113 @@ private:
 
 	bool m_bMemoryLayoutDone;
 
+	// every mesh lives in one interleaved vertex buffer and one
+	// index buffer behind a single VAO; the CPU copies are
+	// uploaded on the first draw after a mesh is loaded
+	GLuint m_arenaVAO;
+	GLuint m_arenaVBOs[3];
+	bool m_bArenaDirty;
+	std::vector<GLfloat> m_arenaVertices;
+	std::vector<GLuint> m_arenaIndices;
+
+	// per-instance attributes, read by the vertex shader
+	// when bUseInstancing is set (locations 8-11, 12, 13)
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec2 uvScale;
+		glm::vec2 padding;
+		glm::vec4 tint;
+	};
+
+	// instance buffer shared by every mesh VAO
+	GLuint m_instanceVBO;
+	size_t m_instanceCapacity;
+	std::vector<INSTANCE_DATA> m_instanceData;
+
+	// optional per-frame stream buffer; the arena VAO reads the
+	// instances from m_instanceSource, starting at the base
+	// instance of the batch when that is the stream buffer
+	StreamRingBuffer* m_pStreamBuffer;
+	bool m_bStreamInstances;		// base instance available
+	bool m_bInstancesInStream;
+	GLuint m_instanceSource;
+	GLuint m_instanceBase;
+	GLint m_storageAlignment;
+
+	// one command of a multi-draw indirect call, in the layout
+	// GL reads from the draw indirect buffer
+	struct INDIRECT_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;	// index of the per-draw record
+	};
+
+	// per-draw record of the indirect vertex shader, std430
+	struct INDIRECT_DRAW
+	{
+		glm::mat4 model;
+		glm::vec4 tint;
+		glm::vec2 uvScale;
+		glm::vec2 padding;
+		glm::vec4 decodeScale;	// as the decode attributes
+		glm::vec4 decodeOffset;
+	};
+
+	// commands and records of the pending indirect call; the
+	// draw index attribute (location 4) reads a buffer holding
+	// 0, 1, 2 ... once per instance, so each command finds its
+	// record through its base instance
+	std::vector<INDIRECT_COMMAND> m_indirectCommands;
+	std::vector<INDIRECT_DRAW> m_indirectDraws;
+	GLuint m_indirectBuffers[3];	// commands, records, draw indices
+	size_t m_indirectCommandCapacity;
+	size_t m_indirectDrawCapacity;
+
+	// level of detail requested for the following draws, and
+	// the level the current draw actually uses
+	int m_lodLevel;
+	int m_drawLevel;
+	FRAME_STATS m_frameStats;
+
+	// layout of the arena vertices; the packed vertices are
+	// built as the meshes are added
+	VERTEX_LAYOUT m_vertexLayout;
+	std::vector<PACKED_VERTEX> m_packedVertices;
+	GLuint m_arenaVertexCount;
+	const MESH_LOD* m_pDecodeLod;
+
+	// optional tangent stream, in its own buffer so meshes
+	// without tangents keep the smaller vertex
+	bool m_bGenerateTangents;
+	std::vector<GLfloat> m_arenaTangents;
+	std::vector<PACKED_TANGENT> m_packedTangents;
+
+	// mesh optimiser settings and results
+	bool m_bReorderTriangles;
+	std::vector<MESH_REPORT> m_meshReports;
+
 public:
 	// methods for loading the shape mesh data 
 	// into memory
 	void LoadBoxMesh();
-	void LoadConeMesh();
-	void LoadCylinderMesh();
-	void LoadPlaneMesh();
+	void LoadConeMesh(
+		int segments = MeshGenerators::DEFAULT_ROUND_SEGMENTS);
+	void LoadCylinderMesh(
+		int segments = MeshGenerators::DEFAULT_ROUND_SEGMENTS);
+	void LoadPlaneMesh(
+		int divisions = 1);
 	void LoadPrismMesh();
 	void LoadPyramid3Mesh();
 	void LoadPyramid4Mesh();
-	void LoadSphereMesh();
-	void LoadTaperedCylinderMesh();
+	void LoadSphereMesh(
+		int rings = MeshGenerators::DEFAULT_SPHERE_RINGS,
+		int segments = MeshGenerators::DEFAULT_SPHERE_SEGMENTS);
+	void LoadTaperedCylinderMesh(
+		int segments = MeshGenerators::DEFAULT_ROUND_SEGMENTS);
 	void LoadTorusMesh(float thickness = 0.2);
 
 	// methods for drawing the shape mesh in the
@@ -87,6 +291,217 @@ public:
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
 
+	// methods for drawing many copies of a shape mesh with
+	// one call - each instance takes its transform, and
+	// optionally a UV scale and a color tint, from the
+	// passed in streams
+	void DrawBoxMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawConeMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr,
+		bool bDrawBottom = true);
+	void DrawCylinderMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void DrawPlaneMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawPrismMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawPyramid3MeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawPyramid4MeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawSphereMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawHalfSphereMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawTaperedCylinderMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void DrawTorusMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+	void DrawHalfTorusMeshInstanced(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales = nullptr,
+		const glm::vec4* tints = nullptr);
+
+	// methods for copying a shape at full detail, placed by
+	// the model matrix, into a static batch; the parts are
+	// chosen as for the draw methods
+	void AddBoxToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddConeToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model,
+		bool bDrawBottom = true);
+	void AddCylinderToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void AddPlaneToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddPrismToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddPyramid3ToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddPyramid4ToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddSphereToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddHalfSphereToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddTaperedCylinderToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void AddTorusToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+	void AddHalfTorusToBatch(
+		STATIC_BATCH& batch, const glm::mat4& model);
+
+	// draw a static batch with the model matrix set to the
+	// identity, uploading it first when it changed
+	void DrawStaticBatch(STATIC_BATCH& batch);
+
+	// free the GL buffers of a static batch
+	void DeleteStaticBatch(STATIC_BATCH& batch);
+
+	// methods for collecting shapes into one multi-draw
+	// indirect call - each shape adds a per-draw record for
+	// the indirect vertex shader and one command per part at
+	// the selected level of detail; the parts are chosen as
+	// for the draw methods
+	void AddBoxIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddConeIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+		bool bDrawBottom = true);
+	void AddCylinderIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void AddPlaneIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddPrismIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddPyramid3Indirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddPyramid4Indirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddSphereIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddHalfSphereIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddTaperedCylinderIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	void AddTorusIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+	void AddHalfTorusIndirect(
+		const glm::mat4& model, const glm::vec2& uvScale, const glm::vec4& tint);
+
+	// issue the shapes added since the last call as a single
+	// glMultiDrawElementsIndirect, returns the command count
+	GLsizei DrawIndirect();
+
+	// whether the current context has multi-draw indirect and
+	// shader storage buffers (GL 4.3); the draw methods above
+	// work on any context
+	static bool IndirectSupported();
+
+	// storage buffer binding of the per-draw records
+	static const GLuint INDIRECT_DRAW_BINDING = 0;
+
+	// take the instance streams and the indirect commands and
+	// records of each frame from a persistently mapped stream
+	// buffer instead of orphaning buffers of their own; null
+	// restores the own buffers. The caller starts and ends the
+	// frames of the stream buffer.
+	void SetStreamBuffer(StreamRingBuffer* pStreamBuffer);
+
+	// select the level of detail used by the draw methods;
+	// shapes without that many levels use their coarsest one
+	void SetLodLevel(int lodLevel);
+
+	// approximate screen height, in pixels, of an object's
+	// bounding sphere given in object space
+	static float ProjectedSize(
+		const glm::vec3& center,
+		float radius,
+		const glm::mat4& model,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		float viewportHeight);
+
+	// level of detail for an object of the given screen size,
+	// staying on the current level inside the hysteresis band
+	static int SelectLodLevel(float screenSize, int currentLevel);
+
+	// every mesh is run through the mesh optimiser when it is
+	// loaded; turn the triangle reordering off before loading
+	// when translucent meshes are blended without sorting, where
+	// the order of their triangles shows
+	void SetTriangleReordering(bool bReorderTriangles);
+	const std::vector<MESH_REPORT>& GetMeshReports() const { return m_meshReports; }
+
+	// generate per-vertex tangents (attribute location 3) for
+	// the meshes loaded after this call; call it before loading
+	// the first mesh so every mesh has them
+	void SetTangentGeneration(bool bGenerateTangents);
+	bool HasTangents() const { return m_arenaTangents.empty() == false || m_packedTangents.empty() == false; }
+
+	// bytes of one vertex in the passed layout, and of the
+	// vertices of every loaded mesh stored in it
+	static GLsizei VertexStride(VERTEX_LAYOUT layout);
+	size_t GetVertexBufferBytes(VERTEX_LAYOUT layout) const { return (size_t)m_arenaVertexCount * VertexStride(layout); }
+	VERTEX_LAYOUT GetVertexLayout() const { return m_vertexLayout; }
+
+	// object-space bounds of each loaded mesh, for culling
+	// and level of detail selection
+	const MESH_BOUNDS& GetBoxBounds() const { return m_BoxMesh.bounds; }
+	const MESH_BOUNDS& GetConeBounds() const { return m_ConeMesh.bounds; }
+	const MESH_BOUNDS& GetCylinderBounds() const { return m_CylinderMesh.bounds; }
+	const MESH_BOUNDS& GetPlaneBounds() const { return m_PlaneMesh.bounds; }
+	const MESH_BOUNDS& GetPrismBounds() const { return m_PrismMesh.bounds; }
+	const MESH_BOUNDS& GetPyramid3Bounds() const { return m_Pyramid3Mesh.bounds; }
+	const MESH_BOUNDS& GetPyramid4Bounds() const { return m_Pyramid4Mesh.bounds; }
+	const MESH_BOUNDS& GetSphereBounds() const { return m_SphereMesh.bounds; }
+	const MESH_BOUNDS& GetTaperedCylinderBounds() const { return m_TaperedCylinderMesh.bounds; }
+	const MESH_BOUNDS& GetTorusBounds() const { return m_TorusMesh.bounds; }
+
+	void ResetFrameStats() { m_frameStats = FRAME_STATS(); }
+	const FRAME_STATS& GetFrameStats() const { return m_frameStats; }
+
 
 private:
 
@@ -98,4 +513,86 @@ private:
 	// called to set the memory layout 
 	// template for shader data
 	void SetShaderMemoryLayout();
+
+	// called to optimise mesh data and append it
+	// to the shared arena
+	void AddIndexedMesh(
+		GLMesh& mesh,
+		const char* name,
+		const GLfloat* verts, GLuint nVertices,
+		const GLuint* indices, GLuint nIndices);
+	void AddArrayMesh(
+		GLMesh& mesh,
+		const char* name,
+		const GLfloat* verts, GLuint nVertices,
+		const ARRAY_RANGE* ranges, int nRanges);
+	void AddGeneratedMesh(
+		GLMesh& mesh,
+		const char* name,
+		MeshGenerators::MESH_DATA data,
+		int lodLevel = 0);
+
+	// called to scale a segment or ring count down for
+	// a level of detail
+	static int LodResolution(int resolution, int lodLevel, int minimum);
+
+	// called to look up the draw ranges of the selected
+	// level of detail of a mesh
+	const DRAW_RANGE* UseLod(const GLMesh& mesh);
+
+	// called to pass the position decode of a packed mesh
+	// to the vertex shader
+	void SetVertexDecode(const MESH_LOD& lod);
+
+	// called to bind the arena VAO before drawing
+	void BindArena();
+
+	// called to draw a sub-range of the arena
+	void DrawRange(const DRAW_RANGE& range);
+	void DrawRange(const DRAW_RANGE& range, GLsizei instances);
+
+	// called to copy one part of a mesh, transformed to
+	// world space, to the end of a static batch
+	void AppendToBatch(
+		STATIC_BATCH& batch,
+		const GLMesh& mesh,
+		const DRAW_RANGE& range,
+		const glm::mat4& model);
+
+	// called to create or refill the GL buffers of a
+	// static batch
+	void UploadStaticBatch(STATIC_BATCH& batch);
+
+	// called to add the per-draw record of a mesh and a
+	// command for each part set in the parts mask (bit n
+	// selects range n) to the pending indirect call
+	void AppendIndirect(
+		const GLMesh& mesh,
+		unsigned int parts,
+		const glm::mat4& model,
+		const glm::vec2& uvScale,
+		const glm::vec4& tint);
+
+	// called to attach the shared instance buffer
+	// to the currently bound VAO
+	void SetInstanceMemoryLayout();
+
+	// called to point the instance attributes of the
+	// currently bound VAO at a buffer
+	void AttachInstanceBuffer(GLuint buffer);
+
+	// called to check whether the stream buffer is
+	// set and persistently mapped
+	bool UseStreamBuffer() const;
+
+	// called after binding the arena VAO to re-point its
+	// instance attributes when their buffer changed
+	void UpdateInstanceSource();
+
+	// called to copy the instance streams into the
+	// instance buffer, returns the instance count
+	GLsizei UploadInstances(
+		const glm::mat4* transforms, size_t count,
+		const glm::vec2* uvScales,
+		const glm::vec4* tints);
 };
\ No newline at end of file
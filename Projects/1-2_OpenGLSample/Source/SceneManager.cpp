@@ -226,32 +226,24 @@ int SceneManager::FindTextureSlot(std::string tag)
  *
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
+ *  The tag is looked up in the material index built when the
+ *  materials are defined, and false is returned when no material
+ *  uses the tag.
  ***********************************************************/
 bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL &material)
 {
-	if (m_objectMaterials.size() == 0)
+	auto found = m_materialIndex.find(tag);
+	if (found == m_materialIndex.end())
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
+	const OBJECT_MATERIAL& defined = m_objectMaterials[found->second];
+	material.ambientColor = defined.ambientColor;
+	material.ambientStrength = defined.ambientStrength;
+	material.diffuseColor = defined.diffuseColor;
+	material.specularColor = defined.specularColor;
+	material.shininess = defined.shininess;
 
 	return(true);
 }
@@ -525,6 +517,14 @@ void SceneManager::DefineObjectMaterials()
 	grapeMaterial.tag = "grape";
 
 	m_objectMaterials.push_back(grapeMaterial);
+
+	// index the materials by tag so that they can be found
+	// without searching the whole list for every draw
+	m_materialIndex.clear();
+	for (size_t index = 0; index < m_objectMaterials.size(); index++)
+	{
+		m_materialIndex.emplace(m_objectMaterials[index].tag, index);
+	}
 }
 
 /***********************************************************
@@ -584,6 +584,10 @@ void SceneManager::PrepareScene()
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
 
+	// the glass and wine are blended without sorting, so keep
+	// the triangles in the order the shapes were built in
+	m_basicMeshes->SetTriangleReordering(false);
+
 	m_basicMeshes->LoadBoxMesh();
 	m_basicMeshes->LoadPlaneMesh();
 	m_basicMeshes->LoadCylinderMesh();
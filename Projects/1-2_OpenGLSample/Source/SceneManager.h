@@ -13,6 +13,7 @@
 #include "ShapeMeshes.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -58,6 +59,8 @@ private:
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// index of each defined material by tag
+	std::unordered_map<std::string, size_t> m_materialIndex;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
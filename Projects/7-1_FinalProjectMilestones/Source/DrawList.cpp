@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////
+// DrawList.cpp
+// ============
+// retained list of scene draw items sorted by a 64-bit state key
+//
+// Key layout, most significant bit first:
+//
+//   opaque       | 0 | mode:3 | texture set:12 | mesh:5 parts:3 | lod:2 | depth:24 | 0:14 |
+//   transparent  | 1 | far-to-near depth:24 | mode:3 | texture set:12 | 0:24 |
+//
+// Opaque items group by shader path, then texture set, then mesh and
+// level of detail, and are drawn front to back inside a group. Transparent items always sort
+// after opaque ones and are drawn back to front.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DrawList.h"
+
+#include <cstring>
+
+namespace
+{
+    // view distance mapped onto the 24-bit depth field
+    const float MAX_SORT_DISTANCE = 1000.0f;
+    const uint64_t DEPTH_MASK = 0xFFFFFF;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes all recorded draw items.
+ ***********************************************************/
+void DrawList::Clear()
+{
+    m_items.clear();
+    m_order.clear();
+    m_sorted = false;
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method records a draw item at the end of the list.
+ ***********************************************************/
+void DrawList::Add(const DRAW_ITEM &item)
+{
+    m_items.push_back(item);
+    m_sorted = false;
+}
+
+/***********************************************************
+ *  SetLod()
+ *
+ *  This method sets the level of detail of an item. The
+ *  level is part of the sort key, so a change invalidates
+ *  the current order.
+ ***********************************************************/
+void DrawList::SetLod(size_t index, uint8_t lod)
+{
+    if (m_items[index].lod != lod)
+    {
+        m_items[index].lod = lod;
+        m_sorted = false;
+    }
+}
+
+/***********************************************************
+ *  BuildKey()
+ *
+ *  This method packs the render state of an item and its
+ *  quantized view distance into a 64-bit sort key.
+ ***********************************************************/
+uint64_t DrawList::BuildKey(const DRAW_ITEM &item, float viewDistance)
+{
+    float normalized = viewDistance / MAX_SORT_DISTANCE;
+    if (normalized < 0.0f) normalized = 0.0f;
+    if (normalized > 1.0f) normalized = 1.0f;
+    uint64_t depth = (uint64_t)(normalized * (float)DEPTH_MASK);
+
+    uint64_t mode = item.shaderMode & 0x7;
+    uint64_t textureSet = item.textureSet & 0xFFF;
+
+    if (item.transparent)
+    {
+        return (1ULL << 63)
+            | ((DEPTH_MASK - depth) << 39)
+            | (mode << 36)
+            | (textureSet << 24);
+    }
+
+    uint64_t mesh = ((uint64_t)(item.mesh & 0x1F) << 3) | (item.parts & 0x7);
+    uint64_t lod = item.lod & 0x3;
+    return (mode << 60)
+        | (textureSet << 48)
+        | (mesh << 40)
+        | (lod << 38)
+        | (depth << 14);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method computes the key of every item for the eye
+ *  position and orders the items by key. The previous order
+ *  is kept when the list and the eye are unchanged.
+ ***********************************************************/
+void DrawList::Sort(const glm::vec3 &eyePosition)
+{
+    if (m_sorted && eyePosition == m_sortEye)
+    {
+        return;
+    }
+
+    m_entries.resize(m_items.size());
+    for (size_t i = 0; i < m_items.size(); i++)
+    {
+        glm::vec3 center = glm::vec3(m_items[i].model[3]);
+        m_entries[i].key = BuildKey(m_items[i], glm::length(center - eyePosition));
+        m_entries[i].index = (uint32_t)i;
+    }
+
+    RadixSort();
+
+    m_order.resize(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        m_order[i] = m_entries[i].index;
+    }
+
+    m_sorted = true;
+    m_sortEye = eyePosition;
+}
+
+/***********************************************************
+ *  RadixSort()
+ *
+ *  This method sorts the key entries with a least
+ *  significant digit radix sort, eight bits per pass.
+ *  Passes where every key has the same digit are skipped,
+ *  which drops most of the work for the sparse key fields.
+ ***********************************************************/
+void DrawList::RadixSort()
+{
+    const size_t count = m_entries.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    m_scratch.resize(count);
+    SORT_ENTRY* source = &m_entries[0];
+    SORT_ENTRY* destination = &m_scratch[0];
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t histogram[256];
+        memset(histogram, 0, sizeof(histogram));
+        for (size_t i = 0; i < count; i++)
+        {
+            histogram[(source[i].key >> shift) & 0xFF]++;
+        }
+
+        // every key shares this digit - the pass would not move anything
+        if (histogram[(source[0].key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            size_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        SORT_ENTRY* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != &m_entries[0])
+    {
+        m_entries.swap(m_scratch);
+    }
+}
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// DrawList.h
+// ============
+// retained list of scene draw items sorted by a 64-bit state key
+//
+// RenderScene records each object once as a DRAW_ITEM. Every frame the
+// items get a sort key built from their render state and view depth, are
+// radix sorted on that key, and are submitted in key order so objects that
+// share a shader path and texture set are drawn back to back.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class DrawList
+{
+public:
+    // meshes that can be drawn from ShapeMeshes
+    enum MESH_TYPE : uint8_t
+    {
+        MESH_BOX = 0,
+        MESH_CONE,
+        MESH_CYLINDER,
+        MESH_PLANE,
+        MESH_PRISM,
+        MESH_PYRAMID3,
+        MESH_PYRAMID4,
+        MESH_SPHERE,
+        MESH_HALF_SPHERE,
+        MESH_TAPERED_CYLINDER,
+        MESH_TORUS,
+        MESH_HALF_TORUS,
+        MESH_COUNT
+    };
+
+    // optional parts of the cone and cylinder meshes
+    enum MESH_PARTS : uint8_t
+    {
+        PART_TOP    = 1,
+        PART_BOTTOM = 2,
+        PART_SIDES  = 4,
+        PART_ALL    = PART_TOP | PART_BOTTOM | PART_SIDES
+    };
+
+    // fragment shader paths, in the order they are submitted
+    enum SHADER_MODE : uint8_t
+    {
+        SHADER_CHECKERBOARD = 0,
+        SHADER_PBR,
+        SHADER_TEXTURE,
+        SHADER_COLOR,
+        SHADER_EMISSIVE
+    };
+
+    struct DRAW_ITEM
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        glm::vec2 uvScale = glm::vec2(1.0f);
+        glm::vec4 color = glm::vec4(1.0f);      // object color, or emissive rgb + alpha
+        glm::vec3 tint = glm::vec3(1.0f);       // PBR tint
+        glm::vec3 checkerColor1 = glm::vec3(1.0f);
+        glm::vec3 checkerColor2 = glm::vec3(0.0f);
+        float emissiveStrength = 3.0f;
+        uint16_t textureSet = 0;                // PBR set or texture slot
+        uint16_t material = 0;                  // record of the material table
+        uint16_t sharedMaterial = 0;            // the same with a neutral color and UV scale
+        uint8_t shaderMode = SHADER_COLOR;
+        uint8_t mesh = MESH_BOX;
+        uint8_t parts = PART_ALL;
+        uint8_t lod = 0;                        // level of detail, chosen per frame
+        bool transparent = false;               // drawn last, back to front
+        bool isStatic = false;                  // scenery, merged into a static batch
+    };
+
+    // per-frame submission counters
+    struct FRAME_STATS
+    {
+        unsigned int draws = 0;             // draw items submitted
+        unsigned int culled = 0;            // items outside the view frustum
+        unsigned int occluded = 0;          // items hidden behind occluders
+        unsigned int drawCalls = 0;         // mesh draws issued to GL
+        unsigned int instancedBatches = 0;  // instanced draws among them
+        unsigned int indirectCommands = 0;  // commands of the multi-draw indirect calls
+        unsigned int modeChanges = 0;       // shader path switches
+        unsigned int materialChanges = 0;   // texture set switches
+        unsigned int staticBatches = 0;     // merged static batches drawn
+        unsigned int staticItems = 0;       // items inside those batches
+        unsigned int blockUploads = 0;      // frame, light and material uniform blocks uploaded
+    };
+
+    DrawList() = default;
+
+    void Clear();
+    void Add(const DRAW_ITEM &item);
+
+    size_t Size() const { return m_items.size(); }
+    bool Empty() const { return m_items.empty(); }
+    const DRAW_ITEM& Item(size_t index) const { return m_items[index]; }
+
+    // change the level of detail of an item; the list is sorted
+    // again on the next Sort() when the level changed
+    void SetLod(size_t index, uint8_t lod);
+
+    // build the sort keys for the given eye position and sort the
+    // items; does nothing when neither the items nor the eye changed
+    void Sort(const glm::vec3 &eyePosition);
+
+    // item indices in submission order, valid after Sort()
+    const std::vector<uint32_t>& Order() const { return m_order; }
+
+    // 64-bit sort key of an item at the given view distance
+    static uint64_t BuildKey(const DRAW_ITEM &item, float viewDistance);
+
+private:
+    struct SORT_ENTRY
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // stable LSD radix sort on the 64-bit keys, one byte per pass
+    void RadixSort();
+
+    std::vector<DRAW_ITEM> m_items;
+    std::vector<SORT_ENTRY> m_entries;
+    std::vector<SORT_ENTRY> m_scratch;
+    std::vector<uint32_t> m_order;
+
+    bool m_sorted = false;
+    glm::vec3 m_sortEye = glm::vec3(0.0f);
+};
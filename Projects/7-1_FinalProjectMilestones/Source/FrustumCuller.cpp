@@ -0,0 +1,279 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrustumCuller.cpp
+// ============
+// batch test of world-space bounding boxes against the view frustum
+//
+// A box with center c and half extent e is completely behind the plane
+// (n, d) when dot(n, c) + d + dot(abs(n), e) < 0 - the left side is the
+// signed distance of the box corner furthest along the plane normal.
+// The SIMD paths evaluate this for a block of boxes per plane and OR the
+// results together, so the only branch is the loop over blocks.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The default planes accept every box until the first
+ *  SetViewProjection() call.
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+    for (int i = 0; i < 6; i++)
+    {
+        m_planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes all boxes.
+ ***********************************************************/
+void FrustumCuller::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method stores the world-space box of an item.
+ ***********************************************************/
+void FrustumCuller::Add(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model)
+{
+    glm::vec3 worldCenter;
+    glm::vec3 worldExtent;
+    WorldBox(boxMin, boxMax, model, worldCenter, worldExtent);
+
+    m_centerX.push_back(worldCenter.x);
+    m_centerY.push_back(worldCenter.y);
+    m_centerZ.push_back(worldCenter.z);
+    m_extentX.push_back(worldExtent.x);
+    m_extentY.push_back(worldExtent.y);
+    m_extentZ.push_back(worldExtent.z);
+}
+
+/***********************************************************
+ *  WorldBox()
+ *
+ *  This method transforms the center of an object-space box
+ *  by the model matrix, and its half extent by the absolute
+ *  model matrix, giving the world-space box that encloses
+ *  the rotated and scaled object box.
+ ***********************************************************/
+void FrustumCuller::WorldBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model,
+                             glm::vec3 &worldCenter, glm::vec3 &worldExtent)
+{
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+
+    worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+    worldExtent =
+        glm::abs(glm::vec3(model[0])) * extent.x +
+        glm::abs(glm::vec3(model[1])) * extent.y +
+        glm::abs(glm::vec3(model[2])) * extent.z;
+}
+
+/***********************************************************
+ *  GetBox()
+ *
+ *  This method returns the stored world-space box of an item
+ *  as its corners.
+ ***********************************************************/
+void FrustumCuller::GetBox(size_t index, glm::vec3 &boxMin, glm::vec3 &boxMax) const
+{
+    glm::vec3 center(m_centerX[index], m_centerY[index], m_centerZ[index]);
+    glm::vec3 extent(m_extentX[index], m_extentY[index], m_extentZ[index]);
+    boxMin = center - extent;
+    boxMax = center + extent;
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method sets the planes the boxes are tested against.
+ ***********************************************************/
+void FrustumCuller::SetViewProjection(const glm::mat4 &viewProjection)
+{
+    ExtractPlanes(viewProjection, m_planes);
+}
+
+/***********************************************************
+ *  ExtractPlanes()
+ *
+ *  This method extracts the left, right, bottom, top, near
+ *  and far planes from the rows of the view-projection
+ *  matrix (Gribb / Hartmann) and normalizes them.
+ ***********************************************************/
+void FrustumCuller::ExtractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6])
+{
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++)
+    {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row],
+                              viewProjection[2][row], viewProjection[3][row]);
+    }
+
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f)
+        {
+            planes[i] = planes[i] / length;
+        }
+    }
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method tests every box against the six planes,
+ *  eight (AVX) or four (SSE) boxes at a time where the
+ *  build allows it, and the remainder one at a time.
+ ***********************************************************/
+size_t FrustumCuller::Cull(uint8_t *visible) const
+{
+    const size_t count = Size();
+    size_t first = 0;
+    size_t visibleCount = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+    const __m256 zero = _mm256_setzero_ps();
+    for (; first + 8 <= count; first += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&m_centerX[first]);
+        __m256 cy = _mm256_loadu_ps(&m_centerY[first]);
+        __m256 cz = _mm256_loadu_ps(&m_centerZ[first]);
+        __m256 ex = _mm256_loadu_ps(&m_extentX[first]);
+        __m256 ey = _mm256_loadu_ps(&m_extentY[first]);
+        __m256 ez = _mm256_loadu_ps(&m_extentZ[first]);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (int i = 0; i < 6; i++)
+        {
+            const glm::vec4 &plane = m_planes[i];
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)),
+                              _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)),
+                              _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(fabsf(plane.x))),
+                              _mm256_mul_ps(ey, _mm256_set1_ps(fabsf(plane.y)))),
+                _mm256_mul_ps(ez, _mm256_set1_ps(fabsf(plane.z))));
+            outside = _mm256_or_ps(outside,
+                _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(outside);
+        for (int lane = 0; lane < 8; lane++)
+        {
+            uint8_t inside = ((mask >> lane) & 1) ? 0 : 1;
+            visible[first + lane] = inside;
+            visibleCount += inside;
+        }
+    }
+#elif defined(FRUSTUM_CULLER_SSE)
+    const __m128 zero = _mm_setzero_ps();
+    for (; first + 4 <= count; first += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&m_centerX[first]);
+        __m128 cy = _mm_loadu_ps(&m_centerY[first]);
+        __m128 cz = _mm_loadu_ps(&m_centerZ[first]);
+        __m128 ex = _mm_loadu_ps(&m_extentX[first]);
+        __m128 ey = _mm_loadu_ps(&m_extentY[first]);
+        __m128 ez = _mm_loadu_ps(&m_extentZ[first]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int i = 0; i < 6; i++)
+        {
+            const glm::vec4 &plane = m_planes[i];
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                           _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)),
+                           _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(fabsf(plane.x))),
+                           _mm_mul_ps(ey, _mm_set1_ps(fabsf(plane.y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(fabsf(plane.z))));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint8_t inside = ((mask >> lane) & 1) ? 0 : 1;
+            visible[first + lane] = inside;
+            visibleCount += inside;
+        }
+    }
+#endif
+
+    return visibleCount + CullScalar(first, count, visible);
+}
+
+/***********************************************************
+ *  CullScalar()
+ *
+ *  This method tests the boxes of a range one at a time,
+ *  with the same plane test as the SIMD paths.
+ ***********************************************************/
+size_t FrustumCuller::CullScalar(size_t first, size_t last, uint8_t *visible) const
+{
+    size_t visibleCount = 0;
+    for (size_t n = first; n < last; n++)
+    {
+        bool outside = false;
+        for (int i = 0; i < 6 && !outside; i++)
+        {
+            const glm::vec4 &plane = m_planes[i];
+            float distance = m_centerX[n] * plane.x + m_centerY[n] * plane.y + m_centerZ[n] * plane.z + plane.w;
+            float radius = m_extentX[n] * fabsf(plane.x) + m_extentY[n] * fabsf(plane.y) + m_extentZ[n] * fabsf(plane.z);
+            outside = distance + radius < 0.0f;
+        }
+        visible[n] = outside ? 0 : 1;
+        visibleCount += outside ? 0 : 1;
+    }
+    return visibleCount;
+}
+
+/***********************************************************
+ *  InstructionSet()
+ *
+ *  This method names the SIMD path compiled into Cull().
+ ***********************************************************/
+const char* FrustumCuller::InstructionSet()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_CULLER_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
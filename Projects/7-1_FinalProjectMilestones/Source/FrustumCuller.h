@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrustumCuller.h
+// ============
+// batch test of world-space bounding boxes against the view frustum
+//
+// The boxes of the scene items are kept as structure-of-arrays streams
+// (one array per center and extent component) so the test runs four or
+// eight boxes at a time with SSE or AVX. The six frustum planes are
+// taken from the view-projection matrix each frame; a box is culled when
+// it lies completely behind any one of them. The test is conservative -
+// a box that straddles a frustum corner can be kept although it is not
+// visible, but no visible box is ever culled.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FrustumCuller
+{
+public:
+    FrustumCuller();
+
+    // remove all boxes
+    void Clear();
+
+    // add the object-space box of an item placed by the model
+    // matrix; it is stored as the world-space box around it
+    void Add(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model);
+
+    size_t Size() const { return m_centerX.size(); }
+
+    // world-space box of the index-th added item
+    void GetBox(size_t index, glm::vec3 &boxMin, glm::vec3 &boxMax) const;
+
+    // world-space box around an object-space box placed by the
+    // model matrix, as center and half extent
+    static void WorldBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model,
+                         glm::vec3 &worldCenter, glm::vec3 &worldExtent);
+
+    // extract the frustum planes of a view-projection matrix
+    void SetViewProjection(const glm::mat4 &viewProjection);
+    const glm::vec4* GetPlanes() const { return m_planes; }
+
+    // the six normalized, inward facing planes of a frustum
+    static void ExtractPlanes(const glm::mat4 &viewProjection, glm::vec4 planes[6]);
+
+    // write 1 for every box inside or crossing the frustum and 0
+    // for every culled box; returns the number of visible boxes
+    size_t Cull(uint8_t *visible) const;
+
+    // name of the instruction set Cull() was compiled for
+    static const char* InstructionSet();
+
+private:
+    // test boxes [first, last) one at a time
+    size_t CullScalar(size_t first, size_t last, uint8_t *visible) const;
+
+    // world-space box centers and half extents
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_extentX;
+    std::vector<float> m_extentY;
+    std::vector<float> m_extentZ;
+
+    // inward facing planes (normal xyz, distance w)
+    glm::vec4 m_planes[6];
+};
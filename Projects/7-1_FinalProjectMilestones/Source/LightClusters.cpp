@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// LightClusters.cpp
+// ============
+// assignment of point lights to the clusters of a froxel grid
+//
+// A light is first bounded by the slices between its nearest and farthest
+// view depth and by the screen rectangle of its view-space box, then
+// tested against the view-space box of every cluster in that range. The
+// (cluster, light) references are collected in light order and sorted
+// into per-cluster lists with a counting sort, so the index list of a
+// cluster keeps the lights in scene order.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************
+ *  LightRadius()
+ *
+ *  This method returns the distance d at which the
+ *  attenuation intensity / (d^2 + 1) of the shader equals
+ *  the cutoff; the shader subtracts the cutoff, so the
+ *  light reaches zero there without a visible edge.
+ ***********************************************************/
+float LightClusters::LightRadius(float intensity, float cutoff)
+{
+    if (cutoff <= 0.0f || intensity <= cutoff)
+    {
+        return (cutoff <= 0.0f) ? 1.0e30f : 0.0f;
+    }
+    return sqrtf(intensity / cutoff - 1.0f);
+}
+
+/***********************************************************
+ *  SliceOfDepth()
+ *
+ *  This method returns the depth slice of a view depth, as
+ *  the fragment shader computes it.
+ ***********************************************************/
+int LightClusters::SliceOfDepth(float depth) const
+{
+    int slice = (int)floorf(logf(depth) * m_scale.z + m_scale.w);
+    return std::min(std::max(slice, 0), GRID_Z - 1);
+}
+
+/***********************************************************
+ *  UpdateClusterBoxes()
+ *
+ *  This method computes the view-space box of every
+ *  cluster. The edge of a tile is a line through the near
+ *  and far plane points of its NDC corner, which holds for
+ *  perspective and orthographic projections alike; a
+ *  cluster box bounds its four edges between the depths of
+ *  its slice.
+ ***********************************************************/
+void LightClusters::UpdateClusterBoxes(const glm::mat4& projection)
+{
+    m_boxProjection = projection;
+    m_boxFar = m_far;
+
+    const glm::mat4 inverse = glm::inverse(projection);
+    const int cornersX = GRID_X + 1;
+    const int cornersY = GRID_Y + 1;
+    std::vector<glm::vec3> nearPoints(cornersX * cornersY);
+    std::vector<glm::vec3> farPoints(cornersX * cornersY);
+    for (int y = 0; y < cornersY; y++)
+    {
+        for (int x = 0; x < cornersX; x++)
+        {
+            float ndcX = -1.0f + 2.0f * x / GRID_X;
+            float ndcY = -1.0f + 2.0f * y / GRID_Y;
+            glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            nearPoints[y * cornersX + x] = glm::vec3(nearPoint) / nearPoint.w;
+            farPoints[y * cornersX + x] = glm::vec3(farPoint) / farPoint.w;
+        }
+    }
+
+    // point of a corner edge at a view depth
+    auto edgePoint = [&](int corner, float depth)
+    {
+        const glm::vec3& nearPoint = nearPoints[corner];
+        const glm::vec3& farPoint = farPoints[corner];
+        float t = (depth + nearPoint.z) / (nearPoint.z - farPoint.z);
+        return nearPoint + (farPoint - nearPoint) * t;
+    };
+
+    m_boxMin.resize(CLUSTER_COUNT);
+    m_boxMax.resize(CLUSTER_COUNT);
+    for (int z = 0; z < GRID_Z; z++)
+    {
+        float depths[2] =
+        {
+            m_near * powf(m_far / m_near, (float)z / GRID_Z),
+            m_near * powf(m_far / m_near, (float)(z + 1) / GRID_Z)
+        };
+        for (int y = 0; y < GRID_Y; y++)
+        {
+            for (int x = 0; x < GRID_X; x++)
+            {
+                const int corners[4] =
+                {
+                    y * cornersX + x, y * cornersX + x + 1,
+                    (y + 1) * cornersX + x, (y + 1) * cornersX + x + 1
+                };
+                glm::vec3 boxMin(1.0e30f);
+                glm::vec3 boxMax(-1.0e30f);
+                for (float depth : depths)
+                {
+                    for (int corner : corners)
+                    {
+                        glm::vec3 point = edgePoint(corner, depth);
+                        boxMin = glm::min(boxMin, point);
+                        boxMax = glm::max(boxMax, point);
+                    }
+                }
+                const int cluster = (z * GRID_Y + y) * GRID_X + x;
+                m_boxMin[cluster] = boxMin;
+                m_boxMax[cluster] = boxMax;
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method fills the light list of every cluster for a
+ *  view. The slices end at the farthest depth any light
+ *  reaches, as fragments beyond it get no light anyway.
+ ***********************************************************/
+void LightClusters::Build(const glm::mat4& view, const glm::mat4& projection, float viewportWidth, float viewportHeight)
+{
+    // near and far plane of a perspective or orthographic projection
+    float projectionFar;
+    if (projection[2][3] != 0.0f)
+    {
+        m_near = projection[3][2] / (projection[2][2] - 1.0f);
+        projectionFar = projection[3][2] / (projection[2][2] + 1.0f);
+    }
+    else
+    {
+        m_near = (projection[3][2] + 1.0f) / projection[2][2];
+        projectionFar = (projection[3][2] - 1.0f) / projection[2][2];
+    }
+
+    const size_t lightCount = m_lights.size();
+    std::vector<glm::vec3> centers(lightCount);
+    float lightFar = m_near * 2.0f;
+    for (size_t i = 0; i < lightCount; i++)
+    {
+        centers[i] = glm::vec3(view * glm::vec4(glm::vec3(m_lights[i].positionRadius), 1.0f));
+        lightFar = std::max(lightFar, -centers[i].z + m_lights[i].positionRadius.w);
+    }
+    m_far = std::min(lightFar, projectionFar);
+
+    const float logRatio = logf(m_far / m_near);
+    m_scale = glm::vec4(GRID_X / std::max(viewportWidth, 1.0f), GRID_Y / std::max(viewportHeight, 1.0f),
+                        GRID_Z / logRatio, -GRID_Z * logf(m_near) / logRatio);
+
+    if (projection != m_boxProjection || m_far != m_boxFar)
+    {
+        UpdateClusterBoxes(projection);
+    }
+
+    m_clusterOfReference.clear();
+    m_lightOfReference.clear();
+    m_visibleLights = 0;
+    for (size_t i = 0; i < lightCount; i++)
+    {
+        const glm::vec3& center = centers[i];
+        const float radius = m_lights[i].positionRadius.w;
+        const float depth = -center.z;
+        if (radius <= 0.0f || depth + radius < m_near || depth - radius > m_far)
+        {
+            continue;
+        }
+
+        // screen rectangle of the part of the light's view-space
+        // box in front of the near plane
+        glm::vec2 ndcMin(1.0e30f);
+        glm::vec2 ndcMax(-1.0e30f);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 point = center + glm::vec3((corner & 1) ? radius : -radius,
+                                                 (corner & 2) ? radius : -radius,
+                                                 (corner & 4) ? radius : -radius);
+            point.z = std::min(point.z, -m_near);
+            glm::vec4 clip = projection * glm::vec4(point, 1.0f);
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+        if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+        {
+            continue;
+        }
+
+        const int x0 = std::max((int)floorf((ndcMin.x * 0.5f + 0.5f) * GRID_X), 0);
+        const int x1 = std::min((int)floorf((ndcMax.x * 0.5f + 0.5f) * GRID_X), GRID_X - 1);
+        const int y0 = std::max((int)floorf((ndcMin.y * 0.5f + 0.5f) * GRID_Y), 0);
+        const int y1 = std::min((int)floorf((ndcMax.y * 0.5f + 0.5f) * GRID_Y), GRID_Y - 1);
+        const int z0 = SliceOfDepth(std::max(depth - radius, m_near));
+        const int z1 = SliceOfDepth(std::min(depth + radius, m_far));
+
+        const size_t referencesBefore = m_clusterOfReference.size();
+        for (int z = z0; z <= z1; z++)
+        {
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    // sphere against the cluster box
+                    const int cluster = (z * GRID_Y + y) * GRID_X + x;
+                    glm::vec3 closest = glm::clamp(center, m_boxMin[cluster], m_boxMax[cluster]);
+                    glm::vec3 offset = closest - center;
+                    if (glm::dot(offset, offset) <= radius * radius)
+                    {
+                        m_clusterOfReference.push_back((uint32_t)cluster);
+                        m_lightOfReference.push_back((uint32_t)i);
+                    }
+                }
+            }
+        }
+        if (m_clusterOfReference.size() > referencesBefore)
+        {
+            m_visibleLights++;
+        }
+    }
+
+    // counting sort of the references by cluster
+    m_ranges.assign(CLUSTER_COUNT, RANGE{ 0, 0 });
+    for (uint32_t cluster : m_clusterOfReference)
+    {
+        m_ranges[cluster].count++;
+    }
+    uint32_t offset = 0;
+    m_maxClusterLights = 0;
+    for (RANGE& range : m_ranges)
+    {
+        range.offset = offset;
+        offset += range.count;
+        m_maxClusterLights = std::max(m_maxClusterLights, range.count);
+        range.count = 0;
+    }
+    m_indices.resize(offset);
+    for (size_t reference = 0; reference < m_clusterOfReference.size(); reference++)
+    {
+        RANGE& range = m_ranges[m_clusterOfReference[reference]];
+        m_indices[range.offset + range.count++] = m_lightOfReference[reference];
+    }
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// LightClusters.h
+// ============
+// assignment of point lights to the clusters of a froxel grid
+//
+// The view frustum is divided into GRID_X x GRID_Y screen tiles and
+// GRID_Z depth slices, spaced exponentially so that near and far slices
+// cover similar screen-space volumes. Every light has a finite radius,
+// where its attenuation intensity / (d^2 + 1) falls to the cutoff, and
+// Build() lists it in each cluster its sphere touches. The fragment
+// shader finds its cluster from the pixel and the view depth and loops
+// only over that list, so its cost follows the local light density
+// rather than the number of lights in the scene.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class LightClusters
+{
+public:
+    static const int GRID_X = 16;
+    static const int GRID_Y = 9;
+    static const int GRID_Z = 24;
+    static const int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    // light record of the LightRecords storage buffer (std430)
+    struct LIGHT
+    {
+        glm::vec4 positionRadius;   // xyz world position, w radius
+        glm::vec4 colorIntensity;   // rgb color, w intensity
+    };
+
+    // offset into the index list and light count of a cluster
+    // (uvec2 of the LightClusters storage buffer)
+    struct RANGE
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // distance at which intensity / (d^2 + 1) falls to the cutoff
+    static float LightRadius(float intensity, float cutoff);
+
+    // replace the lights; their radius must be set
+    void SetLights(const std::vector<LIGHT>& lights) { m_lights = lights; }
+    const std::vector<LIGHT>& GetLights() const { return m_lights; }
+
+    // assign the lights to the clusters of a view, for a viewport
+    // of the given size in pixels
+    void Build(const glm::mat4& view, const glm::mat4& projection, float viewportWidth, float viewportHeight);
+
+    // cluster ranges, in x then y then z order, and the light
+    // indices they refer to
+    const std::vector<RANGE>& GetRanges() const { return m_ranges; }
+    const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+
+    // how the fragment shader finds its cluster: xy clusters per
+    // pixel, z slices per unit of log view depth and w the slice
+    // bias, so slice = floor(log(depth) * z + w)
+    const glm::vec4& GetScale() const { return m_scale; }
+
+    // lights that touch at least one cluster, and the largest
+    // list of a cluster
+    size_t GetVisibleLights() const { return m_visibleLights; }
+    uint32_t GetMaxClusterLights() const { return m_maxClusterLights; }
+
+private:
+    // view-space box of every cluster, rebuilt when the
+    // projection or the depth range changes
+    void UpdateClusterBoxes(const glm::mat4& projection);
+
+    int SliceOfDepth(float depth) const;
+
+    std::vector<LIGHT> m_lights;
+
+    std::vector<RANGE> m_ranges;
+    std::vector<uint32_t> m_indices;
+    std::vector<uint32_t> m_clusterOfReference;  // cluster of each (cluster, light) reference
+    std::vector<uint32_t> m_lightOfReference;    // light of each reference
+
+    std::vector<glm::vec3> m_boxMin;
+    std::vector<glm::vec3> m_boxMax;
+    glm::mat4 m_boxProjection = glm::mat4(0.0f);
+    float m_boxFar = 0.0f;
+
+    float m_near = 0.1f;
+    float m_far = 1000.0f;
+    glm::vec4 m_scale = glm::vec4(0.0f);
+
+    size_t m_visibleLights = 0;
+    uint32_t m_maxClusterLights = 0;
+};
@@ -1,5 +1,8 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <fstream>          // image output
+#include <vector>           // pixel buffers
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +16,7 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "GLStateCache.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,13 +33,99 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// print per-frame renderer counters (enabled with --stats)
+	bool g_bShowFrameStats = false;
+
+	// store the meshes in the packed vertex layout (--packed)
+	ShapeMeshes::VERTEX_LAYOUT g_VertexLayout = ShapeMeshes::LAYOUT_FLOAT;
+
+	// build the PBR normal mapping frame from mesh tangents
+	// (turned off with --no-tangents)
+	bool g_bVertexTangents = true;
+
+	// render the first frame with both tangent frames, write
+	// them side by side to this image and exit (--tangent-diff)
+	const char* g_TangentDiffPath = nullptr;
+
+	// software occlusion culling (turned off with --no-occlusion)
+	// and the occluder selection (--occluders <count>,
+	// --occluder-area <screen fraction>)
+	bool g_bOcclusionCulling = true;
+	size_t g_MaxOccluders = SceneManager::DEFAULT_MAX_OCCLUDERS;
+	float g_MinOccluderArea = SceneManager::DEFAULT_MIN_OCCLUDER_AREA;
+
+	// merge the static scenery into per-material batches
+	// (turned off with --no-static-batching)
+	bool g_bStaticBatching = true;
+
+	// submit the draw list with multi-draw indirect when the
+	// context is GL 4.3 or newer (turned off with --no-indirect)
+	bool g_bIndirectDraw = true;
+
+	// pass the per-draw values through the stream buffer (turned
+	// off with --no-stream-buffer), persistently mapped when the
+	// context has buffer storage (turned off with --no-persistent)
+	bool g_bStreamBuffer = true;
+	bool g_bPersistentMapping = true;
+
+	// pass the camera, lights and environment in uniform blocks
+	// uploaded when they change (turned off with --no-uniform-blocks)
+	bool g_bUniformBlocks = true;
+
+	// read the material values from a table indexed per draw
+	// (turned off with --no-material-table)
+	bool g_bMaterialTable = true;
+
+	// draw each material path with its own shader variant rather
+	// than the uber-shader (turned off with --no-shader-variants)
+	bool g_bShaderVariants = true;
+
+	// light each fragment from the lights of its froxel cluster
+	// when the context has storage buffers (turned off with
+	// --no-clustered-lights); --extra-lights adds that many small
+	// lights, --light-cutoff sets where a light ends
+	bool g_bClusteredLights = true;
+	size_t g_ExtraLights = 0;
+	float g_LightCutoff = 0.005f;
+
+	// draw the lit opaque items into a G-buffer and light it in one
+	// full-screen pass (--deferred); G switches between forward and
+	// deferred shading while running, to compare their frame times
+	bool g_bDeferredShading = false;
+	bool g_bDeferredKeyDown = false;
+
+	// keep the linked shader programs as driver binaries on disk and
+	// load them on later runs (turned off with --no-program-cache)
+	bool g_bProgramCache = true;
+	const char* const PROGRAM_CACHE_DIRECTORY = "shader_cache";
+
+	// build the shader variants off the main thread while the scene
+	// draws with the uber-shader: on the driver's compile threads,
+	// else on a worker with a hidden context sharing the window's
+	// objects (--compile-worker to prefer it, --serial-compile to
+	// build them before the first frame)
+	ShaderManager::COMPILE_MODE g_CompileMode = ShaderManager::COMPILE_PARALLEL;
+	GLFWwindow* g_CompileContext = nullptr;
+
+	// GPU time of the scene, measured with a pair of timer queries
+	// while the frame counters are printed
+	GLuint g_FrameTimerQueries[2] = { 0, 0 };
+	int g_FrameTimerIndex = 0;
+	double g_GpuFrameMs = 0.0;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool CreateCompileContext();
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height); // callback declaration
+void PrintFrameStats();
+void BeginFrameTimer();
+void EndFrameTimer();
+void ProcessRendererKeys();
+bool WriteTangentDiff(const char* filename);
 
 /***********************************************************
  *  main(int, char*)
@@ -45,6 +135,95 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height); // call
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--stats") == 0)
+		{
+			g_bShowFrameStats = true;
+		}
+		else if (strcmp(argv[i], "--packed") == 0)
+		{
+			g_VertexLayout = ShapeMeshes::LAYOUT_PACKED;
+		}
+		else if (strcmp(argv[i], "--no-tangents") == 0)
+		{
+			g_bVertexTangents = false;
+		}
+		else if (strcmp(argv[i], "--tangent-diff") == 0 && i + 1 < argc)
+		{
+			g_TangentDiffPath = argv[++i];
+			g_bVertexTangents = true;
+		}
+		else if (strcmp(argv[i], "--no-occlusion") == 0)
+		{
+			g_bOcclusionCulling = false;
+		}
+		else if (strcmp(argv[i], "--occluders") == 0 && i + 1 < argc)
+		{
+			g_MaxOccluders = (size_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--occluder-area") == 0 && i + 1 < argc)
+		{
+			g_MinOccluderArea = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-static-batching") == 0)
+		{
+			g_bStaticBatching = false;
+		}
+		else if (strcmp(argv[i], "--no-indirect") == 0)
+		{
+			g_bIndirectDraw = false;
+		}
+		else if (strcmp(argv[i], "--no-stream-buffer") == 0)
+		{
+			g_bStreamBuffer = false;
+		}
+		else if (strcmp(argv[i], "--no-persistent") == 0)
+		{
+			g_bPersistentMapping = false;
+		}
+		else if (strcmp(argv[i], "--no-uniform-blocks") == 0)
+		{
+			g_bUniformBlocks = false;
+		}
+		else if (strcmp(argv[i], "--no-material-table") == 0)
+		{
+			g_bMaterialTable = false;
+		}
+		else if (strcmp(argv[i], "--no-shader-variants") == 0)
+		{
+			g_bShaderVariants = false;
+		}
+		else if (strcmp(argv[i], "--no-clustered-lights") == 0)
+		{
+			g_bClusteredLights = false;
+		}
+		else if (strcmp(argv[i], "--extra-lights") == 0 && i + 1 < argc)
+		{
+			g_ExtraLights = (size_t)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--light-cutoff") == 0 && i + 1 < argc)
+		{
+			g_LightCutoff = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--deferred") == 0)
+		{
+			g_bDeferredShading = true;
+		}
+		else if (strcmp(argv[i], "--no-program-cache") == 0)
+		{
+			g_bProgramCache = false;
+		}
+		else if (strcmp(argv[i], "--compile-worker") == 0)
+		{
+			g_CompileMode = ShaderManager::COMPILE_WORKER;
+		}
+		else if (strcmp(argv[i], "--serial-compile") == 0)
+		{
+			g_CompileMode = ShaderManager::COMPILE_SERIAL;
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -77,15 +256,88 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
+	// multi-draw indirect needs GL 4.3 and the vertex shader that
+	// reads the per-draw records; older contexts keep the 3.3 path
+	g_bIndirectDraw = g_bIndirectDraw && ShapeMeshes::IndirectSupported();
+	std::cout << "INFO: Draw submission: "
+		<< (g_bIndirectDraw ? "multi-draw indirect" : "instanced") << "\n" << std::endl;
+
+	// load the shader code from the external GLSL files, through the
+	// program cache when the driver can return program binaries
+	g_bProgramCache = g_bProgramCache && g_ShaderManager->SetProgramCache(PROGRAM_CACHE_DIRECTORY);
+	std::cout << "INFO: Shader programs: "
+		<< (g_bProgramCache ? "binary cache in " : "compiled from source")
+		<< (g_bProgramCache ? PROGRAM_CACHE_DIRECTORY : "") << "\n" << std::endl;
 	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
+		g_bIndirectDraw ? "../../Utilities/shaders/vertexShaderIndirect.glsl"
+		                : "../../Utilities/shaders/vertexShader.glsl",
 		"../../Utilities/shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// the worker context is only kept when the driver has no
+	// compile threads of its own, or the worker was asked for
+	if (g_CompileMode != ShaderManager::COMPILE_SERIAL && CreateCompileContext())
+	{
+		g_CompileMode = g_ShaderManager->SetCompileMode(g_CompileMode, [](bool bCurrent)
+			{
+				glfwMakeContextCurrent(bCurrent ? g_CompileContext : nullptr);
+			});
+		if (g_CompileMode != ShaderManager::COMPILE_WORKER)
+		{
+			glfwDestroyWindow(g_CompileContext);
+			g_CompileContext = nullptr;
+		}
+	}
+	else
+	{
+		g_CompileMode = g_ShaderManager->SetCompileMode(g_CompileMode);
+	}
+	std::cout << "INFO: Shader variants: "
+		<< (g_CompileMode == ShaderManager::COMPILE_PARALLEL ? "built on the driver's compile threads"
+			: g_CompileMode == ShaderManager::COMPILE_WORKER ? "built on a worker thread"
+			: "built before the first frame") << "\n" << std::endl;
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_VertexLayout, g_bVertexTangents);
 	g_SceneManager->PrepareScene(g_Window); // pass the window to set initial projection
+	g_SceneManager->SetOcclusionCulling(g_bOcclusionCulling);
+	g_SceneManager->SetOccluderSelection(g_MaxOccluders, g_MinOccluderArea);
+	g_SceneManager->SetStaticBatching(g_bStaticBatching);
+	g_SceneManager->SetIndirectDraw(g_bIndirectDraw);
+	g_SceneManager->SetStreamBuffer(g_bStreamBuffer, g_bPersistentMapping);
+	std::cout << "INFO: Per-draw values: "
+		<< (!g_SceneManager->GetStreamBuffer() ? "uniforms"
+			: g_SceneManager->GetStreamPersistent() ? "persistently mapped stream buffer"
+			: "orphaned stream buffer") << "\n" << std::endl;
+	g_SceneManager->SetUniformBlocks(g_bUniformBlocks);
+	g_ViewManager->SetMatrixUniforms(!g_SceneManager->GetUniformBlocks());
+	std::cout << "INFO: Camera and lights: "
+		<< (g_SceneManager->GetUniformBlocks() ? "uniform blocks" : "uniforms") << "\n" << std::endl;
+	g_SceneManager->SetMaterialTable(g_bMaterialTable);
+	std::cout << "INFO: Materials: "
+		<< (g_SceneManager->GetMaterialTable() ? "material table" : "uniforms") << "\n" << std::endl;
+	g_SceneManager->SetShaderVariants(g_bShaderVariants);
+	std::cout << "INFO: Fragment shader: "
+		<< (g_SceneManager->GetShaderVariants() ? "variant per material path" : "uber-shader") << "\n" << std::endl;
+	g_SceneManager->SetLightCutoff(g_LightCutoff);
+	g_SceneManager->SetExtraLights(g_ExtraLights);
+	g_SceneManager->SetClusteredLighting(g_bClusteredLights);
+	std::cout << "INFO: Lights: ";
+	if (g_SceneManager->GetClusteredLighting())
+	{
+		std::cout << "clustered, " << LightClusters::GRID_X << "x" << LightClusters::GRID_Y << "x"
+			<< LightClusters::GRID_Z << " grid, " << g_ExtraLights << " extra";
+	}
+	else
+	{
+		std::cout << "all lights per fragment";
+	}
+	std::cout << "\n" << std::endl;
+	g_SceneManager->SetDeferredShading(g_bDeferredShading);
+	std::cout << "INFO: Shading: "
+		<< (g_SceneManager->GetDeferredShading() ? "deferred" : "forward") << " (G to switch)\n" << std::endl;
+	bool bVariantsReported = false;
+	bool bStartupReported = false;
 
 	// Enable depth testing once
 	glEnable(GL_DEPTH_TEST);
@@ -94,15 +346,68 @@ int main(int argc, char* argv[])
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// start a fresh set of per-frame counters
+		g_ShaderManager->ResetFrameStats();
+		GLState().ResetFrameStats();
+
 		// Clear the frame and z buffers
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		ProcessRendererKeys();
+		g_SceneManager->SetEyePosition(g_ViewManager->GetCameraPosition());
+		g_SceneManager->SetViewProjection(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetViewportWidth(),
+			g_ViewManager->GetViewportHeight());
 
 		// refresh the 3D scene
+		if (g_bShowFrameStats)
+		{
+			BeginFrameTimer();
+		}
 		g_SceneManager->RenderScene();
+		if (g_bShowFrameStats)
+		{
+			EndFrameTimer();
+		}
+
+		// the variants are submitted when the scene is first
+		// recorded, and reported once all of them are built
+		if (!bVariantsReported && g_SceneManager->GetShaderVariants()
+			&& g_ShaderManager->GetPendingVariants() == 0)
+		{
+			g_ShaderManager->ReportVariants();
+			std::cout << std::endl;
+			bVariantsReported = true;
+		}
+
+		// time from initialization to the first frame, with how the
+		// shader programs were built, to compare cold and warm starts
+		if (!bStartupReported)
+		{
+			const ShaderManager::PROGRAM_CACHE_STATS& cache = g_ShaderManager->GetProgramCacheStats();
+			std::cout << "INFO: First frame after " << glfwGetTime() * 1000.0 << " ms (shader programs: "
+				<< cache.loaded << " loaded, " << cache.compiled << " compiled, "
+				<< g_ShaderManager->GetPendingVariants() << " still building, "
+				<< cache.rejected << " rejected, " << cache.saved << " saved, waited "
+				<< cache.buildMs << " ms)\n" << std::endl;
+			bStartupReported = true;
+		}
+
+		if (g_bShowFrameStats)
+		{
+			PrintFrameStats();
+		}
+
+		if (g_TangentDiffPath)
+		{
+			WriteTangentDiff(g_TangentDiffPath);
+			glfwSetWindowShouldClose(g_Window, true);
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
@@ -111,6 +416,19 @@ int main(int argc, char* argv[])
 		glfwPollEvents();
 	}
 
+	if (g_FrameTimerQueries[0] != 0)
+	{
+		glDeleteQueries(2, g_FrameTimerQueries);
+	}
+
+	// the compile worker uses its context until it is stopped
+	g_ShaderManager->StopCompileWorker();
+	if (g_CompileContext)
+	{
+		glfwDestroyWindow(g_CompileContext);
+		g_CompileContext = nullptr;
+	}
+
 	// clear the allocated manager objects from memory
 	if (NULL != g_SceneManager)
 	{
@@ -161,6 +479,228 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 	}
 }
 
+/***********************************************************
+ *	PrintFrameStats()
+ *
+ *  This function prints the renderer counters gathered
+ *  during the frame. The first frames are always printed
+ *  and after that one line is printed per second.
+ ***********************************************************/
+void PrintFrameStats()
+{
+	static unsigned int frameNumber = 0;
+	static double lastPrintTime = 0.0;
+
+	frameNumber++;
+	double now = glfwGetTime();
+	if (frameNumber > 2 && now - lastPrintTime < 1.0)
+	{
+		return;
+	}
+	lastPrintTime = now;
+
+	const ShaderManager::FRAME_STATS& shaderStats = g_ShaderManager->GetFrameStats();
+	const GLStateCache::FRAME_STATS& stateStats = GLState().GetFrameStats();
+	const DrawList::FRAME_STATS& drawStats = g_SceneManager->GetDrawStats();
+	const ShapeMeshes::FRAME_STATS& meshStats = g_SceneManager->GetMeshStats();
+	const OcclusionCuller::FRAME_STATS& occlusionStats = g_SceneManager->GetOcclusionStats();
+	std::cout << "STATS frame " << frameNumber
+		<< " (" << (g_SceneManager->IsDeferredFrame() ? "deferred" : "forward") << ")"
+		<< ": uniform lookups " << shaderStats.uniformLookups
+		<< ", cached " << shaderStats.uniformCacheHits
+		<< " | uniforms issued " << shaderStats.uniformsIssued
+		<< ", elided " << shaderStats.uniformsElided
+		<< ", variant switches " << shaderStats.variantSwitches
+		<< " with " << shaderStats.uniformsSynced << " synced"
+		<< ", " << shaderStats.variantFallbacks << " fallbacks"
+		<< " | binds issued " << stateStats.issued
+		<< ", elided " << stateStats.elided
+		<< " | items " << drawStats.draws
+		<< " visible, " << drawStats.culled << " culled"
+		<< ", " << drawStats.occluded << " occluded"
+		<< ", draw calls " << drawStats.drawCalls
+		<< " (" << drawStats.instancedBatches << " instanced, "
+		<< drawStats.indirectCommands << " indirect commands, "
+		<< drawStats.staticBatches << " static with " << drawStats.staticItems << " items)"
+		<< ", block uploads " << drawStats.blockUploads
+		<< ", mode changes " << drawStats.modeChanges
+		<< ", material changes " << drawStats.materialChanges
+		<< " | occlusion " << occlusionStats.occluders << " occluders"
+		<< " (" << occlusionStats.triangles << " triangles)"
+		<< ", " << occlusionStats.occluded << "/" << occlusionStats.tested << " hidden"
+		<< ", raster " << occlusionStats.rasterMs << " ms"
+		<< ", test " << occlusionStats.testMs << " ms"
+		<< " on " << occlusionStats.threads << " threads"
+		<< " | LOD triangles";
+	for (int level = 0; level < ShapeMeshes::MAX_LOD_LEVELS; level++)
+	{
+		std::cout << (level == 0 ? " " : "/") << meshStats.triangles[level];
+	}
+
+	if (g_SceneManager->GetClusteredLighting())
+	{
+		const LightClusters& clusters = g_SceneManager->GetLightClusters();
+		std::cout << " | lights " << clusters.GetLights().size()
+			<< ", " << clusters.GetVisibleLights() << " visible"
+			<< ", " << clusters.GetIndices().size() << " cluster entries"
+			<< ", at most " << clusters.GetMaxClusterLights() << " per cluster";
+	}
+
+	// vertex memory and fetch traffic in both layouts, to compare
+	// them from a single run
+	const ShapeMeshes& meshes = g_SceneManager->GetMeshes();
+	const ShapeMeshes::VERTEX_LAYOUT layouts[] = { ShapeMeshes::LAYOUT_FLOAT, ShapeMeshes::LAYOUT_PACKED };
+	std::cout << " | vertex KB float/packed";
+	for (ShapeMeshes::VERTEX_LAYOUT layout : layouts)
+	{
+		std::cout << (layout == ShapeMeshes::LAYOUT_FLOAT ? " " : "/")
+			<< meshes.GetVertexBufferBytes(layout) / 1024;
+	}
+	std::cout << ", fetched";
+	for (ShapeMeshes::VERTEX_LAYOUT layout : layouts)
+	{
+		std::cout << (layout == ShapeMeshes::LAYOUT_FLOAT ? " " : "/")
+			<< (size_t)meshStats.vertexFetches * ShapeMeshes::VertexStride(layout) / 1024;
+	}
+	std::cout << (meshes.GetVertexLayout() == ShapeMeshes::LAYOUT_PACKED ? " (packed)" : " (float)");
+
+	// per-frame data written through the stream buffer
+	if (g_SceneManager->GetStreamBuffer())
+	{
+		const StreamRingBuffer::FRAME_STATS& streamStats = g_SceneManager->GetStreamStats();
+		std::cout << " | stream " << streamStats.bytes / 1024.0 << " KB"
+			<< " in " << streamStats.allocations << " allocations, "
+			<< streamStats.uploads << " uploads, "
+			<< streamStats.fenceWaits << " fence waits"
+			<< (g_SceneManager->GetStreamPersistent() ? " (persistent)" : " (orphaned)");
+	}
+	std::cout << " | gpu " << g_GpuFrameMs << " ms" << std::endl;
+}
+
+/***********************************************************
+ *	BeginFrameTimer()
+ *
+ *  This function starts the timer query of this frame,
+ *  creating the pair of queries on first use.
+ ***********************************************************/
+void BeginFrameTimer()
+{
+	if (g_FrameTimerQueries[0] == 0)
+	{
+		glGenQueries(2, g_FrameTimerQueries);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, g_FrameTimerQueries[g_FrameTimerIndex]);
+}
+
+/***********************************************************
+ *	EndFrameTimer()
+ *
+ *  This function ends the timer query of this frame and
+ *  reads the one of the previous frame, if it has finished,
+ *  so the counters never wait on the GPU.
+ ***********************************************************/
+void EndFrameTimer()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	g_FrameTimerIndex = 1 - g_FrameTimerIndex;
+
+	GLuint previous = g_FrameTimerQueries[g_FrameTimerIndex];
+	GLint available = 0;
+	if (glIsQuery(previous))
+	{
+		glGetQueryObjectiv(previous, GL_QUERY_RESULT_AVAILABLE, &available);
+	}
+	if (available)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(previous, GL_QUERY_RESULT, &elapsed);
+		g_GpuFrameMs = elapsed / 1.0e6;
+	}
+}
+
+/***********************************************************
+ *	ProcessRendererKeys()
+ *
+ *  This function switches between forward and deferred
+ *  shading each time G is pressed.
+ ***********************************************************/
+void ProcessRendererKeys()
+{
+	bool bDeferredKeyDown = glfwGetKey(g_Window, GLFW_KEY_G) == GLFW_PRESS;
+	if (bDeferredKeyDown && !g_bDeferredKeyDown)
+	{
+		g_SceneManager->SetDeferredShading(!g_SceneManager->GetDeferredShading());
+		std::cout << "INFO: Shading: "
+			<< (g_SceneManager->GetDeferredShading() ? "deferred" : "forward") << "\n" << std::endl;
+	}
+	g_bDeferredKeyDown = bDeferredKeyDown;
+}
+
+/***********************************************************
+ *	WriteTangentDiff()
+ *
+ *  This function reads back the frame just rendered with
+ *  the vertex tangent TBN, renders it again with the TBN
+ *  built from screen-space derivatives, and writes both
+ *  side by side with their difference (scaled by 8) to a
+ *  binary PPM image: derivatives | tangents | difference.
+ ***********************************************************/
+bool WriteTangentDiff(const char* filename)
+{
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	const int width = viewport[2];
+	const int height = viewport[3];
+	const size_t rowBytes = (size_t)width * 3;
+
+	std::vector<unsigned char> tangentPixels(rowBytes * height);
+	std::vector<unsigned char> derivativePixels(rowBytes * height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(viewport[0], viewport[1], width, height, GL_RGB, GL_UNSIGNED_BYTE, tangentPixels.data());
+
+	g_SceneManager->SetVertexTangents(false);
+	g_SceneManager->RenderScene();
+	glReadPixels(viewport[0], viewport[1], width, height, GL_RGB, GL_UNSIGNED_BYTE, derivativePixels.data());
+	g_SceneManager->SetVertexTangents(true);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "ERROR: could not write " << filename << std::endl;
+		return false;
+	}
+	file << "P6\n" << width * 3 << " " << height << "\n255\n";
+
+	int maxDifference = 0;
+	size_t differentPixels = 0;
+	std::vector<unsigned char> row(rowBytes * 3);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		const unsigned char* derivative = &derivativePixels[y * rowBytes];
+		const unsigned char* tangent = &tangentPixels[y * rowBytes];
+		for (size_t x = 0; x < rowBytes; x += 3)
+		{
+			int pixelDifference = 0;
+			for (size_t c = x; c < x + 3; c++)
+			{
+				int difference = abs((int)derivative[c] - (int)tangent[c]);
+				pixelDifference = (difference > pixelDifference) ? difference : pixelDifference;
+				row[c] = derivative[c];
+				row[rowBytes + c] = tangent[c];
+				row[rowBytes * 2 + c] = (unsigned char)((difference * 8 > 255) ? 255 : difference * 8);
+			}
+			maxDifference = (pixelDifference > maxDifference) ? pixelDifference : maxDifference;
+			differentPixels += (pixelDifference > 8) ? 1 : 0;
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+
+	std::cout << "INFO: tangent frame difference written to " << filename
+		<< ": max " << maxDifference << ", " << differentPixels << " of "
+		<< (size_t)width * height << " pixels differ by more than 8" << std::endl;
+	return true;
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
@@ -217,3 +757,20 @@ bool InitializeGLEW()
 
 	return(true);
 }
+
+/***********************************************************
+ *	CreateCompileContext()
+ *
+ *  This function creates the hidden window whose context
+ *  the compile worker uses. It shares the objects of the
+ *  main window's context, so the programs built on it can
+ *  be drawn with there.
+ ***********************************************************/
+bool CreateCompileContext()
+{
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	g_CompileContext = glfwCreateWindow(1, 1, "", nullptr, g_Window);
+	glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+
+	return(g_CompileContext != nullptr);
+}
@@ -0,0 +1,511 @@
+///////////////////////////////////////////////////////////////////////////////
+// OcclusionCuller.cpp
+// ============
+// software depth buffer of large occluders, to skip items hidden behind them
+//
+// Occluder triangles are kept as three edge functions E(x, y) = Ax + By + C
+// that are positive inside, and a depth plane z = Ax + By + C, so a pixel
+// only costs a few multiply-adds. The depth stored is the NDC z of the
+// nearest occluder; the buffer is cleared to 1, the far plane.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE 1
+#endif
+
+namespace
+{
+    // clip-space w below which a corner counts as behind the eye
+    const float g_MinClipW = 1.0e-4f;
+
+    // corners of the four-corner faces of a box, counter-clockwise
+    // seen from outside; corner i is at (i & 1, i & 2, i & 4)
+    const int g_BoxFaces[6][4] =
+    {
+        { 5, 1, 3, 7 },     // +x
+        { 0, 4, 6, 2 },     // -x
+        { 6, 7, 3, 2 },     // +y
+        { 0, 1, 5, 4 },     // -y
+        { 4, 5, 7, 6 },     // +z
+        { 1, 0, 2, 3 }      // -z
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    float ElapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+}
+
+// definitions of the constants, which std::min takes by reference
+const int OcclusionCuller::BUFFER_WIDTH;
+const int OcclusionCuller::BUFFER_HEIGHT;
+const int OcclusionCuller::BAND_HEIGHT;
+const size_t OcclusionCuller::TEST_BATCH;
+const unsigned int OcclusionCuller::MAX_THREADS;
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor starts one worker less than the threads
+ *  that share the work, since the calling thread takes jobs
+ *  as well.
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+    : m_depth(BUFFER_WIDTH * BUFFER_HEIGHT, 1.0f)
+{
+    unsigned int threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_THREADS);
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        m_workers.emplace_back(&OcclusionCuller::WorkerLoop, this);
+    }
+    m_stats.threads = threads;
+}
+
+/***********************************************************
+ *  ~OcclusionCuller()
+ *
+ *  The destructor stops and joins the workers.
+ ***********************************************************/
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method starts a frame with no occluders.
+ ***********************************************************/
+void OcclusionCuller::Begin(const glm::mat4 &viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_triangles.clear();
+    m_stats = FRAME_STATS();
+    m_stats.threads = (unsigned int)m_workers.size() + 1;
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  This method transforms the eight corners of a box to clip
+ *  space and sets up the two triangles of each face. A model
+ *  matrix that mirrors the box turns its faces inside out,
+ *  so their winding is flipped back.
+ ***********************************************************/
+void OcclusionCuller::AddOccluder(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model)
+{
+    const glm::mat4 transform = m_viewProjection * model;
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner(
+            (i & 1) ? boxMax.x : boxMin.x,
+            (i & 2) ? boxMax.y : boxMin.y,
+            (i & 4) ? boxMax.z : boxMin.z);
+        corners[i] = transform * glm::vec4(corner, 1.0f);
+    }
+
+    const bool bFlipped = glm::determinant(glm::mat3(model)) < 0.0f;
+    for (const int* face : g_BoxFaces)
+    {
+        AddTriangle(corners[face[0]], corners[face[1]], corners[face[2]], bFlipped);
+        AddTriangle(corners[face[0]], corners[face[2]], corners[face[3]], bFlipped);
+    }
+    m_stats.occluders++;
+}
+
+/***********************************************************
+ *  AddTriangle()
+ *
+ *  This method projects a triangle to buffer pixels and
+ *  stores its edge functions, depth plane and the range of
+ *  pixel centers it can cover.
+ ***********************************************************/
+void OcclusionCuller::AddTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c, bool bFlipped)
+{
+    if (a.w < g_MinClipW || b.w < g_MinClipW || c.w < g_MinClipW)
+    {
+        return;
+    }
+
+    glm::vec3 p[3];
+    const glm::vec4* clip[3] = { &a, bFlipped ? &c : &b, bFlipped ? &b : &c };
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4& v = *clip[i];
+        p[i] = glm::vec3(
+            (v.x / v.w * 0.5f + 0.5f) * BUFFER_WIDTH,
+            (v.y / v.w * 0.5f + 0.5f) * BUFFER_HEIGHT,
+            v.z / v.w);
+    }
+
+    // counter-clockwise on screen is front facing
+    const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+    if (area <= 0.0f)
+    {
+        return;
+    }
+
+    TRIANGLE triangle;
+    triangle.minX = std::max(0, (int)std::ceil(std::min({ p[0].x, p[1].x, p[2].x }) - 0.5f));
+    triangle.maxX = std::min(BUFFER_WIDTH - 1, (int)std::floor(std::max({ p[0].x, p[1].x, p[2].x }) - 0.5f));
+    triangle.minY = std::max(0, (int)std::ceil(std::min({ p[0].y, p[1].y, p[2].y }) - 0.5f));
+    triangle.maxY = std::min(BUFFER_HEIGHT - 1, (int)std::floor(std::max({ p[0].y, p[1].y, p[2].y }) - 0.5f));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    // the inside of a counter-clockwise triangle is left of
+    // each edge
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec3& from = p[i];
+        const glm::vec3& to = p[(i + 1) % 3];
+        triangle.edgeA[i] = from.y - to.y;
+        triangle.edgeB[i] = to.x - from.x;
+        triangle.edgeC[i] = -(triangle.edgeA[i] * from.x + triangle.edgeB[i] * from.y);
+    }
+
+    const float dz1 = p[1].z - p[0].z;
+    const float dz2 = p[2].z - p[0].z;
+    triangle.depthA = (dz1 * (p[2].y - p[0].y) - dz2 * (p[1].y - p[0].y)) / area;
+    triangle.depthB = (dz2 * (p[1].x - p[0].x) - dz1 * (p[2].x - p[0].x)) / area;
+    triangle.depthC = p[0].z - triangle.depthA * p[0].x - triangle.depthB * p[0].y;
+
+    m_triangles.push_back(triangle);
+}
+
+/***********************************************************
+ *  Rasterize()
+ *
+ *  This method clears and draws the bands of the buffer in
+ *  parallel. Every band walks the whole triangle list, which
+ *  is short, so no binning is needed.
+ ***********************************************************/
+void OcclusionCuller::Rasterize()
+{
+    Clock::time_point start = Clock::now();
+
+    const int bandCount = (BUFFER_HEIGHT + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    RunJobs(bandCount, [this](size_t band) { RasterizeBand((int)band); });
+
+    m_stats.triangles = (unsigned int)m_triangles.size();
+    m_stats.rasterMs = ElapsedMs(start);
+}
+
+/***********************************************************
+ *  RasterizeBand()
+ *
+ *  This method clears the rows of one band and keeps the
+ *  nearest depth of every triangle at each pixel center,
+ *  four pixels at a time where SSE is available.
+ ***********************************************************/
+void OcclusionCuller::RasterizeBand(int band)
+{
+    const int firstRow = band * BAND_HEIGHT;
+    const int lastRow = std::min(firstRow + BAND_HEIGHT, BUFFER_HEIGHT) - 1;
+    std::fill(m_depth.begin() + firstRow * BUFFER_WIDTH,
+              m_depth.begin() + (lastRow + 1) * BUFFER_WIDTH, 1.0f);
+
+    for (const TRIANGLE& triangle : m_triangles)
+    {
+        const int minY = std::max(triangle.minY, firstRow);
+        const int maxY = std::min(triangle.maxY, lastRow);
+
+#if defined(OCCLUSION_CULLER_SSE)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+        const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+        const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+        const __m128 depthA = _mm_set1_ps(triangle.depthA);
+        const int firstX = triangle.minX & ~3;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float centerY = y + 0.5f;
+            const __m128 row0 = _mm_set1_ps(triangle.edgeB[0] * centerY + triangle.edgeC[0]);
+            const __m128 row1 = _mm_set1_ps(triangle.edgeB[1] * centerY + triangle.edgeC[1]);
+            const __m128 row2 = _mm_set1_ps(triangle.edgeB[2] * centerY + triangle.edgeC[2]);
+            const __m128 rowDepth = _mm_set1_ps(triangle.depthB * centerY + triangle.depthC);
+            float* depthRow = &m_depth[y * BUFFER_WIDTH];
+
+            for (int x = firstX; x <= triangle.maxX; x += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 inside = _mm_and_ps(
+                    _mm_and_ps(
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, centerX), row0), zero),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, centerX), row1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, centerX), row2), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, centerX), rowDepth);
+                __m128 stored = _mm_loadu_ps(depthRow + x);
+                __m128 nearest = _mm_min_ps(stored, depth);
+                _mm_storeu_ps(depthRow + x,
+                    _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float centerY = y + 0.5f;
+            float* depthRow = &m_depth[y * BUFFER_WIDTH];
+            for (int x = triangle.minX; x <= triangle.maxX; x++)
+            {
+                const float centerX = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 3 && inside; i++)
+                {
+                    inside = triangle.edgeA[i] * centerX + triangle.edgeB[i] * centerY + triangle.edgeC[i] >= 0.0f;
+                }
+                if (inside)
+                {
+                    float depth = triangle.depthA * centerX + triangle.depthB * centerY + triangle.depthC;
+                    depthRow[x] = std::min(depthRow[x], depth);
+                }
+            }
+        }
+#endif
+    }
+}
+
+/***********************************************************
+ *  ProjectBox()
+ *
+ *  This method projects the eight corners of a world-space
+ *  box and returns the buffer rectangle around them (min x,
+ *  min y, max x, max y) and their nearest depth.
+ ***********************************************************/
+bool OcclusionCuller::ProjectBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax,
+                                 float rect[4], float &nearestDepth) const
+{
+    rect[0] = rect[1] = std::numeric_limits<float>::max();
+    rect[2] = rect[3] = -std::numeric_limits<float>::max();
+    nearestDepth = std::numeric_limits<float>::max();
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner(
+            (i & 1) ? boxMax.x : boxMin.x,
+            (i & 2) ? boxMax.y : boxMin.y,
+            (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w < g_MinClipW)
+        {
+            return false;
+        }
+
+        float x = (clip.x / clip.w * 0.5f + 0.5f) * BUFFER_WIDTH;
+        float y = (clip.y / clip.w * 0.5f + 0.5f) * BUFFER_HEIGHT;
+        rect[0] = std::min(rect[0], x);
+        rect[1] = std::min(rect[1], y);
+        rect[2] = std::max(rect[2], x);
+        rect[3] = std::max(rect[3], y);
+        nearestDepth = std::min(nearestDepth, clip.z / clip.w);
+    }
+    return true;
+}
+
+/***********************************************************
+ *  ScreenArea()
+ *
+ *  This method measures the part of the screen a box covers,
+ *  used to pick the occluders worth drawing.
+ ***********************************************************/
+float OcclusionCuller::ScreenArea(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const
+{
+    float rect[4];
+    float nearestDepth;
+    if (!ProjectBox(boxMin, boxMax, rect, nearestDepth))
+    {
+        return 0.0f;
+    }
+
+    float width = std::min(rect[2], (float)BUFFER_WIDTH) - std::max(rect[0], 0.0f);
+    float height = std::min(rect[3], (float)BUFFER_HEIGHT) - std::max(rect[1], 0.0f);
+    if (width <= 0.0f || height <= 0.0f)
+    {
+        return 0.0f;
+    }
+    return width * height / (float)(BUFFER_WIDTH * BUFFER_HEIGHT);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method compares the nearest depth of a box with the
+ *  occluder depth at every pixel center under its rectangle,
+ *  widened by one pixel, and stops at the first pixel where
+ *  the box could show.
+ ***********************************************************/
+bool OcclusionCuller::IsOccluded(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const
+{
+    float rect[4];
+    float nearestDepth;
+    if (!ProjectBox(boxMin, boxMax, rect, nearestDepth))
+    {
+        return false;
+    }
+
+    const int minX = std::max(0, (int)std::ceil(rect[0] - 0.5f) - 1);
+    const int minY = std::max(0, (int)std::ceil(rect[1] - 0.5f) - 1);
+    const int maxX = std::min(BUFFER_WIDTH - 1, (int)std::floor(rect[2] - 0.5f) + 1);
+    const int maxY = std::min(BUFFER_HEIGHT - 1, (int)std::floor(rect[3] - 0.5f) + 1);
+    if (minX > maxX || minY > maxY)
+    {
+        return false;
+    }
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        const float* depthRow = &m_depth[y * BUFFER_WIDTH];
+        for (int x = minX; x <= maxX; x++)
+        {
+            if (depthRow[x] >= nearestDepth)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method tests the listed items in batches spread over
+ *  the worker pool.
+ ***********************************************************/
+size_t OcclusionCuller::Cull(const SceneBVH::AABB *boxes, const uint32_t *items, size_t count, uint8_t *visible)
+{
+    Clock::time_point start = Clock::now();
+
+    std::atomic<size_t> occluded{0};
+    const size_t batchCount = (count + TEST_BATCH - 1) / TEST_BATCH;
+    RunJobs(batchCount, [&](size_t batch)
+    {
+        const size_t first = batch * TEST_BATCH;
+        const size_t last = std::min(first + TEST_BATCH, count);
+        size_t hidden = 0;
+        for (size_t n = first; n < last; n++)
+        {
+            const SceneBVH::AABB& box = boxes[items[n]];
+            if (IsOccluded(box.min, box.max))
+            {
+                visible[items[n]] = 0;
+                hidden++;
+            }
+        }
+        occluded += hidden;
+    });
+
+    m_stats.tested = (unsigned int)count;
+    m_stats.occluded = (unsigned int)occluded;
+    m_stats.testMs = ElapsedMs(start);
+    return occluded;
+}
+
+/***********************************************************
+ *  RunJobs()
+ *
+ *  This method hands a batch of jobs to the workers, takes
+ *  jobs itself until none are left, and waits for the
+ *  workers to finish theirs. A single job runs inline.
+ ***********************************************************/
+void OcclusionCuller::RunJobs(size_t count, const std::function<void(size_t)> &job)
+{
+    if (m_workers.empty() || count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    m_job = &job;
+    m_jobCount = count;
+    m_nextJob = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busyWorkers = m_workers.size();
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    RunPendingJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_job = nullptr;
+}
+
+/***********************************************************
+ *  RunPendingJobs()
+ *
+ *  This method takes jobs of the current batch until all
+ *  have been handed out.
+ ***********************************************************/
+void OcclusionCuller::RunPendingJobs()
+{
+    for (size_t i = m_nextJob++; i < m_jobCount; i = m_nextJob++)
+    {
+        (*m_job)(i);
+    }
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the body of a worker thread: it sleeps
+ *  until a new batch of jobs is posted, helps run it, and
+ *  reports back when it runs out of jobs.
+ ***********************************************************/
+void OcclusionCuller::WorkerLoop()
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || m_generation != generation; });
+            if (m_quit)
+            {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        RunPendingJobs();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// OcclusionCuller.h
+// ============
+// software depth buffer of large occluders, to skip items hidden behind them
+//
+// Each frame a few large boxes (booth backs, walls, table tops) are drawn
+// into a small depth buffer on the CPU. The buffer is split into bands of
+// rows that a pool of worker threads rasterise in parallel, four pixels at
+// a time with SSE. The world-space box of every item that survived
+// frustum culling is then projected to a screen rectangle; the item is
+// culled when its nearest point is farther than every occluder depth
+// under that rectangle.
+//
+// The test is conservative: the rectangle is widened by a pixel so the
+// occluder edges, which are only sampled at pixel centers, never hide an
+// item, and occluder triangles crossing the near plane are left out
+// rather than clipped.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneBVH.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class OcclusionCuller
+{
+public:
+    // size of the depth buffer; the width is a multiple of four
+    static const int BUFFER_WIDTH = 256;
+    static const int BUFFER_HEIGHT = 144;
+
+    // rows of the depth buffer rasterised by one job
+    static const int BAND_HEIGHT = 8;
+
+    // items tested against the buffer by one job
+    static const size_t TEST_BATCH = 64;
+
+    // most threads, including the calling one, that share the work
+    static const unsigned int MAX_THREADS = 4;
+
+    // counters of the last frame
+    struct FRAME_STATS
+    {
+        unsigned int occluders = 0;     // occluder boxes drawn
+        unsigned int triangles = 0;     // front facing triangles rasterised
+        unsigned int tested = 0;        // items tested against the buffer
+        unsigned int occluded = 0;      // items found hidden
+        unsigned int threads = 1;       // threads sharing the work
+        float rasterMs = 0.0f;          // time to draw the occluders
+        float testMs = 0.0f;            // time to test the items
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // start a frame: set the view-projection and drop the
+    // occluders of the previous frame
+    void Begin(const glm::mat4 &viewProjection);
+
+    // add the object-space box of an occluder placed by the
+    // model matrix
+    void AddOccluder(const glm::vec3 &boxMin, const glm::vec3 &boxMax, const glm::mat4 &model);
+
+    // clear the depth buffer and draw the occluders into it
+    void Rasterize();
+
+    // fraction of the screen covered by the rectangle around a
+    // world-space box, or 0 when it crosses the near plane
+    float ScreenArea(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const;
+
+    // whether a world-space box is completely behind the occluders
+    bool IsOccluded(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const;
+
+    // test the world-space boxes of the listed items and write 0
+    // to visible[] for every hidden one; returns their number
+    size_t Cull(const SceneBVH::AABB *boxes, const uint32_t *items, size_t count, uint8_t *visible);
+
+    const FRAME_STATS& GetFrameStats() const { return m_stats; }
+
+private:
+    // a screen-space triangle as three edge functions and a
+    // depth plane, all evaluated at pixel centers
+    struct TRIANGLE
+    {
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, maxX, minY, maxY;
+    };
+
+    // set up a triangle from three clip-space corners; back
+    // facing triangles and those crossing the near plane are
+    // skipped
+    void AddTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c, bool bFlipped);
+
+    // draw every triangle into the rows of one band
+    void RasterizeBand(int band);
+
+    // buffer rectangle and nearest depth of a world-space box;
+    // false when the box crosses the near plane
+    bool ProjectBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax,
+                    float rect[4], float &nearestDepth) const;
+
+    // run job(0) ... job(count - 1) on the pool and the calling
+    // thread, returning when all are done
+    void RunJobs(size_t count, const std::function<void(size_t)> &job);
+    void RunPendingJobs();
+    void WorkerLoop();
+
+    glm::mat4 m_viewProjection = glm::mat4(1.0f);
+    std::vector<TRIANGLE> m_triangles;
+    std::vector<float> m_depth;
+    FRAME_STATS m_stats;
+
+    // worker pool
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    size_t m_busyWorkers = 0;
+    bool m_quit = false;
+    const std::function<void(size_t)> *m_job = nullptr;
+    size_t m_jobCount = 0;
+    std::atomic<size_t> m_nextJob{0};
+};
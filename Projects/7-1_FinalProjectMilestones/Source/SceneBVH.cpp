@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneBVH.cpp
+// ============
+// bounding volume hierarchy over the world-space boxes of scene items
+//
+// SAH cost of a split, relative to the area A of the node:
+//
+//     1 + (A_left * N_left + A_right * N_right) / A
+//
+// against N for keeping the node as a leaf, where N counts items and the
+// 1 is the cost of visiting the two children.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    // half the surface area of a box, enough to compare costs
+    float HalfArea(const SceneBVH::AABB &box)
+    {
+        glm::vec3 size = glm::max(box.max - box.min, glm::vec3(0.0f));
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    void Grow(SceneBVH::AABB &box, const SceneBVH::AABB &other)
+    {
+        box.min = glm::min(box.min, other.min);
+        box.max = glm::max(box.max, other.max);
+    }
+
+    SceneBVH::AABB EmptyBox()
+    {
+        SceneBVH::AABB box;
+        box.min = glm::vec3(std::numeric_limits<float>::max());
+        box.max = glm::vec3(-std::numeric_limits<float>::max());
+        return box;
+    }
+
+    // distance along the ray to where it enters a box, or
+    // infinity when it misses the box within maxDistance
+    float RayBox(const SceneBVH::AABB &box, const glm::vec3 &origin,
+                 const glm::vec3 &inverseDirection, float maxDistance)
+    {
+        glm::vec3 t1 = (box.min - origin) * inverseDirection;
+        glm::vec3 t2 = (box.max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return (enter <= exit) ? enter : std::numeric_limits<float>::infinity();
+    }
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method builds the tree over the passed boxes from
+ *  scratch, splitting nodes from a work stack.
+ ***********************************************************/
+void SceneBVH::Build(const std::vector<AABB> &boxes)
+{
+    const uint32_t count = (uint32_t)boxes.size();
+    m_boxes = boxes;
+    m_centroids.resize(count);
+    m_itemOrder.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+        m_itemOrder[i] = i;
+    }
+
+    m_nodes.clear();
+    if (count == 0)
+    {
+        return;
+    }
+    m_nodes.reserve(2 * (size_t)count);
+
+    NODE root;
+    root.bounds = ItemBounds(0, count);
+    root.leftChild = 0;
+    root.firstItem = 0;
+    root.itemCount = count;
+    m_nodes.push_back(root);
+
+    std::vector<uint32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+        Subdivide(nodeIndex, stack);
+    }
+}
+
+/***********************************************************
+ *  Subdivide()
+ *
+ *  This method bins the item centroids of a node along its
+ *  widest centroid axis and splits at the bin boundary with
+ *  the lowest SAH cost. Nodes with few items stay leaves
+ *  when splitting would not pay off; nodes with more than
+ *  MAX_LEAF_ITEMS are always split, in the middle of the
+ *  range when the centroids cannot be told apart.
+ ***********************************************************/
+void SceneBVH::Subdivide(uint32_t nodeIndex, std::vector<uint32_t> &stack)
+{
+    const uint32_t first = m_nodes[nodeIndex].firstItem;
+    const uint32_t count = m_nodes[nodeIndex].itemCount;
+    if (count <= 1)
+    {
+        return;
+    }
+
+    glm::vec3 centroidMin = m_centroids[m_itemOrder[first]];
+    glm::vec3 centroidMax = centroidMin;
+    for (uint32_t i = first + 1; i < first + count; i++)
+    {
+        centroidMin = glm::min(centroidMin, m_centroids[m_itemOrder[i]]);
+        centroidMax = glm::max(centroidMax, m_centroids[m_itemOrder[i]]);
+    }
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+
+    uint32_t splitCount = count / 2;
+    bool bSplit = count > MAX_LEAF_ITEMS;
+
+    if (extent[axis] > 0.0f)
+    {
+        AABB binBounds[SAH_BINS];
+        uint32_t binCounts[SAH_BINS] = {};
+        for (int b = 0; b < SAH_BINS; b++)
+        {
+            binBounds[b] = EmptyBox();
+        }
+
+        const float scale = SAH_BINS / extent[axis];
+        auto binOf = [&](uint32_t item)
+        {
+            int bin = (int)((m_centroids[item][axis] - centroidMin[axis]) * scale);
+            return std::min(bin, SAH_BINS - 1);
+        };
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            int bin = binOf(m_itemOrder[i]);
+            binCounts[bin]++;
+            Grow(binBounds[bin], m_boxes[m_itemOrder[i]]);
+        }
+
+        // cost of every split from sweeps in both directions
+        float leftCosts[SAH_BINS - 1];
+        AABB sweep = EmptyBox();
+        uint32_t sweepCount = 0;
+        for (int b = 0; b < SAH_BINS - 1; b++)
+        {
+            Grow(sweep, binBounds[b]);
+            sweepCount += binCounts[b];
+            leftCosts[b] = sweepCount ? HalfArea(sweep) * sweepCount : 0.0f;
+        }
+
+        float bestCost = std::numeric_limits<float>::max();
+        int bestBin = -1;
+        sweep = EmptyBox();
+        sweepCount = 0;
+        for (int b = SAH_BINS - 1; b > 0; b--)
+        {
+            Grow(sweep, binBounds[b]);
+            sweepCount += binCounts[b];
+            if (sweepCount == 0 || sweepCount == count)
+            {
+                continue;
+            }
+            float cost = leftCosts[b - 1] + HalfArea(sweep) * sweepCount;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = b;
+            }
+        }
+
+        const float nodeArea = HalfArea(m_nodes[nodeIndex].bounds);
+        if (bestBin > 0 && (bSplit || nodeArea <= 0.0f || SAH_TRAVERSAL_COST + bestCost / nodeArea < (float)count))
+        {
+            uint32_t* begin = &m_itemOrder[first];
+            uint32_t* middle = std::partition(begin, begin + count,
+                [&](uint32_t item) { return binOf(item) < bestBin; });
+            splitCount = (uint32_t)(middle - begin);
+            bSplit = true;
+        }
+    }
+
+    if (!bSplit)
+    {
+        return;
+    }
+
+    if (splitCount == 0 || splitCount == count)
+    {
+        splitCount = count / 2;
+        std::nth_element(&m_itemOrder[first], &m_itemOrder[first + splitCount], &m_itemOrder[first] + count,
+            [&](uint32_t a, uint32_t b) { return m_centroids[a][axis] < m_centroids[b][axis]; });
+    }
+
+    NODE left;
+    left.leftChild = 0;
+    left.firstItem = first;
+    left.itemCount = splitCount;
+    left.bounds = ItemBounds(left.firstItem, left.itemCount);
+
+    NODE right;
+    right.leftChild = 0;
+    right.firstItem = first + splitCount;
+    right.itemCount = count - splitCount;
+    right.bounds = ItemBounds(right.firstItem, right.itemCount);
+
+    m_nodes[nodeIndex].leftChild = (uint32_t)m_nodes.size();
+    stack.push_back((uint32_t)m_nodes.size());
+    m_nodes.push_back(left);
+    stack.push_back((uint32_t)m_nodes.size());
+    m_nodes.push_back(right);
+}
+
+/***********************************************************
+ *  ItemBounds()
+ *
+ *  This method returns the box around a range of items.
+ ***********************************************************/
+SceneBVH::AABB SceneBVH::ItemBounds(uint32_t first, uint32_t count) const
+{
+    AABB bounds = EmptyBox();
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        Grow(bounds, m_boxes[m_itemOrder[i]]);
+    }
+    return bounds;
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method recomputes the node boxes bottom up. The
+ *  children of a node are always stored after it, so a
+ *  reverse walk over the node array visits them first.
+ ***********************************************************/
+void SceneBVH::Refit()
+{
+    for (size_t n = m_nodes.size(); n-- > 0;)
+    {
+        NODE &node = m_nodes[n];
+        if (node.leftChild == 0)
+        {
+            node.bounds = ItemBounds(node.firstItem, node.itemCount);
+        }
+        else
+        {
+            node.bounds = m_nodes[node.leftChild].bounds;
+            Grow(node.bounds, m_nodes[node.leftChild + 1].bounds);
+        }
+    }
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method walks the tree with a mask of the planes a
+ *  node still crosses. Planes a node is completely in front
+ *  of are dropped for its subtree, and once none are left
+ *  all items of the subtree are accepted at once.
+ ***********************************************************/
+size_t SceneBVH::QueryFrustum(const glm::vec4 planes[6], uint8_t *visible) const
+{
+    memset(visible, 0, m_boxes.size());
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    glm::vec3 absNormals[6];
+    for (int p = 0; p < 6; p++)
+    {
+        absNormals[p] = glm::abs(glm::vec3(planes[p]));
+    }
+
+    // classify a box against the planes of a mask; returns false
+    // when it is outside, and clears the planes it is inside of
+    auto classify = [&](const AABB &box, uint32_t &mask)
+    {
+        glm::vec3 center = (box.min + box.max) * 0.5f;
+        glm::vec3 halfExtent = (box.max - box.min) * 0.5f;
+        for (int p = 0; p < 6; p++)
+        {
+            if ((mask & (1u << p)) == 0)
+            {
+                continue;
+            }
+            float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+            float radius = glm::dot(absNormals[p], halfExtent);
+            if (distance + radius < 0.0f)
+            {
+                return false;
+            }
+            if (distance - radius >= 0.0f)
+            {
+                mask &= ~(1u << p);
+            }
+        }
+        return true;
+    };
+
+    size_t visibleCount = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.reserve(64);
+    stack.push_back(std::make_pair(0u, 0x3Fu));
+    while (!stack.empty())
+    {
+        const NODE &node = m_nodes[stack.back().first];
+        uint32_t mask = stack.back().second;
+        stack.pop_back();
+
+        if (!classify(node.bounds, mask))
+        {
+            continue;
+        }
+
+        if (mask == 0)
+        {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                visible[m_itemOrder[i]] = 1;
+            }
+            visibleCount += node.itemCount;
+        }
+        else if (node.leftChild == 0)
+        {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                uint32_t itemMask = mask;
+                if (classify(m_boxes[m_itemOrder[i]], itemMask))
+                {
+                    visible[m_itemOrder[i]] = 1;
+                    visibleCount++;
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(std::make_pair(node.leftChild, mask));
+            stack.push_back(std::make_pair(node.leftChild + 1, mask));
+        }
+    }
+    return visibleCount;
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method finds the nearest item box along a ray,
+ *  visiting the nearer child of every node first and
+ *  skipping nodes that start beyond the best hit so far.
+ ***********************************************************/
+bool SceneBVH::Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                       float maxDistance, RAY_HIT &hit) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    float best = maxDistance;
+    bool bHit = false;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    if (RayBox(m_nodes[0].bounds, origin, inverseDirection, best) <= best)
+    {
+        stack.push_back(0);
+    }
+    while (!stack.empty())
+    {
+        const NODE &node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (node.leftChild == 0)
+        {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                float distance = RayBox(m_boxes[m_itemOrder[i]], origin, inverseDirection, best);
+                if (distance <= best)
+                {
+                    best = distance;
+                    hit.item = m_itemOrder[i];
+                    hit.distance = distance;
+                    bHit = true;
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearChild = node.leftChild;
+        uint32_t farChild = node.leftChild + 1;
+        float nearDistance = RayBox(m_nodes[nearChild].bounds, origin, inverseDirection, best);
+        float farDistance = RayBox(m_nodes[farChild].bounds, origin, inverseDirection, best);
+        if (farDistance < nearDistance)
+        {
+            std::swap(nearChild, farChild);
+            std::swap(nearDistance, farDistance);
+        }
+        if (farDistance <= best)
+        {
+            stack.push_back(farChild);
+        }
+        if (nearDistance <= best)
+        {
+            stack.push_back(nearChild);
+        }
+    }
+    return bHit;
+}
+
+/***********************************************************
+ *  QuerySphere()
+ *
+ *  This method collects the items whose boxes are within
+ *  the radius of the center.
+ ***********************************************************/
+void SceneBVH::QuerySphere(const glm::vec3 &center, float radius,
+                           std::vector<uint32_t> &items) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    const float radiusSquared = radius * radius;
+    auto touches = [&](const AABB &box)
+    {
+        glm::vec3 offset = center - glm::clamp(center, box.min, box.max);
+        return glm::dot(offset, offset) <= radiusSquared;
+    };
+
+    std::vector<uint32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        const NODE &node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!touches(node.bounds))
+        {
+            continue;
+        }
+
+        if (node.leftChild == 0)
+        {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                if (touches(m_boxes[m_itemOrder[i]]))
+                {
+                    items.push_back(m_itemOrder[i]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.leftChild);
+            stack.push_back(node.leftChild + 1);
+        }
+    }
+}
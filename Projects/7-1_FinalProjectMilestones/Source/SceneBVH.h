@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneBVH.h
+// ============
+// bounding volume hierarchy over the world-space boxes of scene items
+//
+// The tree is built top down with the surface area heuristic: each node
+// bins the centroids of its items along the widest axis and splits where
+// the estimated cost of testing both children is lowest, or becomes a
+// leaf when no split beats testing its items directly. Nodes are stored
+// in one array with the two children of a node next to each other, and
+// the items of every subtree are a contiguous range of the item order,
+// so a node completely inside the frustum accepts its items without
+// visiting its children.
+//
+// Build() is only needed when items are added or removed. When items
+// move, SetBox() followed by Refit() updates the node bounds bottom up
+// while keeping the tree shape.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class SceneBVH
+{
+public:
+    // axis aligned box
+    struct AABB
+    {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+    };
+
+    // nearest item box hit by a ray
+    struct RAY_HIT
+    {
+        uint32_t item = 0;
+        float distance = 0.0f;
+    };
+
+    // most items a leaf holds
+    static const int MAX_LEAF_ITEMS = 4;
+
+    // number of centroid bins evaluated per split
+    static const int SAH_BINS = 16;
+
+    // cost of visiting a node relative to testing one item box;
+    // a node test costs about as much as an item test, but a
+    // visit also pays for the stack push and the cache miss
+    static constexpr float SAH_TRAVERSAL_COST = 2.0f;
+
+    // build the tree over one box per item; item i of the
+    // queries is boxes[i]
+    void Build(const std::vector<AABB> &boxes);
+
+    size_t Size() const { return m_boxes.size(); }
+    size_t NodeCount() const { return m_nodes.size(); }
+
+    // change the box of an item; the tree is only correct
+    // again after Refit()
+    void SetBox(uint32_t item, const AABB &box) { m_boxes[item] = box; }
+
+    // recompute every node box from the item boxes
+    void Refit();
+
+    // write 1 for every item whose box is inside or crosses the
+    // six inward facing planes and 0 for the others; returns the
+    // number of visible items
+    size_t QueryFrustum(const glm::vec4 planes[6], uint8_t *visible) const;
+
+    // nearest item box along a ray within maxDistance; the
+    // direction does not have to be normalized, distances are
+    // in multiples of it
+    bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float maxDistance, RAY_HIT &hit) const;
+
+    // append the items whose boxes touch a sphere, such as the
+    // range of a light
+    void QuerySphere(const glm::vec3 &center, float radius,
+                     std::vector<uint32_t> &items) const;
+
+private:
+    struct NODE
+    {
+        AABB bounds;
+        uint32_t leftChild;     // right child follows it; 0 for a leaf
+        uint32_t firstItem;     // items of the subtree in m_itemOrder
+        uint32_t itemCount;
+    };
+
+    // split a node, or leave it a leaf, and queue its children
+    void Subdivide(uint32_t nodeIndex, std::vector<uint32_t> &stack);
+
+    // box around the items of a range of m_itemOrder
+    AABB ItemBounds(uint32_t first, uint32_t count) const;
+
+    std::vector<AABB> m_boxes;
+    std::vector<glm::vec3> m_centroids;
+    std::vector<uint32_t> m_itemOrder;
+    std::vector<NODE> m_nodes;
+};
@@ -8,8 +8,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "GLStateCache.h"
 #include <GL/gl.h>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <functional>
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -21,23 +26,130 @@
 
 namespace
 {
-    const char* g_ModelName        = "model";
-    const char* g_ColorValueName   = "objectColor";
-    const char* g_TextureValueName = "objectTexture";
-    const char* g_UseTextureName   = "bUseTexture";
-    const char* g_UseLightingName  = "bUseLighting";
-    const char* g_UsePBRName       = "bUsePBR";
-    const char* g_UseCheckerName   = "bUseCheckerboard";
+    // uniform handles - names are hashed at compile time
+    constexpr Uniform<glm::mat4> g_ModelName("model");
+    constexpr Uniform<glm::mat4> g_ViewName("view");
+    constexpr Uniform<glm::mat4> g_ProjectionName("projection");
+    constexpr Uniform<glm::vec4> g_ColorValueName("objectColor");
+    constexpr Uniform<int>       g_TextureValueName("objectTexture");
+    constexpr Uniform<bool>      g_UseTextureName("bUseTexture");
+    constexpr Uniform<bool>      g_UsePBRName("bUsePBR");
+    constexpr Uniform<bool>      g_UseCheckerName("bUseCheckerboard");
+    constexpr Uniform<bool>      g_UseParallaxName("bUseParallax");
+    constexpr Uniform<bool>      g_IsEmissiveName("bIsEmissive");
+    constexpr Uniform<glm::vec2> g_UVScaleName("UVscale");
+    constexpr Uniform<bool>      g_UseInstancingName("bUseInstancing");
+    constexpr Uniform<bool>      g_UseIndirectName("bUseIndirect");
+    constexpr Uniform<bool>      g_UseDrawBlockName("bUseDrawBlock");
+    constexpr Uniform<bool>      g_UseUniformBlocksName("bUseUniformBlocks");
+    constexpr Uniform<bool>      g_UseMaterialTableName("bUseMaterialTable");
+    constexpr Uniform<bool>      g_UseClusteredLightsName("bUseClusteredLights");
+    constexpr Uniform<glm::vec4> g_ClusterScaleName("clusterScale");
+    constexpr Uniform<glm::vec4> g_ClusterViewDepthName("clusterViewDepth");
+    constexpr Uniform<float>     g_LightCutoffName("lightCutoff");
+    constexpr Uniform<int>       g_GBufferAlbedoName("gbufferAlbedo");
+    constexpr Uniform<int>       g_GBufferSurfaceName("gbufferSurface");
+    constexpr Uniform<int>       g_GBufferNormalName("gbufferNormal");
+    constexpr Uniform<int>       g_GBufferDepthName("gbufferDepth");
+    constexpr Uniform<glm::mat4> g_InverseViewProjectionName("inverseViewProjection");
+    constexpr Uniform<int>       g_MaterialIndexName("materialIndex");
+    constexpr Uniform<glm::vec3> g_PBRTintName("pbrTint");
+    constexpr Uniform<float>     g_ParallaxScaleName("parallaxScale");
+    constexpr Uniform<bool>      g_UseVertexTangentsName("bUseVertexTangents");
+    constexpr Uniform<glm::vec3> g_CheckerColor1Name("checkerColor1");
+    constexpr Uniform<glm::vec3> g_CheckerColor2Name("checkerColor2");
+    constexpr Uniform<glm::vec3> g_EmissiveColorName("emissiveColor");
+    constexpr Uniform<float>     g_EmissiveStrengthName("emissiveStrength");
+    constexpr Uniform<float>     g_EmissiveAlphaName("emissiveAlpha");
+    constexpr Uniform<int>       g_AlbedoMapName("albedoMap");
+    constexpr Uniform<int>       g_NormalMapName("normalMap");
+    constexpr Uniform<int>       g_MetallicMapName("metallicMap");
+    constexpr Uniform<int>       g_RoughnessMapName("roughnessMap");
+    constexpr Uniform<int>       g_AOMapName("aoMap");
+    constexpr Uniform<int>       g_HeightMapName("heightMap");
+    constexpr Uniform<int>       g_NumLightsName("numLights");
+    constexpr Uniform<glm::vec3> g_LightPosName("lightPos");
+    constexpr Uniform<glm::vec3> g_LightColorName("lightColor");
+    constexpr Uniform<glm::vec3> g_ViewPosName("viewPos");
+    constexpr Uniform<glm::vec3> g_EnvColorTopName("envColorTop");
+    constexpr Uniform<glm::vec3> g_EnvColorBottomName("envColorBottom");
+    constexpr Uniform<float>     g_EnvIntensityName("envIntensity");
+
+    // per-light array elements, one handle per index
+    constexpr Uniform<glm::vec3> g_LightPositionNames[] =
+    {
+        Uniform<glm::vec3>("lightPositions[0]"), Uniform<glm::vec3>("lightPositions[1]"),
+        Uniform<glm::vec3>("lightPositions[2]"), Uniform<glm::vec3>("lightPositions[3]"),
+        Uniform<glm::vec3>("lightPositions[4]"), Uniform<glm::vec3>("lightPositions[5]"),
+        Uniform<glm::vec3>("lightPositions[6]"), Uniform<glm::vec3>("lightPositions[7]"),
+        Uniform<glm::vec3>("lightPositions[8]"), Uniform<glm::vec3>("lightPositions[9]")
+    };
+    constexpr Uniform<glm::vec3> g_LightColorNames[] =
+    {
+        Uniform<glm::vec3>("lightColors[0]"), Uniform<glm::vec3>("lightColors[1]"),
+        Uniform<glm::vec3>("lightColors[2]"), Uniform<glm::vec3>("lightColors[3]"),
+        Uniform<glm::vec3>("lightColors[4]"), Uniform<glm::vec3>("lightColors[5]"),
+        Uniform<glm::vec3>("lightColors[6]"), Uniform<glm::vec3>("lightColors[7]"),
+        Uniform<glm::vec3>("lightColors[8]"), Uniform<glm::vec3>("lightColors[9]")
+    };
+    constexpr Uniform<float> g_LightIntensityNames[] =
+    {
+        Uniform<float>("lightIntensities[0]"), Uniform<float>("lightIntensities[1]"),
+        Uniform<float>("lightIntensities[2]"), Uniform<float>("lightIntensities[3]"),
+        Uniform<float>("lightIntensities[4]"), Uniform<float>("lightIntensities[5]"),
+        Uniform<float>("lightIntensities[6]"), Uniform<float>("lightIntensities[7]"),
+        Uniform<float>("lightIntensities[8]"), Uniform<float>("lightIntensities[9]")
+    };
+
+    // meshes with coarser levels of detail - only the curved ones
+    const bool g_MeshHasLods[DrawList::MESH_COUNT] =
+    {
+        false,  // box
+        true,   // cone
+        true,   // cylinder
+        false,  // plane
+        false,  // prism
+        false,  // pyramid3
+        false,  // pyramid4
+        true,   // sphere
+        true,   // half sphere
+        true,   // tapered cylinder
+        true,   // torus
+        true    // half torus
+    };
+
+    // marks an occluder candidate as one of the static boxes
+    // rather than a draw list item
+    const uint32_t g_StaticOccluderBit = 0x80000000u;
+
+    // draw lists of at least this many items are culled through
+    // the BVH; below it the SIMD test of every box is faster
+    // (Tools/BVHBench puts the crossover between 10k and 100k)
+    const size_t g_BvhMinItems = 32768;
+
+    // stream buffer bytes reserved per visible item for the
+    // instances or indirect draws ShapeMeshes writes after the
+    // draw blocks, with room for the alignment of each batch
+    const GLsizeiptr g_StreamBytesPerItem = 1024;
+
+    // parallax depth of the PBR sets with a height map
+    const float g_ParallaxScale = 0.06f;
+
+    // first texture unit of the G-buffer in the lighting pass,
+    // after the six of the PBR maps
+    const int g_GBufferTextureUnit = 6;
 }
 
 // =====================================================================
 //  Constructor / Destructor
 // =====================================================================
 
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, ShapeMeshes::VERTEX_LAYOUT vertexLayout, bool bVertexTangents)
 {
     m_pShaderManager = pShaderManager;
-    m_basicMeshes = new ShapeMeshes();
+    m_basicMeshes = new ShapeMeshes(vertexLayout);
+    m_basicMeshes->SetTangentGeneration(bVertexTangents);
+    m_bUseVertexTangents = bVertexTangents;
 
     m_cameraPos   = glm::vec3(0.0f, 5.0f, 20.0f);
     m_cameraFront = glm::vec3(0.0f, -0.2f, -1.0f);
@@ -53,6 +165,23 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
         m_textureIDs[i].ID  = 0;
     }
     m_loadedTextures = 0;
+
+    // the shader program is already linked - report any handle
+    // that does not name an active uniform
+    if (m_pShaderManager)
+    {
+        m_pShaderManager->ValidateUniforms({
+            g_ModelName, g_ViewName, g_ProjectionName, g_ColorValueName,
+            g_TextureValueName, g_UseTextureName, g_UsePBRName, g_UseCheckerName,
+            g_UseParallaxName, g_IsEmissiveName, g_UVScaleName, g_PBRTintName,
+            g_UseInstancingName,
+            g_ParallaxScaleName, g_UseVertexTangentsName, g_CheckerColor1Name, g_CheckerColor2Name,
+            g_EmissiveColorName, g_EmissiveStrengthName, g_EmissiveAlphaName,
+            g_AlbedoMapName, g_NormalMapName, g_MetallicMapName, g_RoughnessMapName,
+            g_AOMapName, g_HeightMapName, g_NumLightsName, g_ViewPosName,
+            g_EnvColorTopName, g_EnvColorBottomName, g_EnvIntensityName,
+            g_LightPositionNames[0], g_LightColorNames[0], g_LightIntensityNames[0] });
+    }
 }
 
 SceneManager::~SceneManager()
@@ -71,6 +200,14 @@ SceneManager::~SceneManager()
     }
     m_pbrTextures.clear();
 
+    ClearStaticBatches();
+    m_streamBuffer.Destroy();
+    m_frameBlock.Destroy();
+    m_lightBlock.Destroy();
+    m_materialBlock.Destroy();
+    DestroyLightBuffers();
+    DestroyGBuffer();
+
     delete m_basicMeshes;
     m_basicMeshes    = nullptr;
     m_pShaderManager = nullptr;
@@ -130,8 +267,7 @@ void SceneManager::BindGLTextures()
 {
     for (int i = 0; i < m_loadedTextures; i++)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+        GLState().BindTexture2D(i, m_textureIDs[i].ID);
     }
 }
 
@@ -241,7 +377,17 @@ bool SceneManager::LoadPBRTextureSet(
         return false;
     }
 
-    m_pbrTextures[tag] = set;
+    auto existing = m_pbrTextures.find(tag);
+    if (existing != m_pbrTextures.end())
+    {
+        set.index = existing->second.index;
+        existing->second = set;
+    }
+    else
+    {
+        set.index = (uint16_t)m_pbrSetList.size();
+        m_pbrSetList.push_back(&m_pbrTextures.emplace(tag, set).first->second);
+    }
     std::cout << "PBR: Registered texture set '" << tag << "'"
               << (set.hasHeight ? " (with parallax)" : "") << std::endl;
     return true;
@@ -249,135 +395,1340 @@ bool SceneManager::LoadPBRTextureSet(
 
 // =====================================================================
 //  Shader State Helpers
-//  Each helper disables all other modes to prevent state leaking.
+//  While the scene is recorded these only fill in the pending draw
+//  item; each helper resets the fields of the other modes so no state
+//  leaks from one object to the next. The uniforms are written when
+//  the draw list is submitted.
 // =====================================================================
 
 void SceneManager::SetShaderTexture(std::string textureTag)
 {
-    m_pShaderManager->setBoolValue(g_UsePBRName, false);
-    m_pShaderManager->setBoolValue(g_UseCheckerName, false);
-    m_pShaderManager->setBoolValue(g_UseTextureName, true);
-    m_pShaderManager->setBoolValue("bUseParallax", false);
-    m_pShaderManager->setBoolValue("bIsEmissive", false);
-    m_pShaderManager->setVec2Value("UVscale", glm::vec2(1.0f, 1.0f));
-
     int slot = FindTextureSlot(textureTag);
-    if (slot >= 0)
+
+    m_pendingDraw.shaderMode  = DrawList::SHADER_TEXTURE;
+    m_pendingDraw.textureSet  = (slot >= 0) ? (uint16_t)slot : NO_TEXTURE_SET;
+    m_pendingDraw.uvScale     = glm::vec2(1.0f, 1.0f);
+    m_pendingDraw.transparent = false;
+}
+
+void SceneManager::SetShaderColor(float red, float green, float blue, float alpha)
+{
+    m_pendingDraw.shaderMode  = DrawList::SHADER_COLOR;
+    m_pendingDraw.textureSet  = 0;
+    m_pendingDraw.uvScale     = glm::vec2(1.0f, 1.0f);
+    m_pendingDraw.color       = glm::vec4(red, green, blue, alpha);
+    m_pendingDraw.transparent = false;
+}
+
+/***********************************************************
+ *  SetShaderEmissive()
+ *
+ *  Sets the fragment shader to emissive mode — the object
+ *  glows with the given color and ignores scene lighting.
+ *  Used for lightbulbs and neon strips. An alpha below 1
+ *  makes the item transparent so it is drawn last.
+ ***********************************************************/
+void SceneManager::SetShaderEmissive(float r, float g, float b, float strength, float alpha)
+{
+    m_pendingDraw.shaderMode       = DrawList::SHADER_EMISSIVE;
+    m_pendingDraw.textureSet       = 0;
+    m_pendingDraw.color            = glm::vec4(r, g, b, alpha);
+    m_pendingDraw.emissiveStrength = strength;
+    m_pendingDraw.transparent      = (alpha < 1.0f);
+}
+
+void SceneManager::SetShaderPBR(const std::string& tag)
+{
+    auto it = m_pbrTextures.find(tag);
+    if (it == m_pbrTextures.end())
+    {
+        std::cout << "PBR: '" << tag << "' not found, falling back" << std::endl;
+        SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
+        return;
+    }
+
+    m_pendingDraw.shaderMode  = DrawList::SHADER_PBR;
+    m_pendingDraw.textureSet  = it->second.index;
+    m_pendingDraw.uvScale     = glm::vec2(1.0f, 1.0f);
+    m_pendingDraw.tint        = glm::vec3(1.0f);  // no tint by default
+    m_pendingDraw.transparent = false;
+}
+
+/***********************************************************
+ *  SetShaderPBRTinted()
+ *
+ *  Convenience: activates PBR textures then applies a color
+ *  tint. Useful for reusing a single PBR set (e.g. plastic)
+ *  with different object colors (ketchup red, mustard yellow).
+ ***********************************************************/
+void SceneManager::SetShaderPBRTinted(const std::string& tag, const glm::vec3& tint)
+{
+    SetShaderPBR(tag);
+    m_pendingDraw.tint = tint;
+}
+
+void SceneManager::SetShaderCheckerboard(
+    float tileCountU, float tileCountV,
+    glm::vec3 color1, glm::vec3 color2)
+{
+    m_pendingDraw.shaderMode    = DrawList::SHADER_CHECKERBOARD;
+    m_pendingDraw.textureSet    = 0;
+    m_pendingDraw.uvScale       = glm::vec2(tileCountU, tileCountV);
+    m_pendingDraw.checkerColor1 = color1;
+    m_pendingDraw.checkerColor2 = color2;
+    m_pendingDraw.transparent   = false;
+}
+
+void SceneManager::SetUVScale(float u, float v)
+{
+    m_pendingDraw.uvScale = glm::vec2(u, v);
+}
+
+// =====================================================================
+//  Draw List Submission
+// =====================================================================
+
+/***********************************************************
+ *  AddDraw()
+ *
+ *  Records the pending transform and material as a draw
+ *  item of the given mesh.
+ ***********************************************************/
+void SceneManager::AddDraw(uint8_t mesh, uint8_t parts)
+{
+    m_pendingDraw.mesh  = mesh;
+    m_pendingDraw.parts = parts;
+    m_pendingDraw.material       = InternMaterial(m_pendingDraw, false);
+    m_pendingDraw.sharedMaterial = InternMaterial(m_pendingDraw, true);
+    if (m_bStaticBatching && m_pendingDraw.isStatic && !m_pendingDraw.transparent)
+    {
+        AddStaticDraw(m_pendingDraw);
+        return;
+    }
+    m_drawList.Add(m_pendingDraw);
+}
+
+/***********************************************************
+ *  InternMaterial()
+ *
+ *  Returns the index of the material record of an item,
+ *  adding the record when no earlier item used it. The
+ *  shared record has the neutral color and UV scale of a
+ *  batch, whose items carry their own per instance or draw.
+ ***********************************************************/
+uint16_t SceneManager::InternMaterial(const DrawList::DRAW_ITEM& item, bool bShared)
+{
+    const glm::vec2 uvScale = bShared ? glm::vec2(1.0f) : item.uvScale;
+
+    MATERIAL_RECORD record;
+    record.color       = glm::vec4(1.0f);
+    record.checker1    = glm::vec4(0.0f);
+    record.checker2    = glm::vec4(0.0f);
+    record.uvScalePath = glm::vec4(uvScale.x, uvScale.y, (float)item.shaderMode, (float)item.textureSet);
+
+    switch (item.shaderMode)
+    {
+    case DrawList::SHADER_EMISSIVE:
+        record.color      = bShared ? glm::vec4(1.0f) : item.color;
+        record.checker1.w = item.emissiveStrength;
+        break;
+    case DrawList::SHADER_COLOR:
+        record.color = bShared ? glm::vec4(1.0f) : item.color;
+        break;
+    case DrawList::SHADER_CHECKERBOARD:
+        record.checker1 = glm::vec4(item.checkerColor1, 0.0f);
+        record.checker2 = glm::vec4(item.checkerColor2, 0.0f);
+        break;
+    case DrawList::SHADER_PBR:
+        record.color      = bShared ? glm::vec4(1.0f) : glm::vec4(item.tint, 1.0f);
+        record.checker2.w = m_pbrSetList[item.textureSet]->hasHeight ? g_ParallaxScale : 0.0f;
+        break;
+    default:
+        break;
+    }
+
+    std::array<float, 16> key;
+    memcpy(key.data(), &record, sizeof(record));
+    auto found = m_materialIndices.find(key);
+    if (found != m_materialIndices.end())
+    {
+        return found->second;
+    }
+
+    uint16_t index = (uint16_t)m_materialRecords.size();
+    m_materialRecords.push_back(record);
+    m_materialIndices.emplace(key, index);
+    return index;
+}
+
+/***********************************************************
+ *  SameMaterial()
+ *
+ *  Two static items can share a batch when they have the
+ *  same material record, which leaves only the transform to
+ *  differ - and the batch bakes that into the vertices.
+ ***********************************************************/
+bool SceneManager::SameMaterial(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b)
+{
+    return a.material == b.material;
+}
+
+/***********************************************************
+ *  AddStaticDraw()
+ *
+ *  Appends an item, transformed to world space at the full
+ *  level of detail, to the batch of its material. Boxes are
+ *  also kept as occluder candidates.
+ ***********************************************************/
+void SceneManager::AddStaticDraw(const DrawList::DRAW_ITEM& item)
+{
+    size_t group = 0;
+    while (group < m_staticGroups.size() && !SameMaterial(m_staticGroups[group].material, item))
+    {
+        group++;
+    }
+    if (group == m_staticGroups.size())
+    {
+        m_staticGroups.emplace_back();
+        m_staticGroups.back().material = item;
+    }
+
+    ShapeMeshes::STATIC_BATCH& batch = m_staticGroups[group].batch;
+    m_staticGroups[group].items++;
+
+    const bool top    = (item.parts & DrawList::PART_TOP) != 0;
+    const bool bottom = (item.parts & DrawList::PART_BOTTOM) != 0;
+    const bool sides  = (item.parts & DrawList::PART_SIDES) != 0;
+
+    switch (item.mesh)
+    {
+    case DrawList::MESH_BOX:              m_basicMeshes->AddBoxToBatch(batch, item.model); break;
+    case DrawList::MESH_CONE:             m_basicMeshes->AddConeToBatch(batch, item.model, bottom); break;
+    case DrawList::MESH_CYLINDER:         m_basicMeshes->AddCylinderToBatch(batch, item.model, top, bottom, sides); break;
+    case DrawList::MESH_PLANE:            m_basicMeshes->AddPlaneToBatch(batch, item.model); break;
+    case DrawList::MESH_PRISM:            m_basicMeshes->AddPrismToBatch(batch, item.model); break;
+    case DrawList::MESH_PYRAMID3:         m_basicMeshes->AddPyramid3ToBatch(batch, item.model); break;
+    case DrawList::MESH_PYRAMID4:         m_basicMeshes->AddPyramid4ToBatch(batch, item.model); break;
+    case DrawList::MESH_SPHERE:           m_basicMeshes->AddSphereToBatch(batch, item.model); break;
+    case DrawList::MESH_HALF_SPHERE:      m_basicMeshes->AddHalfSphereToBatch(batch, item.model); break;
+    case DrawList::MESH_TAPERED_CYLINDER: m_basicMeshes->AddTaperedCylinderToBatch(batch, item.model, top, bottom, sides); break;
+    case DrawList::MESH_TORUS:            m_basicMeshes->AddTorusToBatch(batch, item.model); break;
+    case DrawList::MESH_HALF_TORUS:       m_basicMeshes->AddHalfTorusToBatch(batch, item.model); break;
+    default: break;
+    }
+
+    if (item.mesh == DrawList::MESH_BOX)
+    {
+        const ShapeMeshes::MESH_BOUNDS& bounds = GetMeshBounds(DrawList::MESH_BOX);
+        glm::vec3 center;
+        glm::vec3 extent;
+        FrustumCuller::WorldBox(bounds.boxMin, bounds.boxMax, item.model, center, extent);
+
+        SceneBVH::AABB box;
+        box.min = center - extent;
+        box.max = center + extent;
+        m_staticOccluderModels.push_back(item.model);
+        m_staticOccluderBoxes.push_back(box);
+    }
+}
+
+/***********************************************************
+ *  ClearStaticBatches()
+ *
+ *  Frees the GL buffers of the static batches before the
+ *  scene is recorded again.
+ ***********************************************************/
+void SceneManager::ClearStaticBatches()
+{
+    for (STATIC_GROUP& group : m_staticGroups)
+    {
+        m_basicMeshes->DeleteStaticBatch(group.batch);
+    }
+    m_staticGroups.clear();
+    m_staticOccluderModels.clear();
+    m_staticOccluderBoxes.clear();
+}
+
+/***********************************************************
+ *  SetStaticBatching()
+ *
+ *  Turns the merging of static items on or off.
+ ***********************************************************/
+void SceneManager::SetStaticBatching(bool bStaticBatching)
+{
+    if (m_bStaticBatching != bStaticBatching)
+    {
+        m_bStaticBatching = bStaticBatching;
+        m_drawListDirty = true;
+    }
+}
+
+/***********************************************************
+ *  BindMaterialTextures()
+ *
+ *  Binds the texture, or the maps of the PBR set, of an
+ *  item to the units its samplers read.
+ ***********************************************************/
+void SceneManager::BindMaterialTextures(const DrawList::DRAW_ITEM& item)
+{
+    if (item.shaderMode == DrawList::SHADER_TEXTURE && item.textureSet != NO_TEXTURE_SET)
+    {
+        GLState().BindTexture2D(0, m_textureIDs[item.textureSet].ID);
+        return;
+    }
+    if (item.shaderMode != DrawList::SHADER_PBR)
+    {
+        return;
+    }
+
+    const PBR_TEXTURE_SET& set = *m_pbrSetList[item.textureSet];
+
+    GLState().BindTexture2D(0, set.albedoID);
+    GLState().BindTexture2D(1, set.normalID);
+    GLState().BindTexture2D(2, set.metallicID);
+    GLState().BindTexture2D(3, set.roughnessID);
+    GLState().BindTexture2D(4, set.aoID);
+
+    // Height map for parallax
+    GLState().BindTexture2D(5, set.heightID);
+}
+
+/***********************************************************
+ *  ApplyShaderMode()
+ *
+ *  Selects the fragment shader path, or the variant for
+ *  it, and binds the textures of an item. Only called when
+ *  the shader path or the texture set differs from the
+ *  previous item, which covers every variant change. With the
+ *  material table the record selects the path, and the
+ *  samplers keep the units set by SetMaterialTable().
+ ***********************************************************/
+void SceneManager::ApplyShaderMode(const DrawList::DRAW_ITEM& item)
+{
+    const uint8_t mode = item.shaderMode;
+
+    if (m_renderPass == PASS_GBUFFER)
+    {
+        m_pShaderManager->UseVariant(m_bShaderVariants ? m_gbufferVariants[item.material] : m_gbufferProgram,
+                                     m_gbufferProgram);
+    }
+    else if (m_bShaderVariants)
+    {
+        m_pShaderManager->UseVariant(m_materialVariants[item.material]);
+    }
+    else if (m_bDeferredShading)
+    {
+        m_pShaderManager->UseVariant(0);
+    }
+    BindMaterialTextures(item);
+    if (mode == DrawList::SHADER_PBR)
+    {
+        m_pShaderManager->setBoolValue(g_UseVertexTangentsName, m_bUseVertexTangents);
+    }
+    if (m_bMaterialTable)
+    {
+        return;
+    }
+
+    m_pShaderManager->setBoolValue(g_UsePBRName,      mode == DrawList::SHADER_PBR);
+    m_pShaderManager->setBoolValue(g_UseCheckerName,  mode == DrawList::SHADER_CHECKERBOARD);
+    m_pShaderManager->setBoolValue(g_UseTextureName,  mode == DrawList::SHADER_TEXTURE);
+    m_pShaderManager->setBoolValue(g_IsEmissiveName,  mode == DrawList::SHADER_EMISSIVE);
+
+    if (mode == DrawList::SHADER_TEXTURE && item.textureSet != NO_TEXTURE_SET)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_textureIDs[slot].ID);
         m_pShaderManager->setSampler2DValue(g_TextureValueName, 0);
     }
+
+    if (mode != DrawList::SHADER_PBR)
+    {
+        m_pShaderManager->setBoolValue(g_UseParallaxName, false);
+        return;
+    }
+
+    m_pShaderManager->setIntValue(g_AlbedoMapName, 0);
+    m_pShaderManager->setIntValue(g_NormalMapName, 1);
+    m_pShaderManager->setIntValue(g_MetallicMapName, 2);
+    m_pShaderManager->setIntValue(g_RoughnessMapName, 3);
+    m_pShaderManager->setIntValue(g_AOMapName, 4);
+    m_pShaderManager->setIntValue(g_HeightMapName, 5);
+
+    m_pShaderManager->setBoolValue(g_UseParallaxName, m_pbrSetList[item.textureSet]->hasHeight);
+    m_pShaderManager->setFloatValue(g_ParallaxScaleName, g_ParallaxScale);
+}
+
+/***********************************************************
+ *  SetVertexTangents()
+ *
+ *  Switches the PBR items between the TBN built from the
+ *  mesh tangents and the one rebuilt per fragment from
+ *  screen-space derivatives. Tangents can only be used
+ *  when the meshes were loaded with them.
+ ***********************************************************/
+void SceneManager::SetVertexTangents(bool bUseVertexTangents)
+{
+    m_bUseVertexTangents = bUseVertexTangents && m_basicMeshes->HasTangents();
+}
+
+/***********************************************************
+ *  ApplyItemUniforms()
+ *
+ *  Writes the per-object uniforms of an item. Values that
+ *  repeat from the previous item are filtered out by the
+ *  shader manager.
+ ***********************************************************/
+void SceneManager::ApplyItemUniforms(const DrawList::DRAW_ITEM& item)
+{
+    if (m_bMaterialTable)
+    {
+        m_pShaderManager->setIntValue(g_MaterialIndexName, item.material);
+        m_pShaderManager->setMat4Value(g_ModelName, item.model);
+        return;
+    }
+
+    switch (item.shaderMode)
+    {
+    case DrawList::SHADER_EMISSIVE:
+        m_pShaderManager->setVec3Value(g_EmissiveColorName, glm::vec3(item.color));
+        m_pShaderManager->setFloatValue(g_EmissiveStrengthName, item.emissiveStrength);
+        m_pShaderManager->setFloatValue(g_EmissiveAlphaName, item.color.a);
+        break;
+    case DrawList::SHADER_COLOR:
+        m_pShaderManager->setVec2Value(g_UVScaleName, item.uvScale);
+        m_pShaderManager->setVec4Value(g_ColorValueName, item.color);
+        break;
+    case DrawList::SHADER_CHECKERBOARD:
+        m_pShaderManager->setVec2Value(g_UVScaleName, item.uvScale);
+        m_pShaderManager->setVec3Value(g_CheckerColor1Name, item.checkerColor1);
+        m_pShaderManager->setVec3Value(g_CheckerColor2Name, item.checkerColor2);
+        break;
+    case DrawList::SHADER_PBR:
+        m_pShaderManager->setVec2Value(g_UVScaleName, item.uvScale);
+        m_pShaderManager->setVec3Value(g_PBRTintName, item.tint);
+        break;
+    default:
+        m_pShaderManager->setVec2Value(g_UVScaleName, item.uvScale);
+        break;
+    }
+
+    m_pShaderManager->setMat4Value(g_ModelName, item.model);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  Issues the draw call for a recorded mesh at the given
+ *  level of detail.
+ ***********************************************************/
+void SceneManager::DrawMesh(uint8_t mesh, uint8_t parts, uint8_t lod)
+{
+    m_basicMeshes->SetLodLevel(lod);
+
+    const bool top    = (parts & DrawList::PART_TOP) != 0;
+    const bool bottom = (parts & DrawList::PART_BOTTOM) != 0;
+    const bool sides  = (parts & DrawList::PART_SIDES) != 0;
+
+    switch (mesh)
+    {
+    case DrawList::MESH_BOX:              m_basicMeshes->DrawBoxMesh(); break;
+    case DrawList::MESH_CONE:             m_basicMeshes->DrawConeMesh(bottom); break;
+    case DrawList::MESH_CYLINDER:         m_basicMeshes->DrawCylinderMesh(top, bottom, sides); break;
+    case DrawList::MESH_PLANE:            m_basicMeshes->DrawPlaneMesh(); break;
+    case DrawList::MESH_PRISM:            m_basicMeshes->DrawPrismMesh(); break;
+    case DrawList::MESH_PYRAMID3:         m_basicMeshes->DrawPyramid3Mesh(); break;
+    case DrawList::MESH_PYRAMID4:         m_basicMeshes->DrawPyramid4Mesh(); break;
+    case DrawList::MESH_SPHERE:           m_basicMeshes->DrawSphereMesh(); break;
+    case DrawList::MESH_HALF_SPHERE:      m_basicMeshes->DrawHalfSphereMesh(); break;
+    case DrawList::MESH_TAPERED_CYLINDER: m_basicMeshes->DrawTaperedCylinderMesh(top, bottom, sides); break;
+    case DrawList::MESH_TORUS:            m_basicMeshes->DrawTorusMesh(); break;
+    case DrawList::MESH_HALF_TORUS:       m_basicMeshes->DrawHalfTorusMesh(); break;
+    default: break;
+    }
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  Issues one instanced draw call for a batch of items
+ *  that share a recorded mesh.
+ ***********************************************************/
+void SceneManager::DrawMeshInstanced(uint8_t mesh, uint8_t parts, uint8_t lod, size_t count)
+{
+    m_basicMeshes->SetLodLevel(lod);
+
+    const bool top    = (parts & DrawList::PART_TOP) != 0;
+    const bool bottom = (parts & DrawList::PART_BOTTOM) != 0;
+    const bool sides  = (parts & DrawList::PART_SIDES) != 0;
+
+    const glm::mat4* transforms = m_instanceTransforms.data();
+    const glm::vec2* uvScales   = m_instanceUVScales.data();
+    const glm::vec4* tints      = m_instanceTints.data();
+
+    switch (mesh)
+    {
+    case DrawList::MESH_BOX:              m_basicMeshes->DrawBoxMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_CONE:             m_basicMeshes->DrawConeMeshInstanced(transforms, count, uvScales, tints, bottom); break;
+    case DrawList::MESH_CYLINDER:         m_basicMeshes->DrawCylinderMeshInstanced(transforms, count, uvScales, tints, top, bottom, sides); break;
+    case DrawList::MESH_PLANE:            m_basicMeshes->DrawPlaneMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_PRISM:            m_basicMeshes->DrawPrismMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_PYRAMID3:         m_basicMeshes->DrawPyramid3MeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_PYRAMID4:         m_basicMeshes->DrawPyramid4MeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_SPHERE:           m_basicMeshes->DrawSphereMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_HALF_SPHERE:      m_basicMeshes->DrawHalfSphereMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_TAPERED_CYLINDER: m_basicMeshes->DrawTaperedCylinderMeshInstanced(transforms, count, uvScales, tints, top, bottom, sides); break;
+    case DrawList::MESH_TORUS:            m_basicMeshes->DrawTorusMeshInstanced(transforms, count, uvScales, tints); break;
+    case DrawList::MESH_HALF_TORUS:       m_basicMeshes->DrawHalfTorusMeshInstanced(transforms, count, uvScales, tints); break;
+    default: break;
+    }
+}
+
+/***********************************************************
+ *  SameSharedUniforms()
+ *
+ *  Two items can share a draw call when they use the same
+ *  material, and every uniform that differs between them has
+ *  a per-instance or per-draw stream (transform, UV scale,
+ *  and the color or tint).
+ ***********************************************************/
+bool SceneManager::SameSharedUniforms(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b)
+{
+    return a.sharedMaterial == b.sharedMaterial && a.transparent == b.transparent;
+}
+
+/***********************************************************
+ *  CanInstance()
+ *
+ *  Items can share an instanced draw when they also use the
+ *  same mesh, parts and level of detail.
+ ***********************************************************/
+bool SceneManager::CanInstance(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b)
+{
+    return a.mesh == b.mesh && a.parts == b.parts && a.lod == b.lod &&
+           SameSharedUniforms(a, b);
+}
+
+/***********************************************************
+ *  InstanceTint()
+ *
+ *  The per-instance tint of an item: its color, its PBR
+ *  tint, or white for the modes without one.
+ ***********************************************************/
+glm::vec4 SceneManager::InstanceTint(const DrawList::DRAW_ITEM& item)
+{
+    switch (item.shaderMode)
+    {
+    case DrawList::SHADER_COLOR:
+    case DrawList::SHADER_EMISSIVE:
+        return item.color;
+    case DrawList::SHADER_PBR:
+        return glm::vec4(item.tint, 1.0f);
+    default:
+        return glm::vec4(1.0f);
+    }
+}
+
+/***********************************************************
+ *  ApplySharedUniforms()
+ *
+ *  Sets the uniforms a batch shares to neutral values so
+ *  the per-instance or per-draw values apply unchanged.
+ ***********************************************************/
+void SceneManager::ApplySharedUniforms(const DrawList::DRAW_ITEM& first)
+{
+    if (m_bMaterialTable)
+    {
+        m_pShaderManager->setIntValue(g_MaterialIndexName, first.sharedMaterial);
+        return;
+    }
+
+    switch (first.shaderMode)
+    {
+    case DrawList::SHADER_EMISSIVE:
+        m_pShaderManager->setVec3Value(g_EmissiveColorName, glm::vec3(1.0f));
+        m_pShaderManager->setFloatValue(g_EmissiveStrengthName, first.emissiveStrength);
+        m_pShaderManager->setFloatValue(g_EmissiveAlphaName, 1.0f);
+        break;
+    case DrawList::SHADER_COLOR:
+        m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f));
+        m_pShaderManager->setVec4Value(g_ColorValueName, glm::vec4(1.0f));
+        break;
+    case DrawList::SHADER_CHECKERBOARD:
+        m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f));
+        m_pShaderManager->setVec3Value(g_CheckerColor1Name, first.checkerColor1);
+        m_pShaderManager->setVec3Value(g_CheckerColor2Name, first.checkerColor2);
+        break;
+    case DrawList::SHADER_PBR:
+        m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f));
+        m_pShaderManager->setVec3Value(g_PBRTintName, glm::vec3(1.0f));
+        break;
+    default:
+        m_pShaderManager->setVec2Value(g_UVScaleName, glm::vec2(1.0f));
+        break;
+    }
+}
+
+/***********************************************************
+ *  SubmitInstanced()
+ *
+ *  Gathers the instance streams of a batch and draws the
+ *  batch in one call.
+ ***********************************************************/
+void SceneManager::SubmitInstanced(const uint32_t* indices, size_t count)
+{
+    const DrawList::DRAW_ITEM& first = m_drawList.Item(indices[0]);
+
+    m_instanceTransforms.resize(count);
+    m_instanceUVScales.resize(count);
+    m_instanceTints.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const DrawList::DRAW_ITEM& item = m_drawList.Item(indices[i]);
+        m_instanceTransforms[i] = item.model;
+        m_instanceUVScales[i]   = item.uvScale;
+        m_instanceTints[i]      = InstanceTint(item);
+    }
+
+    m_pShaderManager->setBoolValue(g_UseInstancingName, true);
+    ApplySharedUniforms(first);
+    DrawMeshInstanced(first.mesh, first.parts, first.lod, count);
+}
+
+/***********************************************************
+ *  AddMeshIndirect()
+ *
+ *  Adds an item, at its level of detail, to the pending
+ *  multi-draw indirect call.
+ ***********************************************************/
+void SceneManager::AddMeshIndirect(const DrawList::DRAW_ITEM& item)
+{
+    m_basicMeshes->SetLodLevel(item.lod);
+
+    const bool top    = (item.parts & DrawList::PART_TOP) != 0;
+    const bool bottom = (item.parts & DrawList::PART_BOTTOM) != 0;
+    const bool sides  = (item.parts & DrawList::PART_SIDES) != 0;
+
+    const glm::mat4& model = item.model;
+    const glm::vec2& uv    = item.uvScale;
+    const glm::vec4 tint   = InstanceTint(item);
+
+    switch (item.mesh)
+    {
+    case DrawList::MESH_BOX:              m_basicMeshes->AddBoxIndirect(model, uv, tint); break;
+    case DrawList::MESH_CONE:             m_basicMeshes->AddConeIndirect(model, uv, tint, bottom); break;
+    case DrawList::MESH_CYLINDER:         m_basicMeshes->AddCylinderIndirect(model, uv, tint, top, bottom, sides); break;
+    case DrawList::MESH_PLANE:            m_basicMeshes->AddPlaneIndirect(model, uv, tint); break;
+    case DrawList::MESH_PRISM:            m_basicMeshes->AddPrismIndirect(model, uv, tint); break;
+    case DrawList::MESH_PYRAMID3:         m_basicMeshes->AddPyramid3Indirect(model, uv, tint); break;
+    case DrawList::MESH_PYRAMID4:         m_basicMeshes->AddPyramid4Indirect(model, uv, tint); break;
+    case DrawList::MESH_SPHERE:           m_basicMeshes->AddSphereIndirect(model, uv, tint); break;
+    case DrawList::MESH_HALF_SPHERE:      m_basicMeshes->AddHalfSphereIndirect(model, uv, tint); break;
+    case DrawList::MESH_TAPERED_CYLINDER: m_basicMeshes->AddTaperedCylinderIndirect(model, uv, tint, top, bottom, sides); break;
+    case DrawList::MESH_TORUS:            m_basicMeshes->AddTorusIndirect(model, uv, tint); break;
+    case DrawList::MESH_HALF_TORUS:       m_basicMeshes->AddHalfTorusIndirect(model, uv, tint); break;
+    default: break;
+    }
+}
+
+/***********************************************************
+ *  SubmitIndirect()
+ *
+ *  Draws a run of items that share their uniforms, whatever
+ *  their meshes, with one multi-draw indirect call. Returns
+ *  the number of commands issued.
+ ***********************************************************/
+size_t SceneManager::SubmitIndirect(const uint32_t* indices, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        AddMeshIndirect(m_drawList.Item(indices[i]));
+    }
+
+    m_pShaderManager->setBoolValue(g_UseIndirectName, true);
+    ApplySharedUniforms(m_drawList.Item(indices[0]));
+    return (size_t)m_basicMeshes->DrawIndirect();
+}
+
+/***********************************************************
+ *  SetIndirectDraw()
+ *
+ *  Switches the draw list between multi-draw indirect and
+ *  instanced submission.
+ ***********************************************************/
+void SceneManager::SetIndirectDraw(bool bIndirectDraw)
+{
+    m_bIndirectDraw = bIndirectDraw;
+    if (m_bIndirectDraw && m_pShaderManager)
+    {
+        m_pShaderManager->ValidateUniforms({ g_UseIndirectName });
+    }
+}
+
+/***********************************************************
+ *  SetStreamBuffer()
+ *
+ *  Switches the per-draw values between uniforms and the
+ *  DrawBlock ranges of the stream buffer, which needs the
+ *  block in the linked program. The stream buffer also
+ *  takes the instances and indirect draws of ShapeMeshes
+ *  while it is persistently mapped.
+ ***********************************************************/
+void SceneManager::SetStreamBuffer(bool bStreamBuffer, bool bPersistent)
+{
+    m_bStreamBuffer = bStreamBuffer && m_pShaderManager &&
+                      m_pShaderManager->SetUniformBlockBinding("DrawBlock", DRAW_BLOCK_BINDING);
+    m_drawBlockBase = -1;
+    if (!m_bStreamBuffer)
+    {
+        m_basicMeshes->SetStreamBuffer(nullptr);
+        m_streamBuffer.Destroy();
+        return;
+    }
+
+    m_pShaderManager->ValidateUniforms({ g_UseDrawBlockName });
+    m_streamBuffer.SetPersistent(bPersistent && StreamRingBuffer::PersistentSupported());
+    m_basicMeshes->SetStreamBuffer(&m_streamBuffer);
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_drawBlockAlignment = std::max<GLsizeiptr>(alignment, 1);
+    m_drawBlockStride = (sizeof(DRAW_BLOCK) + m_drawBlockAlignment - 1) / m_drawBlockAlignment * m_drawBlockAlignment;
+}
+
+/***********************************************************
+ *  SetUniformBlocks()
+ *
+ *  Switches the camera, lights and environment between
+ *  uniforms and the FrameBlock and LightBlock, which needs
+ *  both blocks in the linked program. Either way the lights
+ *  are written again on the next frame.
+ ***********************************************************/
+void SceneManager::SetUniformBlocks(bool bUniformBlocks)
+{
+    m_bUniformBlocks = bUniformBlocks && m_pShaderManager &&
+                       m_pShaderManager->SetUniformBlockBinding("FrameBlock", FRAME_BLOCK_BINDING) &&
+                       m_pShaderManager->SetUniformBlockBinding("LightBlock", LIGHT_BLOCK_BINDING);
+    m_bLightsDirty = true;
+    if (!m_pShaderManager)
+    {
+        return;
+    }
+
+    m_pShaderManager->ValidateUniforms({ g_UseUniformBlocksName });
+    m_pShaderManager->setBoolValue(g_UseUniformBlocksName, m_bUniformBlocks);
+    if (!m_bUniformBlocks)
+    {
+        m_frameBlock.Destroy();
+        m_lightBlock.Destroy();
+    }
+}
+
+/***********************************************************
+ *  SetMaterialTable()
+ *
+ *  Switches the material values between uniforms and the
+ *  MaterialBlock, which needs the block in the linked
+ *  program. The samplers of the table keep fixed units, and
+ *  the table is filled when the scene is recorded again.
+ ***********************************************************/
+void SceneManager::SetMaterialTable(bool bMaterialTable)
+{
+    m_bMaterialTable = bMaterialTable && m_pShaderManager &&
+                       m_pShaderManager->SetUniformBlockBinding("MaterialBlock", MATERIAL_BLOCK_BINDING);
+    m_drawListDirty = true;
+    if (!m_pShaderManager)
+    {
+        return;
+    }
+
+    m_pShaderManager->ValidateUniforms({ g_UseMaterialTableName, g_MaterialIndexName });
+    m_pShaderManager->setBoolValue(g_UseMaterialTableName, m_bMaterialTable);
+    if (!m_bMaterialTable)
+    {
+        m_materialBlock.Destroy();
+        return;
+    }
+
+    m_pShaderManager->setSampler2DValue(g_TextureValueName, 0);
+    m_pShaderManager->setIntValue(g_AlbedoMapName, 0);
+    m_pShaderManager->setIntValue(g_NormalMapName, 1);
+    m_pShaderManager->setIntValue(g_MetallicMapName, 2);
+    m_pShaderManager->setIntValue(g_RoughnessMapName, 3);
+    m_pShaderManager->setIntValue(g_AOMapName, 4);
+    m_pShaderManager->setIntValue(g_HeightMapName, 5);
+}
+
+/***********************************************************
+ *  UpdateMaterialTable()
+ *
+ *  Copies the records of the recorded scene into the
+ *  MaterialBlock, which is uploaded with the next frame. A
+ *  scene with more materials than the block holds goes back
+ *  to the uniforms.
+ ***********************************************************/
+void SceneManager::UpdateMaterialTable()
+{
+    if (!m_bMaterialTable)
+    {
+        return;
+    }
+    if (m_materialRecords.size() > MAX_MATERIALS)
+    {
+        std::cout << "Material table: " << m_materialRecords.size() << " materials, more than "
+                  << MAX_MATERIALS << " - using uniforms" << std::endl;
+        SetMaterialTable(false);
+        return;
+    }
+
+    MATERIAL_BLOCK block;
+    memset((void*)&block, 0, sizeof(block));
+    std::copy(m_materialRecords.begin(), m_materialRecords.end(), block.records);
+    m_materialBlock.Set(block);
+}
+
+/***********************************************************
+ *  SetShaderVariants()
+ *
+ *  Switches between the uber-shader and the variants built
+ *  for the material paths of the scene.
+ ***********************************************************/
+void SceneManager::SetShaderVariants(bool bShaderVariants)
+{
+    m_bShaderVariants = bShaderVariants && m_pShaderManager;
+    m_drawListDirty = true;
+    if (m_pShaderManager && !m_bShaderVariants)
+    {
+        m_pShaderManager->UseVariant(0);
+    }
+}
+
+/***********************************************************
+ *  UpdateShaderVariants()
+ *
+ *  Finds the variant of every material record, building
+ *  the ones not compiled yet. A material whose variant is
+ *  still building, or does not build, is drawn with the
+ *  uber-shader.
+ ***********************************************************/
+void SceneManager::UpdateShaderVariants()
+{
+    m_materialVariants.assign(m_materialRecords.size(), 0);
+    m_gbufferVariants.assign(m_materialRecords.size(), m_gbufferProgram);
+    if (!m_bShaderVariants)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_materialRecords.size(); i++)
+    {
+        const MATERIAL_RECORD& record = m_materialRecords[i];
+        const std::string path = "MATERIAL_PATH " + std::to_string((int)record.uvScalePath.z);
+        const std::string parallax = std::string("MATERIAL_PARALLAX ") + (record.checker2.w > 0.0f ? "1" : "0");
+        m_materialVariants[i] = m_pShaderManager->AddVariant({ path, parallax });
+
+        // the emissive items are never drawn into the G-buffer
+        if (m_bDeferredShading && (int)record.uvScalePath.z != DrawList::SHADER_EMISSIVE)
+        {
+            m_gbufferVariants[i] = m_pShaderManager->AddVariant({ path, parallax, "GBUFFER_PASS 1" });
+        }
+    }
+}
+
+/***********************************************************
+ *  FillDrawBlock()
+ *
+ *  The per-draw values of an item, as the instance streams
+ *  carry them. The block is only written to, as it may be
+ *  in write-combined memory.
+ ***********************************************************/
+void SceneManager::FillDrawBlock(DRAW_BLOCK& block, const DrawList::DRAW_ITEM& item)
+{
+    block.model   = item.model;
+    block.tint    = InstanceTint(item);
+    block.uvScale = glm::vec4(item.uvScale.x, item.uvScale.y, 0.0f, 0.0f);
+}
+
+/***********************************************************
+ *  WriteDrawBlocks()
+ *
+ *  Starts the frame of the stream buffer and writes the
+ *  DRAW_BLOCK of every static batch, then of every visible
+ *  item in submission order. The frame is sized for the
+ *  instances and indirect draws added later as well.
+ ***********************************************************/
+void SceneManager::WriteDrawBlocks()
+{
+    const size_t itemBlocks = m_bIndirectDraw ? 0 : m_visibleOrder.size();
+    const size_t blocks = m_staticGroups.size() + itemBlocks;
+    const GLsizeiptr blockBytes = (GLsizeiptr)blocks * m_drawBlockStride;
+
+    m_streamBuffer.BeginFrame(blockBytes + m_drawBlockAlignment +
+                              (GLsizeiptr)m_visibleOrder.size() * g_StreamBytesPerItem);
+    m_drawBlockBase = -1;
+    if (blocks == 0)
+    {
+        return;
+    }
+
+    StreamRingBuffer::ALLOCATION allocation = m_streamBuffer.Allocate(blockBytes, m_drawBlockAlignment);
+    if (allocation.data == nullptr)
+    {
+        return;
+    }
+
+    uint8_t* data = (uint8_t*)allocation.data;
+    for (size_t i = 0; i < m_staticGroups.size(); i++)
+    {
+        DRAW_BLOCK& block = *(DRAW_BLOCK*)(data + i * m_drawBlockStride);
+        FillDrawBlock(block, m_staticGroups[i].material);
+        block.model = glm::mat4(1.0f);
+    }
+    data += m_staticGroups.size() * m_drawBlockStride;
+    for (size_t i = 0; i < itemBlocks; i++)
+    {
+        FillDrawBlock(*(DRAW_BLOCK*)(data + i * m_drawBlockStride), m_drawList.Item(m_visibleOrder[i]));
+    }
+
+    m_streamBuffer.Flush();
+    m_drawBlockBase = allocation.offset;
+}
+
+/***********************************************************
+ *  BindDrawBlock()
+ *
+ *  Binds the range of a draw block of this frame to the
+ *  DrawBlock of the shader. Returns false when the frame
+ *  has no blocks and the values must be set as uniforms.
+ ***********************************************************/
+bool SceneManager::BindDrawBlock(size_t block)
+{
+    if (m_drawBlockBase < 0)
+    {
+        return false;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_BLOCK_BINDING, m_streamBuffer.Buffer(),
+                      m_drawBlockBase + (GLintptr)block * m_drawBlockStride, sizeof(DRAW_BLOCK));
+    return true;
+}
+
+/***********************************************************
+ *  SubmitStaticBatches()
+ *
+ *  Draws every static batch with the uniforms of its
+ *  material and an identity model matrix, as the vertices
+ *  are already in world space. The batches span the room,
+ *  so they are not culled.
+ ***********************************************************/
+void SceneManager::SubmitStaticBatches(int& currentMode, int& currentSet)
+{
+    if (m_staticGroups.empty())
+    {
+        return;
+    }
+
+    m_pShaderManager->setBoolValue(g_UseInstancingName, false);
+    if (m_bIndirectDraw)
+    {
+        // still set by the indirect draws of an earlier pass
+        m_pShaderManager->setBoolValue(g_UseIndirectName, false);
+    }
+    for (size_t g = 0; g < m_staticGroups.size(); g++)
+    {
+        STATIC_GROUP& group = m_staticGroups[g];
+        const DrawList::DRAW_ITEM& material = group.material;
+        if (!InRenderPass(material))
+        {
+            continue;
+        }
+        if (material.shaderMode != currentMode || material.textureSet != currentSet)
+        {
+            if (material.shaderMode != currentMode)
+            {
+                m_drawStats.modeChanges++;
+            }
+            else
+            {
+                m_drawStats.materialChanges++;
+            }
+            ApplyShaderMode(material);
+            currentMode = material.shaderMode;
+            currentSet = material.textureSet;
+        }
+
+        if (BindDrawBlock(g))
+        {
+            ApplySharedUniforms(material);
+        }
+        else
+        {
+            DrawList::DRAW_ITEM uniforms = material;
+            uniforms.model = glm::mat4(1.0f);
+            ApplyItemUniforms(uniforms);
+        }
+        m_basicMeshes->DrawStaticBatch(group.batch);
+
+        m_drawStats.drawCalls++;
+        m_drawStats.staticBatches++;
+        m_drawStats.staticItems += group.items;
+    }
 }
 
-void SceneManager::SetShaderColor(float red, float green, float blue, float alpha)
-{
-    m_pShaderManager->setBoolValue(g_UsePBRName, false);
-    m_pShaderManager->setBoolValue(g_UseCheckerName, false);
-    m_pShaderManager->setBoolValue(g_UseTextureName, false);
-    m_pShaderManager->setBoolValue("bUseParallax", false);
-    m_pShaderManager->setBoolValue("bIsEmissive", false);
-    m_pShaderManager->setVec2Value("UVscale", glm::vec2(1.0f, 1.0f));
-    m_pShaderManager->setVec4Value(g_ColorValueName, glm::vec4(red, green, blue, alpha));
+/***********************************************************
+ *  SubmitDrawList()
+ *
+ *  Draws the static batches, then the recorded items in
+ *  sorted order. The shader path
+ *  and textures are only switched when they change, and depth
+ *  writes are turned off once the transparent items start.
+ *  Runs of items that CanInstance() are merged into a single
+ *  instanced draw; with indirect submission every run of
+ *  items with the SameSharedUniforms() is one multi-draw
+ *  indirect call. With the stream buffer, single draws and
+ *  static batches bind their DrawBlock range in place of
+ *  the per-object uniforms. A deferred frame submits the
+ *  list twice, the lit opaque items into the G-buffer and,
+ *  after it is lit, the others forward.
+ ***********************************************************/
+void SceneManager::SubmitDrawList()
+{
+    m_drawStats = DrawList::FRAME_STATS();
+    m_drawStats.occluded = (unsigned int)m_occludedCount;
+    m_drawStats.culled = (unsigned int)(m_drawList.Size() - m_visibleCount - m_occludedCount);
+    m_basicMeshes->ResetFrameStats();
+
+    if (m_bUniformBlocks)
+    {
+        m_drawStats.blockUploads += m_frameBlock.Update(FRAME_BLOCK_BINDING) ? 1 : 0;
+        m_drawStats.blockUploads += m_lightBlock.Update(LIGHT_BLOCK_BINDING) ? 1 : 0;
+    }
+    if (m_bMaterialTable)
+    {
+        m_drawStats.blockUploads += m_materialBlock.Update(MATERIAL_BLOCK_BINDING) ? 1 : 0;
+    }
+
+    // the sorted items that survived culling
+    m_visibleOrder.clear();
+    for (uint32_t index : m_drawList.Order())
+    {
+        if (m_visibility[index])
+        {
+            m_visibleOrder.push_back(index);
+        }
+    }
+
+    // per-draw values of the frame, when they are streamed
+    if (m_bStreamBuffer)
+    {
+        WriteDrawBlocks();
+        m_pShaderManager->setBoolValue(g_UseDrawBlockName, m_drawBlockBase >= 0);
+    }
+
+    // with deferred shading the lit opaque items go to the
+    // G-buffer and the rest is drawn forward after the lighting
+    m_bDeferredFrame = m_bDeferredShading && BeginGBufferPass();
+    if (m_bDeferredFrame)
+    {
+        m_renderPass = PASS_GBUFFER;
+        SubmitItems();
+        LightGBuffer();
+        m_renderPass = PASS_OVERLAY;
+    }
+    SubmitItems();
+    m_renderPass = PASS_FORWARD;
+
+    m_pShaderManager->setBoolValue(g_UseInstancingName, false);
+    if (m_bIndirectDraw)
+    {
+        m_pShaderManager->setBoolValue(g_UseIndirectName, false);
+    }
+    if (m_bStreamBuffer)
+    {
+        m_pShaderManager->setBoolValue(g_UseDrawBlockName, false);
+        m_streamBuffer.EndFrame();
+    }
+}
+
+/***********************************************************
+ *  SubmitItems()
+ *
+ *  Draws the static batches and the visible items of the
+ *  current render pass in sorted order.
+ ***********************************************************/
+void SceneManager::SubmitItems()
+{
+    const std::vector<uint32_t>& order = m_visibleOrder;
+    int currentMode = -1;
+    int currentSet = -1;
+    bool depthWritesOff = false;
+
+    SubmitStaticBatches(currentMode, currentSet);
+
+    size_t i = 0;
+    while (i < order.size())
+    {
+        const DrawList::DRAW_ITEM& item = m_drawList.Item(order[i]);
+        if (!InRenderPass(item))
+        {
+            i++;
+            continue;
+        }
+
+        size_t runEnd = i + 1;
+        while (runEnd < order.size() && InRenderPass(m_drawList.Item(order[runEnd])) &&
+               (m_bIndirectDraw ? SameSharedUniforms(item, m_drawList.Item(order[runEnd]))
+                                : CanInstance(item, m_drawList.Item(order[runEnd]))))
+        {
+            runEnd++;
+        }
+
+        if (item.transparent && !depthWritesOff)
+        {
+            glDepthMask(GL_FALSE);  // don't write depth for transparent objects
+            depthWritesOff = true;
+        }
+
+        if (item.shaderMode != currentMode || item.textureSet != currentSet)
+        {
+            if (item.shaderMode != currentMode)
+            {
+                m_drawStats.modeChanges++;
+            }
+            else
+            {
+                m_drawStats.materialChanges++;
+            }
+            ApplyShaderMode(item);
+            currentMode = item.shaderMode;
+            currentSet = item.textureSet;
+        }
+
+        size_t runLength = runEnd - i;
+        if (m_bIndirectDraw)
+        {
+            m_drawStats.indirectCommands += (unsigned int)SubmitIndirect(&order[i], runLength);
+            m_drawStats.drawCalls++;
+        }
+        else if (runLength >= MIN_INSTANCE_BATCH)
+        {
+            SubmitInstanced(&order[i], runLength);
+            m_drawStats.instancedBatches++;
+            m_drawStats.drawCalls++;
+        }
+        else
+        {
+            m_pShaderManager->setBoolValue(g_UseInstancingName, false);
+            for (size_t n = i; n < runEnd; n++)
+            {
+                const DrawList::DRAW_ITEM& single = m_drawList.Item(order[n]);
+                if (BindDrawBlock(m_staticGroups.size() + n))
+                {
+                    ApplySharedUniforms(single);
+                }
+                else
+                {
+                    ApplyItemUniforms(single);
+                }
+                DrawMesh(single.mesh, single.parts, single.lod);
+                m_drawStats.drawCalls++;
+            }
+        }
+
+        m_drawStats.draws += (unsigned int)runLength;
+        i = runEnd;
+    }
+
+    if (depthWritesOff)
+    {
+        glDepthMask(GL_TRUE);  // restore depth writes
+    }
+}
+
+/***********************************************************
+ *  InRenderPass()
+ *
+ *  Returns whether an item is drawn in the current render
+ *  pass. The emissive and transparent items are not lit, or
+ *  cannot be stored in the G-buffer, so a deferred frame
+ *  draws them forward after the lighting pass.
+ ***********************************************************/
+bool SceneManager::InRenderPass(const DrawList::DRAW_ITEM& item) const
+{
+    const bool bForward = item.transparent || item.shaderMode == DrawList::SHADER_EMISSIVE;
+    switch (m_renderPass)
+    {
+    case PASS_GBUFFER: return !bForward;
+    case PASS_OVERLAY: return bForward;
+    default:           return true;
+    }
+}
+
+/***********************************************************
+ *  SetDeferredShading()
+ *
+ *  Switches between forward and deferred shading. The
+ *  G-buffer and lighting passes are variants of the scene
+ *  shaders, so they share its uniforms and blocks; with
+ *  shader variants on, each material path also gets a
+ *  G-buffer variant. Frames are drawn forward until the two
+ *  pass programs are built.
+ ***********************************************************/
+void SceneManager::SetDeferredShading(bool bDeferredShading)
+{
+    m_bDeferredShading = bDeferredShading && m_pShaderManager;
+    if (!m_bDeferredShading)
+    {
+        DestroyGBuffer();
+        return;
+    }
+
+    m_gbufferProgram = m_pShaderManager->AddVariant({ "GBUFFER_PASS 1" });
+    m_lightingProgram = m_pShaderManager->AddVariant({ "LIGHTING_PASS 1" });
+    if (m_gbufferProgram == 0 || m_lightingProgram == 0)
+    {
+        std::cout << "Deferred shading: the pass programs did not build - drawing forward" << std::endl;
+        m_bDeferredShading = false;
+        return;
+    }
+
+    m_pShaderManager->setIntValue(g_GBufferAlbedoName, g_GBufferTextureUnit);
+    m_pShaderManager->setIntValue(g_GBufferSurfaceName, g_GBufferTextureUnit + 1);
+    m_pShaderManager->setIntValue(g_GBufferNormalName, g_GBufferTextureUnit + 2);
+    m_pShaderManager->setIntValue(g_GBufferDepthName, g_GBufferTextureUnit + 3);
+    UpdateShaderVariants();
 }
 
 /***********************************************************
- *  SetShaderEmissive()
+ *  BeginGBufferPass()
  *
- *  Sets the fragment shader to emissive mode — the object
- *  glows with the given color and ignores scene lighting.
- *  Used for lightbulbs and neon strips.
+ *  Binds the G-buffer, created or resized to the viewport,
+ *  for the lit opaque items. Returns false, and the frame
+ *  is drawn forward, while the pass programs are building.
  ***********************************************************/
-void SceneManager::SetShaderEmissive(float r, float g, float b, float strength, float alpha)
-{
-    m_pShaderManager->setBoolValue(g_UsePBRName, false);
-    m_pShaderManager->setBoolValue(g_UseCheckerName, false);
-    m_pShaderManager->setBoolValue(g_UseTextureName, false);
-    m_pShaderManager->setBoolValue("bUseParallax", false);
-    m_pShaderManager->setBoolValue("bIsEmissive", true);
-    m_pShaderManager->setVec3Value("emissiveColor", glm::vec3(r, g, b));
-    m_pShaderManager->setFloatValue("emissiveStrength", strength);
-    m_pShaderManager->setFloatValue("emissiveAlpha", alpha);
-}
-
-void SceneManager::SetShaderPBR(const std::string& tag)
+bool SceneManager::BeginGBufferPass()
 {
-    auto it = m_pbrTextures.find(tag);
-    if (it == m_pbrTextures.end())
+    const int width = (int)m_lodViewportWidth;
+    const int height = (int)m_lodViewportHeight;
+    if (width <= 0 || height <= 0 ||
+        !m_pShaderManager->IsVariantReady(m_gbufferProgram) ||
+        !m_pShaderManager->IsVariantReady(m_lightingProgram))
     {
-        std::cout << "PBR: '" << tag << "' not found, falling back" << std::endl;
-        SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
-        return;
+        return false;
     }
 
-    const PBR_TEXTURE_SET& set = it->second;
-
-    m_pShaderManager->setBoolValue(g_UseTextureName, false);
-    m_pShaderManager->setBoolValue(g_UseCheckerName, false);
-    m_pShaderManager->setBoolValue(g_UsePBRName, true);
-    m_pShaderManager->setBoolValue("bIsEmissive", false);
-    m_pShaderManager->setVec2Value("UVscale", glm::vec2(1.0f, 1.0f));
-    m_pShaderManager->setVec3Value("pbrTint", glm::vec3(1.0f));  // no tint by default
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_sceneFramebuffer);
+    if ((width != m_gbufferWidth || height != m_gbufferHeight) && !CreateGBuffer(width, height))
+    {
+        std::cout << "Deferred shading: the G-buffer is incomplete - drawing forward" << std::endl;
+        SetDeferredShading(false);
+        return false;
+    }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, set.albedoID);
-    m_pShaderManager->setIntValue("albedoMap", 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gbufferFramebuffer);
+    glClear(GL_DEPTH_BUFFER_BIT);   // pixels left at the far plane are not lit
+    glDisable(GL_BLEND);            // the alpha channels hold surface values
+    return true;
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, set.normalID);
-    m_pShaderManager->setIntValue("normalMap", 1);
+/***********************************************************
+ *  CreateGBuffer()
+ *
+ *  Creates the G-buffer targets: albedo with gamma 2.2 and
+ *  ambient occlusion in RGBA8, metallic, roughness and the
+ *  lighting model in RGBA8, the octahedral normal in RG16F
+ *  and a 24-bit depth the lighting pass reads positions
+ *  back from. Returns whether the framebuffer is complete.
+ ***********************************************************/
+bool SceneManager::CreateGBuffer(int width, int height)
+{
+    DestroyGBuffer();
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, set.metallicID);
-    m_pShaderManager->setIntValue("metallicMap", 2);
+    const GLenum internalFormats[4] = { GL_RGBA8, GL_RGBA8, GL_RG16F, GL_DEPTH_COMPONENT24 };
+    const GLenum formats[4] = { GL_RGBA, GL_RGBA, GL_RG, GL_DEPTH_COMPONENT };
+    const GLenum types[4] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_HALF_FLOAT, GL_UNSIGNED_INT };
+    const GLenum attachments[4] =
+    {
+        GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_DEPTH_ATTACHMENT
+    };
 
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, set.roughnessID);
-    m_pShaderManager->setIntValue("roughnessMap", 3);
+    glGenFramebuffers(1, &m_gbufferFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_gbufferFramebuffer);
+    glGenTextures(4, m_gbufferTextures);
+    for (int i = 0; i < 4; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, m_gbufferTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], types[i], nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachments[i], GL_TEXTURE_2D, m_gbufferTextures[i], 0);
+    }
+    glDrawBuffers(3, attachments);
+    const bool bComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFramebuffer);
 
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, set.aoID);
-    m_pShaderManager->setIntValue("aoMap", 4);
+    // the full-screen triangle has no attributes, but core
+    // profiles only draw with a vertex array bound
+    glGenVertexArrays(1, &m_fullscreenVertexArray);
 
-    // Height map for parallax
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, set.heightID);
-    m_pShaderManager->setIntValue("heightMap", 5);
+    // the textures were bound outside the state cache
+    GLState().Invalidate();
 
-    m_pShaderManager->setBoolValue("bUseParallax", set.hasHeight);
-    m_pShaderManager->setFloatValue("parallaxScale", 0.06f);
+    m_gbufferWidth = width;
+    m_gbufferHeight = height;
+    return bComplete;
 }
 
 /***********************************************************
- *  SetShaderPBRTinted()
+ *  DestroyGBuffer()
  *
- *  Convenience: activates PBR textures then applies a color
- *  tint. Useful for reusing a single PBR set (e.g. plastic)
- *  with different object colors (ketchup red, mustard yellow).
+ *  Deletes the G-buffer targets and framebuffer.
  ***********************************************************/
-void SceneManager::SetShaderPBRTinted(const std::string& tag, const glm::vec3& tint)
+void SceneManager::DestroyGBuffer()
 {
-    SetShaderPBR(tag);
-    m_pShaderManager->setVec3Value("pbrTint", tint);
-}
+    if (m_gbufferFramebuffer == 0)
+    {
+        return;
+    }
 
-void SceneManager::SetShaderCheckerboard(
-    float tileCountU, float tileCountV,
-    glm::vec3 color1, glm::vec3 color2)
-{
-    m_pShaderManager->setBoolValue(g_UsePBRName, false);
-    m_pShaderManager->setBoolValue(g_UseTextureName, false);
-    m_pShaderManager->setBoolValue(g_UseCheckerName, true);
-    m_pShaderManager->setBoolValue("bUseParallax", false);
-    m_pShaderManager->setBoolValue("bIsEmissive", false);
-    m_pShaderManager->setVec2Value("UVscale", glm::vec2(tileCountU, tileCountV));
-    m_pShaderManager->setVec3Value("checkerColor1", color1);
-    m_pShaderManager->setVec3Value("checkerColor2", color2);
+    glDeleteFramebuffers(1, &m_gbufferFramebuffer);
+    glDeleteTextures(4, m_gbufferTextures);
+    glDeleteVertexArrays(1, &m_fullscreenVertexArray);
+    m_gbufferFramebuffer = 0;
+    m_fullscreenVertexArray = 0;
+    for (GLuint& texture : m_gbufferTextures)
+    {
+        texture = 0;
+    }
+    m_gbufferWidth = 0;
+    m_gbufferHeight = 0;
+    GLState().Invalidate();
 }
 
-void SceneManager::SetUVScale(float u, float v)
+/***********************************************************
+ *  LightGBuffer()
+ *
+ *  Lights every pixel of the G-buffer once, with a single
+ *  triangle covering the screen, into the scene framebuffer.
+ *  The stored depth is written through, so the forward
+ *  items drawn next are hidden behind the lit surfaces.
+ ***********************************************************/
+void SceneManager::LightGBuffer()
 {
-    m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFramebuffer);
+    glEnable(GL_BLEND);
+
+    m_pShaderManager->UseVariant(m_lightingProgram);
+    for (int i = 0; i < 4; i++)
+    {
+        GLState().BindTexture2D(g_GBufferTextureUnit + i, m_gbufferTextures[i]);
+    }
+    m_pShaderManager->setMat4Value(g_InverseViewProjectionName, glm::inverse(m_lodProjection * m_lodView));
+
+    glDepthFunc(GL_ALWAYS);
+    GLState().BindVertexArray(m_fullscreenVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDepthFunc(GL_LESS);
+    m_drawStats.drawCalls++;
 }
 
 // =====================================================================
@@ -386,6 +1737,29 @@ void SceneManager::SetUVScale(float u, float v)
 
 void SceneManager::SetupLighting()
 {
+    // The eye position is written every frame; the frame block
+    // only becomes dirty when the camera actually moved
+    if (m_bUniformBlocks)
+    {
+        FRAME_BLOCK frame;
+        frame.view = m_lodView;
+        frame.projection = m_lodProjection;
+        frame.viewPosition = glm::vec4(m_cameraPos.x, m_cameraPos.y, m_cameraPos.z, 1.0f);
+        m_frameBlock.Set(frame);
+    }
+    else
+    {
+        m_pShaderManager->setVec3Value(g_ViewPosName, m_cameraPos);
+    }
+
+    // The lights never move, so they are written once and again
+    // only after MarkLightsDirty()
+    if (!m_bLightsDirty)
+    {
+        return;
+    }
+    m_bLightsDirty = false;
+
     // ---------------------------------------------------------------
     //  10 lights total (MAX_LIGHTS = 10):
     //    Lights 0–4 : pendant lamp bulbs (warm, per-booth)
@@ -403,12 +1777,11 @@ void SceneManager::SetupLighting()
     const float shadeCenterY = 6.5f - 0.4f;
     const float bulbY        = shadeCenterY - 0.15f;
 
-    const int totalLights = 10;
-    m_pShaderManager->setIntValue("numLights", totalLights);
+    const int totalLights = MAX_LIGHTS;
 
-    glm::vec3 positions[10];
-    glm::vec3 colors[10];
-    float     intensities[10];
+    glm::vec3 positions[MAX_LIGHTS];
+    glm::vec3 colors[MAX_LIGHTS];
+    float     intensities[MAX_LIGHTS];
 
     // --- Lights 0-4: one per pendant lamp (warm tungsten, reduced) ---
     for (int i = 0; i < boothCount; ++i)
@@ -444,23 +1817,192 @@ void SceneManager::SetupLighting()
     colors[9]      = glm::vec3(1.0f, 0.12f, 0.08f);      // neon red
     intensities[9] = 20.0f;
 
+    // Hemisphere environment (dimmer for moodier diner ambiance)
+    const glm::vec3 envColorTop    = glm::vec3(0.55f, 0.55f, 0.65f);
+    const glm::vec3 envColorBottom = glm::vec3(0.10f, 0.08f, 0.07f);
+    const float     envIntensity   = 0.15f;   // was 0.25
+
+    if (m_bClusteredLighting)
+    {
+        SetClusteredLights(positions, colors, intensities);
+    }
+
+    if (m_bUniformBlocks)
+    {
+        LIGHT_BLOCK lights;
+        memset((void*)&lights, 0, sizeof(lights));
+        for (int i = 0; i < totalLights; ++i)
+        {
+            lights.positions[i] = glm::vec4(positions[i].x, positions[i].y, positions[i].z, intensities[i]);
+            lights.colors[i]    = glm::vec4(colors[i].x, colors[i].y, colors[i].z, 0.0f);
+        }
+        lights.envColorTop    = glm::vec4(envColorTop.x, envColorTop.y, envColorTop.z, envIntensity);
+        lights.envColorBottom = glm::vec4(envColorBottom.x, envColorBottom.y, envColorBottom.z, 0.0f);
+        lights.numLights      = totalLights;
+        m_lightBlock.Set(lights);
+        return;
+    }
+
+    m_pShaderManager->setIntValue(g_NumLightsName, totalLights);
     for (int i = 0; i < totalLights; ++i)
     {
-        std::string idx = std::to_string(i);
-        m_pShaderManager->setVec3Value("lightPositions[" + idx + "]", positions[i]);
-        m_pShaderManager->setVec3Value("lightColors[" + idx + "]",    colors[i]);
-        m_pShaderManager->setFloatValue("lightIntensities[" + idx + "]", intensities[i]);
+        m_pShaderManager->setVec3Value(g_LightPositionNames[i], positions[i]);
+        m_pShaderManager->setVec3Value(g_LightColorNames[i],    colors[i]);
+        m_pShaderManager->setFloatValue(g_LightIntensityNames[i], intensities[i]);
     }
 
     // Legacy single-light uniforms (kept for fallback)
-    m_pShaderManager->setVec3Value("lightPos",   positions[0]);
-    m_pShaderManager->setVec3Value("lightColor",  colors[0]);
-    m_pShaderManager->setVec3Value("viewPos",    m_cameraPos);
+    m_pShaderManager->setVec3Value(g_LightPosName,   positions[0]);
+    m_pShaderManager->setVec3Value(g_LightColorName,  colors[0]);
 
-    // Hemisphere environment (dimmer for moodier diner ambiance)
-    m_pShaderManager->setVec3Value("envColorTop",    glm::vec3(0.55f, 0.55f, 0.65f));
-    m_pShaderManager->setVec3Value("envColorBottom", glm::vec3(0.10f, 0.08f, 0.07f));
-    m_pShaderManager->setFloatValue("envIntensity",  0.15f);   // was 0.25
+    m_pShaderManager->setVec3Value(g_EnvColorTopName,    envColorTop);
+    m_pShaderManager->setVec3Value(g_EnvColorBottomName, envColorBottom);
+    m_pShaderManager->setFloatValue(g_EnvIntensityName,  envIntensity);
+}
+
+/***********************************************************
+ *  SetClusteredLights()
+ *
+ *  Uploads the lights of the clustered path: the scene
+ *  lights, then the extra lights scattered through the diner
+ *  on a fixed sequence so every run places them alike. Each
+ *  light ends where its attenuation falls to the cutoff.
+ ***********************************************************/
+void SceneManager::SetClusteredLights(const glm::vec3 positions[], const glm::vec3 colors[], const float intensities[])
+{
+    std::vector<LightClusters::LIGHT> lights;
+    lights.reserve(MAX_LIGHTS + m_extraLights);
+    auto addLight = [&](const glm::vec3& position, const glm::vec3& color, float intensity)
+    {
+        float radius = LightClusters::LightRadius(intensity, m_lightCutoff);
+        lights.push_back({ glm::vec4(position.x, position.y, position.z, radius),
+                           glm::vec4(color.x, color.y, color.z, intensity) });
+    };
+
+    for (int i = 0; i < MAX_LIGHTS; ++i)
+    {
+        addLight(positions[i], colors[i], intensities[i]);
+    }
+
+    // extra lights inside the room (X -10 to 7.5, Y 0 to 8,
+    // Z -15 to 15), placed on an additive recurrence
+    const glm::vec3 roomMin(-9.5f, 0.5f, -14.5f);
+    const glm::vec3 roomSize(16.5f, 7.0f, 29.0f);
+    const glm::vec3 palette[4] =
+    {
+        glm::vec3(1.0f, 0.55f, 0.25f),   // amber
+        glm::vec3(0.25f, 0.6f, 1.0f),    // blue
+        glm::vec3(1.0f, 0.2f, 0.45f),    // pink neon
+        glm::vec3(0.45f, 1.0f, 0.5f)     // green
+    };
+    for (size_t i = 0; i < m_extraLights; ++i)
+    {
+        float n = (float)(i + 1);
+        glm::vec3 position(fmodf(n * 0.8191725f, 1.0f), fmodf(n * 0.6710436f, 1.0f), fmodf(n * 0.5497005f, 1.0f));
+        addLight(roomMin + position * roomSize, palette[i % 4], 0.05f + 0.1f * fmodf(n * 0.618034f, 1.0f));
+    }
+
+    m_lightClusters.SetLights(lights);
+    UploadLightBuffer(0, LIGHT_RECORDS_BINDING, lights.data(), lights.size() * sizeof(LightClusters::LIGHT));
+    m_pShaderManager->setFloatValue(g_LightCutoffName, m_lightCutoff);
+}
+
+/***********************************************************
+ *  SetClusteredLighting()
+ *
+ *  Switches between lighting every fragment from all the
+ *  scene lights and from the lights of its cluster, which
+ *  needs the three storage blocks in the linked program.
+ *  Either way the lights are written again on the next
+ *  frame.
+ ***********************************************************/
+void SceneManager::SetClusteredLighting(bool bClusteredLighting)
+{
+    m_bClusteredLighting = bClusteredLighting && m_pShaderManager &&
+                           m_pShaderManager->SetStorageBlockBinding("LightRecords", LIGHT_RECORDS_BINDING) &&
+                           m_pShaderManager->SetStorageBlockBinding("LightClusters", LIGHT_CLUSTERS_BINDING) &&
+                           m_pShaderManager->SetStorageBlockBinding("LightIndices", LIGHT_INDICES_BINDING);
+    m_bLightsDirty = true;
+    if (!m_pShaderManager)
+    {
+        return;
+    }
+
+    m_pShaderManager->ValidateUniforms({ g_UseClusteredLightsName });
+    m_pShaderManager->setBoolValue(g_UseClusteredLightsName, m_bClusteredLighting);
+    if (!m_bClusteredLighting)
+    {
+        DestroyLightBuffers();
+    }
+}
+
+/***********************************************************
+ *  UpdateLightClusters()
+ *
+ *  Assigns the lights to the clusters of the current view
+ *  and uploads the cluster ranges and index lists, along
+ *  with what the fragment shader needs to find its cluster.
+ ***********************************************************/
+void SceneManager::UpdateLightClusters()
+{
+    if (!m_bClusteredLighting || m_lodViewportHeight <= 0.0f)
+    {
+        return;
+    }
+
+    m_lightClusters.Build(m_lodView, m_lodProjection, m_lodViewportWidth, m_lodViewportHeight);
+    const std::vector<LightClusters::RANGE>& ranges = m_lightClusters.GetRanges();
+    const std::vector<uint32_t>& indices = m_lightClusters.GetIndices();
+    UploadLightBuffer(1, LIGHT_CLUSTERS_BINDING, ranges.data(), ranges.size() * sizeof(LightClusters::RANGE));
+    UploadLightBuffer(2, LIGHT_INDICES_BINDING, indices.data(), indices.size() * sizeof(uint32_t));
+
+    // view depth is minus the view space z
+    m_pShaderManager->setVec4Value(g_ClusterScaleName, m_lightClusters.GetScale());
+    m_pShaderManager->setVec4Value(g_ClusterViewDepthName,
+        -glm::vec4(m_lodView[0][2], m_lodView[1][2], m_lodView[2][2], m_lodView[3][2]));
+}
+
+/***********************************************************
+ *  UploadLightBuffer()
+ *
+ *  Writes one of the light storage buffers. The buffer is
+ *  orphaned on every write, so a frame still reading the
+ *  old lists never stalls the upload, and only grows; an
+ *  empty list still gets a buffer to bind.
+ ***********************************************************/
+void SceneManager::UploadLightBuffer(int buffer, GLuint binding, const void* data, size_t size)
+{
+    if (m_lightBuffers[buffer] == 0)
+    {
+        glGenBuffers(1, &m_lightBuffers[buffer]);
+    }
+    GLsizeiptr capacity = std::max(m_lightBufferSizes[buffer], (GLsizeiptr)std::max(size, (size_t)16));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffers[buffer]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    if (size > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)size, data);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_lightBuffers[buffer]);
+    m_lightBufferSizes[buffer] = capacity;
+}
+
+/***********************************************************
+ *  DestroyLightBuffers()
+ *
+ *  Deletes the light storage buffers.
+ ***********************************************************/
+void SceneManager::DestroyLightBuffers()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (m_lightBuffers[i] != 0)
+        {
+            glDeleteBuffers(1, &m_lightBuffers[i]);
+            m_lightBuffers[i] = 0;
+        }
+        m_lightBufferSizes[i] = 0;
+    }
 }
 
 // =====================================================================
@@ -480,8 +2022,7 @@ void SceneManager::SetTransformations(
     glm::mat4 rotationZ   = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0, 0, 1));
     glm::mat4 translation = glm::translate(positionXYZ);
 
-    glm::mat4 modelView = translation * rotationY * rotationX * rotationZ * scale;
-    m_pShaderManager->setMat4Value(g_ModelName, modelView);
+    m_pendingDraw.model = translation * rotationY * rotationX * rotationZ * scale;
 }
 
 // =====================================================================
@@ -551,6 +2092,9 @@ void SceneManager::LoadSceneTextures()
         "../../Utilities/textures/Plastic016A_2K-PNG/Plastic016A_2K-PNG_Roughness.png",
         nullptr,
         "../../Utilities/textures/Plastic016A_2K-PNG/Plastic016A_2K-PNG_Displacement.png");
+
+    // texture creation bound objects behind the state cache's back
+    GLState().Invalidate();
 }
 
 // =====================================================================
@@ -577,7 +2121,275 @@ void SceneManager::PrepareScene(GLFWwindow* window)
 }
 
 // =====================================================================
-//  RenderScene — 1950s American Diner
+//  RenderScene
+//
+//  The scene is static, so it is recorded into the draw list once and
+//  only re-recorded when marked dirty. Each frame the list is sorted
+//  for the current eye position and submitted.
+// =====================================================================
+
+void SceneManager::RenderScene()
+{
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.04f, 0.04f, 0.06f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    SetupLighting();
+
+    if (m_drawListDirty)
+    {
+        m_drawList.Clear();
+        m_culler.Clear();
+        ClearStaticBatches();
+        m_materialRecords.clear();
+        m_materialIndices.clear();
+        RecordScene();
+        UpdateMaterialTable();
+        UpdateShaderVariants();
+        m_drawListDirty = false;
+    }
+
+    // variants that finished building replace the uber-shader
+    // from this frame on
+    if (m_bShaderVariants || m_bDeferredShading)
+    {
+        m_pShaderManager->PollVariants();
+    }
+
+    CullDrawList();
+    UpdateLodLevels();
+    UpdateLightClusters();
+    m_drawList.Sort(m_eyePosition);
+    SubmitDrawList();
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  Returns the object space bounds of a recorded mesh. The
+ *  half shapes use the bounds of the whole shape.
+ ***********************************************************/
+const ShapeMeshes::MESH_BOUNDS& SceneManager::GetMeshBounds(uint8_t mesh) const
+{
+    switch (mesh)
+    {
+    case DrawList::MESH_CONE:             return m_basicMeshes->GetConeBounds();
+    case DrawList::MESH_CYLINDER:         return m_basicMeshes->GetCylinderBounds();
+    case DrawList::MESH_PLANE:            return m_basicMeshes->GetPlaneBounds();
+    case DrawList::MESH_PRISM:            return m_basicMeshes->GetPrismBounds();
+    case DrawList::MESH_PYRAMID3:         return m_basicMeshes->GetPyramid3Bounds();
+    case DrawList::MESH_PYRAMID4:         return m_basicMeshes->GetPyramid4Bounds();
+    case DrawList::MESH_SPHERE:
+    case DrawList::MESH_HALF_SPHERE:      return m_basicMeshes->GetSphereBounds();
+    case DrawList::MESH_TAPERED_CYLINDER: return m_basicMeshes->GetTaperedCylinderBounds();
+    case DrawList::MESH_TORUS:
+    case DrawList::MESH_HALF_TORUS:       return m_basicMeshes->GetTorusBounds();
+    default:                              return m_basicMeshes->GetBoxBounds();
+    }
+}
+
+/***********************************************************
+ *  CullDrawList()
+ *
+ *  Tests the world space box of every item against the view
+ *  frustum, then the survivors against the occluders. The
+ *  boxes, the BVH over them for large lists and the list of
+ *  occluder candidates are rebuilt only when the list was
+ *  recorded again; until a view has been set every item is
+ *  kept.
+ ***********************************************************/
+void SceneManager::CullDrawList()
+{
+    const size_t count = m_drawList.Size();
+    if (m_culler.Size() != count)
+    {
+        m_culler.Clear();
+        m_itemBoxes.resize(count);
+        m_occluderCandidates.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            const DrawList::DRAW_ITEM& item = m_drawList.Item(i);
+            const ShapeMeshes::MESH_BOUNDS& bounds = GetMeshBounds(item.mesh);
+            m_culler.Add(bounds.boxMin, bounds.boxMax, item.model);
+            m_culler.GetBox(i, m_itemBoxes[i].min, m_itemBoxes[i].max);
+
+            // the box mesh fills its bounds, so opaque boxes
+            // can stand in for their own occluder
+            if (item.mesh == DrawList::MESH_BOX && !item.transparent)
+            {
+                m_occluderCandidates.push_back((uint32_t)i);
+            }
+        }
+
+        m_bvh.Build(count >= g_BvhMinItems ? m_itemBoxes : std::vector<SceneBVH::AABB>());
+        m_isOccluder.assign(count, 0);
+    }
+
+    m_visibility.resize(count);
+    m_occludedCount = 0;
+    if (m_lodViewportHeight <= 0.0f)
+    {
+        std::fill(m_visibility.begin(), m_visibility.end(), (uint8_t)1);
+        m_visibleCount = count;
+        return;
+    }
+
+    m_culler.SetViewProjection(m_lodProjection * m_lodView);
+    m_visibleCount = (count >= g_BvhMinItems && m_bvh.Size() == count)
+        ? m_bvh.QueryFrustum(m_culler.GetPlanes(), m_visibility.data())
+        : m_culler.Cull(m_visibility.data());
+
+    if (m_bOcclusionCulling)
+    {
+        OcclusionCullDrawList();
+    }
+}
+
+/***********************************************************
+ *  OcclusionCullDrawList()
+ *
+ *  Draws the candidate boxes that cover the most screen into
+ *  the software depth buffer, then clears the visibility of
+ *  the items in the frustum that are completely behind them.
+ *  The candidates are the opaque boxes of the draw list and
+ *  of the static batches. The occluders themselves are not
+ *  tested.
+ ***********************************************************/
+void SceneManager::OcclusionCullDrawList()
+{
+    m_occlusion.Begin(m_lodProjection * m_lodView);
+
+    m_occluderAreas.clear();
+    for (uint32_t index : m_occluderCandidates)
+    {
+        if (!m_visibility[index])
+        {
+            continue;
+        }
+        float area = m_occlusion.ScreenArea(m_itemBoxes[index].min, m_itemBoxes[index].max);
+        if (area >= m_minOccluderArea)
+        {
+            m_occluderAreas.push_back(std::make_pair(area, index));
+        }
+    }
+    for (size_t i = 0; i < m_staticOccluderBoxes.size(); i++)
+    {
+        float area = m_occlusion.ScreenArea(m_staticOccluderBoxes[i].min, m_staticOccluderBoxes[i].max);
+        if (area >= m_minOccluderArea)
+        {
+            m_occluderAreas.push_back(std::make_pair(area, (uint32_t)i | g_StaticOccluderBit));
+        }
+    }
+
+    const size_t occluderCount = std::min(m_maxOccluders, m_occluderAreas.size());
+    std::partial_sort(m_occluderAreas.begin(), m_occluderAreas.begin() + occluderCount,
+        m_occluderAreas.end(), std::greater<std::pair<float, uint32_t>>());
+
+    const ShapeMeshes::MESH_BOUNDS& boxBounds = GetMeshBounds(DrawList::MESH_BOX);
+    for (size_t i = 0; i < occluderCount; i++)
+    {
+        uint32_t index = m_occluderAreas[i].second;
+        if (index & g_StaticOccluderBit)
+        {
+            m_occlusion.AddOccluder(boxBounds.boxMin, boxBounds.boxMax,
+                                    m_staticOccluderModels[index & ~g_StaticOccluderBit]);
+            continue;
+        }
+        m_occlusion.AddOccluder(boxBounds.boxMin, boxBounds.boxMax, m_drawList.Item(index).model);
+        m_isOccluder[index] = 1;
+    }
+    m_occlusion.Rasterize();
+
+    m_occlusionTests.clear();
+    for (size_t i = 0; i < m_visibility.size(); i++)
+    {
+        if (m_visibility[i] && !m_isOccluder[i])
+        {
+            m_occlusionTests.push_back((uint32_t)i);
+        }
+    }
+    for (size_t i = 0; i < occluderCount; i++)
+    {
+        if (!(m_occluderAreas[i].second & g_StaticOccluderBit))
+        {
+            m_isOccluder[m_occluderAreas[i].second] = 0;
+        }
+    }
+
+    m_occludedCount = m_occlusion.Cull(m_itemBoxes.data(), m_occlusionTests.data(),
+                                       m_occlusionTests.size(), m_visibility.data());
+    m_visibleCount -= m_occludedCount;
+}
+
+/***********************************************************
+ *  SetOccluderSelection()
+ *
+ *  Sets how many of the opaque boxes are drawn as occluders
+ *  each frame and how much of the screen one has to cover.
+ ***********************************************************/
+void SceneManager::SetOccluderSelection(size_t maxOccluders, float minScreenArea)
+{
+    m_maxOccluders = maxOccluders;
+    m_minOccluderArea = minScreenArea;
+}
+
+/***********************************************************
+ *  UpdateLodLevels()
+ *
+ *  Picks the level of detail of every curved mesh item from
+ *  the screen size of its bounding sphere. The flat meshes
+ *  only have one level and are left alone.
+ ***********************************************************/
+void SceneManager::UpdateLodLevels()
+{
+    if (m_lodViewportHeight <= 0.0f)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_drawList.Size(); i++)
+    {
+        const DrawList::DRAW_ITEM& item = m_drawList.Item(i);
+        if (!g_MeshHasLods[item.mesh] || !m_visibility[i])
+        {
+            continue;
+        }
+
+        const ShapeMeshes::MESH_BOUNDS& bounds = GetMeshBounds(item.mesh);
+        float screenSize = ShapeMeshes::ProjectedSize(
+            bounds.sphereCenter, bounds.sphereRadius, item.model,
+            m_lodView, m_lodProjection, m_lodViewportHeight);
+        m_drawList.SetLod(i, (uint8_t)ShapeMeshes::SelectLodLevel(screenSize, item.lod));
+    }
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  Sets the view used to cull, to select the levels of
+ *  detail and to cluster the lights.
+ ***********************************************************/
+void SceneManager::SetViewProjection(const glm::mat4& view, const glm::mat4& projection,
+                                     float viewportWidth, float viewportHeight)
+{
+    m_lodView = view;
+    m_lodProjection = projection;
+    m_lodViewportWidth = viewportWidth;
+    m_lodViewportHeight = viewportHeight;
+}
+
+/***********************************************************
+ *  SetEyePosition()
+ *
+ *  Sets the camera position used to depth sort the items.
+ ***********************************************************/
+void SceneManager::SetEyePosition(const glm::vec3& eyePosition)
+{
+    m_eyePosition = eyePosition;
+}
+
+// =====================================================================
+//  RecordScene — 1950s American Diner
 //
 //  Layout (top-down, camera at +Z looking toward -Z):
 //
@@ -589,13 +2401,13 @@ void SceneManager::PrepareScene(GLFWwindow* window)
 //
 // =====================================================================
 
-void SceneManager::RenderScene()
+void SceneManager::RecordScene()
 {
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.04f, 0.04f, 0.06f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_pendingDraw = DrawList::DRAW_ITEM();
 
-    SetupLighting();
+    // the room, booths and lamps never move - they are merged into
+    // static batches; the props on the tables and walls stay items
+    m_pendingDraw.isStatic = true;
 
     // =================================================================
     // FLOOR — black & white checkerboard
@@ -608,7 +2420,7 @@ void SceneManager::RenderScene()
         20.0f, 30.0f,
         glm::vec3(0.92f, 0.92f, 0.92f),
         glm::vec3(0.06f, 0.06f, 0.06f));
-    m_basicMeshes->DrawPlaneMesh();
+    AddDraw(DrawList::MESH_PLANE);
 
     // =================================================================
     // RUBBER AISLE STRIP — center walkway (PBR rubber on top of floor)
@@ -619,7 +2431,7 @@ void SceneManager::RenderScene()
         glm::vec3(1.0f, 0.01f, 0.0f));
     SetShaderPBR("pbr_rubber");
     SetUVScale(2.0f, 10.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddDraw(DrawList::MESH_BOX);
 
     // =================================================================
     // BACK WALL — light blue (upper) with checkerboard border strip
@@ -632,8 +2444,8 @@ void SceneManager::RenderScene()
         glm::vec3(7.65f, 4.0f, 0.0f));
     SetShaderPBR("pbr_plaster");
     SetUVScale(6.0f, 4.0f);  // tile properly across 30-unit wall
-    m_pShaderManager->setVec3Value("pbrTint", glm::vec3(0.62f, 0.78f, 0.88f));
-    m_basicMeshes->DrawBoxMesh();
+    m_pendingDraw.tint = glm::vec3(0.62f, 0.78f, 0.88f);
+    AddDraw(DrawList::MESH_BOX);
 
     // Checkerboard border strip on wall (slightly proud of wall face)
     SetTransformations(
@@ -643,7 +2455,7 @@ void SceneManager::RenderScene()
     SetShaderCheckerboard(
         60.0f, 2.0f,
         glm::vec3(0.95f), glm::vec3(0.05f));
-    m_basicMeshes->DrawBoxMesh();
+    AddDraw(DrawList::MESH_BOX);
 
     // Checkerboard wall frame — top metal strip (in front of checkerboard)
     SetTransformations(
@@ -652,7 +2464,7 @@ void SceneManager::RenderScene()
         glm::vec3(7.46f, 3.18f, 0.0f));
     SetShaderTexture("stainless");
     SetUVScale(1.0f, 10.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddDraw(DrawList::MESH_BOX);
 
     // Bottom metal strip
     SetTransformations(
@@ -661,7 +2473,7 @@ void SceneManager::RenderScene()
         glm::vec3(7.46f, 2.62f, 0.0f));
     SetShaderTexture("stainless");
     SetUVScale(1.0f, 10.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddDraw(DrawList::MESH_BOX);
 
     // =================================================================
     // CEILING
@@ -671,7 +2483,7 @@ void SceneManager::RenderScene()
         0.0f, 0.0f, 0.0f,
         glm::vec3(0.0f, 8.0f, 0.0f));
     SetShaderColor(0.06f, 0.05f, 0.05f, 1.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddDraw(DrawList::MESH_BOX);
 
     // =================================================================
     // BOOTHS — 5 booth units along the wall
@@ -705,7 +2517,7 @@ void SceneManager::RenderScene()
             glm::vec3(wallBackX, backY, zPos));
         SetShaderPBR("pbr_leather");
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Wall-side seat cushion ---
         SetTransformations(
@@ -714,7 +2526,7 @@ void SceneManager::RenderScene()
             glm::vec3(wallSeatX, seatY, zPos));
         SetShaderPBR("pbr_leather");
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Aisle-side seat cushion ---
         SetTransformations(
@@ -723,7 +2535,7 @@ void SceneManager::RenderScene()
             glm::vec3(aisleSeatX, seatY, zPos));
         SetShaderPBR("pbr_leather");
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Aisle-side bench back (tall, faces the aisle) ---
         SetTransformations(
@@ -732,7 +2544,7 @@ void SceneManager::RenderScene()
             glm::vec3(aisleBackX, backY, zPos));
         SetShaderPBR("pbr_leather");
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Table top (Metal009 PBR) ---
         SetTransformations(
@@ -741,7 +2553,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, tableTopY, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(2.0f, 2.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Chrome edge strip around table top ---
         // Front edge (overlap table by 0.01 to prevent Z-fighting)
@@ -751,7 +2563,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, tableTopY, zPos + 1.31f));
         SetShaderPBR("pbr_metal009");
         SetUVScale(4.0f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
         // Back edge
         SetTransformations(
             glm::vec3(2.08f, 0.08f, 0.04f),
@@ -759,7 +2571,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, tableTopY, zPos - 1.31f));
         SetShaderPBR("pbr_metal009");
         SetUVScale(4.0f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
         // Left edge (aisle side)
         SetTransformations(
             glm::vec3(0.04f, 0.08f, 2.68f),
@@ -767,7 +2579,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX - 1.01f, tableTopY, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(1.0f, 4.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
         // Right edge (wall side)
         SetTransformations(
             glm::vec3(0.04f, 0.08f, 2.68f),
@@ -775,7 +2587,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX + 1.01f, tableTopY, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(1.0f, 4.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // --- Table pedestal (Metal009 cylinder) ---
         SetTransformations(
@@ -784,7 +2596,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, 0.0f, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawCylinderMesh();
+        AddDraw(DrawList::MESH_CYLINDER);
 
         // --- Table base plate (flat Metal009 disc) ---
         SetTransformations(
@@ -793,7 +2605,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, 0.0f, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawCylinderMesh();
+        AddDraw(DrawList::MESH_CYLINDER);
 
         // =============================================================
         // PENDANT LAMP (Metal052A shade & cable, emissive bulb)
@@ -812,7 +2624,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, shadeCenterY, zPos));
         SetShaderPBR("pbr_metal052");
         SetUVScale(2.0f, 2.0f);
-        m_basicMeshes->DrawHalfSphereMesh();
+        AddDraw(DrawList::MESH_HALF_SPHERE);
 
         // ---- CAP (Metal052A) ----
         float capHeight  = 0.12f;
@@ -824,7 +2636,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, capCenterY, zPos));
         SetShaderPBR("pbr_metal052");
         SetUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawHalfSphereMesh();
+        AddDraw(DrawList::MESH_HALF_SPHERE);
 
         // ---- CABLE (Metal052A thin cylinder) ----
         float capTopY    = capCenterY + capHeight;
@@ -836,7 +2648,7 @@ void SceneManager::RenderScene()
             glm::vec3(tableX, capTopY, zPos));
         SetShaderPBR("pbr_metal052");
         SetUVScale(1.0f, 4.0f);
-        m_basicMeshes->DrawCylinderMesh();
+        AddDraw(DrawList::MESH_CYLINDER);
 
         // ---- BULB (emissive — warm glow) ----
         SetTransformations(
@@ -844,12 +2656,14 @@ void SceneManager::RenderScene()
             0.0f, 0.0f, 0.0f,
             glm::vec3(tableX, shadeCenterY - 0.15f, zPos));
         SetShaderEmissive(1.0f, 0.92f, 0.65f, 3.0f);  // warm tungsten glow
-        m_basicMeshes->DrawSphereMesh();
+        AddDraw(DrawList::MESH_SPHERE);
     }
 
     // =================================================================
     // CONDIMENT / NAPKIN HOLDER on each table
     // =================================================================
+    m_pendingDraw.isStatic = false;
+
     for (int i = 0; i < boothCount; ++i)
     {
         float zPos = -((boothCount - 1) * boothSpacing) / 2.0f + i * boothSpacing;
@@ -864,7 +2678,7 @@ void SceneManager::RenderScene()
             glm::vec3(napkinHolderX, napkinHolderY, zPos));
         SetShaderPBR("pbr_metal009");
         SetUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawBoxMesh();
+        AddDraw(DrawList::MESH_BOX);
 
         // ---- Napkins (stack of thin white slabs poking up) ----
         // Several thin boxes inside the holder, slightly fanned
@@ -877,7 +2691,7 @@ void SceneManager::RenderScene()
                 0.0f, 0.0f, (n - 2) * 2.0f,       // slight tilt
                 glm::vec3(napkinHolderX, napkinHolderY + yOffset, zPos + fan));
             SetShaderColor(0.96f, 0.94f, 0.90f, 1.0f);  // off-white napkin
-            m_basicMeshes->DrawBoxMesh();
+            AddDraw(DrawList::MESH_BOX);
         }
 
         // ---- Ketchup bottle (Plastic PBR, red tint) ----
@@ -892,7 +2706,7 @@ void SceneManager::RenderScene()
             glm::vec3(ketchupX, ketchupBaseY, ketchupZ));
         SetShaderPBRTinted("pbr_plastic", glm::vec3(0.85f, 0.08f, 0.05f));
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawCylinderMesh();
+        AddDraw(DrawList::MESH_CYLINDER);
 
         // Ketchup nozzle (tapered cylinder — open top for squeeze opening)
         SetTransformations(
@@ -901,7 +2715,7 @@ void SceneManager::RenderScene()
             glm::vec3(ketchupX, ketchupBaseY + ketchupBodyH, ketchupZ));
         SetShaderPBRTinted("pbr_plastic", glm::vec3(0.85f, 0.08f, 0.05f));
         SetUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawTaperedCylinderMesh(false, false, true);  // sides only, open top
+        AddDraw(DrawList::MESH_TAPERED_CYLINDER, DrawList::PART_SIDES);  // sides only, open top
 
         // ---- Mustard bottle (Plastic PBR, yellow tint) ----
         float mustardX = tableX + 0.3f;
@@ -915,7 +2729,7 @@ void SceneManager::RenderScene()
             glm::vec3(mustardX, mustardBaseY, mustardZ));
         SetShaderPBRTinted("pbr_plastic", glm::vec3(0.9f, 0.75f, 0.05f));
         SetUVScale(1.0f, 2.0f);
-        m_basicMeshes->DrawCylinderMesh();
+        AddDraw(DrawList::MESH_CYLINDER);
 
         // Mustard nozzle (tapered cylinder — open top for squeeze opening)
         SetTransformations(
@@ -924,7 +2738,7 @@ void SceneManager::RenderScene()
             glm::vec3(mustardX, mustardBaseY + mustardBodyH, mustardZ));
         SetShaderPBRTinted("pbr_plastic", glm::vec3(0.9f, 0.75f, 0.05f));
         SetUVScale(1.0f, 1.0f);
-        m_basicMeshes->DrawTaperedCylinderMesh(false, false, true);  // sides only, open top
+        AddDraw(DrawList::MESH_TAPERED_CYLINDER, DrawList::PART_SIDES);  // sides only, open top
     }
 
     // =================================================================
@@ -943,15 +2757,14 @@ void SceneManager::RenderScene()
             glm::vec3(hubcapX, hy, hz));
         SetShaderPBR("pbr_metal009");
         SetUVScale(3.0f, 3.0f);
-        m_basicMeshes->DrawTorusMesh();
+        AddDraw(DrawList::MESH_TORUS);
     }
 
     // =================================================================
     // NEON LIGHT TUBES along the ceiling edge (glass cylinders)
-    // Rendered last for proper alpha blending.
+    // Their alpha marks them transparent, so the draw list submits them
+    // last and back to front for proper alpha blending.
     // =================================================================
-    glDepthMask(GL_FALSE);  // don't write depth for transparent objects
-
     for (int n = -2; n <= 2; ++n)
     {
         float zOffset = n * 6.0f;
@@ -964,10 +2777,8 @@ void SceneManager::RenderScene()
             90.0f, 0.0f, 0.0f,               // rotate to lay along Z
             glm::vec3(7.45f, 7.9f, zOffset - 2.5f));  // centered on zOffset
         SetShaderEmissive(1.0f, 0.12f, 0.08f, 4.0f, 0.55f);  // semi-transparent glass
-        m_basicMeshes->DrawCylinderMesh(false, false, true);   // sides only
+        AddDraw(DrawList::MESH_CYLINDER, DrawList::PART_SIDES);   // sides only
     }
-
-    glDepthMask(GL_TRUE);  // restore depth writes
 }
 
 // =====================================================================
@@ -991,14 +2802,14 @@ void SceneManager::SetProjection(int width, int height)
         projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
     }
 
-    m_pShaderManager->setMat4Value("projection", projection);
+    m_pShaderManager->setMat4Value(g_ProjectionName, projection);
 }
 
 void SceneManager::SetViewMatrix()
 {
     if (!m_pShaderManager) return;
     glm::mat4 view = glm::lookAt(m_cameraPos, m_cameraPos + m_cameraFront, m_cameraUp);
-    m_pShaderManager->setMat4Value("view", view);
+    m_pShaderManager->setMat4Value(g_ViewName, view);
 }
 
 void SceneManager::UpdateProjection(GLFWwindow* window)
@@ -11,10 +11,18 @@
 
 #include "../../../Utilities/ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "DrawList.h"
+#include "FrustumCuller.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "LightClusters.h"
+#include "StreamRingBuffer.h"
+#include "UniformBlockBuffer.h"
 
 #include <string>
 #include <vector>
 #include <map>
+#include <array>
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
 
@@ -24,7 +32,9 @@
 class SceneManager
 {
 public:
-    SceneManager(ShaderManager *pShaderManager);
+    SceneManager(ShaderManager *pShaderManager,
+                 ShapeMeshes::VERTEX_LAYOUT vertexLayout = ShapeMeshes::LAYOUT_FLOAT,
+                 bool bVertexTangents = true);
     ~SceneManager();
 
     struct TEXTURE_INFO
@@ -42,6 +52,7 @@ public:
         GLuint aoID        = 0;
         GLuint heightID    = 0;
         bool   hasHeight   = false;
+        uint16_t index     = 0;     // position in m_pbrSetList
     };
 
     struct OBJECT_MATERIAL
@@ -65,9 +76,202 @@ private:
     // PBR texture sets
     std::map<std::string, PBR_TEXTURE_SET> m_pbrTextures;
 
+    // PBR texture sets by index, for draw items
+    std::vector<const PBR_TEXTURE_SET*> m_pbrSetList;
+
     // Materials
     std::vector<OBJECT_MATERIAL> m_objectMaterials;
 
+    // texture set of a texture-mode item whose tag was not found
+    static const uint16_t NO_TEXTURE_SET = 0xFFF;
+
+    // Retained draw list - recorded once, sorted and submitted per frame
+    DrawList m_drawList;
+    DrawList::DRAW_ITEM m_pendingDraw;
+    DrawList::FRAME_STATS m_drawStats;
+    bool m_drawListDirty = true;
+
+    // PBR items build their TBN from the mesh tangents rather
+    // than from screen-space derivatives
+    bool m_bUseVertexTangents = false;
+    glm::vec3 m_eyePosition = glm::vec3(0.0f, 4.5f, 12.0f);
+
+    // world space boxes of the items, and which of them are in
+    // the view frustum this frame
+    FrustumCuller m_culler;
+
+    std::vector<SceneBVH::AABB> m_itemBoxes;
+
+    // hierarchy over the same boxes, used instead of the linear
+    // test once the list is large enough for it to be faster
+    SceneBVH m_bvh;
+    std::vector<uint8_t> m_visibility;
+    std::vector<uint32_t> m_visibleOrder;
+    size_t m_visibleCount = 0;
+
+    // items in the frustum that are hidden behind the largest
+    // opaque boxes on screen
+    OcclusionCuller m_occlusion;
+    bool m_bOcclusionCulling = true;
+    size_t m_maxOccluders = DEFAULT_MAX_OCCLUDERS;
+    float m_minOccluderArea = DEFAULT_MIN_OCCLUDER_AREA;
+    size_t m_occludedCount = 0;
+    std::vector<uint32_t> m_occluderCandidates;
+    std::vector<std::pair<float, uint32_t>> m_occluderAreas;
+    std::vector<uint8_t> m_isOccluder;
+    std::vector<uint32_t> m_occlusionTests;
+
+    // view used to cull the items, to pick the level of detail
+    // of the curved meshes and to cluster the lights
+    glm::mat4 m_lodView = glm::mat4(1.0f);
+    glm::mat4 m_lodProjection = glm::mat4(1.0f);
+    float m_lodViewportWidth = 0.0f;
+    float m_lodViewportHeight = 0.0f;
+
+    // opaque scenery merged into one pre-transformed batch per
+    // material, drawn without culling ahead of the draw list
+    struct STATIC_GROUP
+    {
+        DrawList::DRAW_ITEM material;   // first item of the group
+        ShapeMeshes::STATIC_BATCH batch;
+        unsigned int items = 0;
+    };
+    std::vector<STATIC_GROUP> m_staticGroups;
+    bool m_bStaticBatching = true;
+
+    // models and world boxes of the static boxes, which stay
+    // occluder candidates after they are merged
+    std::vector<glm::mat4> m_staticOccluderModels;
+    std::vector<SceneBVH::AABB> m_staticOccluderBoxes;
+
+    // submit each run of items that share their uniforms as one
+    // multi-draw indirect call (GL 4.3 and the indirect vertex
+    // shader) instead of instanced and single draws
+    bool m_bIndirectDraw = false;
+
+    // per-draw values of the single draws and static batches,
+    // in the std140 layout of the DrawBlock uniform block
+    struct DRAW_BLOCK
+    {
+        glm::mat4 model;
+        glm::vec4 tint;
+        glm::vec4 uvScale;      // xy used
+    };
+
+    // each frame writes one DRAW_BLOCK per static batch and per
+    // visible item (none for the items of an indirect frame)
+    // to the stream buffer, and every draw binds its range of
+    // it; ShapeMeshes appends its instances and indirect draws
+    bool m_bStreamBuffer = false;
+    StreamRingBuffer m_streamBuffer;
+    GLsizeiptr m_drawBlockStride = 0;
+    GLsizeiptr m_drawBlockAlignment = 0;
+    GLintptr m_drawBlockBase = -1;     // -1 when the frame has no blocks
+
+    // lights of the fragment shader (MAX_LIGHTS there as well)
+    static const int MAX_LIGHTS = 10;
+
+    // camera of the frame and the lights with the hemisphere
+    // environment, in the std140 layout of the FrameBlock and
+    // LightBlock uniform blocks
+    struct FRAME_BLOCK
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPosition;     // xyz used
+    };
+    struct LIGHT_BLOCK
+    {
+        glm::vec4 positions[MAX_LIGHTS];    // xyz position, w intensity
+        glm::vec4 colors[MAX_LIGHTS];       // rgb used
+        glm::vec4 envColorTop;              // rgb color, w intensity
+        glm::vec4 envColorBottom;           // rgb used
+        GLint numLights;
+        GLint padding[3];
+    };
+
+    // the blocks are only uploaded when their values change, and
+    // the lights, which are fixed, only written when marked dirty
+    bool m_bUniformBlocks = false;
+    bool m_bLightsDirty = true;
+    UniformBlockBuffer<FRAME_BLOCK> m_frameBlock;
+    UniformBlockBuffer<LIGHT_BLOCK> m_lightBlock;
+
+    // clustered lighting: every light, the MAX_LIGHTS of the scene
+    // and the extra ones, is listed in the clusters of the froxel
+    // grid it reaches, and the storage buffers hold the lights, the
+    // cluster ranges and the index lists (LIGHT_*_BINDING)
+    bool m_bClusteredLighting = false;
+    size_t m_extraLights = 0;
+    float m_lightCutoff = 0.005f;
+    LightClusters m_lightClusters;
+    GLuint m_lightBuffers[3] = { 0, 0, 0 };
+    GLsizeiptr m_lightBufferSizes[3] = { 0, 0, 0 };
+
+    // records of the material table (MAX_MATERIALS there as well)
+    static const size_t MAX_MATERIALS = 256;
+
+    // shader path and material values of an item, in the std140
+    // layout of a MaterialRecord of the MaterialBlock; only the
+    // values its path reads are filled in
+    struct MATERIAL_RECORD
+    {
+        glm::vec4 color;            // rgb color, PBR tint or emissive color, a alpha
+        glm::vec4 checker1;         // rgb checker color, w emissive strength
+        glm::vec4 checker2;         // rgb checker color, w parallax scale (0 = off)
+        glm::vec4 uvScalePath;      // xy UV scale, z shader path, w texture set
+    };
+    struct MATERIAL_BLOCK
+    {
+        MATERIAL_RECORD records[MAX_MATERIALS];
+    };
+
+    // every distinct material of the recorded items; the items
+    // refer to their records by index, so comparing materials is
+    // an integer compare, and with the table on the records are
+    // uploaded once and a draw only writes its index
+    bool m_bMaterialTable = false;
+    std::vector<MATERIAL_RECORD> m_materialRecords;
+    std::map<std::array<float, 16>, uint16_t> m_materialIndices;
+    UniformBlockBuffer<MATERIAL_BLOCK> m_materialBlock;
+
+    // shader variant of each material record, compiled for its
+    // shader path and parallax when the scene is recorded
+    bool m_bShaderVariants = false;
+    std::vector<size_t> m_materialVariants;
+
+    // deferred shading: the lit opaque items are drawn into the
+    // G-buffer, one full-screen pass lights it, and the emissive
+    // and transparent items are then drawn forward on top. Until
+    // the G-buffer and lighting variants are built the frames are
+    // drawn forward
+    enum RENDER_PASS
+    {
+        PASS_FORWARD,       // every item, lit as it is drawn
+        PASS_GBUFFER,       // the lit opaque items, into the G-buffer
+        PASS_OVERLAY        // the emissive and transparent items
+    };
+    bool m_bDeferredShading = false;
+    bool m_bDeferredFrame = false;
+    RENDER_PASS m_renderPass = PASS_FORWARD;
+    size_t m_gbufferProgram = 0;                // G-buffer uber-shader variant
+    size_t m_lightingProgram = 0;               // full-screen lighting variant
+    std::vector<size_t> m_gbufferVariants;      // G-buffer variant of each material record
+    GLuint m_gbufferFramebuffer = 0;
+    GLuint m_gbufferTextures[4] = { 0, 0, 0, 0 };   // albedo, surface, normal, depth
+    int m_gbufferWidth = 0;
+    int m_gbufferHeight = 0;
+    GLint m_sceneFramebuffer = 0;               // framebuffer the lighting pass draws to
+    GLuint m_fullscreenVertexArray = 0;
+
+    // runs of at least this many compatible items are instanced
+    static const size_t MIN_INSTANCE_BATCH = 2;
+
+    // instance streams of the batch being submitted
+    std::vector<glm::mat4> m_instanceTransforms;
+    std::vector<glm::vec2> m_instanceUVScales;
+    std::vector<glm::vec4> m_instanceTints;
+
     // --- Shader helpers ---
     void SetTransformations(glm::vec3 scaleXYZ,
                             float XrotationDegrees,
@@ -89,6 +293,43 @@ private:
 
     void SetUVScale(float u, float v);
 
+    // --- Draw List ---
+    void RecordScene();
+    void AddDraw(uint8_t mesh, uint8_t parts = DrawList::PART_ALL);
+    void AddStaticDraw(const DrawList::DRAW_ITEM& item);
+    void ClearStaticBatches();
+    void SubmitStaticBatches(int& currentMode, int& currentSet);
+    static bool SameMaterial(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b);
+    void SubmitDrawList();
+    void SubmitItems();
+    bool InRenderPass(const DrawList::DRAW_ITEM& item) const;
+    bool BeginGBufferPass();
+    bool CreateGBuffer(int width, int height);
+    void DestroyGBuffer();
+    void LightGBuffer();
+    void ApplyShaderMode(const DrawList::DRAW_ITEM& item);
+    void BindMaterialTextures(const DrawList::DRAW_ITEM& item);
+    uint16_t InternMaterial(const DrawList::DRAW_ITEM& item, bool bShared);
+    void UpdateMaterialTable();
+    void UpdateShaderVariants();
+    void ApplyItemUniforms(const DrawList::DRAW_ITEM& item);
+    void UpdateLodLevels();
+    void CullDrawList();
+    void OcclusionCullDrawList();
+    const ShapeMeshes::MESH_BOUNDS& GetMeshBounds(uint8_t mesh) const;
+    void DrawMesh(uint8_t mesh, uint8_t parts, uint8_t lod);
+    void DrawMeshInstanced(uint8_t mesh, uint8_t parts, uint8_t lod, size_t count);
+    static bool SameSharedUniforms(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b);
+    static bool CanInstance(const DrawList::DRAW_ITEM& a, const DrawList::DRAW_ITEM& b);
+    static glm::vec4 InstanceTint(const DrawList::DRAW_ITEM& item);
+    void ApplySharedUniforms(const DrawList::DRAW_ITEM& first);
+    void SubmitInstanced(const uint32_t* indices, size_t count);
+    void AddMeshIndirect(const DrawList::DRAW_ITEM& item);
+    size_t SubmitIndirect(const uint32_t* indices, size_t count);
+    void WriteDrawBlocks();
+    static void FillDrawBlock(DRAW_BLOCK& block, const DrawList::DRAW_ITEM& item);
+    bool BindDrawBlock(size_t block);
+
     // --- Single-Image Texture Management ---
     bool CreateGLTexture(const char* filename, std::string tag);
     void BindGLTextures();
@@ -112,6 +353,18 @@ private:
     void SetShaderPBRTinted(const std::string& tag, const glm::vec3& tint);
     void SetupLighting();
 
+    // the lights of the clustered path: the scene lights followed
+    // by the extra lights, scattered through the diner
+    void SetClusteredLights(const glm::vec3 positions[], const glm::vec3 colors[], const float intensities[]);
+
+    // assign the lights to the clusters of this frame's view and
+    // upload the cluster ranges and index lists
+    void UpdateLightClusters();
+
+    // write one of the light storage buffers, growing it as needed
+    void UploadLightBuffer(int buffer, GLuint binding, const void* data, size_t size);
+    void DestroyLightBuffers();
+
     // Camera state
     glm::vec3 m_cameraPos   = glm::vec3(0.0f, 10.0f, 30.0f);
     glm::vec3 m_cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -130,6 +383,118 @@ public:
     void UpdateProjection(GLFWwindow* window);
     void SetViewMatrix();
 
+    // camera position used to depth sort the draw list
+    void SetEyePosition(const glm::vec3& eyePosition);
+
+    // view, projection and viewport size used to cull the
+    // items, to select the level of detail of each item from
+    // its size on screen and to cluster the lights
+    void SetViewProjection(const glm::mat4& view, const glm::mat4& projection,
+                           float viewportWidth, float viewportHeight);
+
+    // default occluder selection: at most this many boxes, each
+    // covering at least this fraction of the screen
+    static const size_t DEFAULT_MAX_OCCLUDERS = 16;
+    static constexpr float DEFAULT_MIN_OCCLUDER_AREA = 0.02f;
+
+    // turn the software occlusion test on or off, and choose
+    // which opaque boxes are drawn as occluders
+    void SetOcclusionCulling(bool bOcclusionCulling) { m_bOcclusionCulling = bOcclusionCulling; }
+    bool GetOcclusionCulling() const { return m_bOcclusionCulling; }
+    void SetOccluderSelection(size_t maxOccluders, float minScreenArea);
+
+    // switch the draw list to multi-draw indirect submission;
+    // needs a GL 4.3 context and the program linked with the
+    // indirect vertex shader
+    void SetIndirectDraw(bool bIndirectDraw);
+    bool GetIndirectDraw() const { return m_bIndirectDraw; }
+
+    // uniform block binding the DrawBlock of the vertex shader
+    // reads from
+    static const GLuint DRAW_BLOCK_BINDING = 0;
+
+    // pass the per-draw values through a ring of per-frame
+    // buffer ranges instead of uniforms; the ring stays mapped
+    // (persistent) when the context has buffer storage and
+    // bPersistent is set, otherwise it is orphaned every frame
+    void SetStreamBuffer(bool bStreamBuffer, bool bPersistent);
+    bool GetStreamBuffer() const { return m_bStreamBuffer; }
+    bool GetStreamPersistent() const { return m_bStreamBuffer && m_streamBuffer.IsPersistent(); }
+    const StreamRingBuffer::FRAME_STATS& GetStreamStats() const { return m_streamBuffer.GetFrameStats(); }
+
+    // uniform block bindings of the FrameBlock and LightBlock
+    static const GLuint FRAME_BLOCK_BINDING = 1;
+    static const GLuint LIGHT_BLOCK_BINDING = 2;
+
+    // read the camera, lights and environment from uniform blocks
+    // uploaded when they change, instead of setting them as
+    // uniforms; the view and projection uniforms are then unused
+    void SetUniformBlocks(bool bUniformBlocks);
+    bool GetUniformBlocks() const { return m_bUniformBlocks; }
+
+    // write the lights again on the next frame
+    void MarkLightsDirty() { m_bLightsDirty = true; }
+
+    // shader storage bindings of the clustered lighting buffers
+    static const GLuint LIGHT_RECORDS_BINDING = 1;
+    static const GLuint LIGHT_CLUSTERS_BINDING = 2;
+    static const GLuint LIGHT_INDICES_BINDING = 3;
+
+    // light the fragments from the lights listed for their cluster
+    // of a froxel grid instead of from all MAX_LIGHTS lights; needs
+    // shader storage buffers (GL 4.3). Each light then ends at the
+    // radius where its attenuation falls to the cutoff
+    void SetClusteredLighting(bool bClusteredLighting);
+    bool GetClusteredLighting() const { return m_bClusteredLighting; }
+    void SetLightCutoff(float cutoff) { m_lightCutoff = cutoff; m_bLightsDirty = true; }
+
+    // add small lights to the scene, only drawn by the clustered
+    // path, to test it with hundreds of lights
+    void SetExtraLights(size_t count) { m_extraLights = count; m_bLightsDirty = true; }
+    const LightClusters& GetLightClusters() const { return m_lightClusters; }
+
+    // uniform block binding of the MaterialBlock
+    static const GLuint MATERIAL_BLOCK_BINDING = 3;
+
+    // read the shader path and material values of each draw from
+    // the material table instead of setting them as uniforms; the
+    // scene is recorded again on the next frame, and falls back to
+    // the uniforms when it has more than MAX_MATERIALS materials
+    void SetMaterialTable(bool bMaterialTable);
+    bool GetMaterialTable() const { return m_bMaterialTable; }
+    size_t GetMaterialCount() const { return m_materialRecords.size(); }
+
+    // draw each material with the shader variant compiled for its
+    // path instead of the uber-shader; the variants are built when
+    // the scene is recorded again on the next frame
+    void SetShaderVariants(bool bShaderVariants);
+    bool GetShaderVariants() const { return m_bShaderVariants; }
+
+    // switch between forward shading and drawing the lit opaque
+    // items into a G-buffer that one full-screen pass lights; can
+    // be switched between frames to compare their frame times.
+    // IsDeferredFrame() tells whether the last frame was deferred
+    void SetDeferredShading(bool bDeferredShading);
+    bool GetDeferredShading() const { return m_bDeferredShading; }
+    bool IsDeferredFrame() const { return m_bDeferredFrame; }
+
+    // merge the items recorded as static into per-material
+    // batches, or keep every item in the draw list; the scene
+    // is recorded again on the next frame
+    void SetStaticBatching(bool bStaticBatching);
+    bool GetStaticBatching() const { return m_bStaticBatching; }
+
+    // counters from the last submitted frame
+    const DrawList::FRAME_STATS& GetDrawStats() const { return m_drawStats; }
+    const OcclusionCuller::FRAME_STATS& GetOcclusionStats() const { return m_occlusion.GetFrameStats(); }
+    const ShapeMeshes::FRAME_STATS& GetMeshStats() const { return m_basicMeshes->GetFrameStats(); }
+    const ShapeMeshes& GetMeshes() const { return *m_basicMeshes; }
+
+    // switch the PBR items between the vertex tangent and the
+    // derivative TBN; needs tangents loaded to turn them on
+    void SetVertexTangents(bool bUseVertexTangents);
+    bool GetVertexTangents() const { return m_bUseVertexTangents; }
+
     void MoveCamera(const glm::vec3& delta);
     void RotateCamera(float xoffset, float yoffset);
     void AdjustSpeed(float yoffset);
@@ -12,6 +12,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+namespace
+{
+    // uniform handles - names are hashed at compile time
+    constexpr Uniform<glm::mat4> g_ViewName("view");
+    constexpr Uniform<glm::mat4> g_ProjectionName("projection");
+    constexpr Uniform<glm::vec3> g_ViewPositionName("viewPos");
+}
+
 //=================================================================
 // Constructor
 //=================================================================
@@ -51,6 +59,19 @@ ViewManager::~ViewManager()
 GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 {
     GLFWwindow* window = glfwCreateWindow(1000, 800, windowTitle, nullptr, nullptr);
+
+#ifndef __APPLE__
+    // drivers without the requested version (Mesa llvmpipe stops at
+    // 4.5) get the newest core context they have, down to 3.3
+    static const int fallbackVersions[][2] = { { 4, 5 }, { 4, 3 }, { 3, 3 } };
+    for (size_t i = 0; !window && i < sizeof(fallbackVersions) / sizeof(fallbackVersions[0]); i++)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, fallbackVersions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, fallbackVersions[i][1]);
+        window = glfwCreateWindow(1000, 800, windowTitle, nullptr, nullptr);
+    }
+#endif
+
     if (!window)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -145,10 +166,18 @@ void ViewManager::UpdateShaderMatrices()
         projection = glm::perspective(glm::radians(m_pCamera->Zoom), aspect, 0.1f, 1000.0f);
     }
 
-    m_pShaderManager->setMat4Value("view", view);
-    m_pShaderManager->setMat4Value("projection", projection);
-    m_pShaderManager->setVec3Value("viewPosition", m_pCamera->Position);
-    m_pShaderManager->setVec3Value("viewPos", m_pCamera->Position);  // PBR lighting needs this
+    m_viewMatrix = view;
+    m_projectionMatrix = projection;
+    m_viewportWidth = static_cast<float>(width);
+    m_viewportHeight = static_cast<float>(height);
+
+    if (!m_bMatrixUniforms)
+    {
+        return;
+    }
+    m_pShaderManager->setMat4Value(g_ViewName, view);
+    m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+    m_pShaderManager->setVec3Value(g_ViewPositionName, m_pCamera->Position);  // PBR lighting needs this
 }
 
 //=================================================================
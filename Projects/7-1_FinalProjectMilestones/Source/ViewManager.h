@@ -36,11 +36,31 @@ public:
     // toggle between perspective and orthographic views
     void ToggleProjection(bool orthographic);
 
+    // current camera position in world space
+    glm::vec3 GetCameraPosition() const { return m_pCamera->Position; }
+
+    // matrices and viewport size of the last prepared view
+    const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+    const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+    float GetViewportWidth() const { return m_viewportWidth; }
+    float GetViewportHeight() const { return m_viewportHeight; }
+
+    // set the view, projection and eye position uniforms each
+    // frame; off when the scene passes them in a uniform block
+    void SetMatrixUniforms(bool bMatrixUniforms) { m_bMatrixUniforms = bMatrixUniforms; }
+
 private:
     ShaderManager* m_pShaderManager; // pointer to shader manager
     GLFWwindow* m_pWindow;           // active OpenGL window
     Camera* m_pCamera;               // camera for 3D navigation
 
+    // last view set on the shaders
+    glm::mat4 m_viewMatrix = glm::mat4(1.0f);
+    glm::mat4 m_projectionMatrix = glm::mat4(1.0f);
+    float m_viewportWidth = 0.0f;
+    float m_viewportHeight = 0.0f;
+    bool m_bMatrixUniforms = true;
+
     // timing
     float mDeltaTime;
     float mLastFrame;
@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////////////
+// BVHBench.cpp
+// ============
+// time the 7-1 scene BVH queries as scenes grow
+//
+// Builds random scenes of 100 to 1,000,000 boxes at a constant density,
+// so a camera with a fixed far plane sees a similar number of boxes in
+// every scene, and prints the build and refit times and the average time
+// of a frustum, ray and sphere query. The frustum and ray queries are
+// also timed as linear scans - the SIMD FrustumCuller the scene uses and
+// a loop over every box - to show where the tree starts to pay off.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // output
+#include <iomanip>          // column formatting
+#include <cstdlib>          // EXIT_SUCCESS
+#include <chrono>           // timing
+#include <random>           // scene generation
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SceneBVH.h"
+#include "FrustumCuller.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// microseconds between two clock readings
+	double Microseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::micro>(end - start).count();
+	}
+
+	// distance to the nearest box along a ray, testing every box
+	float LinearRaycast(const std::vector<SceneBVH::AABB>& boxes,
+		const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+	{
+		const glm::vec3 inverseDirection = 1.0f / direction;
+		float best = maxDistance;
+		for (const SceneBVH::AABB& box : boxes)
+		{
+			glm::vec3 t1 = (box.min - origin) * inverseDirection;
+			glm::vec3 t2 = (box.max - origin) * inverseDirection;
+			glm::vec3 tNear = glm::min(t1, t2);
+			glm::vec3 tFar = glm::max(t1, t2);
+			float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+			float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, best));
+			if (enter <= exit)
+			{
+				best = enter;
+			}
+		}
+		return best;
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Runs the benchmark and prints one line per scene size.
+ ***********************************************************/
+int main()
+{
+	const size_t sceneSizes[] = { 100, 1000, 10000, 100000, 1000000 };
+	const int rayCount = 1000;
+	const int sphereCount = 1000;
+	const float farPlane = 30.0f;
+	const float lightRadius = 4.0f;
+
+	std::cout << "times in microseconds per query unless noted" << std::endl << std::endl;
+	std::cout << std::right
+		<< std::setw(9) << "boxes"
+		<< std::setw(11) << "build ms"
+		<< std::setw(10) << "refit ms"
+		<< std::setw(10) << "visible"
+		<< std::setw(13) << "cull linear"
+		<< std::setw(10) << "cull bvh"
+		<< std::setw(12) << "ray linear"
+		<< std::setw(9) << "ray bvh"
+		<< std::setw(12) << "sphere bvh" << std::endl;
+
+	std::mt19937 random(330);
+	for (size_t boxCount : sceneSizes)
+	{
+		// one box per 8 cubic units
+		const float side = 2.0f * std::cbrt((float)boxCount);
+		std::uniform_real_distribution<float> position(-0.5f * side, 0.5f * side);
+		std::uniform_real_distribution<float> halfSize(0.1f, 1.0f);
+
+		std::vector<SceneBVH::AABB> boxes(boxCount);
+		FrustumCuller culler;
+		for (SceneBVH::AABB& box : boxes)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extent(halfSize(random), halfSize(random), halfSize(random));
+			box.min = center - extent;
+			box.max = center + extent;
+			culler.Add(box.min, box.max, glm::mat4(1.0f));
+		}
+
+		SceneBVH bvh;
+		Clock::time_point start = Clock::now();
+		bvh.Build(boxes);
+		double buildTime = Microseconds(start, Clock::now()) / 1000.0;
+
+		start = Clock::now();
+		bvh.Refit();
+		double refitTime = Microseconds(start, Clock::now()) / 1000.0;
+
+		// camera on the -x face of the scene looking across it
+		const glm::vec3 eye(-0.5f * side - 5.0f, 0.0f, 0.0f);
+		glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, farPlane);
+		culler.SetViewProjection(projection * view);
+
+		// repeat the cheap queries on small scenes for a stable time
+		const int repeats = (int)std::max<size_t>(1, 100000 / boxCount);
+		std::vector<uint8_t> visible(boxCount);
+		size_t linearVisible = 0;
+		start = Clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			linearVisible = culler.Cull(visible.data());
+		}
+		double linearCullTime = Microseconds(start, Clock::now()) / repeats;
+
+		size_t bvhVisible = 0;
+		start = Clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			bvhVisible = bvh.QueryFrustum(culler.GetPlanes(), visible.data());
+		}
+		double bvhCullTime = Microseconds(start, Clock::now()) / repeats;
+
+		if (bvhVisible != linearVisible)
+		{
+			std::cout << "ERROR: the BVH finds " << bvhVisible << " visible boxes, the linear culler "
+				<< linearVisible << std::endl;
+		}
+
+		// rays from the eye into the view
+		std::uniform_real_distribution<float> spread(-0.5f, 0.5f);
+		std::vector<glm::vec3> directions(rayCount);
+		for (glm::vec3& direction : directions)
+		{
+			direction = glm::normalize(glm::vec3(1.0f, spread(random), spread(random)));
+		}
+
+		const int linearRays = (boxCount > 10000) ? 10 : rayCount;
+		float checksum = 0.0f;
+		start = Clock::now();
+		for (int i = 0; i < linearRays; i++)
+		{
+			checksum += LinearRaycast(boxes, eye, directions[i], farPlane);
+		}
+		double linearRayTime = Microseconds(start, Clock::now()) / linearRays;
+
+		start = Clock::now();
+		for (int i = 0; i < rayCount; i++)
+		{
+			SceneBVH::RAY_HIT hit;
+			if (bvh.Raycast(eye, directions[i], farPlane, hit))
+			{
+				checksum -= (i < linearRays) ? hit.distance : 0.0f;
+			}
+			else
+			{
+				checksum -= (i < linearRays) ? farPlane : 0.0f;
+			}
+		}
+		double bvhRayTime = Microseconds(start, Clock::now()) / rayCount;
+
+		if (std::abs(checksum) > 1e-3f * linearRays)
+		{
+			std::cout << "ERROR: BVH and linear ray hits differ" << std::endl;
+		}
+
+		// light sized spheres anywhere in the scene
+		std::vector<uint32_t> items;
+		size_t touched = 0;
+		start = Clock::now();
+		for (int i = 0; i < sphereCount; i++)
+		{
+			items.clear();
+			bvh.QuerySphere(glm::vec3(position(random), position(random), position(random)), lightRadius, items);
+			touched += items.size();
+		}
+		double sphereTime = Microseconds(start, Clock::now()) / sphereCount;
+
+		std::cout << std::fixed
+			<< std::setw(9) << boxCount
+			<< std::setprecision(2)
+			<< std::setw(11) << buildTime
+			<< std::setw(10) << refitTime
+			<< std::setw(10) << bvhVisible
+			<< std::setprecision(1)
+			<< std::setw(13) << linearCullTime
+			<< std::setw(10) << bvhCullTime
+			<< std::setw(12) << linearRayTime
+			<< std::setw(9) << bvhRayTime
+			<< std::setw(12) << sphereTime << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
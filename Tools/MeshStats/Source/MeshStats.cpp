@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshStats.cpp
+// ============
+// print what the mesh optimiser does to every ShapeMeshes primitive
+//
+// Loads each primitive the way the scenes do, at every level of detail,
+// and prints its size with the vertex cache ACMR and ATVR before and after
+// optimisation, then the size of the vertex buffer in both vertex
+// layouts. The meshes are only built in memory, so no window or GL
+// context is needed.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>         // output
+#include <iomanip>          // column formatting
+#include <cstdlib>          // EXIT_SUCCESS
+#include <cstring>          // strcmp
+
+#include "ShapeMeshes.h"
+#include "MeshOptimizer.h"
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Loads the primitives and prints one line per mesh and
+ *  level of detail.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	bool bReorderTriangles = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--keep-order") == 0)
+		{
+			bReorderTriangles = false;
+		}
+		else
+		{
+			std::cout << "usage: " << argv[0] << " [--keep-order]" << std::endl
+				<< "  --keep-order  only renumber the vertices, as scenes with" << std::endl
+				<< "                unsorted translucent meshes load them" << std::endl;
+			return EXIT_SUCCESS;
+		}
+	}
+
+	ShapeMeshes meshes;
+	meshes.SetTriangleReordering(bReorderTriangles);
+	meshes.LoadBoxMesh();
+	meshes.LoadConeMesh();
+	meshes.LoadCylinderMesh();
+	meshes.LoadPlaneMesh();
+	meshes.LoadPrismMesh();
+	meshes.LoadPyramid3Mesh();
+	meshes.LoadPyramid4Mesh();
+	meshes.LoadSphereMesh();
+	meshes.LoadTaperedCylinderMesh();
+	meshes.LoadTorusMesh();
+
+	std::cout << "vertex cache: " << MeshOptimizer::ANALYZE_CACHE_SIZE
+		<< " entry FIFO" << std::endl << std::endl;
+	std::cout << std::left << std::setw(18) << "mesh"
+		<< std::right << std::setw(4) << "lod"
+		<< std::setw(8) << "verts"
+		<< std::setw(8) << "tris"
+		<< std::setw(13) << "ACMR before"
+		<< std::setw(8) << "after"
+		<< std::setw(13) << "ATVR before"
+		<< std::setw(8) << "after" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (const ShapeMeshes::MESH_REPORT& report : meshes.GetMeshReports())
+	{
+		std::cout << std::left << std::setw(18) << report.name
+			<< std::right << std::setw(4) << report.lodLevel
+			<< std::setw(8) << report.nVertices
+			<< std::setw(8) << report.nTriangles
+			<< std::setw(13) << report.stats.before.acmr
+			<< std::setw(8) << report.stats.after.acmr
+			<< std::setw(13) << report.stats.before.atvr
+			<< std::setw(8) << report.stats.after.atvr << std::endl;
+	}
+
+	std::cout << std::endl << "vertex buffer: "
+		<< meshes.GetVertexBufferBytes(ShapeMeshes::LAYOUT_FLOAT) / 1024 << " KB float, "
+		<< meshes.GetVertexBufferBytes(ShapeMeshes::LAYOUT_PACKED) / 1024 << " KB packed" << std::endl;
+
+	return EXIT_SUCCESS;
+}
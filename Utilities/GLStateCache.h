@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLStateCache.h
+// ==============
+// shadow copy of the GL binding state that filters redundant calls
+//
+// Tracks the current program, vertex array, active texture unit and the
+// 2D texture bound to each unit. A bind that would not change GL state is
+// dropped and counted, so the number of elided calls can be compared with
+// the number actually issued to the driver.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    // per-frame counters of state changes sent to / filtered from the driver
+    struct FRAME_STATS
+    {
+        unsigned int issued = 0;
+        unsigned int elided = 0;
+    };
+
+    GLStateCache() { Invalidate(); }
+
+    // forget everything; call after any code changed bindings directly
+    inline void Invalidate()
+    {
+        m_program = INVALID;
+        m_vertexArray = INVALID;
+        m_activeUnit = INVALID;
+        for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+        {
+            m_textures[i] = INVALID;
+        }
+    }
+
+    inline void UseProgram(GLuint program)
+    {
+        if (m_program == program)
+        {
+            m_frameStats.elided++;
+            return;
+        }
+        glUseProgram(program);
+        m_program = program;
+        m_frameStats.issued++;
+    }
+
+    inline void BindVertexArray(GLuint vertexArray)
+    {
+        if (m_vertexArray == vertexArray)
+        {
+            m_frameStats.elided++;
+            return;
+        }
+        glBindVertexArray(vertexArray);
+        m_vertexArray = vertexArray;
+        m_frameStats.issued++;
+    }
+
+    inline void ActiveTexture(int unit)
+    {
+        if (m_activeUnit == (GLuint)unit)
+        {
+            m_frameStats.elided++;
+            return;
+        }
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_activeUnit = (GLuint)unit;
+        m_frameStats.issued++;
+    }
+
+    // bind a 2D texture to the given unit, selecting the unit only
+    // when the binding actually has to change
+    inline void BindTexture2D(int unit, GLuint texture)
+    {
+        if (unit < 0 || unit >= MAX_TEXTURE_UNITS)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            m_activeUnit = (GLuint)unit;
+            m_frameStats.issued += 2;
+            return;
+        }
+        if (m_textures[unit] == texture)
+        {
+            m_frameStats.elided++;
+            return;
+        }
+        ActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        m_textures[unit] = texture;
+        m_frameStats.issued++;
+    }
+
+    // GL state that is known to be current
+    inline GLuint CurrentProgram() const { return m_program; }
+    inline GLuint CurrentVertexArray() const { return m_vertexArray; }
+
+    inline void ResetFrameStats() { m_frameStats = FRAME_STATS(); }
+    inline const FRAME_STATS& GetFrameStats() const { return m_frameStats; }
+
+private:
+    // never a valid object name, so the first bind is always issued
+    static const GLuint INVALID = 0xFFFFFFFFu;
+
+    GLuint m_program;
+    GLuint m_vertexArray;
+    GLuint m_activeUnit;
+    GLuint m_textures[MAX_TEXTURE_UNITS];
+    FRAME_STATS m_frameStats;
+};
+
+// process-wide state cache shared by the shader, mesh and scene code
+inline GLStateCache& GLState()
+{
+    static GLStateCache s_state;
+    return s_state;
+}
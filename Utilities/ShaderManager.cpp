@@ -12,8 +12,66 @@ using namespace std;
 
 #include <GL/glew.h>
 
+#include <chrono>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 #include "ShaderManager.h"
 
+namespace
+{
+	// copy of a shader source with a "#define" line for each of the
+	// given "NAME value" strings after the #version line; the #line
+	// directive keeps the line numbers of compile errors unchanged
+	std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines)
+	{
+		size_t version = source.find("#version");
+		size_t lineEnd = (version == std::string::npos) ? std::string::npos : source.find('\n', version);
+		if (lineEnd == std::string::npos || defines.empty())
+		{
+			return source;
+		}
+
+		std::string injected = source.substr(0, lineEnd + 1);
+		for (const std::string& define : defines)
+		{
+			injected += "#define " + define + "\n";
+		}
+		int versionLine = (int)std::count(source.begin(), source.begin() + version, '\n') + 1;
+		injected += "#line " + std::to_string(versionLine + 1) + "\n";
+		injected += source.substr(lineEnd + 1);
+		return injected;
+	}
+
+	// FNV-1a over the bytes of a string and its terminator, so the
+	// key of "ab" + "c" differs from "a" + "bc"
+	uint64_t HashText(uint64_t hash, const char* text)
+	{
+		const char* bytes = text ? text : "";
+		do
+		{
+			hash ^= (uint64_t)(unsigned char)(*bytes);
+			hash *= 1099511628211ULL;
+		} while (*bytes++);
+		return hash;
+	}
+
+	// header of a program cache file, followed by the binary
+	struct PROGRAM_CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t format;        // driver binary format
+		uint64_t key;
+		uint32_t length;        // bytes of binary that follow
+		uint32_t reserved;
+	};
+
+	const uint32_t PROGRAM_CACHE_MAGIC = 0x31425047;   // "GPB1"
+}
+
 /***********************************************************
  *  LoadShaders()
  *
@@ -22,10 +80,6 @@ using namespace std;
  ***********************************************************/
 GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
 	// Read the Vertex Shader code from the file
 	std::string VertexShaderCode;
 	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
@@ -50,70 +104,1165 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		FragmentShaderStream.close();
 	}
 
+	m_vertexSource = VertexShaderCode;
+	m_fragmentSource = FragmentShaderCode;
+	m_programCacheFiles = HashText(HashText(14695981039346656037ULL, vertex_file_path), fragment_file_path);
+
+	// the program is variant 0; variants of the previous
+	// sources are dropped once they finish building
+	WaitForVariants();
+	for (size_t variant = 1; variant < m_programs.size(); variant++)
+	{
+		glDeleteProgram(m_programs[variant].id);
+	}
+	m_programs.assign(1, PROGRAM());
+	m_activeProgram = 0;
+	m_uniformHistory.clear();
+	m_historyIndex.clear();
+	m_blockBindings.clear();
+
+	// Compile and link the program, or load it from the program
+	// cache, before returning; the uniform location table is built
+	// once for the linked program
+	printf("Building shader program : %s, %s...", vertex_file_path, fragment_file_path);
+	BuildVariant(0, false);
+	PROGRAM& program = m_programs[0];
+	printf("%s\n", program.id == 0 ? "failed" : program.fromCache ? "loaded from the program cache" : "success");
+	m_programID = program.id;
+	ReportMissingUniforms();
+
+	return program.id;
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method compiles and links a program from source
+ *  text without printing progress. The compile or link log
+ *  is printed when either fails, and 0 is returned.
+ ***********************************************************/
+GLuint ShaderManager::BuildProgram(const std::string& vertexCode, const std::string& fragmentCode) const
+{
+	GLuint shaders[2] = { 0, 0 };
+	GLuint ProgramID = StartProgram(vertexCode, fragmentCode, shaders);
+	return FinishProgram(ProgramID, shaders);
+}
+
+/***********************************************************
+ *  StartProgram()
+ *
+ *  This method issues the compile of both shaders and the
+ *  link of the program without querying either result, so
+ *  a driver with parallel shader compilation keeps working
+ *  on them while the caller continues.
+ ***********************************************************/
+GLuint ShaderManager::StartProgram(const std::string& vertexCode, const std::string& fragmentCode, GLuint shaders[2]) const
+{
+	const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const std::string* sources[2] = { &vertexCode, &fragmentCode };
+
+	GLuint ProgramID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		char const * SourcePointer = sources[i]->c_str();
+		glShaderSource(shaders[i], 1, &SourcePointer, NULL);
+		glCompileShader(shaders[i]);
+		glAttachShader(ProgramID, shaders[i]);
+	}
+	if (!m_programCacheDirectory.empty())
+	{
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(ProgramID);
+	return ProgramID;
+}
+
+/***********************************************************
+ *  FinishProgram()
+ *
+ *  This method waits for the program started by
+ *  StartProgram() and releases its shaders. The log of the
+ *  first step that failed is printed, and 0 is returned.
+ ***********************************************************/
+GLuint ShaderManager::FinishProgram(GLuint ProgramID, GLuint shaders[2]) const
+{
 	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	int InfoLogLength = 0;
+	bool bCompiled = true;
+
+	for (int i = 0; i < 2; i++)
+	{
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &Result);
+		if (Result != GL_TRUE)
+		{
+			glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &InfoLogLength);
+			std::vector<char> ErrorMessage(InfoLogLength + 1);
+			glGetShaderInfoLog(shaders[i], InfoLogLength, NULL, &ErrorMessage[0]);
+			printf("%s\n", &ErrorMessage[0]);
+			bCompiled = false;
+		}
+	}
+
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	if (bCompiled && Result != GL_TRUE)
+	{
+		glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		std::vector<char> ErrorMessage(InfoLogLength + 1);
+		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ErrorMessage[0]);
+		printf("%s\n", &ErrorMessage[0]);
+	}
+
+	glDetachShader(ProgramID, shaders[0]);
+	glDetachShader(ProgramID, shaders[1]);
+	glDeleteShader(shaders[0]);
+	glDeleteShader(shaders[1]);
+	shaders[0] = shaders[1] = 0;
+
+	if (!bCompiled || Result != GL_TRUE)
+	{
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+	return ProgramID;
+}
+
+/***********************************************************
+ *  BuildVariant()
+ *
+ *  This method builds the program of a variant from the
+ *  loaded sources with its defines, loading it from the
+ *  program cache when that holds a binary of the same
+ *  sources for this driver. Otherwise the program is
+ *  compiled, right away or, with bAsync, in the compile
+ *  mode, in which case PollVariants() finishes it.
+ ***********************************************************/
+void ShaderManager::BuildVariant(size_t variant, bool bAsync)
+{
+	PROGRAM& program = m_programs[variant];
+	program.started = std::chrono::steady_clock::now();
+	std::string vertexCode = InjectDefines(m_vertexSource, program.defines);
+	std::string fragmentCode = InjectDefines(m_fragmentSource, program.defines);
+
+	program.cacheKey = ProgramCacheKey(vertexCode, fragmentCode);
+	program.cacheSlot = ProgramCacheSlot(program.defines);
+	GLuint ProgramID = LoadCachedProgram(program.cacheSlot, program.cacheKey);
+	if (ProgramID != 0)
+	{
+		program.fromCache = true;
+		FinishVariant(variant, ProgramID);
+	}
+	else if (!bAsync || m_compileMode == COMPILE_SERIAL)
+	{
+		FinishVariant(variant, BuildProgram(vertexCode, fragmentCode));
+	}
+	else if (m_compileMode == COMPILE_PARALLEL)
+	{
+		program.id = StartProgram(vertexCode, fragmentCode, program.shaders);
+		program.state = PROGRAM::BUILDING;
+		m_pendingVariants++;
+	}
+	else
+	{
+		program.state = PROGRAM::BUILDING;
+		m_pendingVariants++;
+		std::lock_guard<std::mutex> lock(m_compileMutex);
+		m_compileJobs.push_back({ variant, std::move(vertexCode), std::move(fragmentCode), 0 });
+		m_compileQueued.notify_one();
+	}
+
+	// only the time the caller waited counts towards the startup
+	m_cacheStats.buildMs += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - program.started).count();
+}
+
+/***********************************************************
+ *  FinishVariant()
+ *
+ *  This method stores the built program of a variant,
+ *  saving its binary to the program cache, binding its
+ *  uniform blocks like those of the other variants and
+ *  reflecting its uniforms. A variant without a program is
+ *  marked failed and drawn with the default program.
+ ***********************************************************/
+void ShaderManager::FinishVariant(size_t variant, GLuint ProgramID)
+{
+	PROGRAM& program = m_programs[variant];
+	program.id = ProgramID;
+	program.buildMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - program.started).count();
+	if (!program.fromCache)
+	{
+		m_cacheStats.compiled++;
+	}
+
+	if (ProgramID == 0)
+	{
+		program.state = PROGRAM::FAILED;
+		if (variant > 0)
+		{
+			printf("WARNING: shader variant failed to build, using the default program\n");
+		}
+		return;
+	}
+
+	if (!program.fromCache)
+	{
+		SaveCachedProgram(ProgramID, program.cacheSlot, program.cacheKey);
+	}
+	for (const BLOCK_BINDING& binding : m_blockBindings)
+	{
+		ApplyBlockBinding(ProgramID, binding);
+	}
+	CacheActiveUniforms(program);
+	program.state = PROGRAM::READY;
+}
+
+/***********************************************************
+ *  SetCompileMode()
+ *
+ *  This method chooses how AddVariant builds programs. The
+ *  driver's own compile threads are preferred; without
+ *  them a worker thread compiles on a shared context.
+ ***********************************************************/
+ShaderManager::COMPILE_MODE ShaderManager::SetCompileMode(COMPILE_MODE mode, std::function<void(bool)> workerContext)
+{
+	StopCompileWorker();
+	WaitForVariants();
+	m_compileMode = COMPILE_SERIAL;
+
+	if (mode == COMPILE_PARALLEL)
+	{
+		// let the driver pick the number of compile threads
+		if (GLEW_KHR_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			m_compileMode = COMPILE_PARALLEL;
+			return m_compileMode;
+		}
+		if (GLEW_ARB_parallel_shader_compile)
+		{
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			m_compileMode = COMPILE_PARALLEL;
+			return m_compileMode;
+		}
+		mode = COMPILE_WORKER;
+	}
+
+	if (mode == COMPILE_WORKER && workerContext)
+	{
+		m_bStopCompileWorker = false;
+		m_compileThread = std::thread(&ShaderManager::CompileWorker, this, workerContext);
+		m_compileMode = COMPILE_WORKER;
+	}
+	return m_compileMode;
+}
+
+/***********************************************************
+ *  CompileWorker()
+ *
+ *  This method runs on the compile thread. It builds the
+ *  queued programs on its own context, which shares
+ *  objects with the main one, until it is stopped with the
+ *  queue empty.
+ ***********************************************************/
+void ShaderManager::CompileWorker(std::function<void(bool)> workerContext)
+{
+	workerContext(true);
+
+	std::unique_lock<std::mutex> lock(m_compileMutex);
+	while (true)
+	{
+		m_compileQueued.wait(lock, [this] { return m_bStopCompileWorker || !m_compileJobs.empty(); });
+		if (m_compileJobs.empty())
+		{
+			break;
+		}
 
+		COMPILE_JOB job = std::move(m_compileJobs.front());
+		m_compileJobs.pop_front();
+		lock.unlock();
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s...", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+		job.program = BuildProgram(job.vertexCode, job.fragmentCode);
+		// the main context may only use the program once the
+		// commands that built it have completed
+		glFinish();
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("\n%s\n", &VertexShaderErrorMessage[0]);
+		lock.lock();
+		m_compiledJobs.push_back(std::move(job));
+		m_compileDone.notify_one();
 	}
+	lock.unlock();
 
-	printf("success\n");
+	workerContext(false);
+}
+
+/***********************************************************
+ *  StopCompileWorker()
+ *
+ *  This method lets the compile thread build what it was
+ *  given, ends it and finishes those variants.
+ ***********************************************************/
+void ShaderManager::StopCompileWorker()
+{
+	if (!m_compileThread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_compileMutex);
+		m_bStopCompileWorker = true;
+	}
+	m_compileQueued.notify_one();
+	m_compileThread.join();
+	CollectVariants(false);
+	m_compileMode = COMPILE_SERIAL;
+}
+
+/***********************************************************
+ *  ~ShaderManager()
+ ***********************************************************/
+ShaderManager::~ShaderManager()
+{
+	StopCompileWorker();
+}
+
+/***********************************************************
+ *  PollVariants()
+ *
+ *  This method finishes the variants whose build completed
+ *  since the last call, without waiting for the others.
+ ***********************************************************/
+size_t ShaderManager::PollVariants()
+{
+	return CollectVariants(false);
+}
+
+/***********************************************************
+ *  WaitForVariants()
+ *
+ *  This method finishes every variant still building.
+ ***********************************************************/
+void ShaderManager::WaitForVariants()
+{
+	while (CollectVariants(true) > 0)
+	{
+	}
+}
+
+/***********************************************************
+ *  CollectVariants()
+ *
+ *  This method finishes the programs handed back by the
+ *  compile worker and, in COMPILE_PARALLEL, those whose
+ *  link the driver reports complete. With bWait it waits
+ *  for the next worker program, or for every link.
+ ***********************************************************/
+size_t ShaderManager::CollectVariants(bool bWait)
+{
+	std::vector<COMPILE_JOB> compiled;
+	{
+		std::unique_lock<std::mutex> lock(m_compileMutex);
+		if (bWait && m_pendingVariants > 0 && m_compileMode == COMPILE_WORKER)
+		{
+			m_compileDone.wait(lock, [this] { return !m_compiledJobs.empty(); });
+		}
+		compiled.swap(m_compiledJobs);
+	}
+	for (const COMPILE_JOB& job : compiled)
+	{
+		FinishVariant(job.variant, job.program);
+	}
+
+	size_t pending = 0;
+	for (size_t variant = 0; variant < m_programs.size(); variant++)
+	{
+		PROGRAM& program = m_programs[variant];
+		if (program.state != PROGRAM::BUILDING)
+		{
+			continue;
+		}
+
+		if (program.shaders[0] != 0)
+		{
+			GLint complete = GL_TRUE;
+			if (!bWait)
+			{
+				glGetProgramiv(program.id, GL_COMPLETION_STATUS_KHR, &complete);
+			}
+			if (complete == GL_TRUE)
+			{
+				FinishVariant(variant, FinishProgram(program.id, program.shaders));
+				continue;
+			}
+		}
+		pending++;
+	}
+	m_pendingVariants = pending;
+	return pending;
+}
+
+/***********************************************************
+ *  SetProgramCache()
+ *
+ *  This method sets the directory of the program cache,
+ *  which is only used when the driver can return program
+ *  binaries in at least one format.
+ ***********************************************************/
+bool ShaderManager::SetProgramCache(const std::string& directory)
+{
+	m_programCacheDirectory.clear();
+	if (directory.empty() || !GLEW_ARB_get_program_binary)
+	{
+		return false;
+	}
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0)
+	{
+		return false;
+	}
+	m_programCacheDirectory = directory;
+	return true;
+}
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s...", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+/***********************************************************
+ *  ProgramCacheKey()
+ *
+ *  This method hashes the final source text of a program,
+ *  which includes its defines, with the vendor, renderer
+ *  and version strings of the driver, so a driver update
+ *  never loads a binary built by the previous one.
+ ***********************************************************/
+uint64_t ShaderManager::ProgramCacheKey(const std::string& vertexCode, const std::string& fragmentCode) const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = HashText(hash, vertexCode.c_str());
+	hash = HashText(hash, fragmentCode.c_str());
+	hash = HashText(hash, (const char*)glGetString(GL_VENDOR));
+	hash = HashText(hash, (const char*)glGetString(GL_RENDERER));
+	hash = HashText(hash, (const char*)glGetString(GL_VERSION));
+	hash = HashText(hash, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+	return hash;
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("\n%s\n", &FragmentShaderErrorMessage[0]);
+/***********************************************************
+ *  ProgramCacheSlot()
+ *
+ *  This method hashes the shader file names with the
+ *  defines of a variant. Unlike the key, the slot stays the
+ *  same when the sources or the driver change, so the
+ *  rebuilt binary replaces the stale one instead of adding
+ *  a file to the cache.
+ ***********************************************************/
+uint64_t ShaderManager::ProgramCacheSlot(const std::vector<std::string>& defines) const
+{
+	uint64_t hash = m_programCacheFiles;
+	for (const std::string& define : defines)
+	{
+		hash = HashText(hash, define.c_str());
 	}
+	return hash;
+}
 
-	printf("success\n");
+/***********************************************************
+ *  ProgramCachePath()
+ *
+ *  This method returns the cache file of a program slot.
+ ***********************************************************/
+std::string ShaderManager::ProgramCachePath(uint64_t slot) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)slot);
+	return m_programCacheDirectory + "/" + name;
+}
+
+/***********************************************************
+ *  LoadCachedProgram()
+ *
+ *  This method creates a program from the cached binary of
+ *  a slot when it was stored for the same key. It returns 0
+ *  when there is no valid cache file, when the file holds a
+ *  stale key or when the driver rejects the binary, so the
+ *  caller falls back to compiling the sources.
+ ***********************************************************/
+GLuint ShaderManager::LoadCachedProgram(uint64_t slot, uint64_t key)
+{
+	if (m_programCacheDirectory.empty())
+	{
+		return 0;
+	}
+
+	std::ifstream file(ProgramCachePath(slot), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return 0;
+	}
+
+	PROGRAM_CACHE_HEADER header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != PROGRAM_CACHE_MAGIC || header.key != key || header.length == 0)
+	{
+		m_cacheStats.rejected++;
+		return 0;
+	}
+
+	std::vector<char> binary(header.length);
+	file.read(&binary[0], header.length);
+	if (!file)
+	{
+		m_cacheStats.rejected++;
+		return 0;
+	}
 
-	// Link the program
-	printf("Linking shader program...");
 	GLuint ProgramID = glCreateProgram();
-	m_programID = ProgramID;
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
+	glProgramBinary(ProgramID, (GLenum)header.format, &binary[0], (GLsizei)header.length);
 
-	// Check the program
+	GLint Result = GL_FALSE;
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 1 ){
-		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-		printf("\n%s\n", &ProgramErrorMessage[0]);
+	if (Result != GL_TRUE)
+	{
+		glDeleteProgram(ProgramID);
+		m_cacheStats.rejected++;
+		return 0;
 	}
 
-	printf("success\n");
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
-
+	m_cacheStats.loaded++;
 	return ProgramID;
 }
 
+/***********************************************************
+ *  SaveCachedProgram()
+ *
+ *  This method writes the binary of a linked program with
+ *  its key to the cache file of its slot, replacing a stale
+ *  or rejected one.
+ ***********************************************************/
+void ShaderManager::SaveCachedProgram(GLuint program, uint64_t slot, uint64_t key)
+{
+	if (m_programCacheDirectory.empty())
+	{
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0)
+	{
+		return;
+	}
+
+	// a single directory level; it usually exists already
+#ifdef _WIN32
+	_mkdir(m_programCacheDirectory.c_str());
+#else
+	mkdir(m_programCacheDirectory.c_str(), 0755);
+#endif
+	std::ofstream file(ProgramCachePath(slot), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	PROGRAM_CACHE_HEADER header = { PROGRAM_CACHE_MAGIC, (uint32_t)format, key, (uint32_t)written, 0 };
+	file.write((const char*)&header, sizeof(header));
+	file.write(&binary[0], written);
+	if (file)
+	{
+		m_cacheStats.saved++;
+	}
+}
+
+/***********************************************************
+ *  AddVariant()
+ *
+ *  This method builds a variant of the loaded sources with
+ *  the given defines, binds its uniform blocks like those
+ *  of the other variants and reflects its uniforms.
+ ***********************************************************/
+size_t ShaderManager::AddVariant(const std::vector<std::string>& defines)
+{
+	for (size_t variant = 0; variant < m_programs.size(); variant++)
+	{
+		if (m_programs[variant].defines == defines)
+		{
+			return variant;
+		}
+	}
+	if (m_vertexSource.empty())
+	{
+		return 0;
+	}
+
+	if (m_programs.size() == 1)
+	{
+		StartUniformHistory();
+	}
+	m_programs.push_back(PROGRAM());
+	size_t variant = m_programs.size() - 1;
+	m_programs[variant].defines = defines;
+	BuildVariant(variant, true);
+	if (m_programs[variant].state == PROGRAM::FAILED)
+	{
+		m_programs.pop_back();
+		if (m_programs.size() == 1)
+		{
+			m_uniformHistory.clear();
+			m_historyIndex.clear();
+		}
+		return 0;
+	}
+	return variant;
+}
+
+/***********************************************************
+ *  UseVariant()
+ *
+ *  This method binds the program of a variant and writes
+ *  the uniforms whose last value it has not seen.
+ ***********************************************************/
+void ShaderManager::UseVariant(size_t variant, size_t fallback)
+{
+	if (variant >= m_programs.size())
+	{
+		return;
+	}
+	if (m_programs[variant].state != PROGRAM::READY)
+	{
+		m_frameStats.variantFallbacks++;
+		variant = IsVariantReady(fallback) ? fallback : 0;
+	}
+	if (variant == m_activeProgram)
+	{
+		return;
+	}
+
+	m_activeProgram = variant;
+	m_programID = m_programs[variant].id;
+	use();
+	m_frameStats.variantSwitches++;
+	SyncUniforms();
+}
+
+/***********************************************************
+ *  IsVariantReady()
+ *
+ *  This method returns whether a variant has been built
+ *  and can be drawn with.
+ ***********************************************************/
+bool ShaderManager::IsVariantReady(size_t variant) const
+{
+	return variant < m_programs.size() && m_programs[variant].state == PROGRAM::READY;
+}
+
+/***********************************************************
+ *  StartUniformHistory()
+ *
+ *  This method fills the uniform history from the values
+ *  written to the default program while it was the only
+ *  one. Values written before then to uniforms the default
+ *  program does not use were dropped by GL and are not
+ *  known here.
+ ***********************************************************/
+void ShaderManager::StartUniformHistory()
+{
+	m_uniformHistory.clear();
+	m_historyIndex.clear();
+	for (const UNIFORM_SHADOW& shadow : m_programs[0].uniformValues)
+	{
+		if (shadow.valid)
+		{
+			RecordUniform(shadow.hash, shadow.kind, shadow.bytes, shadow.size);
+		}
+	}
+}
+
+/***********************************************************
+ *  SyncUniforms()
+ *
+ *  This method replays the last value written to each
+ *  uniform into the active variant. Values the variant
+ *  already holds, and uniforms it does not use, are skipped.
+ ***********************************************************/
+void ShaderManager::SyncUniforms()
+{
+	PROGRAM& program = Active();
+	for (const UNIFORM_VALUE& value : m_uniformHistory)
+	{
+		GLint location = -1;
+		if (!program.uniformTable.Find(value.hash, location) || location < 0 ||
+			(size_t)location >= program.uniformValues.size())
+		{
+			continue;
+		}
+
+		UNIFORM_SHADOW& shadow = program.uniformValues[location];
+		if (shadow.valid && memcmp(shadow.bytes, value.bytes, value.size) == 0)
+		{
+			continue;
+		}
+		memcpy(shadow.bytes, value.bytes, value.size);
+		shadow.valid = true;
+		shadow.kind = value.kind;
+		shadow.size = (uint8_t)value.size;
+		shadow.hash = value.hash;
+		IssueUniform(location, value.kind, value.bytes);
+		m_frameStats.uniformsSynced++;
+	}
+}
+
+/***********************************************************
+ *  IssueUniform()
+ *
+ *  This method sends a value of the given kind to a uniform
+ *  location of the bound program.
+ ***********************************************************/
+void ShaderManager::IssueUniform(GLint location, UNIFORM_KIND kind, const void* value)
+{
+	switch (kind)
+	{
+	case KIND_INT:   glUniform1iv(location, 1, (const GLint*)value); break;
+	case KIND_FLOAT: glUniform1fv(location, 1, (const GLfloat*)value); break;
+	case KIND_VEC2:  glUniform2fv(location, 1, (const GLfloat*)value); break;
+	case KIND_VEC3:  glUniform3fv(location, 1, (const GLfloat*)value); break;
+	case KIND_VEC4:  glUniform4fv(location, 1, (const GLfloat*)value); break;
+	case KIND_MAT2:  glUniformMatrix2fv(location, 1, GL_FALSE, (const GLfloat*)value); break;
+	case KIND_MAT3:  glUniformMatrix3fv(location, 1, GL_FALSE, (const GLfloat*)value); break;
+	case KIND_MAT4:  glUniformMatrix4fv(location, 1, GL_FALSE, (const GLfloat*)value); break;
+	}
+}
+
+/***********************************************************
+ *  ReportVariants()
+ *
+ *  This method prints one line per variant. GL reports no
+ *  instruction counts, so the size of the program binary,
+ *  where the driver provides one, stands in for the size
+ *  of the compiled code.
+ ***********************************************************/
+void ShaderManager::ReportVariants() const
+{
+	for (size_t variant = 0; variant < m_programs.size(); variant++)
+	{
+		const PROGRAM& program = m_programs[variant];
+
+		std::string defines;
+		for (const std::string& define : program.defines)
+		{
+			defines += (defines.empty() ? "" : ", ") + define;
+		}
+
+		if (program.state != PROGRAM::READY)
+		{
+			printf("Shader variant %zu [%s]: %s\n", variant, defines.empty() ? "default" : defines.c_str(),
+				program.state == PROGRAM::BUILDING ? "still building" : "failed to build");
+			continue;
+		}
+
+		GLint activeUniforms = 0;
+		GLint binaryLength = 0;
+		glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &activeUniforms);
+		if (GLEW_ARB_get_program_binary)
+		{
+			glGetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+		}
+
+		printf("Shader variant %zu [%s]: %d active uniforms, binary %d bytes, %s in %.1f ms\n",
+			variant, defines.empty() ? "default" : defines.c_str(), activeUniforms, binaryLength,
+			program.fromCache ? "loaded from cache" : "compiled", program.buildMs);
+	}
+}
+
+/***********************************************************
+ *  CacheActiveUniforms()
+ *
+ *  This method is called after a program is linked to
+ *  reflect every active uniform into its location table.
+ *  Array uniforms are stored under their base name and
+ *  under each indexed element name.
+ ***********************************************************/
+void ShaderManager::CacheActiveUniforms(PROGRAM& program)
+{
+	UniformLocationTable& table = program.uniformTable;
+	table.Clear();
+	program.uniformValues.clear();
+
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	if (uniformCount <= 0 || maxNameLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> nameBuffer(maxNameLength + 1);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program.id, (GLuint)i, maxNameLength, &nameLength,
+			&arraySize, &type, &nameBuffer[0]);
+
+		std::string name(&nameBuffer[0], nameLength);
+		GLint location = glGetUniformLocation(program.id, name.c_str());
+		table.Insert(HashUniformName(name.c_str()), location);
+		if (location >= 0 && (size_t)(location + arraySize) > program.uniformValues.size())
+		{
+			// array elements take consecutive locations
+			program.uniformValues.resize(location + arraySize);
+		}
+
+		// arrays are reported as "name[0]" - register the base name
+		// and every element so indexed lookups also hit the table
+		size_t bracket = name.rfind("[0]");
+		if (bracket != std::string::npos && bracket + 3 == name.size())
+		{
+			std::string baseName = name.substr(0, bracket);
+			table.Insert(HashUniformName(baseName.c_str()), location);
+			for (GLint element = 1; element < arraySize; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				table.Insert(HashUniformName(elementName.c_str()),
+					glGetUniformLocation(program.id, elementName.c_str()));
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetUniformLocation()
+ *
+ *  This method returns the location of the named uniform
+ *  from the cached table. Names that are not active in the
+ *  program are resolved once and remembered as well, so
+ *  the driver lookup only ever happens on the first call.
+ ***********************************************************/
+GLint ShaderManager::GetUniformLocation(const std::string &name) const
+{
+	uint64_t hash = HashUniformName(name.c_str());
+	GLint location = -1;
+	if (Active().uniformTable.Find(hash, location))
+	{
+		m_frameStats.uniformCacheHits++;
+		return location;
+	}
+
+	location = glGetUniformLocation(m_programID, name.c_str());
+	m_frameStats.uniformLookups++;
+	Active().uniformTable.Insert(hash, location);
+	return location;
+}
+
+/***********************************************************
+ *  GetUniformLocation()
+ *
+ *  Handle overload of the lookup above. The name hash was
+ *  computed at compile time so only the table probe remains.
+ ***********************************************************/
+GLint ShaderManager::GetUniformLocation(const UniformName &uniform) const
+{
+	GLint location = -1;
+	if (Active().uniformTable.Find(uniform.hash, location))
+	{
+		m_frameStats.uniformCacheHits++;
+		return location;
+	}
+
+	location = glGetUniformLocation(m_programID, uniform.name);
+	m_frameStats.uniformLookups++;
+	Active().uniformTable.Insert(uniform.hash, location);
+	return location;
+}
+
+/***********************************************************
+ *  UniformChanged()
+ *
+ *  This method compares a uniform value with the shadow copy
+ *  of the last value written to the location. Unchanged
+ *  values are counted as elided so the caller can skip the
+ *  glUniform* call; anything else is recorded and issued.
+ *  While there are variants, changed values and values of
+ *  uniforms the active variant does not use are also kept
+ *  by name for the others. An unchanged value is already in
+ *  the history, as switching variants brings the shadow
+ *  copies of the active one up to date with it.
+ ***********************************************************/
+bool ShaderManager::UniformChanged(GLint location, uint64_t hash, UNIFORM_KIND kind, const void* value, size_t size) const
+{
+	if (location < 0)
+	{
+		// GL ignores writes to location -1
+		if (m_programs.size() > 1)
+		{
+			RecordUniform(hash, kind, value, size);
+		}
+		m_frameStats.uniformsElided++;
+		return false;
+	}
+
+	std::vector<UNIFORM_SHADOW>& uniformValues = Active().uniformValues;
+	if ((size_t)location < uniformValues.size() && size <= sizeof(UNIFORM_SHADOW::bytes))
+	{
+		UNIFORM_SHADOW &shadow = uniformValues[location];
+		if (shadow.valid && memcmp(shadow.bytes, value, size) == 0)
+		{
+			m_frameStats.uniformsElided++;
+			return false;
+		}
+		memcpy(shadow.bytes, value, size);
+		shadow.valid = true;
+		shadow.kind = kind;
+		shadow.size = (uint8_t)size;
+		shadow.hash = hash;
+	}
+
+	if (m_programs.size() > 1)
+	{
+		RecordUniform(hash, kind, value, size);
+	}
+	m_frameStats.uniformsIssued++;
+	return true;
+}
+
+/***********************************************************
+ *  RecordUniform()
+ *
+ *  This method keeps the last value written to a uniform
+ *  by name, for SyncUniforms() to replay into the variants.
+ ***********************************************************/
+void ShaderManager::RecordUniform(uint64_t hash, UNIFORM_KIND kind, const void* value, size_t size) const
+{
+	if (size > sizeof(UNIFORM_VALUE::bytes))
+	{
+		return;
+	}
+
+	auto found = m_historyIndex.find(hash);
+	if (found == m_historyIndex.end())
+	{
+		found = m_historyIndex.emplace(hash, m_uniformHistory.size()).first;
+		m_uniformHistory.push_back(UNIFORM_VALUE());
+		m_uniformHistory.back().hash = hash;
+	}
+	UNIFORM_VALUE& last = m_uniformHistory[found->second];
+	last.kind = kind;
+	last.size = size;
+	memcpy(last.bytes, value, size);
+}
+
+/***********************************************************
+ *  ValidateUniforms()
+ *
+ *  This method records the uniform handles a caller relies
+ *  on and reports any that are not active in the program.
+ *  The list is checked again after every program link.
+ ***********************************************************/
+void ShaderManager::ValidateUniforms(std::initializer_list<UniformName> uniforms)
+{
+	m_expectedUniforms.insert(m_expectedUniforms.end(), uniforms.begin(), uniforms.end());
+	ReportMissingUniforms();
+}
+
+/***********************************************************
+ *  SetUniformBlockBinding()
+ *
+ *  This method assigns the buffer binding point a uniform
+ *  block of the linked program reads from, in every variant
+ *  and in the variants added later.
+ ***********************************************************/
+bool ShaderManager::SetUniformBlockBinding(const char* blockName, GLuint binding)
+{
+	return SetBlockBinding({ blockName, binding, false });
+}
+
+/***********************************************************
+ *  SetStorageBlockBinding()
+ *
+ *  This method assigns the buffer binding point a shader
+ *  storage block reads from, like SetUniformBlockBinding().
+ ***********************************************************/
+bool ShaderManager::SetStorageBlockBinding(const char* blockName, GLuint binding)
+{
+	if (!GLEW_ARB_shader_storage_buffer_object)
+	{
+		return false;
+	}
+	return SetBlockBinding({ blockName, binding, true });
+}
+
+/***********************************************************
+ *  SetBlockBinding()
+ *
+ *  This method records a block binding and applies it to
+ *  every variant that is built; the variants still building
+ *  get it when they are finished.
+ ***********************************************************/
+bool ShaderManager::SetBlockBinding(const BLOCK_BINDING& binding)
+{
+	if (!ApplyBlockBinding(m_programs[0].id, binding))
+	{
+		return false;
+	}
+
+	auto previous = std::find_if(m_blockBindings.begin(), m_blockBindings.end(),
+		[&binding](const BLOCK_BINDING& entry)
+		{
+			return entry.name == binding.name && entry.bStorage == binding.bStorage;
+		});
+	if (previous != m_blockBindings.end())
+	{
+		previous->binding = binding.binding;
+	}
+	else
+	{
+		m_blockBindings.push_back(binding);
+	}
+	for (size_t variant = 1; variant < m_programs.size(); variant++)
+	{
+		if (m_programs[variant].state == PROGRAM::READY)
+		{
+			ApplyBlockBinding(m_programs[variant].id, binding);
+		}
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ApplyBlockBinding()
+ *
+ *  This method binds a block of one program, returning
+ *  false when the program has no such block.
+ ***********************************************************/
+bool ShaderManager::ApplyBlockBinding(GLuint program, const BLOCK_BINDING& binding)
+{
+	if (binding.bStorage)
+	{
+		GLuint blockIndex = glGetProgramResourceIndex(program, GL_SHADER_STORAGE_BLOCK, binding.name.c_str());
+		if (blockIndex == GL_INVALID_INDEX)
+		{
+			return false;
+		}
+		glShaderStorageBlockBinding(program, blockIndex, binding.binding);
+		return true;
+	}
+
+	GLuint blockIndex = glGetUniformBlockIndex(program, binding.name.c_str());
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+	glUniformBlockBinding(program, blockIndex, binding.binding);
+	return true;
+}
+
+/***********************************************************
+ *  ReportMissingUniforms()
+ *
+ *  This method prints a warning for every expected uniform
+ *  that the program built by LoadShaders does not contain.
+ *  The variants are not checked, as they drop the uniforms
+ *  their defines make unused.
+ ***********************************************************/
+void ShaderManager::ReportMissingUniforms() const
+{
+	for (const UniformName &uniform : m_expectedUniforms)
+	{
+		GLint location = -1;
+		if (!m_programs[0].uniformTable.Find(uniform.hash, location) || location < 0)
+		{
+			printf("WARNING: uniform \"%s\" is not active in the shader program\n", uniform.name);
+		}
+	}
+}
+
+/***********************************************************
+ *  UniformLocationTable
+ *
+ *  Linear probing over a power-of-two slot array that is
+ *  kept at most half full.
+ ***********************************************************/
+void UniformLocationTable::Clear()
+{
+	m_entries.assign(64, ENTRY());
+	m_count = 0;
+}
+
+void UniformLocationTable::Insert(uint64_t hash, GLint location)
+{
+	if (hash == 0)
+	{
+		hash = 1;
+	}
+	if ((m_count + 1) * 2 > m_entries.size())
+	{
+		Grow();
+	}
+
+	size_t mask = m_entries.size() - 1;
+	size_t slot = (size_t)hash & mask;
+	while (m_entries[slot].hash != 0 && m_entries[slot].hash != hash)
+	{
+		slot = (slot + 1) & mask;
+	}
+	if (m_entries[slot].hash == 0)
+	{
+		m_count++;
+	}
+	m_entries[slot].hash = hash;
+	m_entries[slot].location = location;
+}
+
+bool UniformLocationTable::Find(uint64_t hash, GLint &location) const
+{
+	if (m_entries.empty())
+	{
+		return false;
+	}
+	if (hash == 0)
+	{
+		hash = 1;
+	}
+
+	size_t mask = m_entries.size() - 1;
+	size_t slot = (size_t)hash & mask;
+	while (m_entries[slot].hash != 0)
+	{
+		if (m_entries[slot].hash == hash)
+		{
+			location = m_entries[slot].location;
+			return true;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return false;
+}
+
+void UniformLocationTable::Grow()
+{
+	std::vector<ENTRY> previous;
+	previous.swap(m_entries);
+	m_entries.assign(previous.empty() ? 64 : previous.size() * 2, ENTRY());
+	m_count = 0;
+	for (const ENTRY &entry : previous)
+	{
+		if (entry.hash != 0)
+		{
+			Insert(entry.hash, entry.location);
+		}
+	}
+}
+
 
@@ -11,84 +11,392 @@
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "GLStateCache.h"
+
+// 64-bit FNV-1a hash of a uniform name, used as the key
+// into the cached uniform location table
+constexpr uint64_t HashUniformName(const char* name)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    while (*name)
+    {
+        hash ^= (uint64_t)(unsigned char)(*name++);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/***********************************************************
+ *  UniformName / Uniform<T>
+ *
+ *  Typed uniform handle. Declared constexpr over a string
+ *  literal, the name hash is computed by the compiler so
+ *  setting a value costs neither a std::string nor a hash.
+ ***********************************************************/
+struct UniformName
+{
+    const char* name;
+    uint64_t hash;
+
+    constexpr explicit UniformName(const char* uniformName)
+        : name(uniformName), hash(HashUniformName(uniformName)) {}
+};
+
+template <typename T>
+struct Uniform : public UniformName
+{
+    constexpr explicit Uniform(const char* uniformName)
+        : UniformName(uniformName) {}
+};
+
+/***********************************************************
+ *  UniformLocationTable
+ *
+ *  Flat open-addressing hash table mapping precomputed
+ *  uniform name hashes to program uniform locations.
+ ***********************************************************/
+class UniformLocationTable
+{
+public:
+    void Clear();
+    void Insert(uint64_t hash, GLint location);
+    bool Find(uint64_t hash, GLint &location) const;
+    size_t Size() const { return m_count; }
+
+private:
+    struct ENTRY
+    {
+        uint64_t hash = 0;      // 0 marks an empty slot
+        GLint location = -1;
+    };
+
+    void Grow();
+
+    std::vector<ENTRY> m_entries;
+    size_t m_count = 0;
+};
 
 class ShaderManager
 {
 public:
+    ~ShaderManager();
+
+    // program of the active variant
     unsigned int m_programID;
 
+    // per-frame counters for verifying the uniform cache
+    struct FRAME_STATS
+    {
+        unsigned int uniformLookups = 0;    // glGetUniformLocation calls
+        unsigned int uniformCacheHits = 0;  // locations served by the table
+        unsigned int uniformsIssued = 0;    // glUniform* calls sent to the driver
+        unsigned int uniformsElided = 0;    // writes of an unchanged value
+        unsigned int variantSwitches = 0;   // programs bound by UseVariant()
+        unsigned int uniformsSynced = 0;    // values brought up to date on a switch
+        unsigned int variantFallbacks = 0;  // variants still building, drawn with the default program
+    };
+
     GLuint LoadShaders(
         const char* vertex_file_path, 
         const char* fragment_file_path);
 
+    // compile the loaded sources again with a "#define" for each of
+    // the given "NAME value" strings injected after the #version
+    // line. Returns the index of the variant, an existing one when
+    // the defines were already compiled, or 0 (the program built by
+    // LoadShaders) when the variant fails to build. Outside of
+    // COMPILE_SERIAL the variant may still be building on return
+    size_t AddVariant(const std::vector<std::string>& defines);
+
+    // make a variant the active program. Every uniform written so
+    // far, to whichever variant, is brought up to date in it, so
+    // callers set values without knowing which variant is active.
+    // A variant that is still building, or failed to, is drawn with
+    // the fallback, by default the program built by LoadShaders
+    void UseVariant(size_t variant, size_t fallback = 0);
+    bool IsVariantReady(size_t variant) const;
+    size_t GetVariantCount() const { return m_programs.size(); }
+    size_t GetActiveVariant() const { return m_activeProgram; }
+
+    // print the defines, active uniforms, program binary size and
+    // build time of every variant
+    void ReportVariants() const;
+
+    // how AddVariant builds the variants it cannot load from the
+    // program cache
+    enum COMPILE_MODE
+    {
+        COMPILE_SERIAL,         // compiled and linked before AddVariant returns
+        COMPILE_PARALLEL,       // KHR/ARB_parallel_shader_compile, polled for completion
+        COMPILE_WORKER          // compiled on a thread with a shared context
+    };
+
+    // choose how variants are built. COMPILE_PARALLEL needs the
+    // driver extension and falls back to COMPILE_WORKER, which needs
+    // a function making a context that shares objects with this one
+    // current on the calling thread (true) or releasing it (false);
+    // both fall back to COMPILE_SERIAL. Returns the mode in use
+    COMPILE_MODE SetCompileMode(COMPILE_MODE mode, std::function<void(bool)> workerContext = nullptr);
+    COMPILE_MODE GetCompileMode() const { return m_compileMode; }
+
+    // finish the variants whose build has completed and return the
+    // number still building; call once per frame
+    size_t PollVariants();
+    size_t GetPendingVariants() const { return m_pendingVariants; }
+
+    // block until every variant has been built
+    void WaitForVariants();
+
+    // end the compile worker once its programs are built; call
+    // before the context it uses is destroyed
+    void StopCompileWorker();
+
+    // keep the binaries of the linked programs in a directory and
+    // load them from there on later runs, keyed by the source text
+    // with its defines and by the driver; set before LoadShaders.
+    // Each program has one file, named after its shader files and
+    // defines, which a rebuilt binary overwrites.
+    // Returns false, leaving the cache off, when the driver has no
+    // program binary format (GL 4.1 / ARB_get_program_binary)
+    bool SetProgramCache(const std::string& directory);
+    bool GetProgramCache() const { return !m_programCacheDirectory.empty(); }
+
+    // how the programs were built, to compare cold and warm starts
+    struct PROGRAM_CACHE_STATS
+    {
+        unsigned int loaded = 0;        // programs created from a cached binary
+        unsigned int compiled = 0;      // programs compiled from source
+        unsigned int rejected = 0;      // cache files that were invalid or refused
+        unsigned int saved = 0;         // binaries written to the cache
+        double buildMs = 0.0;           // time the caller waited on program builds
+    };
+    const PROGRAM_CACHE_STATS& GetProgramCacheStats() const { return m_cacheStats; }
+
+    // reset the counters at the start of each frame
+    inline void ResetFrameStats() { m_frameStats = FRAME_STATS(); }
+    inline const FRAME_STATS& GetFrameStats() const { return m_frameStats; }
+
+    // resolve a uniform location through the cached table, only
+    // falling back to the driver for names the table has not seen
+    GLint GetUniformLocation(const std::string &name) const;
+    GLint GetUniformLocation(const UniformName &uniform) const;
+
+    // check that each handle names an active uniform of the program
+    // built by LoadShaders; the list is kept so it is checked again
+    // every time that program is linked
+    void ValidateUniforms(std::initializer_list<UniformName> uniforms);
+
+    // attach a uniform block of every variant to a buffer binding
+    // point; GLSL 330 cannot set the binding in the shader.
+    // Returns false when the program has no such block
+    bool SetUniformBlockBinding(const char* blockName, GLuint binding);
+
+    // the same for a shader storage block (GL 4.3 or
+    // ARB_shader_storage_buffer_object); false without support
+    bool SetStorageBlockBinding(const char* blockName, GLuint binding);
+
     // activate the shader
     inline void use()
     {
-        glUseProgram(m_programID);
+        GLState().UseProgram(m_programID);
     }
 
     // utility uniform functions
     inline void setBoolValue(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(m_programID, name.c_str()), (int)value);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, (int)value))
+        {
+            glUniform1i(location, (int)value);
+        }
     }
 
     inline void setIntValue(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1i(location, value);
+        }
     }
 
     inline void setFloatValue(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1f(location, value);
+        }
     }
 
     inline void setVec2Value(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform2fv(location, 1, &value[0]);
+        }
     }
 
     inline void setVec2Value(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(m_programID, name.c_str()), x, y);
+        setVec2Value(name, glm::vec2(x, y));
     }
 
     inline void setVec3Value(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform3fv(location, 1, &value[0]);
+        }
     }
     inline void setVec3Value(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(m_programID, name.c_str()), x, y, z);
+        setVec3Value(name, glm::vec3(x, y, z));
     }
 
     inline void setVec4Value(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform4fv(location, 1, &value[0]);
+        }
     }
     inline void setVec4Value(const std::string &name, float x, float y, float z, float w)
     {
-        glUniform4f(glGetUniformLocation(m_programID, name.c_str()), x, y, z, w);
+        setVec4Value(name, glm::vec4(x, y, z, w));
     }
 
     inline void setMat2Value(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, mat))
+        {
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+        }
     }
 
     inline void setMat3Value(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, mat))
+        {
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+        }
     }
 
     inline void setMat4Value(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, mat))
+        {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+        }
     }
 
     inline void setSampler2DValue(const std::string& name, const int &value) const
     {
-        glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+        const UniformName uniform(name.c_str());
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1i(location, value);
+        }
+    }
+
+    // uniform handle overloads - no string construction or hashing
+    inline void setBoolValue(const Uniform<bool> &uniform, bool value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, (int)value))
+        {
+            glUniform1i(location, (int)value);
+        }
+    }
+
+    inline void setIntValue(const Uniform<int> &uniform, int value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1i(location, value);
+        }
+    }
+
+    inline void setFloatValue(const Uniform<float> &uniform, float value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1f(location, value);
+        }
+    }
+
+    inline void setVec2Value(const Uniform<glm::vec2> &uniform, const glm::vec2 &value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform2fv(location, 1, &value[0]);
+        }
+    }
+
+    inline void setVec3Value(const Uniform<glm::vec3> &uniform, const glm::vec3 &value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform3fv(location, 1, &value[0]);
+        }
+    }
+
+    inline void setVec4Value(const Uniform<glm::vec4> &uniform, const glm::vec4 &value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform4fv(location, 1, &value[0]);
+        }
+    }
+
+    inline void setMat4Value(const Uniform<glm::mat4> &uniform, const glm::mat4 &mat) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, mat))
+        {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+        }
+    }
+
+    inline void setSampler2DValue(const Uniform<int> &uniform, int value) const
+    {
+        GLint location = GetUniformLocation(uniform);
+        if (UniformChanged(location, uniform.hash, value))
+        {
+            glUniform1i(location, value);
+        }
     }
 
     // New sets multiple PBR textures at once
@@ -101,39 +409,220 @@ public:
         GLuint ao, 
         GLuint height)
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, albedo);
-        setIntValue("albedoMap", 0);
+        constexpr Uniform<int> albedoMap("albedoMap");
+        constexpr Uniform<int> normalMap("normalMap");
+        constexpr Uniform<int> metallicMap("metallicMap");
+        constexpr Uniform<int> roughnessMap("roughnessMap");
+        constexpr Uniform<int> aoMap("aoMap");
+        constexpr Uniform<int> heightMap("heightMap");
+
+        GLState().BindTexture2D(0, albedo);
+        setIntValue(albedoMap, 0);
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normal);
-        setIntValue("normalMap", 1);
+        GLState().BindTexture2D(1, normal);
+        setIntValue(normalMap, 1);
 
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, metallic);
-        setIntValue("metallicMap", 2);
+        GLState().BindTexture2D(2, metallic);
+        setIntValue(metallicMap, 2);
 
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, roughness);
-        setIntValue("roughnessMap", 3);
+        GLState().BindTexture2D(3, roughness);
+        setIntValue(roughnessMap, 3);
 
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, ao);
-        setIntValue("aoMap", 4);
+        GLState().BindTexture2D(4, ao);
+        setIntValue(aoMap, 4);
 
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, height);
-        setIntValue("heightMap", 5);
+        GLState().BindTexture2D(5, height);
+        setIntValue(heightMap, 5);
     }
 
     // New set world-space light and camera positions for vertex shader
     inline void setLightPosition(const glm::vec3& lightPos) const
     {
-        setVec3Value("lightPos", lightPos);
+        constexpr Uniform<glm::vec3> lightPosUniform("lightPos");
+        setVec3Value(lightPosUniform, lightPos);
     }
 
     inline void setViewPosition(const glm::vec3& viewPos) const
     {
-        setVec3Value("viewPos", viewPos);
+        constexpr Uniform<glm::vec3> viewPosUniform("viewPos");
+        setVec3Value(viewPosUniform, viewPos);
     }
+
+private:
+    // glUniform* call that writes a value
+    enum UNIFORM_KIND : uint8_t
+    {
+        KIND_INT,
+        KIND_FLOAT,
+        KIND_VEC2,
+        KIND_VEC3,
+        KIND_VEC4,
+        KIND_MAT2,
+        KIND_MAT3,
+        KIND_MAT4
+    };
+
+    static constexpr UNIFORM_KIND KindOf(int) { return KIND_INT; }
+    static constexpr UNIFORM_KIND KindOf(float) { return KIND_FLOAT; }
+    static constexpr UNIFORM_KIND KindOf(const glm::vec2&) { return KIND_VEC2; }
+    static constexpr UNIFORM_KIND KindOf(const glm::vec3&) { return KIND_VEC3; }
+    static constexpr UNIFORM_KIND KindOf(const glm::vec4&) { return KIND_VEC4; }
+    static constexpr UNIFORM_KIND KindOf(const glm::mat2&) { return KIND_MAT2; }
+    static constexpr UNIFORM_KIND KindOf(const glm::mat3&) { return KIND_MAT3; }
+    static constexpr UNIFORM_KIND KindOf(const glm::mat4&) { return KIND_MAT4; }
+
+    // last value written to each uniform location of a program,
+    // with the name hash and kind it was written with
+    struct UNIFORM_SHADOW
+    {
+        bool valid = false;
+        UNIFORM_KIND kind = KIND_INT;
+        uint8_t size = 0;
+        uint64_t hash = 0;
+        unsigned char bytes[sizeof(glm::mat4)];
+    };
+
+    // linked program of one variant with its uniform locations
+    // and the values last written to them
+    struct PROGRAM
+    {
+        GLuint id = 0;
+        std::vector<std::string> defines;
+        UniformLocationTable uniformTable;
+        std::vector<UNIFORM_SHADOW> uniformValues;
+        double buildMs = 0.0;
+        bool fromCache = false;
+
+        // a variant is drawn once its program is ready
+        enum STATE : uint8_t { READY, BUILDING, FAILED } state = READY;
+        // shaders of a COMPILE_PARALLEL link still in progress
+        GLuint shaders[2] = { 0, 0 };
+        uint64_t cacheKey = 0;
+        uint64_t cacheSlot = 0;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // binding point of a uniform or shader storage block
+    struct BLOCK_BINDING
+    {
+        std::string name;
+        GLuint binding;
+        bool bStorage;
+    };
+
+    // program handed back by the compile worker
+    struct COMPILE_JOB
+    {
+        size_t variant;
+        std::string vertexCode;
+        std::string fragmentCode;
+        GLuint program;
+    };
+
+    // last value written to a uniform by name, whichever variant
+    // was active, to bring the other variants up to date; only kept
+    // while there is more than one program
+    struct UNIFORM_VALUE
+    {
+        uint64_t hash = 0;
+        UNIFORM_KIND kind = KIND_INT;
+        size_t size = 0;
+        unsigned char bytes[sizeof(glm::mat4)];
+    };
+
+    inline PROGRAM& Active() const { return m_programs[m_activeProgram]; }
+
+    // compile and link a program from source text; 0 on failure
+    GLuint BuildProgram(const std::string& vertexCode, const std::string& fragmentCode) const;
+
+    // the two halves of BuildProgram: StartProgram issues the compile
+    // and link without waiting for them, FinishProgram waits for the
+    // result, prints the log and returns 0 on failure
+    GLuint StartProgram(const std::string& vertexCode, const std::string& fragmentCode, GLuint shaders[2]) const;
+    GLuint FinishProgram(GLuint program, GLuint shaders[2]) const;
+
+    // build the program of a variant, through the program cache;
+    // with bAsync it may be left building in the compile mode
+    void BuildVariant(size_t variant, bool bAsync);
+
+    // store the built program of a variant, or mark it failed
+    void FinishVariant(size_t variant, GLuint programID);
+
+    // finish the variants built by the worker or the driver threads,
+    // waiting for them with bWait
+    size_t CollectVariants(bool bWait);
+
+    // compile thread of COMPILE_WORKER
+    void CompileWorker(std::function<void(bool)> workerContext);
+
+    // program cache files, one per shader files and defines (the
+    // slot), holding the binary of the sources and the driver of
+    // the key
+    uint64_t ProgramCacheKey(const std::string& vertexCode, const std::string& fragmentCode) const;
+    uint64_t ProgramCacheSlot(const std::vector<std::string>& defines) const;
+    std::string ProgramCachePath(uint64_t slot) const;
+    GLuint LoadCachedProgram(uint64_t slot, uint64_t key);
+    void SaveCachedProgram(GLuint program, uint64_t slot, uint64_t key);
+
+    // record a block binding and apply it to the built variants
+    bool SetBlockBinding(const BLOCK_BINDING& binding);
+    static bool ApplyBlockBinding(GLuint program, const BLOCK_BINDING& binding);
+
+    // reflect all active uniforms of a linked program into its table
+    void CacheActiveUniforms(PROGRAM& program);
+
+    // print a warning for every expected uniform the program lacks
+    void ReportMissingUniforms() const;
+
+    // compare a value with the last one written to the location and
+    // remember it; false means the glUniform* call can be skipped
+    bool UniformChanged(GLint location, uint64_t hash, UNIFORM_KIND kind, const void* value, size_t size) const;
+
+    template <typename T>
+    inline bool UniformChanged(GLint location, uint64_t hash, const T &value) const
+    {
+        return UniformChanged(location, hash, KindOf(value), &value, sizeof(T));
+    }
+
+    // keep the value written to a uniform by name for the variants
+    // that are not active
+    void RecordUniform(uint64_t hash, UNIFORM_KIND kind, const void* value, size_t size) const;
+
+    // start the history from the values of the default program,
+    // when the first variant is added
+    void StartUniformHistory();
+
+    // issue the glUniform* call of a value of the given kind
+    static void IssueUniform(GLint location, UNIFORM_KIND kind, const void* value);
+
+    // write the last value of every uniform the active variant has
+    // not seen yet
+    void SyncUniforms();
+
+    mutable std::vector<PROGRAM> m_programs = std::vector<PROGRAM>(1);
+    size_t m_activeProgram = 0;
+    mutable FRAME_STATS m_frameStats;
+    std::vector<UniformName> m_expectedUniforms;
+
+    // sources of the variants and the block bindings set on them
+    std::string m_vertexSource;
+    std::string m_fragmentSource;
+    std::vector<BLOCK_BINDING> m_blockBindings;
+
+    std::string m_programCacheDirectory;
+    uint64_t m_programCacheFiles = 0;     // hash of the loaded shader file names
+    PROGRAM_CACHE_STATS m_cacheStats;
+
+    COMPILE_MODE m_compileMode = COMPILE_SERIAL;
+    size_t m_pendingVariants = 0;
+    std::thread m_compileThread;
+    std::mutex m_compileMutex;
+    std::condition_variable m_compileQueued;
+    std::condition_variable m_compileDone;
+    std::deque<COMPILE_JOB> m_compileJobs;
+    std::vector<COMPILE_JOB> m_compiledJobs;
+    bool m_bStopCompileWorker = false;
+
+    mutable std::vector<UNIFORM_VALUE> m_uniformHistory;
+    mutable std::unordered_map<uint64_t, size_t> m_historyIndex;
 };
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// StreamRingBuffer.h
+// ==================
+// linear allocator for per-frame dynamic GL data
+//
+// Data written once per frame (per-draw blocks, instance streams, indirect
+// commands) is carved out of one buffer object, front to back, with
+// Allocate(). Where buffer storage is available (GL 4.4 or
+// ARB_buffer_storage) the buffer holds FRAME_COUNT regions and stays
+// persistently and coherently mapped: the CPU writes straight into the
+// region of the current frame, and a fence placed at the end of each frame
+// is waited on before its region is written again. Without buffer storage
+// the allocations go to a CPU copy, and Flush() uploads what was written
+// since the last flush into a buffer that is orphaned at the start of
+// every frame, so the driver never has to wait for draws still reading it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstdint>
+#include <vector>
+
+class StreamRingBuffer
+{
+public:
+    // regions of a persistent buffer in flight at once
+    static const int FRAME_COUNT = 3;
+
+    // a range of the current frame; data is where to write it
+    // and offset is where the GL sees it in Buffer()
+    struct ALLOCATION
+    {
+        void* data = nullptr;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    // per-frame counters
+    struct FRAME_STATS
+    {
+        unsigned int allocations = 0;
+        size_t bytes = 0;               // bytes allocated, with alignment
+        unsigned int uploads = 0;       // glBufferSubData calls (orphaned mode)
+        unsigned int fenceWaits = 0;    // frames that found their region busy
+    };
+
+    StreamRingBuffer() = default;
+    ~StreamRingBuffer() { Destroy(); }
+
+    StreamRingBuffer(const StreamRingBuffer&) = delete;
+    StreamRingBuffer& operator=(const StreamRingBuffer&) = delete;
+
+    // whether the current context can create persistent buffers
+    static bool PersistentSupported()
+    {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        return major > 4 || (major == 4 && minor >= 4) || GLEW_ARB_buffer_storage;
+    }
+
+    // choose persistent mapping or orphaned uploads; takes effect
+    // when the buffer is next created
+    void SetPersistent(bool bPersistent)
+    {
+        if (bPersistent != m_bPersistent)
+        {
+            Destroy();
+            m_bPersistent = bPersistent;
+        }
+    }
+    bool IsPersistent() const { return m_bPersistent; }
+
+    // start a frame with room for at least frameBytes, creating or
+    // growing the buffer when needed; waits for the fence of the
+    // region that is about to be reused
+    void BeginFrame(GLsizeiptr frameBytes)
+    {
+        m_stats = FRAME_STATS();
+
+        if (m_buffer == 0 || frameBytes > m_regionSize)
+        {
+            GLsizeiptr regionSize = (m_regionSize > 0) ? m_regionSize : MIN_REGION_SIZE;
+            while (regionSize < frameBytes)
+            {
+                regionSize *= 2;
+            }
+            Create(regionSize);
+        }
+
+        m_region = (m_region + 1) % (m_bPersistent ? FRAME_COUNT : 1);
+        m_cursor = 0;
+        m_flushed = 0;
+
+        if (m_bPersistent)
+        {
+            GLsync& fence = m_fences[m_region];
+            if (fence != nullptr)
+            {
+                GLenum result = glClientWaitSync(fence, 0, 0);
+                if (result == GL_TIMEOUT_EXPIRED)
+                {
+                    m_stats.fenceWaits++;
+                    while (result == GL_TIMEOUT_EXPIRED)
+                    {
+                        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+                    }
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        else
+        {
+            // orphan the storage the previous frame's draws read
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, m_regionSize, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    // fence the region of the frame once its draws are issued
+    void EndFrame()
+    {
+        Flush();
+        if (m_bPersistent && m_buffer != 0)
+        {
+            m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    // the next size bytes of the frame, at an offset into Buffer()
+    // that is a multiple of alignment (any alignment, not only
+    // powers of two); data is null when the frame is full
+    ALLOCATION Allocate(GLsizeiptr size, GLsizeiptr alignment)
+    {
+        ALLOCATION allocation;
+        GLintptr offset = (RegionStart() + m_cursor + alignment - 1) / alignment * alignment;
+        GLsizeiptr start = offset - RegionStart();
+        if (m_buffer == 0 || start + size > m_regionSize)
+        {
+            return allocation;
+        }
+
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.data = m_bPersistent ? (void*)(m_mapped + allocation.offset) : (void*)(m_staging.data() + start);
+        m_cursor = start + size;
+
+        m_stats.allocations++;
+        m_stats.bytes = (size_t)m_cursor;
+        return allocation;
+    }
+
+    // make everything allocated so far visible to the GL; the
+    // persistent mapping is coherent, so only orphaned mode
+    // copies anything
+    void Flush()
+    {
+        if (m_bPersistent || m_cursor <= m_flushed)
+        {
+            return;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, m_flushed, m_cursor - m_flushed, m_staging.data() + m_flushed);
+        m_flushed = m_cursor;
+        m_stats.uploads++;
+    }
+
+    void Destroy()
+    {
+        for (GLsync& fence : m_fences)
+        {
+            if (fence != nullptr)
+            {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        if (m_buffer != 0)
+        {
+            if (m_mapped != nullptr)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+            glDeleteBuffers(1, &m_buffer);
+        }
+        m_buffer = 0;
+        m_mapped = nullptr;
+        m_regionSize = 0;
+        m_cursor = 0;
+        m_flushed = 0;
+        m_staging.clear();
+    }
+
+    GLuint Buffer() const { return m_buffer; }
+    GLsizeiptr RegionSize() const { return m_regionSize; }
+    const FRAME_STATS& GetFrameStats() const { return m_stats; }
+
+private:
+    // smallest region, grown by doubling
+    static constexpr GLsizeiptr MIN_REGION_SIZE = 64 * 1024;
+
+    // wait slice while a region is still in use
+    static constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000;
+
+    GLintptr RegionStart() const { return m_bPersistent ? m_region * m_regionSize : 0; }
+
+    // (re)create the buffer with FRAME_COUNT regions of the given
+    // size, or one region to orphan; draws already issued keep the
+    // old buffer alive until they finish
+    void Create(GLsizeiptr regionSize)
+    {
+        Destroy();
+        m_regionSize = regionSize;
+        m_region = 0;
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+        if (m_bPersistent)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * FRAME_COUNT, nullptr, flags);
+            m_mapped = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * FRAME_COUNT, flags);
+            if (m_mapped != nullptr)
+            {
+                return;
+            }
+
+            // the driver refused the mapping - upload instead
+            glDeleteBuffers(1, &m_buffer);
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+            m_bPersistent = false;
+        }
+
+        glBufferData(GL_COPY_WRITE_BUFFER, regionSize, nullptr, GL_STREAM_DRAW);
+        m_staging.resize((size_t)regionSize);
+    }
+
+    bool m_bPersistent = false;
+    GLuint m_buffer = 0;
+    uint8_t* m_mapped = nullptr;            // persistent mapping of all regions
+    std::vector<uint8_t> m_staging;         // CPU copy in orphaned mode
+    GLsizeiptr m_regionSize = 0;
+    int m_region = 0;                       // region of the current frame
+    GLsizeiptr m_cursor = 0;                // bytes allocated in the frame
+    GLsizeiptr m_flushed = 0;               // bytes uploaded in the frame
+    GLsync m_fences[FRAME_COUNT] = {};
+    FRAME_STATS m_stats;
+};
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// UniformBlockBuffer.h
+// ====================
+// CPU copy and GL buffer of one std140 uniform block
+//
+// Holds the values of a uniform block that rarely changes (lights, frame
+// constants) in a struct laid out the way std140 lays out the block. Set()
+// only marks the block dirty when the values actually differ, and Update()
+// uploads a dirty block with a single glBufferSubData, so a block whose
+// values stay the same costs nothing per frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstring>
+
+template <typename BLOCK>
+class UniformBlockBuffer
+{
+public:
+    UniformBlockBuffer() { memset((void*)&m_block, 0, sizeof(BLOCK)); }
+    ~UniformBlockBuffer() { Destroy(); }
+
+    UniformBlockBuffer(const UniformBlockBuffer&) = delete;
+    UniformBlockBuffer& operator=(const UniformBlockBuffer&) = delete;
+
+    // replace the values, marking the block dirty if they changed;
+    // compared bytewise, so the padding of BLOCK must be zeroed
+    void Set(const BLOCK& block)
+    {
+        if (memcmp(&block, &m_block, sizeof(BLOCK)) != 0)
+        {
+            m_block = block;
+            m_bDirty = true;
+        }
+    }
+
+    // force the next Update() to upload
+    void MarkDirty() { m_bDirty = true; }
+    bool IsDirty() const { return m_bDirty; }
+    const BLOCK& Get() const { return m_block; }
+
+    // create the buffer and attach it to the binding point on first
+    // use, then upload the values if they changed; returns whether
+    // anything was uploaded
+    bool Update(GLuint binding)
+    {
+        if (m_buffer == 0)
+        {
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(BLOCK), &m_block, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_buffer);
+            m_bDirty = false;
+            return true;
+        }
+        if (!m_bDirty)
+        {
+            return false;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(BLOCK), &m_block);
+        m_bDirty = false;
+        return true;
+    }
+
+    void Destroy()
+    {
+        if (m_buffer != 0)
+        {
+            glDeleteBuffers(1, &m_buffer);
+            m_buffer = 0;
+        }
+        m_bDirty = true;
+    }
+
+    GLuint Buffer() const { return m_buffer; }
+
+private:
+    BLOCK m_block;
+    GLuint m_buffer = 0;
+    bool m_bDirty = true;
+};
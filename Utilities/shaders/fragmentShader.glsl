@@ -1,12 +1,27 @@
 #version 330 core
 
+// storage buffers of the clustered lighting, where the driver has them
+#extension GL_ARB_shader_storage_buffer_object : enable
+
 // Inputs from vertex shader
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+in vec4 fragmentTangent;
+flat in vec2 fragmentUVScale;    // per-instance UV scale, multiplies UVscale
+flat in vec4 fragmentTint;       // per-instance tint, multiplies the base color
 
 // Output
+#ifdef GBUFFER_PASS
+// G-buffer of the deferred path (SceneManager::SetDeferredShading): the
+// lit paths write their surface here instead of lighting it
+layout (location = 0) out vec4 gbufferAlbedoOut;    // rgb albedo, gamma 2.2 encoded; a ambient occlusion
+layout (location = 1) out vec4 gbufferSurfaceOut;   // r metallic, g roughness, b lighting model
+layout (location = 2) out vec2 gbufferNormalOut;    // octahedral encoded world normal
+vec4 outFragmentColor;                              // written by the paths, not output
+#else
 out vec4 outFragmentColor;
+#endif
 
 // --- Mode toggles ---
 uniform bool bUseTexture       = false;
@@ -34,6 +49,11 @@ uniform vec3 pbrTint = vec3(1.0, 1.0, 1.0);
 uniform bool  bUseParallax   = false;
 uniform float parallaxScale  = 0.04;
 
+// --- Tangent frame ---
+// true when the mesh has a tangent stream; the TBN then comes from the
+// interpolated vertex tangent instead of screen-space derivatives
+uniform bool  bUseVertexTangents = false;
+
 // --- Checkerboard custom colours ---
 uniform vec3 checkerColor1 = vec3(1.0);
 uniform vec3 checkerColor2 = vec3(0.0);
@@ -60,6 +80,236 @@ uniform vec3  envColorTop    = vec3(0.85, 0.90, 1.00);
 uniform vec3  envColorBottom = vec3(0.15, 0.12, 0.10);
 uniform float envIntensity   = 0.60;
 
+// --- Uniform blocks (SceneManager::SetUniformBlocks) ---
+// With bUseUniformBlocks set, the eye position comes from the FrameBlock
+// and the lights and environment from the LightBlock, which are only
+// uploaded when they change; otherwise from the uniforms above.
+layout (std140) uniform FrameBlock
+{
+    mat4 frameView;
+    mat4 frameProjection;
+    vec4 frameViewPos;                      // xyz used
+};
+
+layout (std140) uniform LightBlock
+{
+    vec4 blockLightPositions[MAX_LIGHTS];   // xyz position, w intensity
+    vec4 blockLightColors[MAX_LIGHTS];      // rgb used
+    vec4 blockEnvColorTop;                  // rgb color, w intensity
+    vec4 blockEnvColorBottom;               // rgb used
+    int  blockNumLights;
+};
+
+uniform bool bUseUniformBlocks = false;
+
+// --- Clustered lighting (SceneManager::SetClusteredLighting) ---
+// With bUseClusteredLights set, the lights come from the LightRecords
+// storage buffer, and a fragment only loops over the lights listed for
+// its cluster of the froxel grid (LightClusters: screen tiles by
+// exponential depth slices). Each light then ends at its radius, where
+// its attenuation falls to lightCutoff; the cutoff is subtracted so the
+// light fades out there without an edge.
+const ivec3 CLUSTER_GRID = ivec3(16, 9, 24);   // (LightClusters::GRID_X/Y/Z there as well)
+
+uniform bool  bUseClusteredLights = false;
+uniform vec4  clusterScale;         // xy clusters per pixel, z slices per log depth, w slice bias
+uniform vec4  clusterViewDepth;     // view depth of world position p: dot(clusterViewDepth, vec4(p, 1))
+uniform float lightCutoff         = 0.0;
+
+// lights of the fragment's cluster, found by SelectCluster()
+int clusterOffset = 0;
+int clusterCount  = 0;
+
+#ifdef GL_ARB_shader_storage_buffer_object
+struct LightRecord
+{
+    vec4 positionRadius;    // xyz position, w radius
+    vec4 colorIntensity;    // rgb color, w intensity
+};
+
+layout (std430) readonly buffer LightRecords
+{
+    LightRecord lightRecords[];
+};
+
+layout (std430) readonly buffer LightClusters
+{
+    uvec2 clusterRanges[];  // x first entry of clusterLightIndices, y light count
+};
+
+layout (std430) readonly buffer LightIndices
+{
+    uint clusterLightIndices[];
+};
+
+LightRecord ClusterLight(int i) { return lightRecords[clusterLightIndices[clusterOffset + i]]; }
+#endif
+
+void SelectCluster(vec3 position)
+{
+#ifdef GL_ARB_shader_storage_buffer_object
+    if (!bUseClusteredLights)
+    {
+        return;
+    }
+
+    float depth = max(dot(clusterViewDepth, vec4(position, 1.0)), 1.0e-4);
+    ivec3 cell  = ivec3(ivec2(gl_FragCoord.xy * clusterScale.xy),
+                        int(floor(log(depth) * clusterScale.z + clusterScale.w)));
+    cell = clamp(cell, ivec3(0), CLUSTER_GRID - 1);
+
+    uvec2 range   = clusterRanges[(cell.z * CLUSTER_GRID.y + cell.y) * CLUSTER_GRID.x + cell.x];
+    clusterOffset = int(range.x);
+    clusterCount  = int(range.y);
+#endif
+}
+
+int LightCount()
+{
+    if (bUseClusteredLights)
+    {
+        return clusterCount;
+    }
+    return min(bUseUniformBlocks ? blockNumLights : numLights, MAX_LIGHTS);
+}
+
+vec3 LightPosition(int i)
+{
+#ifdef GL_ARB_shader_storage_buffer_object
+    if (bUseClusteredLights) return ClusterLight(i).positionRadius.xyz;
+#endif
+    return bUseUniformBlocks ? blockLightPositions[i].xyz : lightPositions[i];
+}
+
+vec3 LightColor(int i)
+{
+#ifdef GL_ARB_shader_storage_buffer_object
+    if (bUseClusteredLights) return ClusterLight(i).colorIntensity.rgb;
+#endif
+    return bUseUniformBlocks ? blockLightColors[i].rgb : lightColors[i];
+}
+
+float LightIntensity(int i)
+{
+#ifdef GL_ARB_shader_storage_buffer_object
+    if (bUseClusteredLights) return ClusterLight(i).colorIntensity.w;
+#endif
+    return bUseUniformBlocks ? blockLightPositions[i].w : lightIntensities[i];
+}
+
+// inverse square falloff, cut off at the radius of a clustered light
+float LightAttenuation(float intensity, float dist)
+{
+    float attenuation = intensity / (dist * dist + 1.0);
+    return bUseClusteredLights ? max(attenuation - lightCutoff, 0.0) : attenuation;
+}
+
+vec3  EyePosition()         { return bUseUniformBlocks ? frameViewPos.xyz : viewPos; }
+
+// --- Shader variants (ShaderManager::AddVariant) ---
+// A variant compiled with MATERIAL_PATH (one of the PATH_ values below)
+// and MATERIAL_PARALLAX (0 or 1) defined only has the code of that path;
+// the uber-shader without them branches on the material at run time.
+
+// --- Material table (SceneManager::SetMaterialTable) ---
+// With bUseMaterialTable set, the shader path and the material values
+// come from the record at materialIndex, so a draw switches material by
+// writing one int; otherwise from the mode toggles and uniforms above.
+const int MAX_MATERIALS = 256;
+
+struct MaterialRecord
+{
+    vec4 color;         // rgb object color, PBR tint or emissive color; a alpha
+    vec4 checker1;      // rgb first checker color, w emissive strength
+    vec4 checker2;      // rgb second checker color, w parallax scale (0 = off)
+    vec4 uvScalePath;   // xy UV scale, z shader path, w texture set
+};
+
+layout (std140) uniform MaterialBlock
+{
+    MaterialRecord materials[MAX_MATERIALS];
+};
+
+uniform bool bUseMaterialTable = false;
+uniform int  materialIndex     = 0;
+
+// shader paths of the record (DrawList::SHADER_MODE)
+const int PATH_CHECKERBOARD = 0;
+const int PATH_PBR          = 1;
+const int PATH_TEXTURE      = 2;
+const int PATH_COLOR        = 3;
+const int PATH_EMISSIVE     = 4;
+
+// material of the fragment, filled by LoadMaterial()
+struct Material
+{
+    bool  isEmissive;
+    bool  useCheckerboard;
+    bool  usePBR;
+    bool  useTexture;
+    bool  useParallax;
+    float parallaxScale;
+    vec4  color;            // objectColor, or emissive color and alpha
+    vec3  pbrTint;
+    vec2  uvScale;
+    vec3  checkerColor1;
+    vec3  checkerColor2;
+    float emissiveStrength;
+};
+
+Material material;
+
+void LoadMaterial()
+{
+    if (!bUseMaterialTable)
+    {
+        material.isEmissive       = bIsEmissive;
+        material.useCheckerboard  = bUseCheckerboard;
+        material.usePBR           = bUsePBR;
+        material.useTexture       = bUseTexture;
+        material.useParallax      = bUseParallax;
+        material.parallaxScale    = parallaxScale;
+        material.color            = bIsEmissive ? vec4(emissiveColor, emissiveAlpha) : objectColor;
+        material.pbrTint          = pbrTint;
+        material.uvScale          = UVscale;
+        material.checkerColor1    = checkerColor1;
+        material.checkerColor2    = checkerColor2;
+        material.emissiveStrength = emissiveStrength;
+        return;
+    }
+
+    MaterialRecord record = materials[materialIndex];
+    int path = int(record.uvScalePath.z + 0.5);
+
+    material.isEmissive       = path == PATH_EMISSIVE;
+    material.useCheckerboard  = path == PATH_CHECKERBOARD;
+    material.usePBR           = path == PATH_PBR;
+    material.useTexture       = path == PATH_TEXTURE;
+    material.useParallax      = record.checker2.w > 0.0;
+    material.parallaxScale    = record.checker2.w;
+    material.color            = record.color;
+    material.pbrTint          = record.color.rgb;
+    material.uvScale          = record.uvScalePath.xy;
+    material.checkerColor1    = record.checker1.rgb;
+    material.checkerColor2    = record.checker2.rgb;
+    material.emissiveStrength = record.checker1.w;
+}
+
+// the constant path of a variant, which leaves the branches of the other
+// paths as dead code
+void SelectVariantPath()
+{
+#ifdef MATERIAL_PATH
+    material.isEmissive      = MATERIAL_PATH == PATH_EMISSIVE;
+    material.useCheckerboard = MATERIAL_PATH == PATH_CHECKERBOARD;
+    material.usePBR          = MATERIAL_PATH == PATH_PBR;
+    material.useTexture      = MATERIAL_PATH == PATH_TEXTURE;
+#endif
+#ifdef MATERIAL_PARALLAX
+    material.useParallax     = MATERIAL_PARALLAX != 0;
+#endif
+}
+
 // ====================================================================
 // Cotangent-frame TBN (no tangent attribute required)
 // ====================================================================
@@ -80,6 +330,16 @@ mat3 CotangentFrame(vec3 N, vec3 p, vec2 uv)
     return mat3(T * invmax, B * invmax, N);
 }
 
+// ====================================================================
+// Vertex tangent TBN (MikkTSpace: B = sign * cross(N, T))
+// ====================================================================
+mat3 VertexTangentFrame(vec3 N)
+{
+    vec3 T = normalize(fragmentTangent.xyz - N * dot(N, fragmentTangent.xyz));
+    vec3 B = fragmentTangent.w * cross(N, T);
+    return mat3(T, B, N);
+}
+
 vec3 PerturbNormal(vec3 N, vec3 worldPos, vec2 uv)
 {
     vec3 mapNormal = texture(normalMap, uv).rgb * 2.0 - 1.0;
@@ -87,6 +347,12 @@ vec3 PerturbNormal(vec3 N, vec3 worldPos, vec2 uv)
     return normalize(TBN * mapNormal);
 }
 
+vec3 PerturbNormal(mat3 TBN, vec2 uv)
+{
+    vec3 mapNormal = texture(normalMap, uv).rgb * 2.0 - 1.0;
+    return normalize(TBN * mapNormal);
+}
+
 // ====================================================================
 // Parallax Occlusion Mapping
 // ====================================================================
@@ -98,7 +364,7 @@ vec2 ParallaxOcclusionMap(vec2 texCoords, vec3 viewDirTangent)
 
     float layerDepth    = 1.0 / numLayers;
     float currentDepth  = 0.0;
-    vec2  P             = viewDirTangent.xy * parallaxScale;
+    vec2  P             = viewDirTangent.xy * material.parallaxScale;
     vec2  deltaTexCoords = P / numLayers;
 
     vec2  currentTexCoords = texCoords;
@@ -159,9 +425,64 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0)
 vec3 HemisphereAmbient(vec3 N)
 {
     float blend = N.y * 0.5 + 0.5;
+    if (bUseUniformBlocks)
+    {
+        return mix(blockEnvColorBottom.rgb, blockEnvColorTop.rgb, blend) * blockEnvColorTop.w;
+    }
     return mix(envColorBottom, envColorTop, blend) * envIntensity;
 }
 
+// ====================================================================
+// Cook-Torrance over the lights, plus the hemisphere ambient
+// ====================================================================
+vec3 CookTorrance(vec3 albedo, float metallic, float roughness, float ao, vec3 N, vec3 V, vec3 fragPos)
+{
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+    vec3 ambient = HemisphereAmbient(N) * albedo * ao;
+
+    vec3 Lo = vec3(0.0);
+    int lightCount = LightCount();
+    int count = bUseClusteredLights ? lightCount : max(lightCount, 1);
+
+    for (int i = 0; i < count; ++i)
+    {
+        vec3  lPos       = (lightCount > 0) ? LightPosition(i) : lightPos;
+        vec3  lColor     = (lightCount > 0) ? LightColor(i)    : lightColor;
+        float lIntensity = (lightCount > 0) ? LightIntensity(i) : 30.0;
+
+        vec3  L    = lPos - fragPos;
+        float dist = length(L);
+        L = normalize(L);
+        vec3 H = normalize(V + L);
+
+        float attenuation = LightAttenuation(lIntensity, dist);
+        vec3  radiance    = lColor * attenuation;
+
+        float NDF = DistributionGGX(N, H, roughness);
+        float G   = GeometrySmith(N, V, L, roughness);
+        vec3  F   = FresnelSchlick(max(dot(H, V), 0.0), F0);
+
+        vec3  numerator   = NDF * G * F;
+        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+        vec3  specular    = numerator / denominator;
+
+        vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+
+        float NdotL = max(dot(N, L), 0.0);
+        Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+    }
+
+    return ambient + Lo;
+}
+
+// Reinhard tone mapping and gamma
+vec3 ToneMap(vec3 color)
+{
+    color = color / (color + vec3(1.0));
+    return pow(color, vec3(1.0 / 2.2));
+}
+
 // ====================================================================
 // Simple Blinn-Phong for non-PBR paths
 // ====================================================================
@@ -170,22 +491,21 @@ vec3 BlinnPhong(vec3 baseColor, vec3 N, vec3 fragPos)
     vec3 ambient = HemisphereAmbient(N) * baseColor * 0.3;
     vec3 result = ambient;
 
-    vec3 V = normalize(viewPos - fragPos);
-    int count = max(numLights, 1);
+    vec3 V = normalize(EyePosition() - fragPos);
+    int lightCount = LightCount();
+    int count = bUseClusteredLights ? lightCount : max(lightCount, 1);
 
-    for (int i = 0; i < MAX_LIGHTS; ++i)
+    for (int i = 0; i < count; ++i)
     {
-        if (i >= count) break;
-
-        vec3  lPos       = (numLights > 0) ? lightPositions[i] : lightPos;
-        vec3  lColor     = (numLights > 0) ? lightColors[i]    : lightColor;
-        float lIntensity = (numLights > 0) ? lightIntensities[i] : 30.0;
+        vec3  lPos       = (lightCount > 0) ? LightPosition(i) : lightPos;
+        vec3  lColor     = (lightCount > 0) ? LightColor(i)    : lightColor;
+        float lIntensity = (lightCount > 0) ? LightIntensity(i) : 30.0;
 
         vec3  L    = lPos - fragPos;
         float dist = length(L);
         L = normalize(L);
 
-        float attenuation = lIntensity / (dist * dist + 1.0);
+        float attenuation = LightAttenuation(lIntensity, dist);
         vec3  radiance    = lColor * attenuation;
 
         float diff = max(dot(N, L), 0.0);
@@ -200,50 +520,153 @@ vec3 BlinnPhong(vec3 baseColor, vec3 N, vec3 fragPos)
 }
 
 // ====================================================================
+// Deferred shading (SceneManager::SetDeferredShading)
+// ====================================================================
+// Compiled with GBUFFER_PASS, the lit paths store their surface in the
+// G-buffer instead of lighting it. Compiled with LIGHTING_PASS, main()
+// draws one full-screen triangle that lights each stored pixel once with
+// the functions above, so surfaces drawn over are never lit. Emissive
+// and transparent items are drawn forward on top.
+const float SURFACE_PBR   = 0.0;   // Cook-Torrance
+const float SURFACE_PHONG = 1.0;   // Blinn-Phong
+
+// Fold a unit normal onto the octahedron, two components in [-1, 1]
+vec2 EncodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+    {
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e;
+}
+
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void WriteGBuffer(vec3 albedo, float ao, float metallic, float roughness, vec3 N, float surfaceModel)
+{
+#ifdef GBUFFER_PASS
+    gbufferAlbedoOut  = vec4(pow(clamp(albedo, 0.0, 1.0), vec3(1.0 / 2.2)), ao);
+    gbufferSurfaceOut = vec4(metallic, roughness, surfaceModel, 0.0);
+    gbufferNormalOut  = EncodeOctahedral(N);
+#endif
+}
+
+#ifdef LIGHTING_PASS
+uniform sampler2D gbufferAlbedo;      // unit 6
+uniform sampler2D gbufferSurface;     // unit 7
+uniform sampler2D gbufferNormal;      // unit 8
+uniform sampler2D gbufferDepth;       // unit 9
+uniform mat4 inverseViewProjection;   // depth buffer to world space
+
 void main()
 {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gbufferDepth, pixel, 0).r;
+    if (depth >= 1.0)
+    {
+        discard;    // nothing stored, the clear color stays
+    }
+
+    vec4 albedoAO = texelFetch(gbufferAlbedo, pixel, 0);
+    vec4 surface  = texelFetch(gbufferSurface, pixel, 0);
+    vec3 N        = DecodeOctahedral(texelFetch(gbufferNormal, pixel, 0).xy);
+    vec3 albedo   = pow(albedoAO.rgb, vec3(2.2));
+
+    vec2 ndc      = gl_FragCoord.xy / vec2(textureSize(gbufferDepth, 0)) * 2.0 - 1.0;
+    vec4 world    = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    vec3 fragPos  = world.xyz / world.w;
+    SelectCluster(fragPos);
+
+    vec3 color;
+    if (surface.b > 0.5)
+    {
+        color = BlinnPhong(albedo, N, fragPos);
+    }
+    else
+    {
+        vec3 V = normalize(EyePosition() - fragPos);
+        color = CookTorrance(albedo, surface.r, surface.g, albedoAO.a, N, V, fragPos);
+    }
+
+    outFragmentColor = vec4(ToneMap(color), 1.0);
+    gl_FragDepth     = depth;
+}
+#else
+// ====================================================================
+void main()
+{
+    LoadMaterial();
+    SelectVariantPath();
+    SelectCluster(fragmentPosition);
+
     // ----------------------------------------------------------------
     // PATH -1: Emissive (lightbulbs, neon — bypass all lighting)
     // ----------------------------------------------------------------
-    if (bIsEmissive)
+    if (material.isEmissive)
     {
-        vec3 hdr = emissiveColor * emissiveStrength;
+#ifdef GBUFFER_PASS
+        discard;    // drawn forward after the lighting pass
+#endif
+        vec3 hdr = material.color.rgb * fragmentTint.rgb * material.emissiveStrength;
         vec3 ldr = hdr / (hdr + vec3(1.0));        // Reinhard
         ldr = pow(ldr, vec3(1.0 / 2.2));           // gamma
-        outFragmentColor = vec4(ldr, emissiveAlpha);
+        outFragmentColor = vec4(ldr, material.color.a * fragmentTint.a);
         return;
     }
 
     // ----------------------------------------------------------------
     // PATH 0: Procedural checkerboard (with simple lighting)
     // ----------------------------------------------------------------
-    if (bUseCheckerboard)
+    if (material.useCheckerboard)
     {
-        vec2 uv = fragmentTextureCoordinate * UVscale;
+        vec2 uv = fragmentTextureCoordinate * material.uvScale * fragmentUVScale;
         float checker = mod(floor(uv.x) + floor(uv.y), 2.0);
-        vec3 baseColor = mix(checkerColor1, checkerColor2, checker);
+        vec3 baseColor = mix(material.checkerColor1, material.checkerColor2, checker);
 
         vec3 N = normalize(fragmentVertexNormal);
+#ifdef GBUFFER_PASS
+        WriteGBuffer(baseColor, 1.0, 0.0, 1.0, N, SURFACE_PHONG);
+        return;
+#endif
         vec3 lit = BlinnPhong(baseColor, N, fragmentPosition);
-        lit = lit / (lit + vec3(1.0));
-        lit = pow(lit, vec3(1.0 / 2.2));
-        outFragmentColor = vec4(lit, 1.0);
+        outFragmentColor = vec4(ToneMap(lit), 1.0);
         return;
     }
 
     // ----------------------------------------------------------------
     // PATH 1: PBR textures with Cook-Torrance lighting + parallax
     // ----------------------------------------------------------------
-    if (bUsePBR)
+    if (material.usePBR)
     {
         vec3 N = normalize(fragmentVertexNormal);
-        vec3 V = normalize(viewPos - fragmentPosition);
+        vec3 V = normalize(EyePosition() - fragmentPosition);
 
-        vec2 uv = fragmentTextureCoordinate * UVscale;
+        vec2 uv = fragmentTextureCoordinate * material.uvScale * fragmentUVScale;
+
+        // With vertex tangents the frame is built once and shared by
+        // parallax and normal mapping; otherwise each rebuilds it from
+        // derivatives of its own UVs
+        mat3 TBN = mat3(1.0);
+        if (bUseVertexTangents)
+        {
+            TBN = VertexTangentFrame(N);
+        }
 
-        if (bUseParallax)
+        if (material.useParallax)
         {
-            mat3 TBN = CotangentFrame(N, fragmentPosition, uv);
+            if (!bUseVertexTangents)
+            {
+                TBN = CotangentFrame(N, fragmentPosition, uv);
+            }
             vec3 viewDirTangent = normalize(transpose(TBN) * V);
             uv = ParallaxOcclusionMap(uv, viewDirTangent);
             // No discard — textures use GL_REPEAT so wrapping is seamless.
@@ -251,56 +674,26 @@ void main()
             // offsets push UVs slightly out of the nominal range.
         }
 
-        vec3  albedo    = pow(texture(albedoMap, uv).rgb, vec3(2.2)) * pbrTint;
+        vec3  albedo    = pow(texture(albedoMap, uv).rgb, vec3(2.2)) * material.pbrTint * fragmentTint.rgb;
         float metallic  = texture(metallicMap, uv).r;
         float roughness = clamp(texture(roughnessMap, uv).r, 0.05, 1.0);
         float ao        = texture(aoMap, uv).r;
 
-        N = PerturbNormal(N, fragmentPosition, uv);
-
-        vec3 F0 = mix(vec3(0.04), albedo, metallic);
-
-        vec3 ambient = HemisphereAmbient(N) * albedo * ao;
-
-        vec3 Lo = vec3(0.0);
-        int count = max(numLights, 1);
-
-        for (int i = 0; i < MAX_LIGHTS; ++i)
+        if (bUseVertexTangents)
         {
-            if (i >= count) break;
-
-            vec3  lPos       = (numLights > 0) ? lightPositions[i] : lightPos;
-            vec3  lColor     = (numLights > 0) ? lightColors[i]    : lightColor;
-            float lIntensity = (numLights > 0) ? lightIntensities[i] : 30.0;
-
-            vec3  L    = lPos - fragmentPosition;
-            float dist = length(L);
-            L = normalize(L);
-            vec3 H = normalize(V + L);
-
-            float attenuation = lIntensity / (dist * dist + 1.0);
-            vec3  radiance    = lColor * attenuation;
-
-            float NDF = DistributionGGX(N, H, roughness);
-            float G   = GeometrySmith(N, V, L, roughness);
-            vec3  F   = FresnelSchlick(max(dot(H, V), 0.0), F0);
-
-            vec3  numerator   = NDF * G * F;
-            float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-            vec3  specular    = numerator / denominator;
-
-            vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
-
-            float NdotL = max(dot(N, L), 0.0);
-            Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+            N = PerturbNormal(TBN, uv);
+        }
+        else
+        {
+            N = PerturbNormal(N, fragmentPosition, uv);
         }
 
-        vec3 color = ambient + Lo;
-
-        color = color / (color + vec3(1.0));
-        color = pow(color, vec3(1.0 / 2.2));
-
-        outFragmentColor = vec4(color, 1.0);
+#ifdef GBUFFER_PASS
+        WriteGBuffer(albedo, ao, metallic, roughness, N, SURFACE_PBR);
+        return;
+#endif
+        vec3 color = CookTorrance(albedo, metallic, roughness, ao, N, V, fragmentPosition);
+        outFragmentColor = vec4(ToneMap(color), 1.0);
         return;
     }
 
@@ -310,22 +703,24 @@ void main()
     vec3 baseColor;
     float alpha = 1.0;
 
-    if (bUseTexture)
+    if (material.useTexture)
     {
-        vec4 texSample = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+        vec4 texSample = texture(objectTexture, fragmentTextureCoordinate * material.uvScale * fragmentUVScale);
         baseColor = texSample.rgb;
         alpha     = texSample.a;
     }
     else
     {
-        baseColor = objectColor.rgb;
-        alpha     = objectColor.a;
+        baseColor = material.color.rgb * fragmentTint.rgb;
+        alpha     = material.color.a * fragmentTint.a;
     }
 
     vec3 N = normalize(fragmentVertexNormal);
+#ifdef GBUFFER_PASS
+    WriteGBuffer(baseColor, 1.0, 0.0, 1.0, N, SURFACE_PHONG);
+    return;
+#endif
     vec3 lit = BlinnPhong(baseColor, N, fragmentPosition);
-    lit = lit / (lit + vec3(1.0));
-    lit = pow(lit, vec3(1.0 / 2.2));
-
-    outFragmentColor = vec4(lit, alpha);
+    outFragmentColor = vec4(ToneMap(lit), alpha);
 }
+#endif
@@ -5,27 +5,121 @@ layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
 
+// Optional tangent stream (ShapeMeshes::SetTangentGeneration): xyz along
+// +u, w the handedness of the bitangent. Only read by the fragment shader
+// when bUseVertexTangents is set.
+layout (location = 3) in vec4 inVertexTangent;
+
+// Vertex decode, constant for each mesh (ShapeMeshes sets these with
+// glVertexAttrib). The packed layout stores positions in [-1, 1] within
+// the mesh bounds and normals octahedral encoded in xy, flagged by
+// scale.w = 1; float vertices come with scale (1, 1, 1, 0) and offset 0.
+layout (location = 14) in vec4 inPositionDecodeScale;
+layout (location = 15) in vec3 inPositionDecodeOffset;
+
+// Per-instance attributes (ShapeMeshes instance buffer), only read
+// when bUseInstancing is set
+layout (location = 8)  in mat4 inInstanceModel;      // locations 8-11
+layout (location = 12) in vec2 inInstanceUVScale;
+layout (location = 13) in vec4 inInstanceTint;
+
+// Per-draw values of an ordinary draw, read from a range of the
+// SceneManager stream buffer when bUseDrawBlock is set; they take the
+// place of the model uniform and of the per-instance attributes
+layout (std140) uniform DrawBlock
+{
+    mat4 drawModel;
+    vec4 drawTint;
+    vec4 drawUVScale;    // xy used
+};
+
+// Camera of the frame, read when bUseUniformBlocks is set (declared the
+// same way in the fragment shader)
+layout (std140) uniform FrameBlock
+{
+    mat4 frameView;
+    mat4 frameProjection;
+    vec4 frameViewPos;    // xyz used
+};
+
 // Outputs to fragment shader
 out vec3 fragmentPosition;       // world-space position
 out vec3 fragmentVertexNormal;   // world-space normal
 out vec2 fragmentTextureCoordinate;
+out vec4 fragmentTangent;        // world-space tangent, w = bitangent sign
+flat out vec2 fragmentUVScale;   // per-instance UV scale (1 when not instanced)
+flat out vec4 fragmentTint;      // per-instance color tint (1 when not instanced)
 
 // Uniforms
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool bUseInstancing = false;
+uniform bool bUseDrawBlock = false;
+uniform bool bUseUniformBlocks = false;
+
+// Unfold an octahedral encoded normal
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
+#ifdef LIGHTING_PASS
+    // the deferred lighting pass draws one triangle covering the
+    // screen, from three vertices without attributes
+    gl_Position = vec4(vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0, 0.0, 1.0);
+    return;
+#endif
+
+    vec3 position = inPositionDecodeOffset + inPositionDecodeScale.xyz * inVertexPosition;
+    vec3 normal = (inPositionDecodeScale.w > 0.5) ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+
+    mat4 world = model;
+    fragmentUVScale = vec2(1.0);
+    fragmentTint    = vec4(1.0);
+
+    if (bUseInstancing)
+    {
+        // Instanced draws take the model matrix from the instance stream
+        world = inInstanceModel;
+        fragmentUVScale = inInstanceUVScale;
+        fragmentTint    = inInstanceTint;
+    }
+    else if (bUseDrawBlock)
+    {
+        world = drawModel;
+        fragmentUVScale = drawUVScale.xy;
+        fragmentTint    = drawTint;
+    }
+
     // World-space fragment position
-    fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
+    fragmentPosition = vec3(world * vec4(position, 1.0));
 
     // Transform normal to world space (use normal matrix for non-uniform scale)
-    fragmentVertexNormal = normalize(mat3(transpose(inverse(model))) * inVertexNormal);
+    fragmentVertexNormal = normalize(mat3(transpose(inverse(world))) * normal);
+
+    // Tangents follow the surface, so they take the model matrix itself;
+    // a mirroring transform flips the handedness
+    mat3 world3 = mat3(world);
+    fragmentTangent = vec4(world3 * inVertexTangent.xyz,
+                           inVertexTangent.w * sign(determinant(world3)));
 
     // Pass through texture coordinates
     fragmentTextureCoordinate = inTextureCoordinate;
 
     // Final clip-space position
-    gl_Position = projection * view * vec4(fragmentPosition, 1.0);
+    if (bUseUniformBlocks)
+    {
+        gl_Position = frameProjection * frameView * vec4(fragmentPosition, 1.0);
+    }
+    else
+    {
+        gl_Position = projection * view * vec4(fragmentPosition, 1.0);
+    }
 }
@@ -0,0 +1,163 @@
+#version 430 core
+
+// GL 4.3 variant of vertexShader.glsl for multi-draw indirect submission.
+// Ordinary and instanced draws behave exactly as in the 3.3 shader; when
+// bUseIndirect is set, every draw of a glMultiDrawElementsIndirect call
+// takes its transform, UV scale, tint and vertex decode from its record
+// in the DrawRecords storage buffer (ShapeMeshes::DrawIndirect).
+
+// Input attributes (matches ShapeMeshes memory layout: pos, normal, UV)
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// Optional tangent stream (ShapeMeshes::SetTangentGeneration): xyz along
+// +u, w the handedness of the bitangent. Only read by the fragment shader
+// when bUseVertexTangents is set.
+layout (location = 3) in vec4 inVertexTangent;
+
+// Index of the draw record, advancing once per instance. Each indirect
+// command draws one instance starting at its record, so the base instance
+// selects the record.
+layout (location = 4) in uint inDrawIndex;
+
+// Vertex decode, constant for each mesh (ShapeMeshes sets these with
+// glVertexAttrib). The packed layout stores positions in [-1, 1] within
+// the mesh bounds and normals octahedral encoded in xy, flagged by
+// scale.w = 1; float vertices come with scale (1, 1, 1, 0) and offset 0.
+layout (location = 14) in vec4 inPositionDecodeScale;
+layout (location = 15) in vec3 inPositionDecodeOffset;
+
+// Per-instance attributes (ShapeMeshes instance buffer), only read
+// when bUseInstancing is set
+layout (location = 8)  in mat4 inInstanceModel;      // locations 8-11
+layout (location = 12) in vec2 inInstanceUVScale;
+layout (location = 13) in vec4 inInstanceTint;
+
+// Per-draw records of an indirect call (ShapeMeshes::INDIRECT_DRAW)
+struct DrawRecord
+{
+    mat4 model;
+    vec4 tint;
+    vec2 uvScale;
+    vec4 decodeScale;
+    vec4 decodeOffset;
+};
+
+layout (std430, binding = 0) readonly buffer DrawRecords
+{
+    DrawRecord draws[];
+};
+
+// Per-draw values of an ordinary draw, read from a range of the
+// SceneManager stream buffer when bUseDrawBlock is set; they take the
+// place of the model uniform and of the per-instance attributes
+layout (std140) uniform DrawBlock
+{
+    mat4 drawModel;
+    vec4 drawTint;
+    vec4 drawUVScale;    // xy used
+};
+
+// Camera of the frame, read when bUseUniformBlocks is set (declared the
+// same way in the fragment shader)
+layout (std140) uniform FrameBlock
+{
+    mat4 frameView;
+    mat4 frameProjection;
+    vec4 frameViewPos;    // xyz used
+};
+
+// Outputs to fragment shader
+out vec3 fragmentPosition;       // world-space position
+out vec3 fragmentVertexNormal;   // world-space normal
+out vec2 fragmentTextureCoordinate;
+out vec4 fragmentTangent;        // world-space tangent, w = bitangent sign
+flat out vec2 fragmentUVScale;   // per-instance UV scale (1 when not instanced)
+flat out vec4 fragmentTint;      // per-instance color tint (1 when not instanced)
+
+// Uniforms
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool bUseInstancing = false;
+uniform bool bUseDrawBlock = false;
+uniform bool bUseUniformBlocks = false;
+uniform bool bUseIndirect = false;
+
+// Unfold an octahedral encoded normal
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+#ifdef LIGHTING_PASS
+    // the deferred lighting pass draws one triangle covering the
+    // screen, from three vertices without attributes
+    gl_Position = vec4(vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0, 0.0, 1.0);
+    return;
+#endif
+
+    vec4 decodeScale = inPositionDecodeScale;
+    vec3 decodeOffset = inPositionDecodeOffset;
+    mat4 world = model;
+    fragmentUVScale = vec2(1.0);
+    fragmentTint    = vec4(1.0);
+
+    if (bUseIndirect)
+    {
+        DrawRecord record = draws[inDrawIndex];
+        decodeScale  = record.decodeScale;
+        decodeOffset = record.decodeOffset.xyz;
+        world        = record.model;
+        fragmentUVScale = record.uvScale;
+        fragmentTint    = record.tint;
+    }
+    else if (bUseInstancing)
+    {
+        // Instanced draws take the model matrix from the instance stream
+        world = inInstanceModel;
+        fragmentUVScale = inInstanceUVScale;
+        fragmentTint    = inInstanceTint;
+    }
+    else if (bUseDrawBlock)
+    {
+        world = drawModel;
+        fragmentUVScale = drawUVScale.xy;
+        fragmentTint    = drawTint;
+    }
+
+    vec3 position = decodeOffset + decodeScale.xyz * inVertexPosition;
+    vec3 normal = (decodeScale.w > 0.5) ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+
+    // World-space fragment position
+    fragmentPosition = vec3(world * vec4(position, 1.0));
+
+    // Transform normal to world space (use normal matrix for non-uniform scale)
+    fragmentVertexNormal = normalize(mat3(transpose(inverse(world))) * normal);
+
+    // Tangents follow the surface, so they take the model matrix itself;
+    // a mirroring transform flips the handedness
+    mat3 world3 = mat3(world);
+    fragmentTangent = vec4(world3 * inVertexTangent.xyz,
+                           inVertexTangent.w * sign(determinant(world3)));
+
+    // Pass through texture coordinates
+    fragmentTextureCoordinate = inTextureCoordinate;
+
+    // Final clip-space position
+    if (bUseUniformBlocks)
+    {
+        gl_Position = frameProjection * frameView * vec4(fragmentPosition, 1.0);
+    }
+    else
+    {
+        gl_Position = projection * view * vec4(fragmentPosition, 1.0);
+    }
+}